@@ -1,16 +1,22 @@
 #include "App.h"
 
+#include "gen/shaders/Resolve.h"
 #include "gen/shaders/Shader.h"
-#include "Mesh.h"
+#include "Image.h"
+#include "LoadQueue.h"
+#include "MeshOptimizer.h"
+#include "Mipmap.h"
+#include "SceneIR.h"
 
 #include <d3dx12.h>
-#include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
 
 #include <algorithm>
 #include <chrono>
-#include <random>
+#include <functional>
+#include <iostream>
 #include <span>
+#include <string>
 #include <vector>
 
 using winrt::com_ptr;
@@ -23,7 +29,6 @@ static const wchar_t* const kMissShaderName = L"MissShader";
 
 static const wchar_t* const kHitGroupName = L"HitGroup";
 
-static const wchar_t* const kVisibilityClosestHitShaderName = L"VisibilityClosestHitShader";
 static const wchar_t* const kVisibilityMissShaderName = L"VisibilityMissShader";
 
 static const wchar_t* const kVisibilityHitGroupName = L"VisibilityHitGroup";
@@ -33,7 +38,13 @@ static const wchar_t* const kLightClosestHitShaderName = L"LightClosestHitShader
 
 static const wchar_t* const kLightHitGroupName = L"LightHitGroup";
 
-App::App(HWND hwnd) : m_hwnd(hwnd)
+// Meshes in a SceneIR have no names of their own.
+static std::string GetMeshName(uint32_t meshIdx)
+{
+    return "mesh " + std::to_string(meshIdx);
+}
+
+App::App(HWND hwnd, const AppOptions& options) : m_hwnd(hwnd), m_options(options)
 {
     CreateDevice();
 
@@ -47,6 +58,8 @@ App::App(HWND hwnd) : m_hwnd(hwnd)
 
     CreatePipeline();
 
+    CreateResolvePipeline();
+
     LoadScene();
 
     CreateAccelerationStructures();
@@ -149,8 +162,9 @@ void App::CreatePipeline()
     {
         D3D12_DESCRIPTOR_RANGE1 ranges[Global::Range::NUM_RANGES] = {};
 
+        // The film and its compensation.
         ranges[Global::Range::Film].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
-        ranges[Global::Range::Film].NumDescriptors = 1;
+        ranges[Global::Range::Film].NumDescriptors = 2;
         ranges[Global::Range::Film].BaseShaderRegister = 0;
 
         ranges[Global::Range::Sampler].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER;
@@ -170,7 +184,8 @@ void App::CreatePipeline()
         params[Global::Param::DrawConstants].ParameterType =
             D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
         params[Global::Param::DrawConstants].Constants.ShaderRegister = 0;
-        params[Global::Param::DrawConstants].Constants.Num32BitValues = 1;
+        params[Global::Param::DrawConstants].Constants.Num32BitValues =
+            sizeof(DrawConstants) / sizeof(uint32_t);
 
         params[Global::Param::Sampler].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
         params[Global::Param::Sampler].DescriptorTable.NumDescriptorRanges = 1;
@@ -186,6 +201,20 @@ void App::CreatePipeline()
         params[Global::Param::HaltonPerms].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
         params[Global::Param::HaltonPerms].Descriptor.ShaderRegister = 3;
 
+        params[Global::Param::SobolMatrices].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+        params[Global::Param::SobolMatrices].Descriptor.ShaderRegister = 4;
+
+        params[Global::Param::LightAliasTable].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+        params[Global::Param::LightAliasTable].Descriptor.ShaderRegister = 5;
+
+        params[Global::Param::LightBvh].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+        params[Global::Param::LightBvh].Descriptor.ShaderRegister = 6;
+
+        params[Global::Param::Camera].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+        params[Global::Param::Camera].Constants.ShaderRegister = 1;
+        params[Global::Param::Camera].Constants.Num32BitValues =
+            sizeof(CameraConstants) / sizeof(uint32_t);
+
         D3D12_VERSIONED_ROOT_SIGNATURE_DESC rootSigDesc{};
         rootSigDesc.Version = D3D_ROOT_SIGNATURE_VERSION_1_1;
         rootSigDesc.Desc_1_1.NumParameters = _countof(params);
@@ -257,7 +286,6 @@ void App::CreatePipeline()
     dxilExports.push_back({kRayGenShaderName, nullptr, D3D12_EXPORT_FLAG_NONE});
     dxilExports.push_back({kClosestHitShaderName, nullptr, D3D12_EXPORT_FLAG_NONE});
     dxilExports.push_back({kMissShaderName, nullptr, D3D12_EXPORT_FLAG_NONE});
-    dxilExports.push_back({kVisibilityClosestHitShaderName, nullptr, D3D12_EXPORT_FLAG_NONE});
     dxilExports.push_back({kVisibilityMissShaderName, nullptr, D3D12_EXPORT_FLAG_NONE});
     dxilExports.push_back({kSphereIntersectShaderName, nullptr, D3D12_EXPORT_FLAG_NONE});
     dxilExports.push_back({kLightClosestHitShaderName, nullptr, D3D12_EXPORT_FLAG_NONE});
@@ -296,10 +324,11 @@ void App::CreatePipeline()
     subObjs[SubObj::HitGroup].Type = D3D12_STATE_SUBOBJECT_TYPE_HIT_GROUP;
     subObjs[SubObj::HitGroup].pDesc = &hitGroupDesc;
 
+    // Visibility rays end at the first hit and skip the closest hit shader, so their hit group
+    // has no shaders at all.
     D3D12_HIT_GROUP_DESC visibilityHitGroupDesc{};
     visibilityHitGroupDesc.HitGroupExport = kVisibilityHitGroupName;
     visibilityHitGroupDesc.Type = D3D12_HIT_GROUP_TYPE_TRIANGLES;
-    visibilityHitGroupDesc.ClosestHitShaderImport = kVisibilityClosestHitShaderName;
 
     subObjs[SubObj::VisibilityHitGroup].Type = D3D12_STATE_SUBOBJECT_TYPE_HIT_GROUP;
     subObjs[SubObj::VisibilityHitGroup].pDesc = &visibilityHitGroupDesc;
@@ -344,67 +373,149 @@ struct Mat3x4
 
 } // namespace
 
+void App::CreateResolvePipeline()
+{
+    D3D12_DESCRIPTOR_RANGE1 range{};
+    range.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+    range.NumDescriptors = 3;
+    range.BaseShaderRegister = 0;
+
+    D3D12_ROOT_PARAMETER1 param{};
+    param.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+    param.DescriptorTable.NumDescriptorRanges = 1;
+    param.DescriptorTable.pDescriptorRanges = &range;
+
+    D3D12_VERSIONED_ROOT_SIGNATURE_DESC rootSigDesc{};
+    rootSigDesc.Version = D3D_ROOT_SIGNATURE_VERSION_1_1;
+    rootSigDesc.Desc_1_1.NumParameters = 1;
+    rootSigDesc.Desc_1_1.pParameters = &param;
+    rootSigDesc.Desc_1_1.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+
+    com_ptr<ID3DBlob> signatureBlob;
+    com_ptr<ID3DBlob> errorBlob;
+    check_hresult(D3D12SerializeVersionedRootSignature(&rootSigDesc, signatureBlob.put(),
+                                                       errorBlob.put()));
+    check_hresult(m_device->CreateRootSignature(0, signatureBlob->GetBufferPointer(),
+                                                signatureBlob->GetBufferSize(),
+                                                IID_PPV_ARGS(m_resolveRootSig.put())));
+
+    D3D12_COMPUTE_PIPELINE_STATE_DESC pipelineDesc{};
+    pipelineDesc.pRootSignature = m_resolveRootSig.get();
+    pipelineDesc.CS.pShaderBytecode = g_resolveShader;
+    pipelineDesc.CS.BytecodeLength = ARRAYSIZE(g_resolveShader);
+
+    check_hresult(
+        m_device->CreateComputePipelineState(&pipelineDesc, IID_PPV_ARGS(m_resolvePipeline.put())));
+}
+
 void App::LoadScene()
 {
-    m_geometries.resize(3);
+    ThreadPool pool;
+
+    SceneIR scene = LoadSceneIR(m_options.Scene, &pool);
 
-    LoadGeometry("scenes/pbrt-book/geometry/mesh_00002.ply",
-                 "scenes/pbrt-book/texture/book_pages.png", &m_geometries[0]);
+    m_camera = scene.Camera;
 
-    LoadGeometry("scenes/pbrt-book/geometry/mesh_00003.ply",
-                 "scenes/pbrt-book/texture/book_pbrt.png", &m_geometries[1]);
+    // Each mesh and texture is uploaded once and shared by the geometries that use it.
+    std::vector<Geometry> meshes(scene.Meshes.size());
+    std::vector<com_ptr<ID3D12Resource>> textures(scene.Textures.size());
 
-    LoadGeometry("scenes/pbrt-book/geometry/mesh_00001.ply", std::nullopt, &m_geometries[2]);
+    {
+        std::vector<GeometryUpload> uploads(meshes.size());
+        std::vector<Image> images(textures.size());
+
+        // Indexed by job. Run on this thread, in the order the decode jobs complete.
+        std::vector<std::function<void()>> uploadSteps;
+
+        LoadQueue queue(&pool);
+
+        for (uint32_t i = 0; i < meshes.size(); ++i)
+        {
+            queue.Add(GetMeshName(i), [&, i] { DecodeGeometry(scene, i, &uploads[i]); });
+
+            uploadSteps.push_back([&, i] { UploadGeometry(uploads[i], &meshes[i]); });
+        }
+
+        for (uint32_t i = 0; i < textures.size(); ++i)
+        {
+            queue.Add(scene.GetTexturePath(i).filename().string(), [&, i] {
+                images[i] = DecodeImage(scene.GetTexturePath(i));
+            });
+
+            // The levels of a mip are filtered in parallel, so this can't run on a worker.
+            uploadSteps.push_back([&, i] {
+                TextureUpload upload;
+                m_resourceManager->CopyMipChainToUpload(BuildMipChain(std::move(images[i]), &pool),
+                                                        &upload);
+
+                textures[i] = m_resourceManager->CreateTextureFromUpload(upload);
+            });
+        }
+
+        size_t jobIdx = 0;
+
+        while (queue.WaitNext(&jobIdx))
+            uploadSteps[jobIdx]();
+    }
 
-    glm::mat4 transforms[3] = {};
+    m_geometries.resize(scene.Instances.size());
 
-    transforms[0] = glm::translate(glm::mat4(1.f), glm::vec3(0.f, 2.2f, 0.f)) *
-                    glm::rotate(glm::mat4(1.f), 1.35f, glm::vec3(0.403f, -0.755f, -0.517f)) *
-                    glm::scale(glm::mat4(1.f), glm::vec3(0.5f));
+    for (size_t i = 0; i < m_geometries.size(); ++i)
+    {
+        const SceneIRInstance& instance = scene.Instances[i];
+        uint32_t textureIdx = scene.Materials[instance.MaterialIdx].TextureIdx;
 
-    transforms[1] = glm::translate(glm::mat4(1.f), glm::vec3(0.f, 2.2f, 0.f)) *
-                    glm::rotate(glm::mat4(1.f), 1.35f, glm::vec3(0.403f, -0.755f, -0.517f)) *
-                    glm::scale(glm::mat4(1.f), glm::vec3(0.5f));
+        m_geometries[i] = meshes[instance.MeshIdx];
 
-    transforms[2] = glm::scale(glm::mat4(1.f), glm::vec3(0.213f));
+        if (textureIdx != kSceneIRNoTexture)
+            m_geometries[i].Texture = textures[textureIdx];
+    }
 
     {
         m_transformBuffer = m_resourceManager->CreateUploadBuffer(
-            sizeof(Mat3x4) * m_geometries.size());
+            sizeof(Mat3x4) * scene.Transforms.size());
 
         auto it = UploadIterator<Mat3x4>(m_transformBuffer.get());
 
-        for (size_t i = 0; i < m_geometries.size(); ++i)
+        for (const glm::mat4& objectToWorld : scene.Transforms)
         {
-            glm::mat4 transform = glm::transpose(transforms[i]);
+            glm::mat4 transform = glm::transpose(objectToWorld);
 
             it->Rows[0] = transform[0];
             it->Rows[1] = transform[1];
             it->Rows[2] = transform[2];
 
-            m_geometries[i].Transform = it.GetGpuAddress();
-
             ++it;
         }
+
+        for (size_t i = 0; i < m_geometries.size(); ++i)
+        {
+            m_geometries[i].Transform = m_transformBuffer->GetGPUVirtualAddress() +
+                                        sizeof(Mat3x4) * scene.Instances[i].TransformIdx;
+        }
     }
 
     {
-        m_hitGroupGeomConstantsBuffer =
-            m_resourceManager->CreateUploadBuffer(sizeof(HitGroupGeometryConstants) * 3);
+        m_hitGroupGeomConstantsBuffer = m_resourceManager->CreateUploadBuffer(
+            sizeof(HitGroupGeometryConstants) * m_geometries.size());
 
         auto it = UploadIterator<HitGroupGeometryConstants>(m_hitGroupGeomConstantsBuffer.get());
 
-        it->IsTextured = 1;
-        it->NormalMatrix = glm::mat4(glm::inverseTranspose(glm::mat3(transforms[0])));
-        ++it;
+        for (size_t i = 0; i < m_geometries.size(); ++i)
+        {
+            const SceneIRInstance& instance = scene.Instances[i];
+            const glm::mat4& transform = scene.Transforms[instance.TransformIdx];
 
-        it->IsTextured = 1;
-        it->NormalMatrix = glm::mat4(glm::inverseTranspose(glm::mat3(transforms[1])));
-        ++it;
+            bool isTextured =
+                scene.Materials[instance.MaterialIdx].TextureIdx != kSceneIRNoTexture;
 
-        it->IsTextured = 0;
-        it->NormalMatrix = glm::mat4(glm::inverseTranspose(glm::mat3(transforms[2])));
-        ++it;
+            it->IsTextured = isTextured ? 1 : 0;
+            it->UVLodOffset = isTextured ? GetUVLodOffset(scene, static_cast<uint32_t>(i)) : 0.f;
+            it->NormalMatrix = glm::mat4(glm::inverseTranspose(glm::mat3(transform)));
+            it->VertexLayout = static_cast<uint32_t>(m_geometries[i].Layout);
+            it->IndexSize = m_geometries[i].IndexSize;
+            ++it;
+        }
     }
 
     {
@@ -419,39 +530,134 @@ void App::LoadScene()
         m_aabbBuffer = m_resourceManager->CreateBufferAndUpload(std::span(&lightAabb, 1));
     }
 
+    m_lightBuffer = m_resourceManager->CreateBufferAndUpload(scene.Lights);
+    m_lightCount = static_cast<uint32_t>(scene.Lights.size());
+
+    LightSamplerTables lightTables = BuildLightSamplerTables(scene.Lights);
+
+    m_lightAliasTable = m_resourceManager->CreateBufferAndUpload(std::span(lightTables.AliasTable));
+    m_lightBvh = m_resourceManager->CreateBufferAndUpload(std::span(lightTables.Bvh));
+}
+
+void App::DecodeGeometry(const SceneIR& scene, uint32_t meshIdx, GeometryUpload* upload)
+{
+    const SceneIRMesh& source = scene.Meshes[meshIdx];
+
+    std::span<const glm::vec3> positions = scene.GetVertices(scene.Positions, source);
+    std::span<const glm::vec3> normals = scene.GetVertices(scene.Normals, source);
+    std::span<const glm::vec2> uvs = scene.GetVertices(scene.UVs, source);
+    std::span<const uint32_t> indices = scene.GetIndices(source);
+
+    upload->VertexCount = source.VertexCount;
+    upload->IndexCount = source.IndexCount;
+
+    if (m_options.Vertices.Layout == VertexLayout::Separate && !m_options.OptimizeMeshes)
     {
-        m_lightBuffer = m_resourceManager->CreateUploadBuffer(sizeof(SphereLight) * 2);
+        // The mesh is copied straight from the scene, which may be a mapped snapshot, into the
+        // upload buffers.
+        auto copyToUpload = [&]<typename T>(std::span<const T> data, size_t* size) {
+            std::span<T> mapped;
+            com_ptr<ID3D12Resource> buffer =
+                m_resourceManager->CreateUploadBufferAndMap(data.size(), &mapped);
+            std::copy(data.begin(), data.end(), mapped.begin());
 
-        auto it = UploadIterator<SphereLight>(m_lightBuffer.get());
+            *size = mapped.size_bytes();
 
-        it->Position = glm::vec3(34.92f, 55.92f, -15.351f);
-        it->Radius = 7.5f;
-        it->L = glm::vec3(41.5594f, 43.3127f, 45.066f);
-        ++it;
+            return buffer;
+        };
 
-        it->Position = glm::vec3(-32.892f, 55.92f, 36.293f);
-        it->Radius = 7.5f;
-        it->L = glm::vec3(65.066f, 63.3127f, 61.5594f);
-        ++it;
+        upload->Positions = copyToUpload(positions, &upload->PositionsSize);
+        upload->Normals = copyToUpload(normals, &upload->NormalsSize);
+        upload->UVs = copyToUpload(uvs, &upload->UVsSize);
+        upload->Indices = copyToUpload(indices, &upload->IndicesSize);
+
+        return;
+    }
+
+    // Optimized meshes and packed layouts are converted from a full mesh, so they can't be copied
+    // in place.
+    Mesh mesh{};
+    mesh.Positions.assign(positions.begin(), positions.end());
+    mesh.Normals.assign(normals.begin(), normals.end());
+    mesh.UVs.assign(uvs.begin(), uvs.end());
+    mesh.Indices.assign(indices.begin(), indices.end());
+
+    if (m_options.OptimizeMeshes)
+    {
+        MeshOptimizationStats stats{};
+        OptimizeMesh(&mesh, &stats);
+
+        std::cout << GetMeshName(meshIdx) << ": " << stats.VerticesBefore << " -> "
+                  << stats.VerticesAfter << " vertices, ACMR " << stats.AcmrBefore << " -> "
+                  << stats.AcmrAfter << "\n";
     }
+
+    PackedMesh packed = PackMesh(mesh, m_options.Vertices);
+
+    auto createUpload = [&](const std::vector<std::byte>& data, size_t* size) {
+        if (data.empty())
+            return com_ptr<ID3D12Resource>();
+
+        std::span<std::byte> mapped;
+        com_ptr<ID3D12Resource> buffer =
+            m_resourceManager->CreateUploadBufferAndMap(data.size(), &mapped);
+        std::copy(data.begin(), data.end(), mapped.begin());
+
+        *size = data.size();
+
+        return buffer;
+    };
+
+    upload->Positions = createUpload(packed.Positions, &upload->PositionsSize);
+    upload->Normals = createUpload(packed.Normals, &upload->NormalsSize);
+    upload->UVs = createUpload(packed.UVs, &upload->UVsSize);
+    upload->Indices = createUpload(packed.Indices, &upload->IndicesSize);
+
+    upload->Layout = packed.Layout;
+    upload->PositionStride = packed.PositionStride;
+    upload->IndexSize = packed.IndexSize;
+
+    upload->VertexCount = packed.VertexCount;
+    upload->IndexCount = packed.IndexCount;
+
+    if (packed.Layout == VertexLayout::Separate)
+        return;
+
+    size_t unpackedSize = GetUnpackedMeshSize(mesh);
+
+    std::cout << GetMeshName(meshIdx) << ": " << GetVertexLayoutName(packed.Layout)
+              << " layout saves " << (unpackedSize - packed.GetSize()) << " of " << unpackedSize
+              << " bytes\n";
 }
 
-void App::LoadGeometry(std::filesystem::path path, std::optional<std::filesystem::path> texture,
-                       Geometry* geometry)
+void App::UploadGeometry(const GeometryUpload& upload, Geometry* geometry)
 {
-    Mesh mesh{};
-    LoadMeshFromPlyFile(path, &mesh);
+    auto createBuffer = [&](ID3D12Resource* uploadBuffer, size_t size) {
+        if (!uploadBuffer)
+            return com_ptr<ID3D12Resource>();
 
-    geometry->Positions = m_resourceManager->CreateBufferAndUpload(std::span(mesh.Positions));
-    geometry->Normals = m_resourceManager->CreateBufferAndUpload(std::span(mesh.Normals));
-    geometry->UVs = m_resourceManager->CreateBufferAndUpload(std::span(mesh.UVs));
-    geometry->Indices  = m_resourceManager->CreateBufferAndUpload(std::span(mesh.Indices));
+        return m_resourceManager->CreateBufferFromUpload(uploadBuffer, size);
+    };
 
-    geometry->VertexCount = static_cast<uint32_t>(mesh.Positions.size());
-    geometry->IndexCount = static_cast<uint32_t>(mesh.Indices.size());
+    geometry->Positions = createBuffer(upload.Positions.get(), upload.PositionsSize);
+    geometry->Normals = createBuffer(upload.Normals.get(), upload.NormalsSize);
+    geometry->UVs = createBuffer(upload.UVs.get(), upload.UVsSize);
+    geometry->Indices = createBuffer(upload.Indices.get(), upload.IndicesSize);
 
-    if (texture)
-        geometry->Texture = m_resourceManager->LoadImage(*texture);
+    // Every hit group root parameter needs a buffer, so ones the layout doesn't have point at
+    // the buffer the shader reads the attributes from instead.
+    if (!geometry->Normals)
+        geometry->Normals = geometry->Positions;
+
+    if (!geometry->UVs)
+        geometry->UVs = geometry->Normals;
+
+    geometry->Layout = upload.Layout;
+    geometry->PositionStride = upload.PositionStride;
+    geometry->IndexSize = upload.IndexSize;
+
+    geometry->VertexCount = upload.VertexCount;
+    geometry->IndexCount = upload.IndexCount;
 }
 
 void App::CreateAccelerationStructures()
@@ -472,14 +678,15 @@ void App::CreateAccelerationStructures()
             geometryDesc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
             geometryDesc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
             geometryDesc.Triangles.Transform3x4 = geom.Transform;
-            geometryDesc.Triangles.IndexFormat = DXGI_FORMAT_R32_UINT;
+            geometryDesc.Triangles.IndexFormat =
+                geom.IndexSize == sizeof(uint16_t) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
             geometryDesc.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
             geometryDesc.Triangles.IndexCount = geom.IndexCount;
             geometryDesc.Triangles.VertexCount = geom.VertexCount;
             geometryDesc.Triangles.IndexBuffer = geom.Indices->GetGPUVirtualAddress();
             geometryDesc.Triangles.VertexBuffer.StartAddress =
                 geom.Positions->GetGPUVirtualAddress();
-            geometryDesc.Triangles.VertexBuffer.StrideInBytes = sizeof(float) * 3;
+            geometryDesc.Triangles.VertexBuffer.StrideInBytes = geom.PositionStride;
         }
 
         D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS blasInputs{};
@@ -622,133 +829,43 @@ void App::CreateAccelerationStructures()
     WaitForGpu();
 }
 
-static constexpr uint16_t PRIMES[] = {
-    2, 3, 5, 7, 11,
-    13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71, 73, 79, 83, 89, 97, 101,
-    103, 107, 109, 113, 127, 131, 137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191,
-    193, 197, 199, 211, 223, 227, 229, 233, 239, 241, 251, 257, 263, 269, 271, 277, 281,
-    283, 293, 307, 311, 313, 317, 331, 337, 347, 349, 353, 359, 367, 373, 379, 383, 389,
-    397, 401, 409, 419, 421, 431, 433, 439, 443, 449, 457, 461, 463, 467, 479, 487, 491,
-    499, 503, 509, 521, 523, 541, 547, 557, 563, 569, 571, 577, 587, 593, 599, 601, 607,
-    613, 617, 619, 631, 641, 643, 647, 653, 659, 661, 673, 677, 683, 691, 701, 709, 719,
-    727, 733, 739, 743, 751, 757, 761, 769, 773, 787, 797, 809, 811, 821, 823, 827, 829,
-    839, 853, 857, 859, 863, 877, 881, 883, 887, 907, 911, 919, 929, 937, 941, 947, 953,
-    967, 971, 977, 983, 991, 997, 1009, 1013, 1019, 1021, 1031, 1033, 1039, 1049, 1051,
-    1061, 1063, 1069, 1087, 1091, 1093, 1097, 1103, 1109, 1117, 1123, 1129, 1151, 1153,
-    1163, 1171, 1181, 1187, 1193, 1201, 1213, 1217, 1223, 1229, 1231, 1237, 1249, 1259,
-    1277, 1279, 1283, 1289, 1291, 1297, 1301, 1303, 1307, 1319, 1321, 1327, 1361, 1367,
-    1373, 1381, 1399, 1409, 1423, 1427, 1429, 1433, 1439, 1447, 1451, 1453, 1459, 1471,
-    1481, 1483, 1487, 1489, 1493, 1499, 1511, 1523, 1531, 1543, 1549, 1553, 1559, 1567,
-    1571, 1579, 1583, 1597, 1601, 1607, 1609, 1613, 1619, 1621, 1627, 1637, 1657, 1663,
-    1667, 1669, 1693, 1697, 1699, 1709, 1721, 1723, 1733, 1741, 1747, 1753, 1759, 1777,
-    1783, 1787, 1789, 1801, 1811, 1823, 1831, 1847, 1861, 1867, 1871, 1873, 1877, 1879,
-    1889, 1901, 1907, 1913, 1931, 1933, 1949, 1951, 1973, 1979, 1987, 1993, 1997, 1999,
-    2003, 2011, 2017, 2027, 2029, 2039, 2053, 2063, 2069, 2081, 2083, 2087, 2089, 2099,
-    2111, 2113, 2129, 2131, 2137, 2141, 2143, 2153, 2161, 2179, 2203, 2207, 2213, 2221,
-    2237, 2239, 2243, 2251, 2267, 2269, 2273, 2281, 2287, 2293, 2297, 2309, 2311, 2333,
-    2339, 2341, 2347, 2351, 2357, 2371, 2377, 2381, 2383, 2389, 2393, 2399, 2411, 2417,
-    2423, 2437, 2441, 2447, 2459, 2467, 2473, 2477, 2503, 2521, 2531, 2539, 2543, 2549,
-    2551, 2557, 2579, 2591, 2593, 2609, 2617, 2621, 2633, 2647, 2657, 2659, 2663, 2671,
-    2677, 2683, 2687, 2689, 2693, 2699, 2707, 2711, 2713, 2719, 2729, 2731, 2741, 2749,
-    2753, 2767, 2777, 2789, 2791, 2797, 2801, 2803, 2819, 2833, 2837, 2843, 2851, 2857,
-    2861, 2879, 2887, 2897, 2903, 2909, 2917, 2927, 2939, 2953, 2957, 2963, 2969, 2971,
-    2999, 3001, 3011, 3019, 3023, 3037, 3041, 3049, 3061, 3067, 3079, 3083, 3089, 3109,
-    3119, 3121, 3137, 3163, 3167, 3169, 3181, 3187, 3191, 3203, 3209, 3217, 3221, 3229,
-    3251, 3253, 3257, 3259, 3271, 3299, 3301, 3307, 3313, 3319, 3323, 3329, 3331, 3343,
-    3347, 3359, 3361, 3371, 3373, 3389, 3391, 3407, 3413, 3433, 3449, 3457, 3461, 3463,
-    3467, 3469, 3491, 3499, 3511, 3517, 3527, 3529, 3533, 3539, 3541, 3547, 3557, 3559,
-    3571, 3581, 3583, 3593, 3607, 3613, 3617, 3623, 3631, 3637, 3643, 3659, 3671, 3673,
-    3677, 3691, 3697, 3701, 3709, 3719, 3727, 3733, 3739, 3761, 3767, 3769, 3779, 3793,
-    3797, 3803, 3821, 3823, 3833, 3847, 3851, 3853, 3863, 3877, 3881, 3889, 3907, 3911,
-    3917, 3919, 3923, 3929, 3931, 3943, 3947, 3967, 3989, 4001, 4003, 4007, 4013, 4019,
-    4021, 4027, 4049, 4051, 4057, 4073, 4079, 4091, 4093, 4099, 4111, 4127, 4129, 4133,
-    4139, 4153, 4157, 4159, 4177, 4201, 4211, 4217, 4219, 4229, 4231, 4241, 4243, 4253,
-    4259, 4261, 4271, 4273, 4283, 4289, 4297, 4327, 4337, 4339, 4349, 4357, 4363, 4373,
-    4391, 4397, 4409, 4421, 4423, 4441, 4447, 4451, 4457, 4463, 4481, 4483, 4493, 4507,
-    4513, 4517, 4519, 4523, 4547, 4549, 4561, 4567, 4583, 4591, 4597, 4603, 4621, 4637,
-    4639, 4643, 4649, 4651, 4657, 4663, 4673, 4679, 4691, 4703, 4721, 4723, 4729, 4733,
-    4751, 4759, 4783, 4787, 4789, 4793, 4799, 4801, 4813, 4817, 4831, 4861, 4871, 4877,
-    4889, 4903, 4909, 4919, 4931, 4933, 4937, 4943, 4951, 4957, 4967, 4969, 4973, 4987,
-    4993, 4999, 5003, 5009, 5011, 5021, 5023, 5039, 5051, 5059, 5077, 5081, 5087, 5099,
-    5101, 5107, 5113, 5119, 5147, 5153, 5167, 5171, 5179, 5189, 5197, 5209, 5227, 5231,
-    5233, 5237, 5261, 5273, 5279, 5281, 5297, 5303, 5309, 5323, 5333, 5347, 5351, 5381,
-    5387, 5393, 5399, 5407, 5413, 5417, 5419, 5431, 5437, 5441, 5443, 5449, 5471, 5477,
-    5479, 5483, 5501, 5503, 5507, 5519, 5521, 5527, 5531, 5557, 5563, 5569, 5573, 5581,
-    5591, 5623, 5639, 5641, 5647, 5651, 5653, 5657, 5659, 5669, 5683, 5689, 5693, 5701,
-    5711, 5717, 5737, 5741, 5743, 5749, 5779, 5783, 5791, 5801, 5807, 5813, 5821, 5827,
-    5839, 5843, 5849, 5851, 5857, 5861, 5867, 5869, 5879, 5881, 5897, 5903, 5923, 5927,
-    5939, 5953, 5981, 5987, 6007, 6011, 6029, 6037, 6043, 6047, 6053, 6067, 6073, 6079,
-    6089, 6091, 6101, 6113, 6121, 6131, 6133, 6143, 6151, 6163, 6173, 6197, 6199, 6203,
-    6211, 6217, 6221, 6229, 6247, 6257, 6263, 6269, 6271, 6277, 6287, 6299, 6301, 6311,
-    6317, 6323, 6329, 6337, 6343, 6353, 6359, 6361, 6367, 6373, 6379, 6389, 6397, 6421,
-    6427, 6449, 6451, 6469, 6473, 6481, 6491, 6521, 6529, 6547, 6551, 6553, 6563, 6569,
-    6571, 6577, 6581, 6599, 6607, 6619, 6637, 6653, 6659, 6661, 6673, 6679, 6689, 6691,
-    6701, 6703, 6709, 6719, 6733, 6737, 6761, 6763, 6779, 6781, 6791, 6793, 6803, 6823,
-    6827, 6829, 6833, 6841, 6857, 6863, 6869, 6871, 6883, 6899, 6907, 6911, 6917, 6947,
-    6949, 6959, 6961, 6967, 6971, 6977, 6983, 6991, 6997, 7001, 7013, 7019, 7027, 7039,
-    7043, 7057, 7069, 7079, 7103, 7109, 7121, 7127, 7129, 7151, 7159, 7177, 7187, 7193,
-    7207, 7211, 7213, 7219, 7229, 7237, 7243, 7247, 7253, 7283, 7297, 7307, 7309, 7321,
-    7331, 7333, 7349, 7351, 7369, 7393, 7411, 7417, 7433, 7451, 7457, 7459, 7477, 7481,
-    7487, 7489, 7499, 7507, 7517, 7523, 7529, 7537, 7541, 7547, 7549, 7559, 7561, 7573,
-    7577, 7583, 7589, 7591, 7603, 7607, 7621, 7639, 7643, 7649, 7669, 7673, 7681, 7687,
-    7691, 7699, 7703, 7717, 7723, 7727, 7741, 7753, 7757, 7759, 7789, 7793, 7817, 7823,
-    7829, 7841, 7853, 7867, 7873, 7877, 7879, 7883, 7901, 7907, 7919};
-
-
 void App::CreateOtherResources()
 {
-    {
+    auto createFilmTexture = [&](DXGI_FORMAT format, com_ptr<ID3D12Resource>* texture) {
         CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_DEFAULT);
         CD3DX12_RESOURCE_DESC resourceDesc =
-            CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, m_windowWidth, m_windowHeight,
-                                         1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+            CD3DX12_RESOURCE_DESC::Tex2D(format, m_windowWidth, m_windowHeight, 1, 1, 1, 0,
+                                         D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
 
         check_hresult(m_device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE,
                                                         &resourceDesc,
                                                         D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
-                                                        nullptr, IID_PPV_ARGS(m_film.put())));
-    }
-
-    size_t numPrimes = _countof(PRIMES);
-
-    std::vector<HaltonEntry> haltonEntries(numPrimes);
-
-    size_t permSize = 0;
-
-    for (int i = 0; i < numPrimes; ++i)
-    {
-        haltonEntries[i].Prime = PRIMES[i];
-        haltonEntries[i].PermutationOffset = static_cast<uint32_t>(permSize);
+                                                        nullptr, IID_PPV_ARGS(texture->put())));
+    };
 
-        permSize += haltonEntries[i].Prime;
-    }
-
-    m_haltonEntries = m_resourceManager->CreateBufferAndUpload(std::span(haltonEntries));
+    createFilmTexture(DXGI_FORMAT_R32G32B32A32_FLOAT, &m_film);
+    createFilmTexture(DXGI_FORMAT_R32G32B32A32_FLOAT, &m_filmCompensation);
+    createFilmTexture(DXGI_FORMAT_R8G8B8A8_UNORM, &m_display);
 
-    std::vector<uint16_t> permutations(permSize);
+    m_seed = static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count());
 
-    uint32_t seed =
-        static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count());
+    SamplerTables samplerTables = GetSamplerTables(m_options.Sampler, MAX_SAMPLES, m_seed);
 
-    for (const auto& entry : haltonEntries)
+    if (samplerTables.Halton)
     {
-        for (int j = 0; j < entry.Prime; ++j)
-        {
-            permutations[entry.PermutationOffset + j] = static_cast<uint16_t>(j);
-        }
-
-        auto it = permutations.begin() + entry.PermutationOffset;
-        std::shuffle(it, it + entry.Prime, std::default_random_engine(seed));
+        m_haltonEntries = m_resourceManager->CreateBufferAndUpload(samplerTables.Halton->Entries);
+        m_haltonPerms =
+            m_resourceManager->CreateBufferAndUpload(std::span(samplerTables.Halton->Permutations));
     }
 
-    m_haltonPerms = m_resourceManager->CreateBufferAndUpload(std::span(permutations));
+    m_sobolMatrices = m_resourceManager->CreateBufferAndUpload(samplerTables.SobolMatrices);
 }
 
 void App::CreateDescriptors()
 {
     {
         D3D12_DESCRIPTOR_HEAP_DESC heapDesc{};
-        heapDesc.NumDescriptors = static_cast<uint32_t>(1 + m_geometries.size());
+        heapDesc.NumDescriptors = static_cast<uint32_t>(3 + m_geometries.size());
         heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
         heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 
@@ -759,20 +876,30 @@ void App::CreateDescriptors()
         D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc{};
         uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
 
-        auto handles = m_descriptorHeap.Allocate();
+        // Allocated back to back, since the root signatures take them as one table.
+        ID3D12Resource* textures[] = {m_film.get(), m_filmCompensation.get(), m_display.get()};
 
-        m_device->CreateUnorderedAccessView(m_film.get(), nullptr, &uavDesc, handles.CpuHandle);
-        m_filmUav = handles.GpuHandle;
+        for (size_t i = 0; i < _countof(textures); ++i)
+        {
+            auto handles = m_descriptorHeap.Allocate();
+
+            m_device->CreateUnorderedAccessView(textures[i], nullptr, &uavDesc, handles.CpuHandle);
+
+            if (i == 0)
+                m_filmUav = handles.GpuHandle;
+        }
     }
 
     for (auto& geom : m_geometries)
     {
+        // exr textures are float. Geometries without a texture get a null descriptor.
         D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
-        srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        srvDesc.Format =
+            geom.Texture ? geom.Texture->GetDesc().Format : DXGI_FORMAT_R8G8B8A8_UNORM;
         srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
         srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
         srvDesc.Texture2D.MostDetailedMip = 0;
-        srvDesc.Texture2D.MipLevels = 1;
+        srvDesc.Texture2D.MipLevels = geom.Texture ? geom.Texture->GetDesc().MipLevels : 1;
 
         auto handles = m_descriptorHeap.Allocate();
 
@@ -933,8 +1060,6 @@ void App::Render()
     check_hresult(m_frames[m_currentFrame].CmdAllocator->Reset());
     check_hresult(m_cmdList->Reset(m_frames[m_currentFrame].CmdAllocator.get(), nullptr));
 
-    static constexpr int MAX_SAMPLES = 2048;
-
     if (m_sampleIdx < MAX_SAMPLES)
     {
         m_cmdList->SetComputeRootSignature(m_globalRootSig.get());
@@ -947,7 +1072,20 @@ void App::Render()
 
         m_cmdList->SetComputeRootDescriptorTable(Global::Param::Film, m_filmUav);
 
-        m_cmdList->SetComputeRoot32BitConstant(Global::Param::DrawConstants, m_sampleIdx, 0);
+        DrawConstants drawConstants{};
+        drawConstants.SampleIndex = m_sampleIdx;
+        drawConstants.SamplerType = static_cast<uint32_t>(m_options.Sampler);
+        drawConstants.SamplesPerPixel = MAX_SAMPLES;
+        drawConstants.Seed = m_seed;
+        drawConstants.MaxDepth = m_options.MaxDepth;
+        drawConstants.RouletteDepth = m_options.RouletteDepth;
+        drawConstants.LightSampler = static_cast<uint32_t>(m_options.LightSampler);
+        drawConstants.LightCount = m_lightCount;
+        drawConstants.LightSamples = m_options.LightSamples;
+
+        m_cmdList->SetComputeRoot32BitConstants(Global::Param::DrawConstants,
+                                                sizeof(DrawConstants) / sizeof(uint32_t),
+                                                &drawConstants, 0);
         ++m_sampleIdx;
 
         m_cmdList->SetComputeRootDescriptorTable(Global::Param::Sampler, m_sampler);
@@ -955,10 +1093,29 @@ void App::Render()
         m_cmdList->SetComputeRootShaderResourceView(Global::Param::Lights,
                                                     m_lightBuffer->GetGPUVirtualAddress());
 
-        m_cmdList->SetComputeRootShaderResourceView(Global::Param::HaltonEntries,
-                                                    m_haltonEntries->GetGPUVirtualAddress());
-        m_cmdList->SetComputeRootShaderResourceView(Global::Param::HaltonPerms,
-                                                    m_haltonPerms->GetGPUVirtualAddress());
+        // The shader never reads the Halton tables when they're null.
+        m_cmdList->SetComputeRootShaderResourceView(
+            Global::Param::HaltonEntries,
+            m_haltonEntries ? m_haltonEntries->GetGPUVirtualAddress() : 0);
+        m_cmdList->SetComputeRootShaderResourceView(
+            Global::Param::HaltonPerms, m_haltonPerms ? m_haltonPerms->GetGPUVirtualAddress() : 0);
+        m_cmdList->SetComputeRootShaderResourceView(Global::Param::SobolMatrices,
+                                                    m_sobolMatrices->GetGPUVirtualAddress());
+        m_cmdList->SetComputeRootShaderResourceView(Global::Param::LightAliasTable,
+                                                    m_lightAliasTable->GetGPUVirtualAddress());
+        m_cmdList->SetComputeRootShaderResourceView(Global::Param::LightBvh,
+                                                    m_lightBvh->GetGPUVirtualAddress());
+
+        CameraConstants camera{};
+        camera.Origin = m_camera.Origin;
+        camera.Fov = m_camera.Fov;
+        camera.Right = m_camera.Right;
+        camera.Up = m_camera.Up;
+        camera.Forward = m_camera.Forward;
+
+        m_cmdList->SetComputeRoot32BitConstants(Global::Param::Camera,
+                                                sizeof(CameraConstants) / sizeof(uint32_t),
+                                                &camera, 0);
 
         D3D12_DISPATCH_RAYS_DESC dispatchDesc{};
 
@@ -979,6 +1136,23 @@ void App::Render()
 
         m_cmdList->SetPipelineState1(m_pipeline.get());
         m_cmdList->DispatchRays(&dispatchDesc);
+
+        D3D12_RESOURCE_BARRIER barriers[2] = {};
+
+        barriers[0].Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+        barriers[0].UAV.pResource = m_film.get();
+
+        barriers[1].Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+        barriers[1].UAV.pResource = m_filmCompensation.get();
+
+        m_cmdList->ResourceBarrier(_countof(barriers), barriers);
+
+        // The display image keeps the last resolve once every sample has been taken.
+        m_cmdList->SetComputeRootSignature(m_resolveRootSig.get());
+        m_cmdList->SetComputeRootDescriptorTable(0, m_filmUav);
+        m_cmdList->SetPipelineState(m_resolvePipeline.get());
+        m_cmdList->Dispatch((m_windowWidth + RESOLVE_GROUP_SIZE - 1) / RESOLVE_GROUP_SIZE,
+                            (m_windowHeight + RESOLVE_GROUP_SIZE - 1) / RESOLVE_GROUP_SIZE, 1);
     }
 
     {
@@ -991,7 +1165,7 @@ void App::Render()
         barriers[0].Transition.StateAfter = D3D12_RESOURCE_STATE_COPY_DEST;
 
         barriers[1].Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-        barriers[1].Transition.pResource = m_film.get();
+        barriers[1].Transition.pResource = m_display.get();
         barriers[1].Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
         barriers[1].Transition.StateBefore = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
         barriers[1].Transition.StateAfter = D3D12_RESOURCE_STATE_COPY_SOURCE;
@@ -999,7 +1173,7 @@ void App::Render()
         m_cmdList->ResourceBarrier(_countof(barriers), barriers);
     }
 
-    m_cmdList->CopyResource(m_frames[m_currentFrame].SwapChainBuffer.get(), m_film.get());
+    m_cmdList->CopyResource(m_frames[m_currentFrame].SwapChainBuffer.get(), m_display.get());
 
     {
         D3D12_RESOURCE_BARRIER barriers[2] = {};
@@ -1011,7 +1185,7 @@ void App::Render()
         barriers[0].Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
 
         barriers[1].Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-        barriers[1].Transition.pResource = m_film.get();
+        barriers[1].Transition.pResource = m_display.get();
         barriers[1].Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
         barriers[1].Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_SOURCE;
         barriers[1].Transition.StateAfter = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
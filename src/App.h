@@ -1,6 +1,10 @@
 #pragma once
 
+#include "LightSamplerTables.h"
 #include "ResourceManager.h"
+#include "SamplerTables.h"
+#include "SceneIR.h"
+#include "VertexLayout.h"
 
 #include "shaders/Common.h"
 
@@ -8,13 +12,35 @@
 #include <dxgi1_6.h>
 #include <winrt/base.h>
 
+#include <filesystem>
 #include <optional>
 #include <vector>
 
+struct AppOptions
+{
+    // A pbrt-v4 file, a .pbrtscene snapshot, or empty for the built-in scene: see LoadSceneIR.
+    std::filesystem::path Scene;
+
+    VertexLayoutOptions Vertices;
+
+    // Runs OptimizeMesh on every mesh after loading it.
+    bool OptimizeMeshes = false;
+
+    SamplerType Sampler = SamplerType::Halton;
+
+    // DrawConstants::MaxDepth and DrawConstants::RouletteDepth.
+    uint32_t MaxDepth = 3;
+    uint32_t RouletteDepth = 0;
+
+    // DrawConstants::LightSampler and DrawConstants::LightSamples.
+    LightSamplerType LightSampler = LightSamplerType::All;
+    uint32_t LightSamples = 1;
+};
+
 class App
 {
 public:
-    App(HWND hwnd);
+    App(HWND hwnd, const AppOptions& options);
 
     void Render();
 
@@ -32,10 +58,38 @@ private:
 
     void CreatePipeline();
 
+    // The compute pipeline of ResolveShader, which turns the film into the displayed image.
+    void CreateResolvePipeline();
+
     void LoadScene();
 
-    void LoadGeometry(std::filesystem::path path, std::optional<std::filesystem::path> texture,
-                      Geometry* geometry);
+    // Mesh data decoded into mapped upload buffers, waiting to be copied to the default heap.
+    struct GeometryUpload
+    {
+        winrt::com_ptr<ID3D12Resource> Positions;
+        winrt::com_ptr<ID3D12Resource> Normals;
+        winrt::com_ptr<ID3D12Resource> UVs;
+        winrt::com_ptr<ID3D12Resource> Indices;
+
+        // Sizes in bytes. Zero for buffers the layout doesn't use.
+        size_t PositionsSize = 0;
+        size_t NormalsSize = 0;
+        size_t UVsSize = 0;
+        size_t IndicesSize = 0;
+
+        VertexLayout Layout = VertexLayout::Separate;
+        uint32_t PositionStride = sizeof(float) * 3;
+        uint32_t IndexSize = sizeof(uint32_t);
+
+        uint32_t VertexCount = 0;
+        uint32_t IndexCount = 0;
+    };
+
+    // Copies the mesh into upload buffers, converting it first if the options ask for it. Safe to
+    // call from worker threads.
+    void DecodeGeometry(const SceneIR& scene, uint32_t meshIdx, GeometryUpload* upload);
+
+    void UploadGeometry(const GeometryUpload& upload, Geometry* geometry);
 
     void CreateAccelerationStructures();
 
@@ -51,6 +105,8 @@ private:
 
     HWND m_hwnd;
 
+    AppOptions m_options;
+
     UINT m_windowWidth = 0;
     UINT m_windowHeight = 0;
 
@@ -88,16 +144,31 @@ private:
 
     winrt::com_ptr<ID3D12StateObject> m_pipeline;
 
+    winrt::com_ptr<ID3D12RootSignature> m_resolveRootSig;
+    winrt::com_ptr<ID3D12PipelineState> m_resolvePipeline;
+
+    // Rendering stops once every pixel has this many samples.
+    static constexpr uint32_t MAX_SAMPLES = 2048;
+
     uint32_t m_sampleIdx = 0;
 
+    // Seeds the Halton digit permutations or the Sobol scrambles.
+    uint32_t m_seed = 0;
+
     struct Geometry
     {
+        // Normals and UVs alias the buffer holding the attributes when the layout doesn't
+        // have separate ones.
         winrt::com_ptr<ID3D12Resource> Positions;
         winrt::com_ptr<ID3D12Resource> Normals;
         winrt::com_ptr<ID3D12Resource> UVs;
 
         winrt::com_ptr<ID3D12Resource> Indices;
 
+        VertexLayout Layout = VertexLayout::Separate;
+        uint32_t PositionStride = sizeof(float) * 3;
+        uint32_t IndexSize = sizeof(uint32_t);
+
         uint32_t VertexCount = 0;
         uint32_t IndexCount = 0;
 
@@ -109,24 +180,38 @@ private:
 
     std::vector<Geometry> m_geometries;
 
+    SceneCamera m_camera;
+
     winrt::com_ptr<ID3D12Resource> m_transformBuffer;
     winrt::com_ptr<ID3D12Resource> m_hitGroupGeomConstantsBuffer;
 
     winrt::com_ptr<ID3D12Resource> m_aabbBuffer;
 
     winrt::com_ptr<ID3D12Resource> m_lightBuffer;
+    winrt::com_ptr<ID3D12Resource> m_lightAliasTable;
+    winrt::com_ptr<ID3D12Resource> m_lightBvh;
+    uint32_t m_lightCount = 0;
 
     winrt::com_ptr<ID3D12Resource> m_blas;
     winrt::com_ptr<ID3D12Resource> m_lightBlas;
 
     winrt::com_ptr<ID3D12Resource> m_tlas;
 
+    // R32G32B32A32_FLOAT textures holding the FilmAccumulator of every pixel, which
+    // ResolveShader turns into the R8G8B8A8_UNORM display image that is copied to the swap chain.
     winrt::com_ptr<ID3D12Resource> m_film;
+    winrt::com_ptr<ID3D12Resource> m_filmCompensation;
+    winrt::com_ptr<ID3D12Resource> m_display;
+
+    // Null unless the Halton sampler is used.
     winrt::com_ptr<ID3D12Resource> m_haltonEntries;
     winrt::com_ptr<ID3D12Resource> m_haltonPerms;
 
+    winrt::com_ptr<ID3D12Resource> m_sobolMatrices;
+
     DescriptorHeap m_descriptorHeap;
 
+    // The UAVs of the film, its compensation and the display image, in that order.
     D3D12_GPU_DESCRIPTOR_HANDLE m_filmUav;
 
     DescriptorHeap m_samplerHeap;
@@ -160,6 +245,10 @@ private:
                 Lights,
                 HaltonEntries,
                 HaltonPerms,
+                SobolMatrices,
+                LightAliasTable,
+                LightBvh,
+                Camera,
                 NUM_PARAMS
             };
         };
@@ -0,0 +1,421 @@
+#include "ImageCodecs.h"
+#include "Inflate.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace
+{
+
+enum class Compression : uint8_t
+{
+    None = 0,
+    RLE = 1,
+    ZIPS = 2,
+    ZIP = 3
+};
+
+enum class SampleType : int32_t
+{
+    Uint = 0,
+    Half = 1,
+    Float = 2
+};
+
+struct Channel
+{
+    SampleType Type = SampleType::Half;
+
+    // The RGBA component the channel goes to, 4 for Y, which goes to R, G and B, or -1 for
+    // channels that aren't used.
+    int Target = -1;
+};
+
+constexpr uint32_t kTiledFlag = 0x200;
+constexpr uint32_t kDeepFlag = 0x800;
+constexpr uint32_t kMultipartFlag = 0x1000;
+
+float HalfToFloat(uint16_t half)
+{
+    uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+
+    if (exponent == 0)
+    {
+        float value = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -value : value;
+    }
+
+    if (exponent == 31)
+        return std::bit_cast<float>(sign | 0x7F800000 | mantissa << 13);
+
+    return std::bit_cast<float>(sign | (exponent + 112) << 23 | mantissa << 13);
+}
+
+size_t GetSampleSize(SampleType type)
+{
+    return type == SampleType::Half ? 2 : 4;
+}
+
+class ExrDecoder
+{
+public:
+    ExrDecoder(std::span<const std::byte> file, ImageSink* sink) : m_file(file), m_sink(sink)
+    {
+    }
+
+    void Decode()
+    {
+        uint32_t version = Read<uint32_t>();
+
+        if ((version & 0xFF) != 2)
+            throw std::runtime_error("Unsupported exr version.");
+
+        if (version & (kTiledFlag | kDeepFlag | kMultipartFlag))
+            throw std::runtime_error("Only single part scanline exr files are supported.");
+
+        ReadHeader();
+
+        uint32_t linesPerChunk = m_compression == Compression::ZIP ? 16 : 1;
+        uint32_t chunkCount = (m_info.Height + linesPerChunk - 1) / linesPerChunk;
+
+        size_t offsetsPos = m_pos;
+        m_pos += sizeof(uint64_t) * chunkCount;
+
+        if (m_pos > m_file.size())
+            throw std::runtime_error("Truncated offset table.");
+
+        AllocateSink(m_info, m_sink);
+
+        for (uint32_t i = 0; i < chunkCount; ++i)
+        {
+            uint64_t offset = 0;
+            memcpy(&offset, &m_file[offsetsPos + sizeof(uint64_t) * i], sizeof(offset));
+
+            DecodeChunk(offset, linesPerChunk);
+        }
+    }
+
+private:
+    template<typename T>
+    T Read()
+    {
+        if (m_file.size() - m_pos < sizeof(T))
+            throw std::runtime_error("Unexpected end of file.");
+
+        T value;
+        memcpy(&value, &m_file[m_pos], sizeof(T));
+        m_pos += sizeof(T);
+
+        return value;
+    }
+
+    std::string_view ReadString()
+    {
+        if (m_pos >= m_file.size())
+            throw std::runtime_error("Unexpected end of file.");
+
+        const char* start = reinterpret_cast<const char*>(&m_file[m_pos]);
+        const void* end = memchr(start, 0, m_file.size() - m_pos);
+
+        if (!end)
+            throw std::runtime_error("Unexpected end of file.");
+
+        std::string_view value(start, static_cast<const char*>(end) - start);
+        m_pos += value.size() + 1;
+
+        return value;
+    }
+
+    void ReadHeader()
+    {
+        bool hasChannels = false;
+        bool hasDataWindow = false;
+
+        while (true)
+        {
+            std::string_view name = ReadString();
+
+            if (name.empty())
+                break;
+
+            std::string_view type = ReadString();
+            uint32_t size = Read<uint32_t>();
+
+            if (size > m_file.size() - m_pos)
+                throw std::runtime_error("Unexpected end of file.");
+
+            size_t end = m_pos + size;
+
+            if (name == "channels" && type == "chlist")
+            {
+                ReadChannels(end);
+                hasChannels = true;
+            }
+            else if (name == "compression" && type == "compression")
+            {
+                uint8_t compression = Read<uint8_t>();
+
+                if (compression > static_cast<uint8_t>(Compression::ZIP))
+                {
+                    throw std::runtime_error("Unsupported exr compression " +
+                                             std::to_string(compression) + ".");
+                }
+
+                m_compression = static_cast<Compression>(compression);
+            }
+            else if (name == "dataWindow" && type == "box2i")
+            {
+                int32_t minX = Read<int32_t>();
+                m_minY = Read<int32_t>();
+                int32_t maxX = Read<int32_t>();
+                int32_t maxY = Read<int32_t>();
+
+                if (maxX < minX || maxY < m_minY)
+                    throw std::runtime_error("Invalid data window.");
+
+                m_info.Width = static_cast<uint32_t>(int64_t(maxX) - minX + 1);
+                m_info.Height = static_cast<uint32_t>(int64_t(maxY) - m_minY + 1);
+                hasDataWindow = true;
+            }
+
+            m_pos = end;
+        }
+
+        if (!hasChannels || !hasDataWindow)
+            throw std::runtime_error("Missing channels or data window.");
+
+        m_info.Format = PixelFormat::RGBA32F;
+    }
+
+    void ReadChannels(size_t end)
+    {
+        bool hasColor = false;
+
+        while (true)
+        {
+            std::string_view name = ReadString();
+
+            if (name.empty())
+                break;
+
+            Channel channel;
+            channel.Type = static_cast<SampleType>(Read<int32_t>());
+            Read<uint32_t>(); // pLinear and reserved
+            int32_t samplingX = Read<int32_t>();
+            int32_t samplingY = Read<int32_t>();
+
+            if (channel.Type != SampleType::Uint && channel.Type != SampleType::Half &&
+                channel.Type != SampleType::Float)
+            {
+                throw std::runtime_error("Invalid channel type.");
+            }
+
+            if (samplingX != 1 || samplingY != 1)
+                throw std::runtime_error("Subsampled exr channels are not supported.");
+
+            static constexpr std::string_view kTargets[] = {"R", "G", "B", "A", "Y"};
+
+            for (int i = 0; i < 5; ++i)
+            {
+                if (name == kTargets[i])
+                    channel.Target = i;
+            }
+
+            hasColor = hasColor || (channel.Target != -1 && channel.Target != 3);
+
+            m_bytesPerPixel += GetSampleSize(channel.Type);
+            m_channels.push_back(channel);
+
+            if (m_pos > end)
+                throw std::runtime_error("Invalid channel list.");
+        }
+
+        if (!hasColor)
+            throw std::runtime_error("No R, G, B or Y channel.");
+    }
+
+    // Undoes the byte delta predictor and the split into even and odd bytes of RLE and ZIP
+    // compression. Overwrites src.
+    static void Reconstruct(std::span<std::byte> src, std::byte* dst)
+    {
+        for (size_t i = 1; i < src.size(); ++i)
+        {
+            src[i] = static_cast<std::byte>(static_cast<uint8_t>(src[i - 1]) +
+                                            static_cast<uint8_t>(src[i]) - 128);
+        }
+
+        size_t half = (src.size() + 1) / 2;
+
+        for (size_t i = 0; i < src.size(); ++i)
+            dst[i] = src[i % 2 == 0 ? i / 2 : half + i / 2];
+    }
+
+    void DecodeRle(std::span<const std::byte> src, std::span<std::byte> dst)
+    {
+        size_t srcPos = 0;
+        size_t dstPos = 0;
+
+        while (srcPos < src.size())
+        {
+            int count = static_cast<int8_t>(src[srcPos++]);
+
+            if (count < 0)
+            {
+                size_t size = static_cast<size_t>(-count);
+
+                if (size > src.size() - srcPos || size > dst.size() - dstPos)
+                    throw std::runtime_error("Invalid RLE data.");
+
+                memcpy(&dst[dstPos], &src[srcPos], size);
+                srcPos += size;
+                dstPos += size;
+            }
+            else
+            {
+                size_t size = static_cast<size_t>(count) + 1;
+
+                if (srcPos == src.size() || size > dst.size() - dstPos)
+                    throw std::runtime_error("Invalid RLE data.");
+
+                memset(&dst[dstPos], static_cast<int>(src[srcPos++]), size);
+                dstPos += size;
+            }
+        }
+
+        if (dstPos != dst.size())
+            throw std::runtime_error("Invalid RLE data.");
+    }
+
+    void DecodeChunk(uint64_t offset, uint32_t linesPerChunk)
+    {
+        if (offset > m_file.size())
+            throw std::runtime_error("Invalid chunk offset.");
+
+        m_pos = static_cast<size_t>(offset);
+
+        int32_t chunkY = Read<int32_t>();
+        uint32_t packedSize = Read<uint32_t>();
+
+        int64_t firstLine = int64_t(chunkY) - m_minY;
+
+        if (firstLine < 0 || firstLine >= m_info.Height || packedSize > m_file.size() - m_pos)
+            throw std::runtime_error("Invalid chunk.");
+
+        uint32_t lineCount = std::min(linesPerChunk, m_info.Height - uint32_t(firstLine));
+        size_t lineSize = m_bytesPerPixel * m_info.Width;
+        size_t size = lineSize * lineCount;
+
+        std::span<const std::byte> packed = m_file.subspan(m_pos, packedSize);
+        std::span<const std::byte> data = packed;
+
+        // Chunks that compression wouldn't make smaller are stored as they are.
+        if (packedSize != size)
+        {
+            m_unpacked.resize(size);
+            m_compressed.resize(size);
+
+            switch (m_compression)
+            {
+            case Compression::None:
+                throw std::runtime_error("Invalid chunk size.");
+            case Compression::RLE:
+                DecodeRle(packed, m_compressed);
+                break;
+            case Compression::ZIPS:
+            case Compression::ZIP:
+                Inflate(packed, m_compressed);
+                break;
+            }
+
+            Reconstruct(m_compressed, m_unpacked.data());
+            data = m_unpacked;
+        }
+
+        for (uint32_t line = 0; line < lineCount; ++line)
+        {
+            uint32_t y = uint32_t(firstLine) + line;
+            float* dst = reinterpret_cast<float*>(GetSinkRow(*m_sink, m_info, y));
+
+            for (uint32_t x = 0; x < m_info.Width; ++x)
+            {
+                dst[4 * x + 0] = dst[4 * x + 1] = dst[4 * x + 2] = 0.f;
+                dst[4 * x + 3] = 1.f;
+            }
+
+            // A line holds all the samples of one channel, then of the next.
+            const std::byte* src = data.data() + lineSize * line;
+
+            for (const Channel& channel : m_channels)
+            {
+                size_t sampleSize = GetSampleSize(channel.Type);
+
+                if (channel.Target == -1)
+                {
+                    src += sampleSize * m_info.Width;
+                    continue;
+                }
+
+                for (uint32_t x = 0; x < m_info.Width; ++x, src += sampleSize)
+                {
+                    float value = 0.f;
+
+                    if (channel.Type == SampleType::Half)
+                    {
+                        uint16_t half = 0;
+                        memcpy(&half, src, sizeof(half));
+                        value = HalfToFloat(half);
+                    }
+                    else if (channel.Type == SampleType::Float)
+                    {
+                        memcpy(&value, src, sizeof(value));
+                    }
+                    else
+                    {
+                        uint32_t sample = 0;
+                        memcpy(&sample, src, sizeof(sample));
+                        value = static_cast<float>(sample);
+                    }
+
+                    if (channel.Target == 4)
+                        dst[4 * x + 0] = dst[4 * x + 1] = dst[4 * x + 2] = value;
+                    else
+                        dst[4 * x + channel.Target] = value;
+                }
+            }
+        }
+    }
+
+    std::span<const std::byte> m_file;
+    size_t m_pos = 4;
+
+    ImageSink* m_sink;
+
+    ImageInfo m_info;
+
+    // Chunks are addressed by the line numbers of the data window.
+    int32_t m_minY = 0;
+
+    Compression m_compression = Compression::None;
+
+    // In the order they are stored, which is sorted by name.
+    std::vector<Channel> m_channels;
+    size_t m_bytesPerPixel = 0;
+
+    std::vector<std::byte> m_compressed;
+    std::vector<std::byte> m_unpacked;
+};
+
+} // namespace
+
+void DecodeExr(std::span<const std::byte> file, ImageSink* sink)
+{
+    ExrDecoder decoder(file, sink);
+    decoder.Decode();
+}
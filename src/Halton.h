@@ -0,0 +1,33 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include "shaders/HaltonSampler.h"
+
+#include <memory>
+#include <span>
+#include <vector>
+
+// Tables read by the Halton sampler, which are the same on both backends for the same seed.
+struct HaltonTables
+{
+    // One entry per dimension, giving its prime base and where its digit permutations start.
+    std::span<const HaltonEntry> Entries;
+
+    // A permutation of the digits of every base for every digit position, generated like
+    // pbrt-v4's DigitPermutation and concatenated in the order of the entries.
+    std::vector<uint16_t> Permutations;
+
+    HaltonSampler CreateSampler(glm::uvec2 resolution) const
+    {
+        return HaltonSampler(Entries.data(), Permutations.data(), resolution);
+    }
+};
+
+// Computed at compile time.
+std::span<const HaltonEntry> GetHaltonEntries();
+
+// Spread over the pool when one is given. The result only depends on the seed.
+std::vector<uint16_t> CreateHaltonPermutations(uint32_t seed, ThreadPool* pool = nullptr);
+
+// The tables for a seed are generated once and shared for as long as someone holds them.
+std::shared_ptr<const HaltonTables> GetHaltonTables(uint32_t seed, ThreadPool* pool = nullptr);
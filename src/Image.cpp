@@ -0,0 +1,91 @@
+#include "Image.h"
+
+#include "ImageCodecs.h"
+#include "MappedFile.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+// Larger than any texture a D3D12 device supports.
+static constexpr uint32_t kMaxImageSize = 1 << 16;
+
+size_t GetPixelSize(PixelFormat format)
+{
+    return format == PixelFormat::RGBA32F ? 4 * sizeof(float) : 4;
+}
+
+void AllocateSink(const ImageInfo& info, ImageSink* sink)
+{
+    if (info.Width == 0 || info.Height == 0 || info.Width > kMaxImageSize ||
+        info.Height > kMaxImageSize)
+    {
+        throw std::runtime_error("Invalid image size " + std::to_string(info.Width) + "x" +
+                                 std::to_string(info.Height) + ".");
+    }
+
+    sink->Allocate(info);
+
+    size_t rowSize = info.Width * GetPixelSize(info.Format);
+
+    if (sink->RowPitch < rowSize ||
+        sink->Pixels.size() < (info.Height - 1) * sink->RowPitch + rowSize)
+    {
+        throw std::runtime_error("Image sink is too small.");
+    }
+}
+
+void SinkIntoImage(Image* image, ImageSink* sink)
+{
+    sink->Allocate = [image, sink](const ImageInfo& info) {
+        image->Info = info;
+        image->Pixels.resize(static_cast<size_t>(info.Width) * info.Height *
+                             GetPixelSize(info.Format));
+
+        sink->Pixels = image->Pixels;
+        sink->RowPitch = info.Width * GetPixelSize(info.Format);
+    };
+}
+
+void DecodeImageInto(const std::filesystem::path& path, ImageSink* sink)
+{
+    static constexpr unsigned char kPngSignature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    static constexpr unsigned char kJpegSignature[] = {0xFF, 0xD8, 0xFF};
+    static constexpr unsigned char kExrSignature[] = {0x76, 0x2F, 0x31, 0x01};
+
+    try
+    {
+        MappedFile file(path);
+        std::span<const std::byte> data = file.Data();
+
+        auto startsWith = [&](std::span<const unsigned char> signature) {
+            return data.size() >= signature.size() &&
+                   memcmp(data.data(), signature.data(), signature.size()) == 0;
+        };
+
+        if (startsWith(kPngSignature))
+            DecodePng(data, sink);
+        else if (startsWith(kJpegSignature))
+            DecodeJpeg(data, sink);
+        else if (startsWith(kExrSignature))
+            DecodeExr(data, sink);
+        else
+            throw std::runtime_error("Not a png, jpeg or exr file.");
+    }
+    catch (const std::runtime_error& e)
+    {
+        throw std::runtime_error(path.string() + ": " + e.what());
+    }
+}
+
+Image DecodeImage(const std::filesystem::path& path)
+{
+    Image image;
+
+    ImageSink sink;
+    SinkIntoImage(&image, &sink);
+
+    DecodeImageInto(path, &sink);
+
+    return image;
+}
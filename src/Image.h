@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <vector>
+
+enum class PixelFormat
+{
+    // As stored in the file, i.e. sRGB encoded for the usual png and jpeg files.
+    RGBA8,
+
+    // Linear, from exr files.
+    RGBA32F
+};
+
+size_t GetPixelSize(PixelFormat format);
+
+struct ImageInfo
+{
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+
+    PixelFormat Format = PixelFormat::RGBA8;
+};
+
+// Tightly packed pixels, with the first row at the bottom of the image.
+struct Image
+{
+    ImageInfo Info;
+
+    std::vector<std::byte> Pixels;
+};
+
+// Caller-provided destination for DecodeImageInto.
+struct ImageSink
+{
+    // Called once the size and format are known, before any pixels are decoded. Must point Pixels
+    // at a destination for Height rows, RowPitch bytes apart, of Width pixels each.
+    std::function<void(const ImageInfo& info)> Allocate;
+
+    std::span<std::byte> Pixels;
+    size_t RowPitch = 0;
+};
+
+// Points the sink at the image's pixels, which are resized once the size is known. The sink must
+// not be moved afterwards.
+void SinkIntoImage(Image* image, ImageSink* sink);
+
+// Memory-maps a png, jpeg or exr file and decodes it straight into the sink, with the first row
+// at the bottom - for pbrt, texture coordinate (0,0) is at the lower left corner. png and jpeg
+// files are decoded to RGBA8 and exr files to RGBA32F. Only touches the file and the sink, so
+// images can be decoded on any thread. Throws std::runtime_error for files it can't decode.
+void DecodeImageInto(const std::filesystem::path& path, ImageSink* sink);
+
+Image DecodeImage(const std::filesystem::path& path);
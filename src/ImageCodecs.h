@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Image.h"
+
+// The decoders behind DecodeImageInto, which call the sink's Allocate through AllocateSink. Their
+// errors don't name the file, which DecodeImageInto adds.
+
+void DecodePng(std::span<const std::byte> file, ImageSink* sink);
+
+// Baseline and extended sequential files with 8-bit samples, grayscale or YCbCr.
+void DecodeJpeg(std::span<const std::byte> file, ImageSink* sink);
+
+// Single part scanline files with uncompressed, RLE, ZIPS or ZIP compressed R, G, B and A or Y
+// channels.
+void DecodeExr(std::span<const std::byte> file, ImageSink* sink);
+
+// Throws if the size is zero or too large.
+void AllocateSink(const ImageInfo& info, ImageSink* sink);
+
+// Row y counted from the top of the image, which is stored at the bottom of the sink.
+inline std::byte* GetSinkRow(const ImageSink& sink, const ImageInfo& info, uint32_t y)
+{
+    return sink.Pixels.data() + static_cast<size_t>(info.Height - 1 - y) * sink.RowPitch;
+}
@@ -0,0 +1,391 @@
+#include "Inflate.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+static constexpr uint16_t kLengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10,  11,  13,
+                                             15, 17, 19, 23, 27, 31, 35, 43,  51,  59,
+                                             67, 83, 99, 115, 131, 163, 195, 227, 258};
+
+static constexpr uint8_t kLengthExtraBits[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                                 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+static constexpr uint16_t kDistanceBase[30] = {1,    2,    3,    4,     5,     7,    9,    13,
+                                               17,   25,   33,   49,    65,    97,   129,  193,
+                                               257,  385,  513,  769,   1025,  1537, 2049, 3073,
+                                               4097, 6145, 8193, 12289, 16385, 24577};
+
+static constexpr uint8_t kDistanceExtraBits[30] = {0, 0, 0, 0, 1, 1, 2,  2,  3,  3,
+                                                   4, 4, 5, 5, 6, 6, 7,  7,  8,  8,
+                                                   9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// The order in which the lengths of the code length code are stored.
+static constexpr uint8_t kCodeLengthOrder[19] = {16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                                                 11, 4,  12, 3, 13, 2, 14, 1, 15};
+
+static uint32_t ReverseBits(uint32_t code, int count)
+{
+    uint32_t reversed = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        reversed = (reversed << 1) | (code & 1);
+        code >>= 1;
+    }
+
+    return reversed;
+}
+
+Inflater::Inflater(std::vector<std::span<const std::byte>> input)
+    : m_input(std::move(input)), m_window(kWindowSize)
+{
+    uint32_t cmf = GetBits(8);
+    uint32_t flags = GetBits(8);
+
+    if ((cmf & 0x0F) != 8 || (cmf >> 4) > 7 || (cmf * 256 + flags) % 31 != 0)
+        throw std::runtime_error("Not a zlib stream.");
+
+    if (flags & 0x20)
+        throw std::runtime_error("zlib streams with a preset dictionary are not supported.");
+}
+
+void Inflater::Refill()
+{
+    while (m_bitCount <= 56 && m_inputIdx < m_input.size())
+    {
+        std::span<const std::byte> input = m_input[m_inputIdx];
+
+        if (m_inputPos == input.size())
+        {
+            ++m_inputIdx;
+            m_inputPos = 0;
+            continue;
+        }
+
+        m_bits |= static_cast<uint64_t>(input[m_inputPos++]) << m_bitCount;
+        m_bitCount += 8;
+    }
+}
+
+uint32_t Inflater::GetBits(int count)
+{
+    if (m_bitCount < count)
+    {
+        Refill();
+
+        if (m_bitCount < count)
+            throw std::runtime_error("Unexpected end of compressed data.");
+    }
+
+    uint32_t value = static_cast<uint32_t>(m_bits & ((1ull << count) - 1));
+
+    m_bits >>= count;
+    m_bitCount -= count;
+
+    return value;
+}
+
+void Inflater::BuildTable(std::span<const uint8_t> lengths, HuffmanTable* table)
+{
+    memset(table->Counts, 0, sizeof(table->Counts));
+
+    for (uint8_t length : lengths)
+        ++table->Counts[length];
+
+    table->Counts[0] = 0;
+
+    // Incomplete codes are allowed, e.g. a distance code with a single code, but a code with more
+    // codes than lengths can hold isn't.
+    int left = 1;
+
+    for (int length = 1; length <= kMaxCodeLength; ++length)
+    {
+        left = left * 2 - table->Counts[length];
+
+        if (left < 0)
+            throw std::runtime_error("Invalid Huffman code.");
+    }
+
+    uint16_t offsets[kMaxCodeLength + 1] = {};
+
+    for (int length = 1; length < kMaxCodeLength; ++length)
+        offsets[length + 1] = offsets[length] + table->Counts[length];
+
+    for (size_t symbol = 0; symbol < lengths.size(); ++symbol)
+    {
+        if (lengths[symbol] != 0)
+            table->Symbols[offsets[lengths[symbol]]++] = static_cast<uint16_t>(symbol);
+    }
+
+    memset(table->Fast, 0, sizeof(table->Fast));
+
+    // Codes are assigned in symbol order within each length, so walking the sorted symbols
+    // reproduces them.
+    uint32_t code = 0;
+    int symbolIdx = 0;
+
+    for (int length = 1; length <= kFastBits; ++length)
+    {
+        for (int i = 0; i < table->Counts[length]; ++i, ++code, ++symbolIdx)
+        {
+            uint16_t entry = static_cast<uint16_t>(length << 9 | table->Symbols[symbolIdx]);
+
+            for (uint32_t bits = ReverseBits(code, length); bits < (1u << kFastBits);
+                 bits += 1u << length)
+            {
+                table->Fast[bits] = entry;
+            }
+        }
+
+        code <<= 1;
+    }
+}
+
+int Inflater::Decode(const HuffmanTable& table)
+{
+    if (m_bitCount < kMaxCodeLength)
+        Refill();
+
+    uint16_t entry = table.Fast[m_bits & ((1u << kFastBits) - 1)];
+    int length = entry >> 9;
+
+    if (entry != 0 && length <= m_bitCount)
+    {
+        m_bits >>= length;
+        m_bitCount -= length;
+
+        return entry & 0x1FF;
+    }
+
+    // Codes are stored most significant bit first, so they are read one bit at a time.
+    int code = 0;
+    int first = 0;
+    int index = 0;
+
+    for (length = 1; length <= kMaxCodeLength; ++length)
+    {
+        code |= static_cast<int>(GetBits(1));
+
+        int count = table.Counts[length];
+
+        if (code - first < count)
+            return table.Symbols[index + code - first];
+
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+
+    throw std::runtime_error("Invalid Huffman code.");
+}
+
+void Inflater::ReadBlockHeader()
+{
+    if (m_finalBlock)
+        throw std::runtime_error("Unexpected end of compressed data.");
+
+    m_finalBlock = GetBits(1) != 0;
+
+    switch (GetBits(2))
+    {
+    case 0:
+    {
+        // Stored blocks start at a byte boundary.
+        GetBits(m_bitCount % 8);
+
+        uint32_t length = GetBits(16);
+        uint32_t complement = GetBits(16);
+
+        if ((length ^ 0xFFFF) != complement)
+            throw std::runtime_error("Invalid stored block length.");
+
+        m_storedRemaining = length;
+        m_state = BlockState::Stored;
+        break;
+    }
+    case 1:
+    {
+        uint8_t lengths[288];
+        std::fill(lengths, lengths + 144, uint8_t(8));
+        std::fill(lengths + 144, lengths + 256, uint8_t(9));
+        std::fill(lengths + 256, lengths + 280, uint8_t(7));
+        std::fill(lengths + 280, lengths + 288, uint8_t(8));
+
+        BuildTable(lengths, &m_literals);
+
+        std::fill(lengths, lengths + 30, uint8_t(5));
+        BuildTable(std::span(lengths, 30), &m_distances);
+
+        m_state = BlockState::Huffman;
+        break;
+    }
+    case 2:
+        ReadDynamicTables();
+        m_state = BlockState::Huffman;
+        break;
+    default:
+        throw std::runtime_error("Invalid block type.");
+    }
+}
+
+void Inflater::ReadDynamicTables()
+{
+    uint32_t literalCount = GetBits(5) + 257;
+    uint32_t distanceCount = GetBits(5) + 1;
+    uint32_t codeLengthCount = GetBits(4) + 4;
+
+    if (literalCount > 286 || distanceCount > 30)
+        throw std::runtime_error("Invalid code counts.");
+
+    uint8_t codeLengthLengths[19] = {};
+
+    for (uint32_t i = 0; i < codeLengthCount; ++i)
+        codeLengthLengths[kCodeLengthOrder[i]] = static_cast<uint8_t>(GetBits(3));
+
+    HuffmanTable codeLengths;
+    BuildTable(codeLengthLengths, &codeLengths);
+
+    // The literal and distance lengths are one sequence, and repeats may cross from one to the
+    // other.
+    uint8_t lengths[286 + 30] = {};
+    uint32_t count = literalCount + distanceCount;
+
+    for (uint32_t i = 0; i < count;)
+    {
+        int symbol = Decode(codeLengths);
+
+        if (symbol < 16)
+        {
+            lengths[i++] = static_cast<uint8_t>(symbol);
+            continue;
+        }
+
+        uint8_t value = 0;
+        uint32_t repeat = 0;
+
+        if (symbol == 16)
+        {
+            if (i == 0)
+                throw std::runtime_error("Invalid code length repeat.");
+
+            value = lengths[i - 1];
+            repeat = 3 + GetBits(2);
+        }
+        else if (symbol == 17)
+        {
+            repeat = 3 + GetBits(3);
+        }
+        else
+        {
+            repeat = 11 + GetBits(7);
+        }
+
+        if (i + repeat > count)
+            throw std::runtime_error("Invalid code length repeat.");
+
+        std::fill(lengths + i, lengths + i + repeat, value);
+        i += repeat;
+    }
+
+    if (lengths[256] == 0)
+        throw std::runtime_error("Missing end of block code.");
+
+    BuildTable(std::span(lengths, literalCount), &m_literals);
+    BuildTable(std::span(lengths + literalCount, distanceCount), &m_distances);
+}
+
+void Inflater::Output(std::byte value, std::byte* dst)
+{
+    *dst = value;
+
+    m_window[m_written & (kWindowSize - 1)] = value;
+    ++m_written;
+}
+
+void Inflater::Read(std::span<std::byte> dst)
+{
+    size_t pos = 0;
+
+    while (pos < dst.size())
+    {
+        if (m_matchLength > 0)
+        {
+            uint32_t length =
+                static_cast<uint32_t>(std::min<size_t>(m_matchLength, dst.size() - pos));
+
+            for (uint32_t i = 0; i < length; ++i)
+            {
+                std::byte value = m_window[(m_written - m_matchDistance) & (kWindowSize - 1)];
+                Output(value, &dst[pos++]);
+            }
+
+            m_matchLength -= length;
+            continue;
+        }
+
+        switch (m_state)
+        {
+        case BlockState::Header:
+            ReadBlockHeader();
+            break;
+
+        case BlockState::Stored:
+            if (m_storedRemaining == 0)
+            {
+                m_state = m_finalBlock ? BlockState::Done : BlockState::Header;
+                break;
+            }
+
+            Output(static_cast<std::byte>(GetBits(8)), &dst[pos++]);
+            --m_storedRemaining;
+            break;
+
+        case BlockState::Huffman:
+        {
+            int symbol = Decode(m_literals);
+
+            if (symbol < 256)
+            {
+                Output(static_cast<std::byte>(symbol), &dst[pos++]);
+                break;
+            }
+
+            if (symbol == 256)
+            {
+                m_state = m_finalBlock ? BlockState::Done : BlockState::Header;
+                break;
+            }
+
+            symbol -= 257;
+
+            if (symbol >= 29)
+                throw std::runtime_error("Invalid length code.");
+
+            m_matchLength = kLengthBase[symbol] + GetBits(kLengthExtraBits[symbol]);
+
+            int distanceSymbol = Decode(m_distances);
+
+            if (distanceSymbol >= 30)
+                throw std::runtime_error("Invalid distance code.");
+
+            m_matchDistance =
+                kDistanceBase[distanceSymbol] + GetBits(kDistanceExtraBits[distanceSymbol]);
+
+            if (m_matchDistance > m_written)
+                throw std::runtime_error("Distance too far back.");
+
+            break;
+        }
+
+        case BlockState::Done:
+            throw std::runtime_error("Unexpected end of compressed data.");
+        }
+    }
+}
+
+void Inflate(std::span<const std::byte> src, std::span<std::byte> dst)
+{
+    Inflater inflater({src});
+    inflater.Read(dst);
+}
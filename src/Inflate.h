@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Decompresses a zlib stream a piece at a time, so that the output never has to be held whole.
+// The input may be split over several spans, like the IDAT chunks of a png. The adler32 checksum
+// at the end of the stream isn't checked.
+class Inflater
+{
+public:
+    explicit Inflater(std::vector<std::span<const std::byte>> input);
+
+    // Fills dst with the next dst.size() bytes of output. Throws std::runtime_error if the stream
+    // is malformed or ends first.
+    void Read(std::span<std::byte> dst);
+
+private:
+    static constexpr int kFastBits = 9;
+    static constexpr int kMaxCodeLength = 15;
+    static constexpr uint32_t kWindowSize = 32768;
+
+    struct HuffmanTable
+    {
+        // Indexed by the next kFastBits bits of input: the code length << 9 | the symbol, or zero
+        // for codes that are longer.
+        uint16_t Fast[1 << kFastBits];
+
+        uint16_t Counts[kMaxCodeLength + 1];
+
+        // Ordered by code.
+        uint16_t Symbols[288];
+    };
+
+    enum class BlockState
+    {
+        Header,
+        Stored,
+        Huffman,
+        Done
+    };
+
+    void Refill();
+    uint32_t GetBits(int count);
+
+    void BuildTable(std::span<const uint8_t> lengths, HuffmanTable* table);
+    int Decode(const HuffmanTable& table);
+
+    void ReadBlockHeader();
+    void ReadDynamicTables();
+
+    void Output(std::byte value, std::byte* dst);
+
+    std::vector<std::span<const std::byte>> m_input;
+    size_t m_inputIdx = 0;
+    size_t m_inputPos = 0;
+
+    uint64_t m_bits = 0;
+    int m_bitCount = 0;
+
+    BlockState m_state = BlockState::Header;
+    bool m_finalBlock = false;
+    uint32_t m_storedRemaining = 0;
+
+    HuffmanTable m_literals;
+    HuffmanTable m_distances;
+
+    // A back-reference that didn't fit in the last Read.
+    uint32_t m_matchLength = 0;
+    uint32_t m_matchDistance = 0;
+
+    std::vector<std::byte> m_window;
+    uint64_t m_written = 0;
+};
+
+// Decompresses a zlib stream into dst. Throws std::runtime_error if the stream holds less.
+void Inflate(std::span<const std::byte> src, std::span<std::byte> dst);
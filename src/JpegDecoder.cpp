@@ -0,0 +1,844 @@
+#include "ImageCodecs.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+
+// The natural order position of each coefficient in zigzag order.
+constexpr uint8_t kZigzag[64] = {0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18,
+                                 11, 4,  5,  12, 19, 26, 33, 40, 48, 41, 34, 27, 20,
+                                 13, 6,  7,  14, 21, 28, 35, 42, 49, 56, 57, 50, 43,
+                                 36, 29, 22, 15, 23, 30, 37, 44, 51, 58, 59, 52, 45,
+                                 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+
+constexpr uint8_t kSOF0 = 0xC0;
+constexpr uint8_t kSOF1 = 0xC1;
+constexpr uint8_t kDHT = 0xC4;
+constexpr uint8_t kJPG = 0xC8;
+constexpr uint8_t kDAC = 0xCC;
+constexpr uint8_t kSOF15 = 0xCF;
+constexpr uint8_t kRST0 = 0xD0;
+constexpr uint8_t kRST7 = 0xD7;
+constexpr uint8_t kSOI = 0xD8;
+constexpr uint8_t kEOI = 0xD9;
+constexpr uint8_t kSOS = 0xDA;
+constexpr uint8_t kDQT = 0xDB;
+constexpr uint8_t kDRI = 0xDD;
+constexpr uint8_t kAPP14 = 0xEE;
+
+constexpr int kFastBits = 9;
+
+struct HuffmanTable
+{
+    // Indexed by the next kFastBits bits of input: the code length << 8 | the symbol, or zero for
+    // codes that are longer.
+    uint16_t Fast[1 << kFastBits] = {};
+
+    // The largest code of each length, or -1, and what to add to a code of that length to get the
+    // index of its symbol.
+    int32_t MaxCode[17] = {};
+    int32_t SymbolOffset[17] = {};
+
+    uint8_t Symbols[256] = {};
+
+    bool IsDefined = false;
+};
+
+struct Component
+{
+    uint8_t Id = 0;
+
+    uint32_t SamplingX = 1;
+    uint32_t SamplingY = 1;
+
+    uint32_t QuantizationIdx = 0;
+    uint32_t DcTableIdx = 0;
+    uint32_t AcTableIdx = 0;
+
+    int DcPredictor = 0;
+
+    // Of blocks of 8x8 samples, padded to whole MCUs.
+    uint32_t BlocksWide = 0;
+    uint32_t BlocksHigh = 0;
+
+    // The decoded samples of a row of MCUs, or of the whole image when the components are spread
+    // over several scans.
+    std::vector<uint8_t> Plane;
+    size_t PlaneStride = 0;
+
+    // The sample column of each pixel column.
+    std::vector<uint32_t> ColumnMap;
+};
+
+// Reads entropy-coded data most significant bit first, dropping the zero bytes that follow
+// 0xFF bytes. Pads with zero bits once it reaches a marker.
+class BitReader
+{
+public:
+    BitReader(std::span<const std::byte> file, size_t pos) : m_file(file), m_pos(pos)
+    {
+    }
+
+    size_t GetPos() const
+    {
+        return m_pos;
+    }
+
+    uint32_t Peek(int count)
+    {
+        if (m_bitCount < count)
+            Refill();
+
+        return static_cast<uint32_t>(m_bits >> (64 - count));
+    }
+
+    void Consume(int count)
+    {
+        m_bits <<= count;
+        m_bitCount -= count;
+    }
+
+    uint32_t GetBits(int count)
+    {
+        if (count == 0)
+            return 0;
+
+        uint32_t value = Peek(count);
+        Consume(count);
+
+        return value;
+    }
+
+    // Drops the buffered bits, with the padding of the interval, and skips past the restart
+    // marker that should come next.
+    void Restart()
+    {
+        m_bits = 0;
+        m_bitCount = 0;
+
+        while (true)
+        {
+            if (m_pos + 1 >= m_file.size())
+                throw std::runtime_error("Missing restart marker.");
+
+            uint8_t marker = static_cast<uint8_t>(m_file[m_pos + 1]);
+
+            if (static_cast<uint8_t>(m_file[m_pos]) == 0xFF && marker >= kRST0 && marker <= kRST7)
+                break;
+
+            ++m_pos;
+        }
+
+        m_pos += 2;
+    }
+
+private:
+    void Refill()
+    {
+        while (m_bitCount <= 56)
+        {
+            uint64_t value = 0;
+
+            if (m_pos < m_file.size())
+            {
+                value = static_cast<uint8_t>(m_file[m_pos]);
+
+                if (value != 0xFF)
+                {
+                    ++m_pos;
+                }
+                else if (m_pos + 1 < m_file.size() && static_cast<uint8_t>(m_file[m_pos + 1]) == 0)
+                {
+                    m_pos += 2;
+                }
+                else
+                {
+                    // A marker, which ends the data. Leave it for the caller.
+                    value = 0;
+                }
+            }
+
+            m_bits |= value << (56 - m_bitCount);
+            m_bitCount += 8;
+        }
+    }
+
+    std::span<const std::byte> m_file;
+    size_t m_pos;
+
+    // The next bits are the most significant ones.
+    uint64_t m_bits = 0;
+    int m_bitCount = 0;
+};
+
+// The AAN inverse DCT leaves each coefficient scaled by 1 for k = 0 and cos(k pi / 16) * sqrt(2)
+// otherwise, along each axis, which is folded into the dequantization.
+float GetAanScale(int k)
+{
+    return k == 0 ? 1.f : std::cos(k * 3.14159265f / 16.f) * std::sqrt(2.f);
+}
+
+// A one-dimensional inverse DCT of the 8 values stride apart, in place, with the AAN factorization
+// of libjpeg's jidctflt.
+void Idct8(float* values, int stride)
+{
+    float* v = values;
+
+    // Even part.
+    float tmp10 = v[0] + v[4 * stride];
+    float tmp11 = v[0] - v[4 * stride];
+    float tmp13 = v[2 * stride] + v[6 * stride];
+    float tmp12 = (v[2 * stride] - v[6 * stride]) * 1.414213562f - tmp13;
+
+    float tmp0 = tmp10 + tmp13;
+    float tmp3 = tmp10 - tmp13;
+    float tmp1 = tmp11 + tmp12;
+    float tmp2 = tmp11 - tmp12;
+
+    // Odd part.
+    float z13 = v[5 * stride] + v[3 * stride];
+    float z10 = v[5 * stride] - v[3 * stride];
+    float z11 = v[1 * stride] + v[7 * stride];
+    float z12 = v[1 * stride] - v[7 * stride];
+
+    float tmp7 = z11 + z13;
+    tmp11 = (z11 - z13) * 1.414213562f;
+
+    float z5 = (z10 + z12) * 1.847759065f;
+    tmp10 = 1.082392200f * z12 - z5;
+    tmp12 = -2.613125930f * z10 + z5;
+
+    float tmp6 = tmp12 - tmp7;
+    float tmp5 = tmp11 - tmp6;
+    float tmp4 = tmp10 + tmp5;
+
+    v[0] = tmp0 + tmp7;
+    v[7 * stride] = tmp0 - tmp7;
+    v[1 * stride] = tmp1 + tmp6;
+    v[6 * stride] = tmp1 - tmp6;
+    v[2 * stride] = tmp2 + tmp5;
+    v[5 * stride] = tmp2 - tmp5;
+    v[4 * stride] = tmp3 + tmp4;
+    v[3 * stride] = tmp3 - tmp4;
+}
+
+uint8_t ClampToByte(float value)
+{
+    return static_cast<uint8_t>(std::clamp(value, 0.f, 255.f) + 0.5f);
+}
+
+class JpegDecoder
+{
+public:
+    JpegDecoder(std::span<const std::byte> file, ImageSink* sink) : m_file(file), m_sink(sink)
+    {
+    }
+
+    void Decode()
+    {
+        size_t pos = 2;
+
+        while (true)
+        {
+            uint8_t marker = ReadMarker(&pos);
+
+            if (marker == kEOI)
+                break;
+
+            std::span<const std::byte> segment = ReadSegment(&pos);
+
+            if (marker == kSOS)
+                pos = DecodeScan(segment, pos);
+            else if (marker == kSOF0 || marker == kSOF1)
+                ReadFrame(segment);
+            else if (marker == kDHT)
+                ReadHuffmanTables(segment);
+            else if (marker == kDQT)
+                ReadQuantizationTables(segment);
+            else if (marker == kDRI)
+                ReadRestartInterval(segment);
+            else if (marker == kAPP14)
+                ReadAdobeSegment(segment);
+            else if (marker == 0xC2 || marker == 0xC6 || marker == 0xCA || marker == 0xCE)
+                throw std::runtime_error("Progressive jpeg files are not supported.");
+            else if (marker > kSOF1 && marker <= kSOF15 && marker != kDHT && marker != kJPG &&
+                     marker != kDAC)
+                throw std::runtime_error("Unsupported jpeg coding process.");
+        }
+
+        if (m_scanCount == 0)
+            throw std::runtime_error("Missing scan.");
+
+        // Scans that each hold some of the components only fill the planes.
+        if (!m_streaming)
+            ConvertRows(0, m_info.Height, 0);
+    }
+
+private:
+    uint8_t ReadByte(size_t pos) const
+    {
+        if (pos >= m_file.size())
+            throw std::runtime_error("Unexpected end of file.");
+
+        return static_cast<uint8_t>(m_file[pos]);
+    }
+
+    uint32_t ReadBigEndian16(size_t pos) const
+    {
+        return static_cast<uint32_t>(ReadByte(pos)) << 8 | ReadByte(pos + 1);
+    }
+
+    // Skips to the next marker, past fill bytes and anything between segments, and returns it.
+    uint8_t ReadMarker(size_t* pos) const
+    {
+        while (true)
+        {
+            if (ReadByte(*pos) != 0xFF)
+            {
+                ++*pos;
+                continue;
+            }
+
+            uint8_t marker = ReadByte(*pos + 1);
+            *pos += 2;
+
+            if (marker != 0 && marker != 0xFF && (marker < kRST0 || marker > kRST7) &&
+                marker != kSOI)
+            {
+                return marker;
+            }
+
+            if (marker == 0xFF)
+                --*pos;
+        }
+    }
+
+    std::span<const std::byte> ReadSegment(size_t* pos) const
+    {
+        uint32_t length = ReadBigEndian16(*pos);
+
+        if (length < 2 || *pos + length > m_file.size())
+            throw std::runtime_error("Truncated segment.");
+
+        std::span<const std::byte> segment = m_file.subspan(*pos + 2, length - 2);
+        *pos += length;
+
+        return segment;
+    }
+
+    static uint8_t At(std::span<const std::byte> segment, size_t pos)
+    {
+        if (pos >= segment.size())
+            throw std::runtime_error("Truncated segment.");
+
+        return static_cast<uint8_t>(segment[pos]);
+    }
+
+    void ReadFrame(std::span<const std::byte> segment)
+    {
+        if (!m_components.empty())
+            throw std::runtime_error("More than one frame.");
+
+        if (At(segment, 0) != 8)
+            throw std::runtime_error("Only 8-bit jpeg files are supported.");
+
+        m_info.Height = At(segment, 1) << 8 | At(segment, 2);
+        m_info.Width = At(segment, 3) << 8 | At(segment, 4);
+        m_info.Format = PixelFormat::RGBA8;
+
+        uint32_t componentCount = At(segment, 5);
+
+        if (componentCount != 1 && componentCount != 3)
+            throw std::runtime_error("Only grayscale and 3 component jpeg files are supported.");
+
+        if (m_info.Height == 0)
+            throw std::runtime_error("Jpeg files with a DNL marker are not supported.");
+
+        m_components.resize(componentCount);
+
+        for (uint32_t i = 0; i < componentCount; ++i)
+        {
+            Component& component = m_components[i];
+            component.Id = At(segment, 6 + 3 * i);
+
+            uint8_t sampling = At(segment, 7 + 3 * i);
+            component.SamplingX = sampling >> 4;
+            component.SamplingY = sampling & 0x0F;
+            component.QuantizationIdx = At(segment, 8 + 3 * i);
+
+            if (component.SamplingX < 1 || component.SamplingX > 4 || component.SamplingY < 1 ||
+                component.SamplingY > 4 || component.QuantizationIdx > 3)
+            {
+                throw std::runtime_error("Invalid frame header.");
+            }
+
+            // The sampling of a single component doesn't matter.
+            if (componentCount == 1)
+                component.SamplingX = component.SamplingY = 1;
+
+            m_maxSamplingX = std::max(m_maxSamplingX, component.SamplingX);
+            m_maxSamplingY = std::max(m_maxSamplingY, component.SamplingY);
+        }
+
+        m_mcusWide = (m_info.Width + 8 * m_maxSamplingX - 1) / (8 * m_maxSamplingX);
+        m_mcusHigh = (m_info.Height + 8 * m_maxSamplingY - 1) / (8 * m_maxSamplingY);
+
+        for (Component& component : m_components)
+        {
+            component.BlocksWide = m_mcusWide * component.SamplingX;
+            component.BlocksHigh = m_mcusHigh * component.SamplingY;
+
+            component.ColumnMap.resize(m_info.Width);
+
+            for (uint32_t x = 0; x < m_info.Width; ++x)
+                component.ColumnMap[x] = x * component.SamplingX / m_maxSamplingX;
+        }
+
+        AllocateSink(m_info, m_sink);
+    }
+
+    void ReadHuffmanTables(std::span<const std::byte> segment)
+    {
+        size_t pos = 0;
+
+        while (pos < segment.size())
+        {
+            uint8_t classAndIdx = At(segment, pos);
+            uint32_t tableClass = classAndIdx >> 4;
+            uint32_t tableIdx = classAndIdx & 0x0F;
+
+            if (tableClass > 1 || tableIdx > 3)
+                throw std::runtime_error("Invalid Huffman table.");
+
+            HuffmanTable& table = tableClass == 0 ? m_dcTables[tableIdx] : m_acTables[tableIdx];
+            table = HuffmanTable{};
+
+            uint32_t counts[17] = {};
+            uint32_t symbolCount = 0;
+
+            for (int length = 1; length <= 16; ++length)
+            {
+                counts[length] = At(segment, pos + length);
+                symbolCount += counts[length];
+            }
+
+            if (symbolCount > 256)
+                throw std::runtime_error("Invalid Huffman table.");
+
+            pos += 17;
+
+            for (uint32_t i = 0; i < symbolCount; ++i)
+                table.Symbols[i] = At(segment, pos + i);
+
+            pos += symbolCount;
+
+            int32_t code = 0;
+            int32_t symbolIdx = 0;
+
+            for (int length = 1; length <= 16; ++length)
+            {
+                table.SymbolOffset[length] = symbolIdx - code;
+
+                for (uint32_t i = 0; i < counts[length]; ++i, ++code, ++symbolIdx)
+                {
+                    if (code >= (1 << length))
+                        throw std::runtime_error("Invalid Huffman table.");
+
+                    if (length > kFastBits)
+                        continue;
+
+                    uint16_t entry = static_cast<uint16_t>(length << 8 | table.Symbols[symbolIdx]);
+                    int shift = kFastBits - length;
+
+                    for (int32_t bits = 0; bits < (1 << shift); ++bits)
+                        table.Fast[code << shift | bits] = entry;
+                }
+
+                table.MaxCode[length] = counts[length] > 0 ? code - 1 : -1;
+                code <<= 1;
+            }
+
+            table.IsDefined = true;
+        }
+    }
+
+    void ReadQuantizationTables(std::span<const std::byte> segment)
+    {
+        size_t pos = 0;
+
+        while (pos < segment.size())
+        {
+            uint8_t precisionAndIdx = At(segment, pos++);
+            bool is16Bit = (precisionAndIdx >> 4) != 0;
+            uint32_t tableIdx = precisionAndIdx & 0x0F;
+
+            if (tableIdx > 3)
+                throw std::runtime_error("Invalid quantization table.");
+
+            for (int k = 0; k < 64; ++k)
+            {
+                uint32_t value = At(segment, pos++);
+
+                if (is16Bit)
+                    value = value << 8 | At(segment, pos++);
+
+                int n = kZigzag[k];
+
+                m_dequantization[tableIdx][n] =
+                    value * GetAanScale(n / 8) * GetAanScale(n % 8) / 8.f;
+            }
+        }
+    }
+
+    void ReadRestartInterval(std::span<const std::byte> segment)
+    {
+        m_restartInterval = At(segment, 0) << 8 | At(segment, 1);
+    }
+
+    void ReadAdobeSegment(std::span<const std::byte> segment)
+    {
+        if (segment.size() >= 12 && memcmp(segment.data(), "Adobe", 5) == 0)
+            m_isYCbCr = At(segment, 11) != 0;
+    }
+
+    int DecodeSymbol(BitReader* reader, const HuffmanTable& table)
+    {
+        uint32_t bits = reader->Peek(16);
+        uint16_t entry = table.Fast[bits >> (16 - kFastBits)];
+
+        if (entry != 0)
+        {
+            reader->Consume(entry >> 8);
+            return entry & 0xFF;
+        }
+
+        for (int length = kFastBits + 1; length <= 16; ++length)
+        {
+            int32_t code = static_cast<int32_t>(bits >> (16 - length));
+
+            if (code <= table.MaxCode[length])
+            {
+                reader->Consume(length);
+                return table.Symbols[code + table.SymbolOffset[length]];
+            }
+        }
+
+        throw std::runtime_error("Invalid Huffman code.");
+    }
+
+    // A coefficient of the given size in bits, which is negative if its top bit is clear.
+    static int Extend(uint32_t bits, int size)
+    {
+        if (size == 0)
+            return 0;
+
+        int value = static_cast<int>(bits);
+
+        return value < (1 << (size - 1)) ? value - (1 << size) + 1 : value;
+    }
+
+    void DecodeBlock(BitReader* reader, Component* component, uint8_t* dst, size_t stride)
+    {
+        const HuffmanTable& dcTable = m_dcTables[component->DcTableIdx];
+        const HuffmanTable& acTable = m_acTables[component->AcTableIdx];
+        const float* dequantization = m_dequantization[component->QuantizationIdx];
+
+        float coefficients[64] = {};
+
+        int dcSize = DecodeSymbol(reader, dcTable);
+
+        if (dcSize > 11)
+            throw std::runtime_error("Invalid DC coefficient.");
+
+        component->DcPredictor += Extend(reader->GetBits(dcSize), dcSize);
+        coefficients[0] = component->DcPredictor * dequantization[0];
+
+        bool hasAc = false;
+
+        for (int k = 1; k < 64;)
+        {
+            int runAndSize = DecodeSymbol(reader, acTable);
+            int run = runAndSize >> 4;
+            int size = runAndSize & 0x0F;
+
+            if (size == 0)
+            {
+                // End of block, or a run of 16 zeros.
+                if (run != 15)
+                    break;
+
+                k += 16;
+                continue;
+            }
+
+            k += run;
+
+            if (k > 63)
+                throw std::runtime_error("Invalid AC coefficient.");
+
+            int n = kZigzag[k];
+            coefficients[n] = Extend(reader->GetBits(size), size) * dequantization[n];
+            hasAc = true;
+            ++k;
+        }
+
+        if (!hasAc)
+        {
+            uint8_t value = ClampToByte(coefficients[0] + 128.f);
+
+            for (int y = 0; y < 8; ++y)
+                memset(dst + y * stride, value, 8);
+
+            return;
+        }
+
+        // Columns, then rows.
+        for (int x = 0; x < 8; ++x)
+            Idct8(&coefficients[x], 8);
+
+        for (int y = 0; y < 8; ++y)
+        {
+            Idct8(&coefficients[8 * y], 1);
+
+            for (int x = 0; x < 8; ++x)
+                dst[y * stride + x] = ClampToByte(coefficients[8 * y + x] + 128.f);
+        }
+    }
+
+    // Decodes the scan that starts after its header at pos and returns the position after it.
+    size_t DecodeScan(std::span<const std::byte> header, size_t pos)
+    {
+        if (m_components.empty())
+            throw std::runtime_error("Scan before the frame header.");
+
+        uint32_t scanComponentCount = At(header, 0);
+
+        if (scanComponentCount < 1 || scanComponentCount > m_components.size())
+            throw std::runtime_error("Invalid scan header.");
+
+        std::vector<Component*> components;
+
+        for (uint32_t i = 0; i < scanComponentCount; ++i)
+        {
+            uint8_t id = At(header, 1 + 2 * i);
+            uint8_t tables = At(header, 2 + 2 * i);
+
+            auto it = std::find_if(m_components.begin(), m_components.end(),
+                                   [&](const Component& c) { return c.Id == id; });
+
+            if (it == m_components.end())
+                throw std::runtime_error("Invalid scan header.");
+
+            it->DcTableIdx = tables >> 4;
+            it->AcTableIdx = tables & 0x0F;
+            it->DcPredictor = 0;
+
+            if (it->DcTableIdx > 3 || it->AcTableIdx > 3 || !m_dcTables[it->DcTableIdx].IsDefined ||
+                !m_acTables[it->AcTableIdx].IsDefined)
+            {
+                throw std::runtime_error("Missing Huffman table.");
+            }
+
+            components.push_back(&*it);
+        }
+
+        // A scan with every component can be converted a row of MCUs at a time, which only needs
+        // the samples of that row.
+        if (m_scanCount++ == 0)
+        {
+            m_streaming = scanComponentCount == m_components.size();
+
+            for (Component& component : m_components)
+            {
+                uint32_t planeBlocksHigh = m_streaming ? component.SamplingY : component.BlocksHigh;
+
+                component.PlaneStride = 8 * static_cast<size_t>(component.BlocksWide);
+                component.Plane.resize(component.PlaneStride * 8 * planeBlocksHigh);
+            }
+        }
+        else if (m_streaming)
+        {
+            throw std::runtime_error("Scan after a scan with every component.");
+        }
+
+        BitReader reader(m_file, pos);
+
+        uint32_t mcuCount = 0;
+
+        auto startMcu = [&] {
+            if (m_restartInterval != 0 && mcuCount != 0 && mcuCount % m_restartInterval == 0)
+            {
+                reader.Restart();
+
+                for (Component* component : components)
+                    component->DcPredictor = 0;
+            }
+
+            ++mcuCount;
+        };
+
+        if (scanComponentCount > 1)
+        {
+            for (uint32_t mcuY = 0; mcuY < m_mcusHigh; ++mcuY)
+            {
+                for (uint32_t mcuX = 0; mcuX < m_mcusWide; ++mcuX)
+                {
+                    startMcu();
+
+                    for (Component* component : components)
+                    {
+                        uint32_t planeY = m_streaming ? 0 : mcuY * component->SamplingY;
+
+                        for (uint32_t y = 0; y < component->SamplingY; ++y)
+                        {
+                            for (uint32_t x = 0; x < component->SamplingX; ++x)
+                            {
+                                size_t offset = 8 * ((planeY + y) * component->PlaneStride +
+                                                     mcuX * component->SamplingX + x);
+
+                                DecodeBlock(&reader, component, &component->Plane[offset],
+                                            component->PlaneStride);
+                            }
+                        }
+                    }
+                }
+
+                if (m_streaming)
+                    ConvertRows(mcuY * 8 * m_maxSamplingY, (mcuY + 1) * 8 * m_maxSamplingY, mcuY);
+            }
+        }
+        else
+        {
+            // A single component is stored block by block, with only the blocks that cover the
+            // image.
+            Component* component = components[0];
+
+            uint32_t width = (m_info.Width * component->SamplingX + m_maxSamplingX - 1) /
+                             m_maxSamplingX;
+            uint32_t height = (m_info.Height * component->SamplingY + m_maxSamplingY - 1) /
+                              m_maxSamplingY;
+
+            for (uint32_t blockY = 0; blockY < (height + 7) / 8; ++blockY)
+            {
+                for (uint32_t blockX = 0; blockX < (width + 7) / 8; ++blockX)
+                {
+                    startMcu();
+
+                    uint32_t planeY = m_streaming ? 0 : blockY;
+                    size_t offset = 8 * (planeY * component->PlaneStride + blockX);
+
+                    DecodeBlock(&reader, component, &component->Plane[offset],
+                                component->PlaneStride);
+                }
+
+                // Streaming scans of a single component have one block per MCU.
+                if (m_streaming)
+                    ConvertRows(blockY * 8, (blockY + 1) * 8, blockY);
+            }
+        }
+
+        return reader.GetPos();
+    }
+
+    // Converts rows [y0, y1) of the image into the sink, with the planes holding the samples from
+    // MCU row planeMcuY on.
+    void ConvertRows(uint32_t y0, uint32_t y1, uint32_t planeMcuY)
+    {
+        y1 = std::min(y1, m_info.Height);
+
+        for (uint32_t y = y0; y < y1; ++y)
+        {
+            const uint8_t* rows[3] = {};
+
+            for (size_t c = 0; c < m_components.size(); ++c)
+            {
+                const Component& component = m_components[c];
+
+                uint32_t sampleY = (y * component.SamplingY) / m_maxSamplingY -
+                                   planeMcuY * 8 * component.SamplingY;
+
+                rows[c] = &component.Plane[sampleY * component.PlaneStride];
+            }
+
+            uint8_t* dst = reinterpret_cast<uint8_t*>(GetSinkRow(*m_sink, m_info, y));
+
+            if (m_components.size() == 1)
+            {
+                for (uint32_t x = 0; x < m_info.Width; ++x, dst += 4)
+                {
+                    dst[0] = dst[1] = dst[2] = rows[0][x];
+                    dst[3] = 255;
+                }
+
+                continue;
+            }
+
+            const std::vector<uint32_t>& map0 = m_components[0].ColumnMap;
+            const std::vector<uint32_t>& map1 = m_components[1].ColumnMap;
+            const std::vector<uint32_t>& map2 = m_components[2].ColumnMap;
+
+            for (uint32_t x = 0; x < m_info.Width; ++x, dst += 4)
+            {
+                float c0 = rows[0][map0[x]];
+                float c1 = rows[1][map1[x]];
+                float c2 = rows[2][map2[x]];
+
+                if (m_isYCbCr)
+                {
+                    float cb = c1 - 128.f;
+                    float cr = c2 - 128.f;
+
+                    dst[0] = ClampToByte(c0 + 1.402f * cr);
+                    dst[1] = ClampToByte(c0 - 0.344136f * cb - 0.714136f * cr);
+                    dst[2] = ClampToByte(c0 + 1.772f * cb);
+                }
+                else
+                {
+                    dst[0] = static_cast<uint8_t>(c0);
+                    dst[1] = static_cast<uint8_t>(c1);
+                    dst[2] = static_cast<uint8_t>(c2);
+                }
+
+                dst[3] = 255;
+            }
+        }
+    }
+
+    std::span<const std::byte> m_file;
+    ImageSink* m_sink;
+
+    ImageInfo m_info;
+
+    std::vector<Component> m_components;
+    uint32_t m_maxSamplingX = 1;
+    uint32_t m_maxSamplingY = 1;
+
+    uint32_t m_mcusWide = 0;
+    uint32_t m_mcusHigh = 0;
+
+    HuffmanTable m_dcTables[4];
+    HuffmanTable m_acTables[4];
+
+    // In natural order, with the scales of the inverse DCT.
+    float m_dequantization[4][64] = {};
+
+    uint32_t m_restartInterval = 0;
+
+    // Unless an Adobe segment says the components are RGB.
+    bool m_isYCbCr = true;
+
+    uint32_t m_scanCount = 0;
+    bool m_streaming = false;
+};
+
+} // namespace
+
+void DecodeJpeg(std::span<const std::byte> file, ImageSink* sink)
+{
+    JpegDecoder decoder(file, sink);
+    decoder.Decode();
+}
@@ -0,0 +1,287 @@
+#include "LightSamplerTables.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+
+struct LightBounds
+{
+    glm::vec3 Min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 Max = glm::vec3(std::numeric_limits<float>::lowest());
+    float Phi = 0.f;
+
+    void Add(const LightBounds& other)
+    {
+        Min = glm::min(Min, other.Min);
+        Max = glm::max(Max, other.Max);
+        Phi += other.Phi;
+    }
+
+    float GetSurfaceArea() const
+    {
+        glm::vec3 d = Max - Min;
+
+        return 2.f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+};
+
+struct BvhLight
+{
+    uint32_t LightIdx;
+    LightBounds Bounds;
+    glm::vec3 Centroid;
+};
+
+// BVHLightSampler::EvaluateCost without its M_Omega term, which is the same for every node of
+// lights that emit in every direction.
+float EvaluateCost(const LightBounds& bounds, glm::vec3 parentDiagonal, int dim)
+{
+    float kr = std::max({parentDiagonal.x, parentDiagonal.y, parentDiagonal.z}) /
+               parentDiagonal[dim];
+
+    return bounds.Phi * kr * bounds.GetSurfaceArea();
+}
+
+// BVHLightSampler::buildBVH: splits at the cheapest of 12 buckets along any axis, or in the
+// middle when no split is cheaper. Returns the node's index.
+uint32_t BuildBvh(std::span<BvhLight> lights, std::vector<LightBvhNode>* nodes)
+{
+    uint32_t nodeIdx = static_cast<uint32_t>(nodes->size());
+    nodes->emplace_back();
+
+    LightBounds bounds;
+    LightBounds centroidBounds;
+
+    for (const BvhLight& light : lights)
+    {
+        bounds.Add(light.Bounds);
+
+        centroidBounds.Min = glm::min(centroidBounds.Min, light.Centroid);
+        centroidBounds.Max = glm::max(centroidBounds.Max, light.Centroid);
+    }
+
+    LightBvhNode node{};
+    node.Min = bounds.Min;
+    node.Max = bounds.Max;
+    node.Phi = bounds.Phi;
+
+    if (lights.size() == 1)
+    {
+        node.ChildOrLightIdx = lights[0].LightIdx;
+        node.IsLeaf = 1;
+        (*nodes)[nodeIdx] = node;
+
+        return nodeIdx;
+    }
+
+    constexpr int kBucketCount = 12;
+
+    float minCost = std::numeric_limits<float>::infinity();
+    int minCostBucket = -1;
+    int minCostDim = -1;
+
+    glm::vec3 diagonal = bounds.Max - bounds.Min;
+
+    auto getBucket = [&](const BvhLight& light, int dim)
+    {
+        float offset = (light.Centroid[dim] - centroidBounds.Min[dim]) /
+                       (centroidBounds.Max[dim] - centroidBounds.Min[dim]);
+
+        return std::min(static_cast<int>(offset * kBucketCount), kBucketCount - 1);
+    };
+
+    for (int dim = 0; dim < 3; ++dim)
+    {
+        if (centroidBounds.Max[dim] == centroidBounds.Min[dim])
+            continue;
+
+        LightBounds buckets[kBucketCount];
+
+        for (const BvhLight& light : lights)
+            buckets[getBucket(light, dim)].Add(light.Bounds);
+
+        for (int split = 0; split < kBucketCount - 1; ++split)
+        {
+            LightBounds below;
+            LightBounds above;
+
+            for (int i = 0; i <= split; ++i)
+                below.Add(buckets[i]);
+
+            for (int i = split + 1; i < kBucketCount; ++i)
+                above.Add(buckets[i]);
+
+            float cost = EvaluateCost(below, diagonal, dim) + EvaluateCost(above, diagonal, dim);
+
+            if (cost > 0.f && cost < minCost)
+            {
+                minCost = cost;
+                minCostBucket = split;
+                minCostDim = dim;
+            }
+        }
+    }
+
+    size_t mid = lights.size() / 2;
+
+    if (minCostDim != -1)
+    {
+        auto midIt = std::partition(lights.begin(), lights.end(), [&](const BvhLight& light)
+                                    { return getBucket(light, minCostDim) <= minCostBucket; });
+
+        mid = static_cast<size_t>(midIt - lights.begin());
+
+        if (mid == 0 || mid == lights.size())
+            mid = lights.size() / 2;
+    }
+
+    BuildBvh(lights.subspan(0, mid), nodes);
+    node.ChildOrLightIdx = BuildBvh(lights.subspan(mid), nodes);
+    node.IsLeaf = 0;
+    (*nodes)[nodeIdx] = node;
+
+    return nodeIdx;
+}
+
+// AliasTable's constructor. Lights without power are never picked, unless no light has any.
+std::vector<AliasBin> BuildAliasTable(std::span<const float> weights)
+{
+    size_t count = weights.size();
+    double sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+
+    std::vector<AliasBin> bins(count);
+
+    struct Outcome
+    {
+        double PHat;
+        uint32_t Idx;
+    };
+
+    std::vector<Outcome> under;
+    std::vector<Outcome> over;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        double p = sum > 0.0 ? weights[i] / sum : 1.0 / count;
+        bins[i].Pmf = static_cast<float>(p);
+
+        double pHat = p * count;
+
+        if (pHat < 1.0)
+            under.push_back({pHat, i});
+        else
+            over.push_back({pHat, i});
+    }
+
+    while (!under.empty() && !over.empty())
+    {
+        Outcome un = under.back();
+        under.pop_back();
+
+        Outcome ov = over.back();
+        over.pop_back();
+
+        bins[un.Idx].Q = static_cast<float>(un.PHat);
+        bins[un.Idx].Alias = ov.Idx;
+
+        double excess = un.PHat + ov.PHat - 1.0;
+
+        if (excess < 1.0)
+            under.push_back({excess, ov.Idx});
+        else
+            over.push_back({excess, ov.Idx});
+    }
+
+    // What is left is within rounding of one.
+    for (const std::vector<Outcome>* outcomes : {&under, &over})
+    {
+        for (const Outcome& outcome : *outcomes)
+        {
+            bins[outcome.Idx].Q = 1.f;
+            bins[outcome.Idx].Alias = outcome.Idx;
+        }
+    }
+
+    return bins;
+}
+
+} // namespace
+
+LightSamplerType ParseLightSamplerType(std::string_view name)
+{
+    if (name == "all")
+        return LightSamplerType::All;
+    if (name == "power")
+        return LightSamplerType::Power;
+    if (name == "bvh")
+        return LightSamplerType::Bvh;
+
+    throw std::runtime_error("Unknown light sampler: " + std::string(name));
+}
+
+const char* GetLightSamplerTypeName(LightSamplerType type)
+{
+    switch (type)
+    {
+        case LightSamplerType::All:
+            return "all";
+        case LightSamplerType::Power:
+            return "power";
+        case LightSamplerType::Bvh:
+            return "bvh";
+    }
+
+    return "unknown";
+}
+
+LightSampler LightSamplerTables::CreateSampler(LightSamplerType type) const
+{
+    return LightSampler(static_cast<uint32_t>(type), static_cast<uint32_t>(AliasTable.size()),
+                        AliasTable.data(), Bvh.data());
+}
+
+float GetLightPower(const SphereLight& light)
+{
+    constexpr float kPi = 3.14159265358979323846f;
+
+    float area = 4.f * kPi * light.Radius * light.Radius;
+
+    return kPi * area * (light.L.x + light.L.y + light.L.z) / 3.f;
+}
+
+LightSamplerTables BuildLightSamplerTables(std::span<const SphereLight> lights)
+{
+    LightSamplerTables tables;
+
+    if (lights.empty())
+        return tables;
+
+    std::vector<float> powers(lights.size());
+    std::vector<BvhLight> bvhLights(lights.size());
+
+    for (uint32_t i = 0; i < lights.size(); ++i)
+    {
+        const SphereLight& light = lights[i];
+
+        powers[i] = GetLightPower(light);
+
+        BvhLight& bvhLight = bvhLights[i];
+        bvhLight.LightIdx = i;
+        bvhLight.Bounds.Min = light.Position - glm::vec3(light.Radius);
+        bvhLight.Bounds.Max = light.Position + glm::vec3(light.Radius);
+        bvhLight.Bounds.Phi = powers[i];
+        bvhLight.Centroid = light.Position;
+    }
+
+    tables.AliasTable = BuildAliasTable(powers);
+
+    tables.Bvh.reserve(2 * lights.size() - 1);
+    BuildBvh(bvhLights, &tables.Bvh);
+
+    return tables;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "shaders/LightSampler.h"
+
+#include <span>
+#include <string_view>
+#include <vector>
+
+enum class LightSamplerType : uint32_t
+{
+    // Every light at every shading point, which costs a shadow ray per light.
+    All = LIGHT_SAMPLER_ALL,
+
+    // pbrt-v4's PowerLightSampler: lights in proportion to their power, from an alias table.
+    Power = LIGHT_SAMPLER_POWER,
+
+    // pbrt-v4's BVHLightSampler: down a tree of the lights, by the importance of each subtree to
+    // the shading point.
+    Bvh = LIGHT_SAMPLER_BVH
+};
+
+LightSamplerType ParseLightSamplerType(std::string_view name);
+
+const char* GetLightSamplerTypeName(LightSamplerType type);
+
+// Everything the light samplers of a scene read.
+struct LightSamplerTables
+{
+    // An entry per light.
+    std::vector<AliasBin> AliasTable;
+
+    // A leaf per light, the root first.
+    std::vector<LightBvhNode> Bvh;
+
+    // Not for LightSamplerType::All, which needs no sampler.
+    LightSampler CreateSampler(LightSamplerType type) const;
+};
+
+// The power of a sphere light as pbrt-v4's DiffuseAreaLight::Phi has it, averaged over RGB.
+float GetLightPower(const SphereLight& light);
+
+LightSamplerTables BuildLightSamplerTables(std::span<const SphereLight> lights);
@@ -0,0 +1,84 @@
+#include "LoadQueue.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+LoadQueue::LoadQueue(ThreadPool* pool) : m_pool(pool)
+{
+}
+
+LoadQueue::~LoadQueue()
+{
+    std::unique_lock lock(m_mutex);
+    m_completedCondition.wait(lock, [this] { return m_completed.size() == m_outstanding; });
+}
+
+size_t LoadQueue::Add(std::string name, std::function<void()> job)
+{
+    size_t jobIdx = m_names.size();
+    m_names.push_back(std::move(name));
+
+    {
+        std::lock_guard lock(m_mutex);
+        ++m_outstanding;
+    }
+
+    m_pool->Submit([this, jobIdx, job = std::move(job)] {
+        Completion completion{};
+        completion.JobIdx = jobIdx;
+
+        auto start = std::chrono::steady_clock::now();
+
+        try
+        {
+            job();
+        }
+        catch (...)
+        {
+            completion.Error = std::current_exception();
+        }
+
+        std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        completion.Milliseconds = elapsed.count();
+
+        // Notify under the lock: once it is released the queue may be destroyed.
+        std::lock_guard lock(m_mutex);
+
+        m_completed.push_back(std::move(completion));
+        m_completedCondition.notify_all();
+    });
+
+    return jobIdx;
+}
+
+bool LoadQueue::WaitNext(size_t* jobIdx)
+{
+    Completion completion{};
+
+    {
+        std::unique_lock lock(m_mutex);
+
+        if (m_outstanding == 0)
+            return false;
+
+        m_completedCondition.wait(lock, [this] { return !m_completed.empty(); });
+
+        completion = std::move(m_completed.front());
+        m_completed.pop_front();
+
+        --m_outstanding;
+    }
+
+    std::cout << "Loaded " << m_names[completion.JobIdx] << " in " << std::fixed
+              << std::setprecision(1) << completion.Milliseconds << " ms"
+              << (completion.Error ? " (failed)" : "") << std::endl;
+
+    if (completion.Error)
+        std::rethrow_exception(completion.Error);
+
+    *jobIdx = completion.JobIdx;
+
+    return true;
+}
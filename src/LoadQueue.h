@@ -0,0 +1,48 @@
+#pragma once
+
+#include "ThreadPool.h"
+
+#include <exception>
+#include <functional>
+#include <string>
+
+// Runs scene loading jobs (mesh and texture decodes) on a thread pool and hands them back in the
+// order they complete, so that the caller can upload each result as soon as it is ready.
+class LoadQueue
+{
+public:
+    explicit LoadQueue(ThreadPool* pool);
+
+    // Waits for outstanding jobs, since they may reference state owned by the caller.
+    ~LoadQueue();
+
+    LoadQueue(const LoadQueue&) = delete;
+    LoadQueue& operator=(const LoadQueue&) = delete;
+
+    // Returns the index of the job, which is what WaitNext reports once it has completed.
+    size_t Add(std::string name, std::function<void()> job);
+
+    // Blocks until another job has completed and returns its index. Returns false once every job
+    // that was added has been returned. Logs the time each job took and rethrows its exception if
+    // it failed.
+    bool WaitNext(size_t* jobIdx);
+
+private:
+    struct Completion
+    {
+        size_t JobIdx = 0;
+        double Milliseconds = 0.0;
+
+        std::exception_ptr Error;
+    };
+
+    ThreadPool* m_pool;
+
+    std::vector<std::string> m_names;
+
+    std::mutex m_mutex;
+    std::condition_variable m_completedCondition;
+
+    std::deque<Completion> m_completed;
+    size_t m_outstanding = 0;
+};
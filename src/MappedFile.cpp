@@ -0,0 +1,165 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+    m_file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                         OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+    if (m_file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Could not open file.");
+
+    LARGE_INTEGER size{};
+    GetFileSizeEx(m_file, &size);
+
+    m_size = static_cast<size_t>(size.QuadPart);
+
+    if (m_size == 0)
+        return;
+
+    m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (!m_mapping)
+    {
+        CloseHandle(m_file);
+        throw std::runtime_error("Could not map file.");
+    }
+
+    m_data = static_cast<const std::byte*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+
+    if (!m_data)
+    {
+        CloseHandle(m_mapping);
+        CloseHandle(m_file);
+        throw std::runtime_error("Could not map file.");
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data)
+        UnmapViewOfFile(m_data);
+
+    if (m_mapping)
+        CloseHandle(m_mapping);
+
+    CloseHandle(m_file);
+}
+
+void MappedFile::Release(size_t, size_t) const
+{
+}
+
+#else
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+
+    if (fd < 0)
+        throw std::runtime_error("Could not open file.");
+
+    struct stat st{};
+
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("Could not stat file.");
+    }
+
+    m_size = static_cast<size_t>(st.st_size);
+
+    if (m_size > 0)
+    {
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            throw std::runtime_error("Could not map file.");
+        }
+
+        madvise(data, m_size, MADV_SEQUENTIAL);
+
+        m_data = static_cast<const std::byte*>(data);
+    }
+
+    // The mapping keeps its own reference to the file.
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data)
+        munmap(const_cast<std::byte*>(m_data), m_size);
+}
+
+void MappedFile::Release(size_t offset, size_t size) const
+{
+    static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+    // Only whole pages inside the range can be dropped.
+    size_t begin = (offset + pageSize - 1) / pageSize * pageSize;
+    size_t end = std::min(offset + size, m_size) / pageSize * pageSize;
+
+    if (m_data && begin < end)
+        madvise(const_cast<std::byte*>(m_data) + begin, end - begin, MADV_DONTNEED);
+}
+
+#endif
+
+void ReplaceFile(const std::filesystem::path& path,
+                 const std::function<void(std::ostream& file)>& write)
+{
+#ifdef _WIN32
+    unsigned long processId = GetCurrentProcessId();
+#else
+    long processId = getpid();
+#endif
+
+    std::filesystem::path tempPath = path;
+    tempPath += ".";
+    tempPath += std::to_string(processId);
+    tempPath += ".";
+    tempPath += std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    tempPath += ".tmp";
+
+    try
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+
+        if (!file)
+            throw std::runtime_error("Could not create " + tempPath.string() + ".");
+
+        write(file);
+        file.close();
+
+        if (!file)
+            throw std::runtime_error("Could not write " + tempPath.string() + ".");
+
+        std::filesystem::rename(tempPath, path);
+    }
+    catch (...)
+    {
+        std::error_code error;
+        std::filesystem::remove(tempPath, error);
+
+        throw;
+    }
+}
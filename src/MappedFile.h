@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <ostream>
+#include <span>
+
+// Read-only memory mapping of a whole file.
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::filesystem::path& path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::span<const std::byte> Data() const
+    {
+        return {m_data, m_size};
+    }
+
+    // Hints that the given range has been consumed and its pages can be dropped from the working
+    // set. The data stays readable - it is paged back in from the file if touched again.
+    void Release(size_t offset, size_t size) const;
+
+private:
+    const std::byte* m_data = nullptr;
+    size_t m_size = 0;
+
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
+
+// Writes a file through a temporary file next to it, unique to the process and thread, which is
+// then renamed over it, so that readers never see a partial file. The temporary file is removed if
+// writing or renaming it fails.
+void ReplaceFile(const std::filesystem::path& path,
+                 const std::function<void(std::ostream& file)>& write);
@@ -1,8 +1,18 @@
 #include "Mesh.h"
 
+#include "MappedFile.h"
+
 #include <rply.h>
 
+#include <algorithm>
+#include <bit>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
 
 static void PlyMessageCallback(p_ply, const char* message)
 {
@@ -29,6 +39,27 @@ static int PlyVertexCallback(p_ply_argument argument)
     return 1;
 }
 
+// Add quad faces as triangles.
+static void AppendQuadsAsTriangles(const std::vector<uint32_t>& quadIndices,
+                                   std::vector<uint32_t>* indices)
+{
+    if (quadIndices.empty())
+        return;
+
+    indices->reserve(indices->size() + 3 * quadIndices.size() / 2);
+
+    for (size_t i = 0; i < quadIndices.size(); i += 4)
+    {
+        indices->push_back(quadIndices[i]);
+        indices->push_back(quadIndices[i + 1]);
+        indices->push_back(quadIndices[i + 2]);
+
+        indices->push_back(quadIndices[i]);
+        indices->push_back(quadIndices[i + 2]);
+        indices->push_back(quadIndices[i + 3]);
+    }
+}
+
 struct FaceCallbackContext
 {
     int Face[4];
@@ -80,13 +111,16 @@ static int PlyFaceCallback(p_ply_argument argument)
     return 1;
 }
 
-void LoadMeshFromPlyFile(std::filesystem::path path, Mesh* mesh)
+void LoadMeshFromPlyFileRply(std::filesystem::path path, Mesh* mesh)
 {
-    p_ply ply = ply_open(path.string().c_str(), PlyMessageCallback, 0, nullptr);
+    std::unique_ptr<t_ply_, decltype(&ply_close)> plyHandle(
+        ply_open(path.string().c_str(), PlyMessageCallback, 0, nullptr), ply_close);
 
-    if (!ply)
+    if (!plyHandle)
         throw std::runtime_error("Could not open ply file.");
 
+    p_ply ply = plyHandle.get();
+
     if (ply_read_header(ply) == 0)
         throw std::runtime_error("Could not open ply header.");
 
@@ -153,20 +187,641 @@ void LoadMeshFromPlyFile(std::filesystem::path path, Mesh* mesh)
 
     mesh->Indices = std::move(context.TriIndices);
 
-    // Add quad faces as triangles.
-    if (!context.QuadIndices.empty())
+    AppendQuadsAsTriangles(context.QuadIndices, &mesh->Indices);
+}
+
+namespace
+{
+
+enum class PlyFormat
+{
+    Ascii,
+    BinaryLittleEndian,
+    BinaryBigEndian
+};
+
+enum class PlyType
+{
+    Int8,
+    Uint8,
+    Int16,
+    Uint16,
+    Int32,
+    Uint32,
+    Float32,
+    Float64
+};
+
+struct PlyProperty
+{
+    std::string Name;
+    PlyType Type = PlyType::Float32;
+
+    bool IsList = false;
+    PlyType CountType = PlyType::Uint8;
+};
+
+struct PlyElement
+{
+    std::string Name;
+    size_t Count = 0;
+
+    std::vector<PlyProperty> Properties;
+};
+
+struct PlyHeader
+{
+    PlyFormat Format = PlyFormat::Ascii;
+    std::vector<PlyElement> Elements;
+
+    // Offset of the first byte after "end_header".
+    size_t DataOffset = 0;
+};
+
+} // namespace
+
+static PlyType ParsePlyType(const std::string& name)
+{
+    if (name == "char" || name == "int8")
+        return PlyType::Int8;
+    if (name == "uchar" || name == "uint8")
+        return PlyType::Uint8;
+    if (name == "short" || name == "int16")
+        return PlyType::Int16;
+    if (name == "ushort" || name == "uint16")
+        return PlyType::Uint16;
+    if (name == "int" || name == "int32")
+        return PlyType::Int32;
+    if (name == "uint" || name == "uint32")
+        return PlyType::Uint32;
+    if (name == "float" || name == "float32")
+        return PlyType::Float32;
+    if (name == "double" || name == "float64")
+        return PlyType::Float64;
+
+    throw std::runtime_error("Unknown ply property type.");
+}
+
+static size_t GetPlyTypeSize(PlyType type)
+{
+    switch (type)
+    {
+        case PlyType::Int8:
+        case PlyType::Uint8:
+            return 1;
+        case PlyType::Int16:
+        case PlyType::Uint16:
+            return 2;
+        case PlyType::Int32:
+        case PlyType::Uint32:
+        case PlyType::Float32:
+            return 4;
+        case PlyType::Float64:
+            return 8;
+    }
+
+    return 0;
+}
+
+template<typename T, typename U>
+static T ReadPlyValue(const std::byte* ptr)
+{
+    U value;
+    memcpy(&value, ptr, sizeof(U));
+
+    return static_cast<T>(value);
+}
+
+template<typename T>
+static T ReadPlyScalar(const std::byte* ptr, PlyType type)
+{
+    switch (type)
+    {
+        case PlyType::Int8:
+            return ReadPlyValue<T, int8_t>(ptr);
+        case PlyType::Uint8:
+            return ReadPlyValue<T, uint8_t>(ptr);
+        case PlyType::Int16:
+            return ReadPlyValue<T, int16_t>(ptr);
+        case PlyType::Uint16:
+            return ReadPlyValue<T, uint16_t>(ptr);
+        case PlyType::Int32:
+            return ReadPlyValue<T, int32_t>(ptr);
+        case PlyType::Uint32:
+            return ReadPlyValue<T, uint32_t>(ptr);
+        case PlyType::Float32:
+            return ReadPlyValue<T, float>(ptr);
+        case PlyType::Float64:
+            return ReadPlyValue<T, double>(ptr);
+    }
+
+    return T{};
+}
+
+static void ParsePlyHeader(std::span<const std::byte> data, PlyHeader* header)
+{
+    std::string_view text(reinterpret_cast<const char*>(data.data()), data.size());
+
+    size_t lineStart = 0;
+    bool isFirstLine = true;
+
+    while (true)
+    {
+        size_t lineEnd = text.find('\n', lineStart);
+
+        if (lineEnd == std::string_view::npos)
+            throw std::runtime_error("Could not open ply header.");
+
+        std::string line(text.substr(lineStart, lineEnd - lineStart));
+        lineStart = lineEnd + 1;
+
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        if (isFirstLine)
+        {
+            if (line != "ply")
+                throw std::runtime_error("Not a ply file.");
+
+            isFirstLine = false;
+            continue;
+        }
+
+        std::istringstream tokens(line);
+
+        std::string keyword;
+        tokens >> keyword;
+
+        if (keyword == "format")
+        {
+            std::string format;
+            tokens >> format;
+
+            if (format == "ascii")
+                header->Format = PlyFormat::Ascii;
+            else if (format == "binary_little_endian")
+                header->Format = PlyFormat::BinaryLittleEndian;
+            else if (format == "binary_big_endian")
+                header->Format = PlyFormat::BinaryBigEndian;
+            else
+                throw std::runtime_error("Unknown ply format.");
+        }
+        else if (keyword == "element")
+        {
+            auto& element = header->Elements.emplace_back();
+            tokens >> element.Name >> element.Count;
+        }
+        else if (keyword == "property")
+        {
+            if (header->Elements.empty())
+                throw std::runtime_error("Ply property declared before any element.");
+
+            auto& property = header->Elements.back().Properties.emplace_back();
+
+            std::string type;
+            tokens >> type;
+
+            if (type == "list")
+            {
+                std::string countType;
+                tokens >> countType >> type;
+
+                property.IsList = true;
+                property.CountType = ParsePlyType(countType);
+            }
+
+            property.Type = ParsePlyType(type);
+            tokens >> property.Name;
+        }
+        else if (keyword == "end_header")
+        {
+            header->DataOffset = lineStart;
+            return;
+        }
+    }
+}
+
+static const PlyProperty* FindPlyProperty(const PlyElement& element, const char* name,
+                                          size_t* offset)
+{
+    size_t currentOffset = 0;
+
+    for (const auto& property : element.Properties)
+    {
+        if (property.Name == name)
+        {
+            if (offset)
+                *offset = currentOffset;
+
+            return &property;
+        }
+
+        currentOffset += GetPlyTypeSize(property.Type);
+    }
+
+    return nullptr;
+}
+
+static bool HasFixedStride(const PlyElement& element, size_t* stride)
+{
+    *stride = 0;
+
+    for (const auto& property : element.Properties)
+    {
+        if (property.IsList)
+            return false;
+
+        *stride += GetPlyTypeSize(property.Type);
+    }
+
+    return true;
+}
+
+static const std::byte* SkipPlyProperty(const PlyProperty& property, const std::byte* ptr,
+                                        const std::byte* end)
+{
+    size_t size = GetPlyTypeSize(property.Type);
+
+    if (property.IsList)
+    {
+        if (ptr + GetPlyTypeSize(property.CountType) > end)
+            throw std::runtime_error("Unexpected end of ply file.");
+
+        size = size * ReadPlyScalar<size_t>(ptr, property.CountType) +
+               GetPlyTypeSize(property.CountType);
+    }
+
+    if (static_cast<size_t>(end - ptr) < size)
+        throw std::runtime_error("Unexpected end of ply file.");
+
+    return ptr + size;
+}
+
+// Locations of N consecutive attribute components (e.g. x, y, z) within a vertex.
+template<size_t N>
+struct PlyVertexAttribute
+{
+    size_t Offsets[N] = {};
+    PlyType Types[N] = {};
+
+    bool IsPackedFloat = true;
+};
+
+template<size_t N>
+static PlyVertexAttribute<N> FindPlyVertexAttribute(const PlyElement& element,
+                                                    const char* const (&names)[N])
+{
+    PlyVertexAttribute<N> attribute;
+
+    for (size_t i = 0; i < N; ++i)
+    {
+        const PlyProperty* property = FindPlyProperty(element, names[i], &attribute.Offsets[i]);
+
+        if (!property)
+            throw std::runtime_error("Could not find vertex data.");
+
+        attribute.Types[i] = property->Type;
+
+        attribute.IsPackedFloat = attribute.IsPackedFloat && property->Type == PlyType::Float32 &&
+                                  attribute.Offsets[i] == attribute.Offsets[0] + i * sizeof(float);
+    }
+
+    return attribute;
+}
+
+template<size_t N>
+static void ReadPlyVertexAttribute(const PlyVertexAttribute<N>& attribute,
+                                   const std::byte* vertices, size_t stride, size_t count,
+                                   float* dst)
+{
+    if (attribute.IsPackedFloat)
+    {
+        for (size_t v = 0; v < count; ++v)
+            memcpy(dst + v * N, vertices + v * stride + attribute.Offsets[0], N * sizeof(float));
+    }
+    else
+    {
+        for (size_t v = 0; v < count; ++v)
+        {
+            for (size_t i = 0; i < N; ++i)
+            {
+                dst[v * N + i] = ReadPlyScalar<float>(vertices + v * stride + attribute.Offsets[i],
+                                                      attribute.Types[i]);
+            }
+        }
+    }
+}
+
+namespace
+{
+
+// Where the vertex and face data of a binary ply file live, computed before anything is decoded.
+struct PlyBinaryLayout
+{
+    const PlyElement* Vertices = nullptr;
+    size_t VertexOffset = 0;
+    size_t VertexStride = 0;
+
+    const PlyElement* Faces = nullptr;
+    const PlyProperty* FaceIndices = nullptr;
+    size_t FaceOffset = 0;
+
+    size_t TriangleCount = 0;
+    size_t QuadCount = 0;
+};
+
+} // namespace
+
+// Walks the face lists once to validate them and count triangles and quads, so that the index
+// destination can be sized up front. Returns a pointer past the last face.
+static const std::byte* ScanPlyFaces(const std::byte* ptr, const std::byte* end,
+                                     PlyBinaryLayout* layout)
+{
+    const PlyProperty* indices = layout->FaceIndices;
+    size_t countSize = GetPlyTypeSize(indices->CountType);
+
+    for (size_t f = 0; f < layout->Faces->Count; ++f)
+    {
+        for (const auto& property : layout->Faces->Properties)
+        {
+            if (&property == indices)
+            {
+                if (ptr + countSize > end)
+                    throw std::runtime_error("Unexpected end of ply file.");
+
+                auto length = ReadPlyScalar<size_t>(ptr, indices->CountType);
+
+                if (length == 3)
+                    ++layout->TriangleCount;
+                else if (length == 4)
+                    ++layout->QuadCount;
+                else
+                    throw std::runtime_error("Only triangles and quads supported.");
+            }
+
+            ptr = SkipPlyProperty(property, ptr, end);
+        }
+    }
+
+    return ptr;
+}
+
+static void ComputePlyBinaryLayout(const PlyHeader& header, std::span<const std::byte> data,
+                                   PlyBinaryLayout* layout)
+{
+    const std::byte* begin = data.data();
+    const std::byte* end = data.data() + data.size();
+    const std::byte* ptr = begin + header.DataOffset;
+
+    for (const auto& element : header.Elements)
+    {
+        if (element.Name == "vertex")
+        {
+            if (!HasFixedStride(element, &layout->VertexStride))
+                throw std::runtime_error("List properties on vertices not supported.");
+
+            if (static_cast<size_t>(end - ptr) < element.Count * layout->VertexStride)
+                throw std::runtime_error("Unexpected end of ply file.");
+
+            layout->Vertices = &element;
+            layout->VertexOffset = ptr - begin;
+
+            ptr += element.Count * layout->VertexStride;
+        }
+        else if (element.Name == "face")
+        {
+            if (FindPlyProperty(element, "face_indices", nullptr))
+                throw std::runtime_error("Face indices not supported.");
+
+            layout->FaceIndices = FindPlyProperty(element, "vertex_indices", nullptr);
+
+            if (!layout->FaceIndices || !layout->FaceIndices->IsList)
+                throw std::runtime_error("Could not find vertex indices.");
+
+            layout->Faces = &element;
+            layout->FaceOffset = ptr - begin;
+
+            ptr = ScanPlyFaces(ptr, end, layout);
+        }
+        else
+        {
+            for (size_t i = 0; i < element.Count; ++i)
+            {
+                for (const auto& property : element.Properties)
+                    ptr = SkipPlyProperty(property, ptr, end);
+            }
+        }
+    }
+
+    if (!layout->Vertices || !layout->Faces || layout->Vertices->Count == 0 ||
+        layout->Faces->Count == 0)
     {
-        mesh->Indices.reserve(mesh->Indices.size() + 3 * context.QuadIndices.size() / 2);
+        throw std::runtime_error("No face or vertex elements found.");
+    }
+}
+
+// Decoded ranges are released from the mapping in blocks of roughly this size, which keeps the
+// resident part of the source file small while the destinations fill up.
+static constexpr size_t kReleaseBlockSize = 1 << 20;
+
+static void DecodePlyVertices(const PlyBinaryLayout& layout, const MappedFile& file,
+                              const MeshSinks& sinks)
+{
+    auto positions = FindPlyVertexAttribute(*layout.Vertices, {"x", "y", "z"});
+    auto normals = FindPlyVertexAttribute(*layout.Vertices, {"nx", "ny", "nz"});
+    auto uvs = FindPlyVertexAttribute(*layout.Vertices, {"u", "v"});
+
+    size_t stride = layout.VertexStride;
+    size_t vertexCount = layout.Vertices->Count;
+    size_t blockVertices = std::max<size_t>(kReleaseBlockSize / stride, 1);
+
+    for (size_t first = 0; first < vertexCount; first += blockVertices)
+    {
+        size_t count = std::min(blockVertices, vertexCount - first);
+        size_t offset = layout.VertexOffset + first * stride;
+
+        const std::byte* vertices = file.Data().data() + offset;
 
-        for (size_t i = 0; i < context.QuadIndices.size(); i += 4)
+        ReadPlyVertexAttribute(positions, vertices, stride, count, &sinks.Positions[first].x);
+        ReadPlyVertexAttribute(normals, vertices, stride, count, &sinks.Normals[first].x);
+        ReadPlyVertexAttribute(uvs, vertices, stride, count, &sinks.UVs[first].x);
+
+        file.Release(offset, count * stride);
+    }
+}
+
+static void DecodePlyFaces(const PlyBinaryLayout& layout, const MappedFile& file,
+                           const MeshSinks& sinks)
+{
+    const PlyProperty* indices = layout.FaceIndices;
+
+    size_t countSize = GetPlyTypeSize(indices->CountType);
+    size_t indexSize = GetPlyTypeSize(indices->Type);
+
+    const std::byte* begin = file.Data().data();
+    const std::byte* end = begin + file.Data().size();
+    const std::byte* ptr = begin + layout.FaceOffset;
+
+    // Triangles come first, followed by the quads split into two triangles each. This matches the
+    // order produced by the rply path.
+    uint32_t* triDst = sinks.Indices.data();
+    uint32_t* quadDst = sinks.Indices.data() + layout.TriangleCount * 3;
+
+    size_t releasedOffset = layout.FaceOffset;
+
+    for (size_t f = 0; f < layout.Faces->Count; ++f)
+    {
+        for (const auto& property : layout.Faces->Properties)
         {
-            mesh->Indices.push_back(context.QuadIndices[i]);
-            mesh->Indices.push_back(context.QuadIndices[i + 1]);
-            mesh->Indices.push_back(context.QuadIndices[i + 2]);
+            if (&property != indices)
+            {
+                ptr = SkipPlyProperty(property, ptr, end);
+                continue;
+            }
+
+            auto length = ReadPlyScalar<size_t>(ptr, indices->CountType);
+            ptr += countSize;
+
+            uint32_t face[4] = {};
+
+            for (size_t i = 0; i < length; ++i)
+                face[i] = ReadPlyScalar<uint32_t>(ptr + i * indexSize, indices->Type);
+
+            ptr += length * indexSize;
+
+            if (length == 3)
+            {
+                *triDst++ = face[0];
+                *triDst++ = face[1];
+                *triDst++ = face[2];
+            }
+            else
+            {
+                *quadDst++ = face[0];
+                *quadDst++ = face[1];
+                *quadDst++ = face[2];
+
+                *quadDst++ = face[0];
+                *quadDst++ = face[2];
+                *quadDst++ = face[3];
+            }
+        }
 
-            mesh->Indices.push_back(context.QuadIndices[i]);
-            mesh->Indices.push_back(context.QuadIndices[i + 2]);
-            mesh->Indices.push_back(context.QuadIndices[i + 3]);
+        if (static_cast<size_t>(ptr - begin) - releasedOffset >= kReleaseBlockSize)
+        {
+            file.Release(releasedOffset, (ptr - begin) - releasedOffset);
+            releasedOffset = ptr - begin;
         }
     }
 }
+
+static bool CanLoadBinaryPly(const PlyHeader& header)
+{
+    if constexpr (std::endian::native != std::endian::little)
+        return false;
+
+    if (header.Format != PlyFormat::BinaryLittleEndian)
+        return false;
+
+    for (const auto& element : header.Elements)
+    {
+        size_t stride = 0;
+
+        if (element.Name == "vertex" && !HasFixedStride(element, &stride))
+            return false;
+    }
+
+    return true;
+}
+
+static void AllocateSinks(const MeshSizes& sizes, MeshSinks* sinks)
+{
+    sinks->Allocate(sizes);
+
+    if (sinks->Positions.size() < sizes.VertexCount || sinks->Normals.size() < sizes.VertexCount ||
+        sinks->UVs.size() < sizes.VertexCount || sinks->Indices.size() < sizes.IndexCount)
+    {
+        throw std::runtime_error("Mesh sinks are too small.");
+    }
+}
+
+void CopyMeshToSinks(const Mesh& mesh, MeshSinks* sinks)
+{
+    AllocateSinks({mesh.Positions.size(), mesh.Indices.size()}, sinks);
+
+    std::copy(mesh.Positions.begin(), mesh.Positions.end(), sinks->Positions.begin());
+    std::copy(mesh.Normals.begin(), mesh.Normals.end(), sinks->Normals.begin());
+    std::copy(mesh.UVs.begin(), mesh.UVs.end(), sinks->UVs.begin());
+    std::copy(mesh.Indices.begin(), mesh.Indices.end(), sinks->Indices.begin());
+}
+
+void LoadMeshInto(std::filesystem::path path, MeshSinks* sinks)
+{
+    MappedFile file(path);
+
+    PlyHeader header{};
+    ParsePlyHeader(file.Data(), &header);
+
+    if (!CanLoadBinaryPly(header))
+    {
+        Mesh mesh{};
+        LoadMeshFromPlyFileRply(path, &mesh);
+
+        CopyMeshToSinks(mesh, sinks);
+        return;
+    }
+
+    PlyBinaryLayout layout{};
+    ComputePlyBinaryLayout(header, file.Data(), &layout);
+
+    MeshSizes sizes{};
+    sizes.VertexCount = layout.Vertices->Count;
+    sizes.IndexCount = layout.TriangleCount * 3 + layout.QuadCount * 6;
+
+    AllocateSinks(sizes, sinks);
+
+    DecodePlyVertices(layout, file, *sinks);
+    DecodePlyFaces(layout, file, *sinks);
+}
+
+bool GetPlyMeshSizes(std::filesystem::path path, MeshSizes* sizes)
+{
+    MappedFile file(path);
+
+    PlyHeader header{};
+    ParsePlyHeader(file.Data(), &header);
+
+    if (!CanLoadBinaryPly(header))
+        return false;
+
+    PlyBinaryLayout layout{};
+    ComputePlyBinaryLayout(header, file.Data(), &layout);
+
+    sizes->VertexCount = layout.Vertices->Count;
+    sizes->IndexCount = layout.TriangleCount * 3 + layout.QuadCount * 6;
+
+    return true;
+}
+
+void SinkIntoMesh(Mesh* mesh, MeshSinks* sinks)
+{
+    sinks->Allocate = [mesh, sinks](const MeshSizes& sizes) {
+        mesh->Positions.resize(sizes.VertexCount);
+        mesh->Normals.resize(sizes.VertexCount);
+        mesh->UVs.resize(sizes.VertexCount);
+        mesh->Indices.resize(sizes.IndexCount);
+
+        sinks->Positions = mesh->Positions;
+        sinks->Normals = mesh->Normals;
+        sinks->UVs = mesh->UVs;
+        sinks->Indices = mesh->Indices;
+    };
+}
+
+void LoadMeshFromPlyFile(std::filesystem::path path, Mesh* mesh)
+{
+    MeshSinks sinks{};
+    SinkIntoMesh(mesh, &sinks);
+
+    LoadMeshInto(path, &sinks);
+}
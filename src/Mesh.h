@@ -3,6 +3,8 @@
 #include <glm/glm.hpp>
 
 #include <filesystem>
+#include <functional>
+#include <span>
 #include <vector>
 
 struct Mesh
@@ -14,4 +16,44 @@ struct Mesh
     std::vector<uint32_t> Indices;
 };
 
+struct MeshSizes
+{
+    size_t VertexCount = 0;
+
+    // Number of indices after quads have been split into triangles.
+    size_t IndexCount = 0;
+};
+
+// Caller-provided destinations for LoadMeshInto.
+struct MeshSinks
+{
+    // Called once the sizes are known, before any data is decoded. Must point the spans below at
+    // destinations with room for at least that many elements.
+    std::function<void(const MeshSizes& sizes)> Allocate;
+
+    std::span<glm::vec3> Positions;
+    std::span<glm::vec3> Normals;
+    std::span<glm::vec2> UVs;
+    std::span<uint32_t> Indices;
+};
+
+// Points the sinks at the mesh's vectors, which are resized once the sizes are known. The sinks
+// must not be moved afterwards.
+void SinkIntoMesh(Mesh* mesh, MeshSinks* sinks);
+
+// Allocates the sinks for the mesh and copies it into them.
+void CopyMeshToSinks(const Mesh& mesh, MeshSinks* sinks);
+
+// Memory-maps the file and decodes it straight into the sinks. Binary little endian files are
+// decoded without intermediate copies; other files go through rply and are copied over.
+void LoadMeshInto(std::filesystem::path path, MeshSinks* sinks);
+
+// The sizes LoadMeshInto allocates, from the header and face lists of a file it decodes directly.
+// Returns false for files that go through rply, whose sizes are only known once they are loaded.
+bool GetPlyMeshSizes(std::filesystem::path path, MeshSizes* sizes);
+
+// Reads binary_little_endian files directly and falls back to rply for everything else.
 void LoadMeshFromPlyFile(std::filesystem::path path, Mesh* mesh);
+
+// Reads the file through rply's per-scalar callbacks. Handles ascii and big endian files.
+void LoadMeshFromPlyFileRply(std::filesystem::path path, Mesh* mesh);
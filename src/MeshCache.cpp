@@ -0,0 +1,244 @@
+#include "MeshCache.h"
+
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+static const char kMeshCacheMagic[8] = {'P', 'B', 'R', 'T', 'M', 'S', 'H', '\0'};
+
+// 64-bit FNV-1a.
+static uint64_t HashBytes(std::span<const std::byte> data)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (std::byte b : data)
+    {
+        hash ^= static_cast<uint64_t>(b);
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+// Fills in the fields that identify the source file, hashing only its ply header so that checking
+// a cache stays cheap for large meshes.
+static void DescribeSource(const std::filesystem::path& source, MeshCacheHeader* header)
+{
+    MappedFile file(source);
+
+    std::string_view text(reinterpret_cast<const char*>(file.Data().data()), file.Data().size());
+
+    static constexpr std::string_view endHeader = "end_header";
+    size_t headerSize = std::min(text.find(endHeader), text.size());
+
+    header->SourceSize = file.Data().size();
+    header->SourceWriteTime = std::filesystem::last_write_time(source).time_since_epoch().count();
+    header->SourceHeaderHash = HashBytes(file.Data().first(headerSize));
+}
+
+std::filesystem::path GetMeshCachePath(const std::filesystem::path& source)
+{
+    return std::filesystem::path(source).replace_extension(".pbrtmesh");
+}
+
+// Whether the mapped cache is up to date with the source and holds a valid mesh.
+static bool IsCacheValid(const std::filesystem::path& source, const MappedFile& file,
+                         MeshCacheHeader* header)
+{
+    if (file.Data().size() < sizeof(MeshCacheHeader))
+        return false;
+
+    memcpy(header, file.Data().data(), sizeof(*header));
+
+    if (memcmp(header->Magic, kMeshCacheMagic, sizeof(kMeshCacheMagic)) != 0 ||
+        header->Version != kMeshCacheVersion)
+    {
+        return false;
+    }
+
+    MeshCacheHeader expected{};
+    DescribeSource(source, &expected);
+
+    if (header->SourceSize != expected.SourceSize ||
+        header->SourceWriteTime != expected.SourceWriteTime ||
+        header->SourceHeaderHash != expected.SourceHeaderHash)
+    {
+        return false;
+    }
+
+    uint64_t fileSize = file.Data().size();
+
+    for (const auto& section : header->Sections)
+    {
+        if (section.Size > fileSize || section.Offset > fileSize - section.Size)
+            return false;
+    }
+
+    auto holdsExactly = [&](int sectionIdx, uint64_t count, size_t elementSize) {
+        uint64_t size = header->Sections[sectionIdx].Size;
+
+        return size % elementSize == 0 && size / elementSize == count;
+    };
+
+    if (!holdsExactly(MeshCacheHeader::Positions, header->VertexCount, sizeof(glm::vec3)) ||
+        !holdsExactly(MeshCacheHeader::Normals, header->VertexCount, sizeof(glm::vec3)) ||
+        !holdsExactly(MeshCacheHeader::UVs, header->VertexCount, sizeof(glm::vec2)) ||
+        !holdsExactly(MeshCacheHeader::Indices, header->IndexCount, sizeof(uint32_t)) ||
+        header->IndexCount % 3 != 0)
+    {
+        return false;
+    }
+
+    // Checked in the mapping, as the sinks may be write-combined memory that is slow to read back.
+    const std::byte* indices =
+        file.Data().data() + header->Sections[MeshCacheHeader::Indices].Offset;
+
+    for (uint64_t i = 0; i < header->IndexCount; ++i)
+    {
+        uint32_t index = 0;
+        memcpy(&index, indices + i * sizeof(index), sizeof(index));
+
+        if (index >= header->VertexCount)
+            return false;
+    }
+
+    return true;
+}
+
+// Maps the cache of the source, if it has one.
+static std::unique_ptr<MappedFile> MapCache(const std::filesystem::path& source)
+{
+    std::filesystem::path cachePath = GetMeshCachePath(source);
+
+    std::error_code error;
+
+    if (!std::filesystem::exists(cachePath, error))
+        return nullptr;
+
+    return std::make_unique<MappedFile>(cachePath);
+}
+
+bool GetMeshSizesCached(const std::filesystem::path& source, MeshSizes* sizes)
+{
+    std::unique_ptr<MappedFile> file = MapCache(source);
+    MeshCacheHeader header{};
+
+    if (file && IsCacheValid(source, *file, &header))
+    {
+        sizes->VertexCount = header.VertexCount;
+        sizes->IndexCount = header.IndexCount;
+
+        return true;
+    }
+
+    return GetPlyMeshSizes(source, sizes);
+}
+
+bool LoadMeshFromCache(const std::filesystem::path& source, MeshSinks* sinks)
+{
+    std::unique_ptr<MappedFile> file = MapCache(source);
+    MeshCacheHeader header{};
+
+    if (!file || !IsCacheValid(source, *file, &header))
+        return false;
+
+    MeshSizes sizes{};
+    sizes.VertexCount = header.VertexCount;
+    sizes.IndexCount = header.IndexCount;
+
+    sinks->Allocate(sizes);
+
+    auto copySection = [&](auto dst, int sectionIdx) {
+        const auto& section = header.Sections[sectionIdx];
+
+        if (dst.size_bytes() < section.Size)
+            return false;
+
+        memcpy(dst.data(), file->Data().data() + section.Offset, section.Size);
+
+        return true;
+    };
+
+    return copySection(sinks->Positions, MeshCacheHeader::Positions) &&
+           copySection(sinks->Normals, MeshCacheHeader::Normals) &&
+           copySection(sinks->UVs, MeshCacheHeader::UVs) &&
+           copySection(sinks->Indices, MeshCacheHeader::Indices);
+}
+
+void WriteMeshCache(const std::filesystem::path& source, const Mesh& mesh)
+{
+    MeshCacheHeader header{};
+    memcpy(header.Magic, kMeshCacheMagic, sizeof(kMeshCacheMagic));
+    header.Version = kMeshCacheVersion;
+
+    DescribeSource(source, &header);
+
+    header.VertexCount = mesh.Positions.size();
+    header.IndexCount = mesh.Indices.size();
+
+    std::span<const std::byte> sections[MeshCacheHeader::NUM_SECTIONS] = {
+        std::as_bytes(std::span(mesh.Positions)),
+        std::as_bytes(std::span(mesh.Normals)),
+        std::as_bytes(std::span(mesh.UVs)),
+        std::as_bytes(std::span(mesh.Indices)),
+    };
+
+    auto align = [](uint64_t offset) {
+        return (offset + (kMeshCacheSectionAlignment - 1)) & ~(kMeshCacheSectionAlignment - 1);
+    };
+
+    uint64_t offset = align(sizeof(header));
+
+    for (int i = 0; i < MeshCacheHeader::NUM_SECTIONS; ++i)
+    {
+        header.Sections[i].Offset = offset;
+        header.Sections[i].Size = sections[i].size();
+
+        offset = align(offset + sections[i].size());
+    }
+
+    ReplaceFile(GetMeshCachePath(source), [&](std::ostream& file) {
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        for (int i = 0; i < MeshCacheHeader::NUM_SECTIONS; ++i)
+        {
+            file.seekp(static_cast<std::streamoff>(header.Sections[i].Offset));
+            file.write(reinterpret_cast<const char*>(sections[i].data()),
+                       static_cast<std::streamsize>(sections[i].size()));
+        }
+    });
+}
+
+void LoadMeshCached(const std::filesystem::path& source, MeshSinks* sinks)
+{
+    if (LoadMeshFromCache(source, sinks))
+        return;
+
+    Mesh mesh{};
+    LoadMeshFromPlyFile(source, &mesh);
+
+    try
+    {
+        WriteMeshCache(source, mesh);
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << "Could not write mesh cache for " << source.string() << ": " << e.what()
+                  << std::endl;
+    }
+
+    CopyMeshToSinks(mesh, sinks);
+}
+
+void LoadMeshCached(const std::filesystem::path& source, Mesh* mesh)
+{
+    MeshSinks sinks{};
+    SinkIntoMesh(mesh, &sinks);
+
+    LoadMeshCached(source, &sinks);
+}
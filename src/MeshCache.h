@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <filesystem>
+
+// .pbrtmesh files cache a triangulated Mesh next to the ply file it came from. The attributes are
+// stored in the same layout as the GPU buffers, so loading one is a memory mapping plus a copy
+// into the sinks.
+//
+// Layout: a MeshCacheHeader followed by the position, normal, uv and index sections, each aligned
+// to kMeshCacheSectionAlignment. A cache is stale when its version or the size, modification time
+// or header hash of the source file no longer match, and is then rebuilt by LoadMeshCached.
+
+static constexpr uint32_t kMeshCacheVersion = 1;
+static constexpr size_t kMeshCacheSectionAlignment = 256;
+
+struct MeshCacheHeader
+{
+    char Magic[8];
+    uint32_t Version;
+    uint32_t Unused;
+
+    uint64_t SourceSize;
+    int64_t SourceWriteTime;
+    uint64_t SourceHeaderHash;
+
+    uint64_t VertexCount;
+    uint64_t IndexCount;
+
+    struct Section
+    {
+        uint64_t Offset;
+        uint64_t Size;
+    };
+
+    enum
+    {
+        Positions = 0,
+        Normals,
+        UVs,
+        Indices,
+        NUM_SECTIONS
+    };
+
+    Section Sections[NUM_SECTIONS];
+};
+
+std::filesystem::path GetMeshCachePath(const std::filesystem::path& source);
+
+// Returns false if the cache is missing, stale or corrupt, in which case the sinks may have been
+// allocated but hold nothing useful.
+bool LoadMeshFromCache(const std::filesystem::path& source, MeshSinks* sinks);
+
+// The sizes LoadMeshCached allocates, from the cache when it is up to date and otherwise from the
+// ply file through GetPlyMeshSizes. Returns false when they are only known once the file is loaded.
+bool GetMeshSizesCached(const std::filesystem::path& source, MeshSizes* sizes);
+
+void WriteMeshCache(const std::filesystem::path& source, const Mesh& mesh);
+
+// Loads from the cache when it is up to date. Otherwise loads the ply file and rebuilds the cache,
+// logging (but otherwise ignoring) failures to write it.
+void LoadMeshCached(const std::filesystem::path& source, MeshSinks* sinks);
+
+void LoadMeshCached(const std::filesystem::path& source, Mesh* mesh);
@@ -0,0 +1,237 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+namespace
+{
+
+using VertexKey = std::array<uint32_t, 8>;
+
+struct VertexKeyHash
+{
+    size_t operator()(const VertexKey& key) const
+    {
+        // FNV-1a over the words.
+        uint64_t hash = 0xcbf29ce484222325ull;
+
+        for (uint32_t word : key)
+        {
+            hash ^= word;
+            hash *= 0x100000001b3ull;
+        }
+
+        return static_cast<size_t>(hash);
+    }
+};
+
+VertexKey GetVertexKey(const Mesh& mesh, size_t vertexIdx)
+{
+    const glm::vec3& p = mesh.Positions[vertexIdx];
+    const glm::vec3& n = mesh.Normals[vertexIdx];
+    const glm::vec2& uv = mesh.UVs[vertexIdx];
+
+    return {std::bit_cast<uint32_t>(p.x),  std::bit_cast<uint32_t>(p.y),
+            std::bit_cast<uint32_t>(p.z),  std::bit_cast<uint32_t>(n.x),
+            std::bit_cast<uint32_t>(n.y),  std::bit_cast<uint32_t>(n.z),
+            std::bit_cast<uint32_t>(uv.x), std::bit_cast<uint32_t>(uv.y)};
+}
+
+constexpr uint32_t kRemoved = std::numeric_limits<uint32_t>::max();
+
+// Moves vertex i to remap[i] and rewrites the indices to match. Vertices mapped to kRemoved must
+// not be referenced by any index, and are dropped.
+void RemapVertices(const std::vector<uint32_t>& remap, size_t newVertexCount, Mesh* mesh)
+{
+    Mesh remapped;
+    remapped.Positions.resize(newVertexCount);
+    remapped.Normals.resize(newVertexCount);
+    remapped.UVs.resize(newVertexCount);
+
+    for (size_t i = 0; i < remap.size(); ++i)
+    {
+        if (remap[i] == kRemoved)
+            continue;
+
+        remapped.Positions[remap[i]] = mesh->Positions[i];
+        remapped.Normals[remap[i]] = mesh->Normals[i];
+        remapped.UVs[remap[i]] = mesh->UVs[i];
+    }
+
+    remapped.Indices = std::move(mesh->Indices);
+
+    for (uint32_t& index : remapped.Indices)
+        index = remap[index];
+
+    *mesh = std::move(remapped);
+}
+
+// Spreads the low 10 bits of x out to every third bit.
+uint32_t ExpandBits(uint32_t x)
+{
+    x &= 0x3ff;
+    x = (x | (x << 16)) & 0x030000ff;
+    x = (x | (x << 8)) & 0x0300f00f;
+    x = (x | (x << 4)) & 0x030c30c3;
+    x = (x | (x << 2)) & 0x09249249;
+
+    return x;
+}
+
+uint32_t GetMortonCode(glm::vec3 p)
+{
+    auto quantize = [](float v) {
+        return static_cast<uint32_t>(std::clamp(v * 1024.f, 0.f, 1023.f));
+    };
+
+    return (ExpandBits(quantize(p.x)) << 2) | (ExpandBits(quantize(p.y)) << 1) |
+           ExpandBits(quantize(p.z));
+}
+
+} // namespace
+
+void OptimizeMesh(Mesh* mesh, MeshOptimizationStats* stats)
+{
+    if (stats)
+    {
+        stats->VerticesBefore = mesh->Positions.size();
+        stats->AcmrBefore = ComputeAverageCacheMissRatio(mesh->Indices, mesh->Positions.size());
+    }
+
+    WeldVertices(mesh);
+    SortTrianglesByMorton(mesh);
+    ReorderVerticesByFirstUse(mesh);
+
+    if (stats)
+    {
+        stats->VerticesAfter = mesh->Positions.size();
+        stats->AcmrAfter = ComputeAverageCacheMissRatio(mesh->Indices, mesh->Positions.size());
+    }
+}
+
+void WeldVertices(Mesh* mesh)
+{
+    size_t vertexCount = mesh->Positions.size();
+
+    std::unordered_map<VertexKey, uint32_t, VertexKeyHash> uniqueVertices;
+    uniqueVertices.reserve(vertexCount);
+
+    std::vector<uint32_t> remap(vertexCount);
+
+    Mesh welded;
+
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        auto [it, inserted] = uniqueVertices.try_emplace(
+            GetVertexKey(*mesh, i), static_cast<uint32_t>(welded.Positions.size()));
+
+        if (inserted)
+        {
+            welded.Positions.push_back(mesh->Positions[i]);
+            welded.Normals.push_back(mesh->Normals[i]);
+            welded.UVs.push_back(mesh->UVs[i]);
+        }
+
+        remap[i] = it->second;
+    }
+
+    if (welded.Positions.size() == vertexCount)
+        return;
+
+    welded.Indices = std::move(mesh->Indices);
+
+    for (uint32_t& index : welded.Indices)
+        index = remap[index];
+
+    *mesh = std::move(welded);
+}
+
+void SortTrianglesByMorton(Mesh* mesh)
+{
+    size_t triangleCount = mesh->Indices.size() / 3;
+
+    if (triangleCount == 0)
+        return;
+
+    std::vector<glm::vec3> centroids(triangleCount);
+
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+
+    for (size_t i = 0; i < triangleCount; ++i)
+    {
+        const uint32_t* tri = &mesh->Indices[i * 3];
+
+        centroids[i] = (mesh->Positions[tri[0]] + mesh->Positions[tri[1]] +
+                        mesh->Positions[tri[2]]) / 3.f;
+
+        boundsMin = glm::min(boundsMin, centroids[i]);
+        boundsMax = glm::max(boundsMax, centroids[i]);
+    }
+
+    // Flat axes map to zero instead of dividing by zero.
+    glm::vec3 extent = boundsMax - boundsMin;
+    glm::vec3 scale(extent.x > 0.f ? 1.f / extent.x : 0.f, extent.y > 0.f ? 1.f / extent.y : 0.f,
+                    extent.z > 0.f ? 1.f / extent.z : 0.f);
+
+    std::vector<uint32_t> codes(triangleCount);
+
+    for (size_t i = 0; i < triangleCount; ++i)
+        codes[i] = GetMortonCode((centroids[i] - boundsMin) * scale);
+
+    std::vector<uint32_t> order(triangleCount);
+    std::iota(order.begin(), order.end(), 0);
+
+    std::stable_sort(order.begin(), order.end(),
+                     [&](uint32_t a, uint32_t b) { return codes[a] < codes[b]; });
+
+    std::vector<uint32_t> sorted(mesh->Indices.size());
+
+    for (size_t i = 0; i < triangleCount; ++i)
+        std::copy_n(&mesh->Indices[static_cast<size_t>(order[i]) * 3], 3, &sorted[i * 3]);
+
+    mesh->Indices = std::move(sorted);
+}
+
+void ReorderVerticesByFirstUse(Mesh* mesh)
+{
+    std::vector<uint32_t> remap(mesh->Positions.size(), kRemoved);
+
+    uint32_t nextVertex = 0;
+
+    for (uint32_t index : mesh->Indices)
+    {
+        if (remap[index] == kRemoved)
+            remap[index] = nextVertex++;
+    }
+
+    RemapVertices(remap, nextVertex, mesh);
+}
+
+double ComputeAverageCacheMissRatio(std::span<const uint32_t> indices, size_t vertexCount,
+                                    size_t cacheSize)
+{
+    size_t triangleCount = indices.size() / 3;
+
+    if (triangleCount == 0)
+        return 0.0;
+
+    // A vertex is in the FIFO if it was added within the last cacheSize misses.
+    std::vector<size_t> addedAt(vertexCount, 0);
+    size_t misses = 0;
+
+    for (uint32_t index : indices)
+    {
+        if (addedAt[index] == 0 || misses + 1 - addedAt[index] > cacheSize)
+        {
+            ++misses;
+            addedAt[index] = misses;
+        }
+    }
+
+    return static_cast<double>(misses) / static_cast<double>(triangleCount);
+}
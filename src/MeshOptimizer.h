@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <span>
+
+// Optional pass run on a loaded mesh. Every step is deterministic: the same input mesh always
+// produces byte-identical output.
+
+struct MeshOptimizationStats
+{
+    size_t VerticesBefore = 0;
+    size_t VerticesAfter = 0;
+
+    // Average cache miss ratio, see ComputeAverageCacheMissRatio.
+    double AcmrBefore = 0.0;
+    double AcmrAfter = 0.0;
+};
+
+// Welds vertices, sorts triangles along a Morton curve of their centroids and then renumbers the
+// vertices in the order the triangles first use them.
+void OptimizeMesh(Mesh* mesh, MeshOptimizationStats* stats = nullptr);
+
+// Merges vertices whose position, normal and uv are bitwise identical. The first occurrence of
+// each vertex is kept, so surviving vertices keep their relative order.
+void WeldVertices(Mesh* mesh);
+
+// Stable-sorts triangles by the 30-bit Morton code of their centroid within the mesh bounds.
+void SortTrianglesByMorton(Mesh* mesh);
+
+// Renumbers vertices in the order the index buffer first references them. Unreferenced vertices
+// are dropped.
+void ReorderVerticesByFirstUse(Mesh* mesh);
+
+// Vertex shader invocations per triangle with a FIFO post-transform cache of the given size. 3 is
+// the worst case and 0.5 about the best for a regular grid.
+double ComputeAverageCacheMissRatio(std::span<const uint32_t> indices, size_t vertexCount,
+                                    size_t cacheSize = 16);
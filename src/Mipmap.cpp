@@ -0,0 +1,262 @@
+#include "Mipmap.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+
+// Rows of a level each index of ParallelFor filters.
+constexpr uint32_t kRowsPerJob = 16;
+
+// Narrower than the linear distance between any two successive sRGB encoded bytes, so that a
+// bucket's first byte is at most one short of the byte any of its values round to.
+constexpr uint32_t kEncodeBuckets = 4096;
+
+// The texels of the level before that a texel covers along one axis, and their weights.
+struct BoxTaps
+{
+    uint32_t First = 0;
+    uint32_t Count = 0;
+    float Weights[3] = {};
+};
+
+std::vector<BoxTaps> GetBoxTaps(uint32_t srcSize, uint32_t dstSize)
+{
+    std::vector<BoxTaps> taps(dstSize);
+
+    for (uint32_t i = 0; i < dstSize; ++i)
+    {
+        BoxTaps& tap = taps[i];
+
+        if (srcSize == 1)
+        {
+            tap.Count = 1;
+            tap.Weights[0] = 1.f;
+        }
+        else if (srcSize % 2 == 0)
+        {
+            tap.First = 2 * i;
+            tap.Count = 2;
+            tap.Weights[0] = tap.Weights[1] = 0.5f;
+        }
+        else
+        {
+            // dstSize texels cover the 2 * dstSize + 1 texels of the level before.
+            float scale = 1.f / static_cast<float>(srcSize);
+
+            tap.First = 2 * i;
+            tap.Count = 3;
+            tap.Weights[0] = static_cast<float>(dstSize - i) * scale;
+            tap.Weights[1] = static_cast<float>(dstSize) * scale;
+            tap.Weights[2] = static_cast<float>(i + 1) * scale;
+        }
+    }
+
+    return taps;
+}
+
+float SrgbToLinear(float value)
+{
+    return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+// What each sRGB encoded byte is in linear space, the linear values halfway between successive
+// bytes in encoded space, which round a linear value to the nearest byte, and the byte the first
+// value of each bucket of linear values rounds to.
+struct SrgbTables
+{
+    float ToLinear[256];
+    float Thresholds[256];
+    uint8_t BucketStarts[kEncodeBuckets];
+};
+
+const SrgbTables& GetSrgbTables()
+{
+    static const SrgbTables tables = [] {
+        SrgbTables result{};
+
+        for (int i = 0; i < 256; ++i)
+            result.ToLinear[i] = SrgbToLinear(static_cast<float>(i) / 255.f);
+
+        for (int i = 0; i < 255; ++i)
+            result.Thresholds[i] = SrgbToLinear((static_cast<float>(i) + 0.5f) / 255.f);
+
+        // Nothing rounds past 255.
+        result.Thresholds[255] = std::numeric_limits<float>::infinity();
+
+        for (uint32_t i = 0; i < kEncodeBuckets; ++i)
+        {
+            float value = static_cast<float>(i) / kEncodeBuckets;
+
+            result.BucketStarts[i] = static_cast<uint8_t>(
+                std::upper_bound(result.Thresholds, result.Thresholds + 255, value) -
+                result.Thresholds);
+        }
+
+        return result;
+    }();
+
+    return tables;
+}
+
+uint8_t LinearToSrgb(const SrgbTables& tables, float value)
+{
+    value = std::clamp(value, 0.f, 1.f);
+
+    uint32_t bucket = std::min(static_cast<uint32_t>(value * kEncodeBuckets), kEncodeBuckets - 1);
+    uint32_t encoded = tables.BucketStarts[bucket];
+
+    if (value >= tables.Thresholds[encoded])
+        ++encoded;
+
+    return static_cast<uint8_t>(encoded);
+}
+
+void AddTexel(PixelFormat format, const SrgbTables& tables, const std::byte* texel, float weight,
+              float sum[4])
+{
+    if (format == PixelFormat::RGBA32F)
+    {
+        float value[4];
+        memcpy(value, texel, sizeof(value));
+
+        for (int c = 0; c < 4; ++c)
+            sum[c] += weight * value[c];
+
+        return;
+    }
+
+    for (int c = 0; c < 3; ++c)
+        sum[c] += weight * tables.ToLinear[static_cast<uint8_t>(texel[c])];
+
+    sum[3] += weight * static_cast<float>(static_cast<uint8_t>(texel[3])) / 255.f;
+}
+
+void StoreTexel(PixelFormat format, const SrgbTables& tables, const float sum[4], std::byte* texel)
+{
+    if (format == PixelFormat::RGBA32F)
+    {
+        memcpy(texel, sum, 4 * sizeof(float));
+        return;
+    }
+
+    for (int c = 0; c < 3; ++c)
+        texel[c] = static_cast<std::byte>(LinearToSrgb(tables, sum[c]));
+
+    float alpha = std::clamp(sum[3], 0.f, 1.f);
+    texel[3] = static_cast<std::byte>(static_cast<uint8_t>(alpha * 255.f + 0.5f));
+}
+
+void FilterRows(PixelFormat format, const MipLevel& src, const MipLevel& dst,
+                std::span<const BoxTaps> xTaps, std::span<const BoxTaps> yTaps,
+                uint32_t firstRow, uint32_t endRow)
+{
+    const SrgbTables& tables = GetSrgbTables();
+    size_t pixelSize = GetPixelSize(format);
+
+    for (uint32_t y = firstRow; y < endRow; ++y)
+    {
+        const BoxTaps& yTap = yTaps[y];
+        std::byte* dstRow = dst.Pixels.data() + y * dst.RowPitch;
+
+        for (uint32_t x = 0; x < dst.Width; ++x)
+        {
+            const BoxTaps& xTap = xTaps[x];
+            float sum[4] = {};
+
+            for (uint32_t j = 0; j < yTap.Count; ++j)
+            {
+                const std::byte* srcRow = src.Pixels.data() + (yTap.First + j) * src.RowPitch;
+
+                for (uint32_t i = 0; i < xTap.Count; ++i)
+                {
+                    AddTexel(format, tables, srcRow + (xTap.First + i) * pixelSize,
+                             yTap.Weights[j] * xTap.Weights[i], sum);
+                }
+            }
+
+            StoreTexel(format, tables, sum, dstRow + x * pixelSize);
+        }
+    }
+}
+
+} // namespace
+
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height)
+{
+    return static_cast<uint32_t>(std::bit_width(std::max(width, height)));
+}
+
+uint32_t GetMipSize(uint32_t size, uint32_t level)
+{
+    return std::max(size >> level, 1u);
+}
+
+void GenerateMips(PixelFormat format, std::span<const MipLevel> levels, ThreadPool* pool)
+{
+    for (size_t i = 1; i < levels.size(); ++i)
+    {
+        const MipLevel& src = levels[i - 1];
+        const MipLevel& dst = levels[i];
+
+        if (dst.Width != GetMipSize(src.Width, 1) || dst.Height != GetMipSize(src.Height, 1))
+            throw std::runtime_error("Mip levels must halve the size of the level before.");
+
+        std::vector<BoxTaps> xTaps = GetBoxTaps(src.Width, dst.Width);
+        std::vector<BoxTaps> yTaps = GetBoxTaps(src.Height, dst.Height);
+
+        uint32_t jobCount = (dst.Height + kRowsPerJob - 1) / kRowsPerJob;
+
+        auto filterJob = [&](size_t jobIdx) {
+            uint32_t firstRow = static_cast<uint32_t>(jobIdx) * kRowsPerJob;
+
+            FilterRows(format, src, dst, xTaps, yTaps, firstRow,
+                       std::min(firstRow + kRowsPerJob, dst.Height));
+        };
+
+        if (!pool || jobCount == 1)
+        {
+            for (uint32_t jobIdx = 0; jobIdx < jobCount; ++jobIdx)
+                filterJob(jobIdx);
+        }
+        else
+        {
+            pool->ParallelFor(jobCount, filterJob);
+        }
+    }
+}
+
+std::vector<Image> BuildMipChain(Image image, ThreadPool* pool)
+{
+    ImageInfo info = image.Info;
+    size_t pixelSize = GetPixelSize(info.Format);
+
+    std::vector<Image> chain(GetMipLevelCount(info.Width, info.Height));
+    std::vector<MipLevel> levels(chain.size());
+
+    chain[0] = std::move(image);
+
+    for (uint32_t i = 0; i < chain.size(); ++i)
+    {
+        Image& level = chain[i];
+
+        level.Info.Width = GetMipSize(info.Width, i);
+        level.Info.Height = GetMipSize(info.Height, i);
+        level.Info.Format = info.Format;
+        level.Pixels.resize(level.Info.Width * pixelSize * level.Info.Height);
+
+        levels[i].Width = level.Info.Width;
+        levels[i].Height = level.Info.Height;
+        levels[i].Pixels = level.Pixels;
+        levels[i].RowPitch = level.Info.Width * pixelSize;
+    }
+
+    GenerateMips(info.Format, levels, pool);
+
+    return chain;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Image.h"
+#include "ThreadPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// A level of a mip chain, Height rows of Width pixels, RowPitch bytes apart. Rows are in the order
+// of the image's, i.e. the first row is at the bottom.
+struct MipLevel
+{
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+
+    std::span<std::byte> Pixels;
+    size_t RowPitch = 0;
+};
+
+// The levels of a full chain, down to 1x1, as D3D12 counts them.
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+
+// The width or height of a level, given that of the first.
+uint32_t GetMipSize(uint32_t size, uint32_t level);
+
+// Fills every level after the first by box filtering the level before it. A level that halves an
+// odd size weights the three texels each of its texels covers by how much of them it covers, so
+// every texel of the level before contributes the same. RGBA8 texels are taken to be sRGB encoded
+// and are filtered in linear space, with alpha filtered as it is; RGBA32F texels are filtered as
+// they are. The rows of a level are split across the pool, if there is one, in which case this
+// must not be called from one of its workers.
+void GenerateMips(PixelFormat format, std::span<const MipLevel> levels, ThreadPool* pool);
+
+// The image followed by every level GenerateMips makes from it, tightly packed.
+std::vector<Image> BuildMipChain(Image image, ThreadPool* pool);
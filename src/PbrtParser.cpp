@@ -0,0 +1,1044 @@
+#include "PbrtParser.h"
+
+#include "MappedFile.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <charconv>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace
+{
+
+// Splits a .pbrt file into keywords, numbers, quoted strings with their quotes and brackets,
+// skipping whitespace and comments. The file is mapped rather than read, and tokens point into it.
+class Tokenizer
+{
+public:
+    explicit Tokenizer(const std::filesystem::path& path)
+        : m_path(path), m_file(CheckExists(path))
+    {
+        std::span<const std::byte> data = m_file.Data();
+        m_text = std::string_view(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+
+    // Empty at the end of the file.
+    std::string_view Next()
+    {
+        if (m_hasPeeked)
+        {
+            m_hasPeeked = false;
+            return m_peeked;
+        }
+
+        return Scan();
+    }
+
+    std::string_view Peek()
+    {
+        if (!m_hasPeeked)
+        {
+            m_peeked = Scan();
+            m_hasPeeked = true;
+        }
+
+        return m_peeked;
+    }
+
+    [[noreturn]] void Fail(const std::string& message) const
+    {
+        throw std::runtime_error(m_path.string() + ":" + std::to_string(m_line) + ": " + message);
+    }
+
+private:
+    static const std::filesystem::path& CheckExists(const std::filesystem::path& path)
+    {
+        if (!std::filesystem::is_regular_file(path))
+            throw std::runtime_error("Could not open " + path.string() + ".");
+
+        return path;
+    }
+
+    static bool IsSpace(char c)
+    {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+    }
+
+    std::string_view Scan()
+    {
+        for (;;)
+        {
+            while (m_pos < m_text.size() && IsSpace(m_text[m_pos]))
+            {
+                m_line += m_text[m_pos] == '\n';
+                ++m_pos;
+            }
+
+            if (m_pos == m_text.size() || m_text[m_pos] != '#')
+                break;
+
+            while (m_pos < m_text.size() && m_text[m_pos] != '\n')
+                ++m_pos;
+        }
+
+        size_t start = m_pos;
+
+        if (m_pos == m_text.size())
+            return {};
+
+        char c = m_text[m_pos];
+
+        if (c == '"')
+        {
+            for (++m_pos; m_pos < m_text.size() && m_text[m_pos] != '"'; ++m_pos)
+            {
+                if (m_text[m_pos] == '\n')
+                    Fail("Unterminated string.");
+
+                if (m_text[m_pos] == '\\')
+                    ++m_pos;
+            }
+
+            if (m_pos >= m_text.size())
+                Fail("Unterminated string.");
+
+            ++m_pos;
+        }
+        else if (c == '[' || c == ']')
+        {
+            ++m_pos;
+        }
+        else
+        {
+            while (m_pos < m_text.size() && !IsSpace(m_text[m_pos]) && m_text[m_pos] != '"' &&
+                   m_text[m_pos] != '[' && m_text[m_pos] != ']' && m_text[m_pos] != '#')
+            {
+                ++m_pos;
+            }
+        }
+
+        return m_text.substr(start, m_pos - start);
+    }
+
+    std::filesystem::path m_path;
+    MappedFile m_file;
+    std::string_view m_text;
+
+    size_t m_pos = 0;
+    int m_line = 1;
+
+    std::string_view m_peeked;
+    bool m_hasPeeked = false;
+};
+
+bool IsQuoted(std::string_view token)
+{
+    return token.size() >= 2 && token.front() == '"';
+}
+
+// Strips the quotes and undoes escapes.
+std::string Dequote(std::string_view token)
+{
+    std::string value;
+    value.reserve(token.size() - 2);
+
+    for (size_t i = 1; i + 1 < token.size(); ++i)
+    {
+        char c = token[i];
+
+        if (c == '\\' && i + 2 < token.size())
+        {
+            c = token[++i];
+
+            if (c == 'n')
+                c = '\n';
+            else if (c == 't')
+                c = '\t';
+        }
+
+        value.push_back(c);
+    }
+
+    return value;
+}
+
+std::string ReadString(Tokenizer* tokenizer)
+{
+    std::string_view token = tokenizer->Next();
+
+    if (!IsQuoted(token))
+        tokenizer->Fail("Expected a quoted string, got '" + std::string(token) + "'.");
+
+    return Dequote(token);
+}
+
+double ParseNumber(Tokenizer* tokenizer, std::string_view token)
+{
+    std::string_view digits = token;
+
+    if (!digits.empty() && digits.front() == '+')
+        digits.remove_prefix(1);
+
+    double value = 0.0;
+    auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(), value);
+
+    if (error != std::errc() || end != digits.data() + digits.size())
+        tokenizer->Fail("Expected a number, got '" + std::string(token) + "'.");
+
+    return value;
+}
+
+// count numbers, in brackets or not.
+std::vector<double> ReadNumbers(Tokenizer* tokenizer, size_t count)
+{
+    bool bracketed = tokenizer->Peek() == "[";
+
+    if (bracketed)
+        tokenizer->Next();
+
+    std::vector<double> numbers(count);
+
+    for (double& number : numbers)
+        number = ParseNumber(tokenizer, tokenizer->Next());
+
+    if (bracketed && tokenizer->Next() != "]")
+        tokenizer->Fail("Expected ']' after " + std::to_string(count) + " numbers.");
+
+    return numbers;
+}
+
+glm::vec3 ToVec3(const std::vector<double>& numbers, size_t first = 0)
+{
+    return glm::vec3(static_cast<float>(numbers[first]), static_cast<float>(numbers[first + 1]),
+                     static_cast<float>(numbers[first + 2]));
+}
+
+glm::mat4 ToMat4(const std::vector<double>& numbers)
+{
+    float values[16];
+
+    for (int i = 0; i < 16; ++i)
+        values[i] = static_cast<float>(numbers[i]);
+
+    // pbrt's matrices are given column by column, as glm stores them.
+    return glm::make_mat4(values);
+}
+
+struct Parameter
+{
+    std::string Type;
+    std::string Name;
+
+    // Either numbers or strings. Bools are the strings "true" and "false".
+    std::vector<double> Numbers;
+    std::vector<std::string> Strings;
+};
+
+using ParameterList = std::vector<Parameter>;
+
+// The "type name" value or "type name" [values] pairs that follow a directive's arguments.
+ParameterList ReadParameters(Tokenizer* tokenizer)
+{
+    ParameterList parameters;
+
+    while (IsQuoted(tokenizer->Peek()))
+    {
+        std::string declaration = ReadString(tokenizer);
+
+        size_t typeEnd = declaration.find(' ');
+        size_t nameStart = declaration.find_first_not_of(' ', typeEnd);
+
+        if (typeEnd == std::string::npos || nameStart == std::string::npos ||
+            declaration.find(' ', nameStart) != std::string::npos)
+        {
+            tokenizer->Fail("Expected a \"type name\" parameter, got \"" + declaration + "\".");
+        }
+
+        Parameter& parameter = parameters.emplace_back();
+        parameter.Type = declaration.substr(0, typeEnd);
+        parameter.Name = declaration.substr(nameStart);
+
+        auto readValue = [&](std::string_view token)
+        {
+            if (IsQuoted(token))
+                parameter.Strings.push_back(Dequote(token));
+            else if (token == "true" || token == "false")
+                parameter.Strings.emplace_back(token);
+            else
+                parameter.Numbers.push_back(ParseNumber(tokenizer, token));
+        };
+
+        if (tokenizer->Peek() != "[")
+        {
+            readValue(tokenizer->Next());
+            continue;
+        }
+
+        tokenizer->Next();
+
+        for (std::string_view token = tokenizer->Next(); token != "]"; token = tokenizer->Next())
+        {
+            if (token.empty())
+                tokenizer->Fail("Expected ']' after the values of \"" + declaration + "\".");
+
+            readValue(token);
+        }
+    }
+
+    return parameters;
+}
+
+const Parameter* FindParameter(const ParameterList& parameters, std::string_view name)
+{
+    for (const Parameter& parameter : parameters)
+    {
+        if (parameter.Name == name)
+            return &parameter;
+    }
+
+    return nullptr;
+}
+
+float GetFloat(const ParameterList& parameters, std::string_view name, float defaultValue)
+{
+    const Parameter* parameter = FindParameter(parameters, name);
+
+    if (!parameter || parameter->Numbers.empty())
+        return defaultValue;
+
+    return static_cast<float>(parameter->Numbers[0]);
+}
+
+std::string GetString(const ParameterList& parameters, std::string_view name)
+{
+    const Parameter* parameter = FindParameter(parameters, name);
+
+    if (!parameter || parameter->Strings.empty())
+        return {};
+
+    return parameter->Strings[0];
+}
+
+// pbrt's LookAt, which is left handed: the camera looks down z with x to its right.
+glm::mat4 LookAt(glm::vec3 position, glm::vec3 look, glm::vec3 up, Tokenizer* tokenizer)
+{
+    glm::vec3 dir = glm::normalize(look - position);
+    glm::vec3 right = glm::cross(glm::normalize(up), dir);
+
+    if (glm::dot(right, right) == 0.f)
+        tokenizer->Fail("LookAt's up vector points along the viewing direction.");
+
+    right = glm::normalize(right);
+    glm::vec3 newUp = glm::cross(dir, right);
+
+    glm::mat4 worldFromCamera(glm::vec4(right, 0.f), glm::vec4(newUp, 0.f),
+                              glm::vec4(dir, 0.f), glm::vec4(position, 1.f));
+
+    return glm::inverse(worldFromCamera);
+}
+
+// pbrt's perspective camera, whose space the current transform maps the world to.
+SceneCamera MakeCamera(const glm::mat4& cameraFromWorld, float fov)
+{
+    glm::mat4 worldFromCamera = glm::inverse(cameraFromWorld);
+
+    SceneCamera camera;
+    camera.Origin = glm::vec3(worldFromCamera * glm::vec4(0.f, 0.f, 0.f, 1.f));
+    camera.Right = glm::normalize(glm::vec3(worldFromCamera * glm::vec4(1.f, 0.f, 0.f, 0.f)));
+    camera.Up = glm::normalize(glm::vec3(worldFromCamera * glm::vec4(0.f, 1.f, 0.f, 0.f)));
+    camera.Forward = glm::normalize(glm::vec3(worldFromCamera * glm::vec4(0.f, 0.f, 1.f, 0.f)));
+    camera.Fov = fov;
+
+    return camera;
+}
+
+// The parts of a material the renderers use.
+struct MaterialState
+{
+    // The image map of the reflectance.
+    std::optional<std::filesystem::path> Texture;
+
+    // pbrt's interface material, whose shapes only bound media and aren't drawn.
+    bool IsInterface = false;
+};
+
+struct GraphicsState
+{
+    glm::mat4 Ctm = glm::mat4(1.f);
+
+    MaterialState Material;
+
+    // The radiance shapes emit, if they are area lights.
+    std::optional<glm::vec3> AreaLight;
+};
+
+// Everything a file can refer to by name, but objects. An imported file starts with a copy of
+// its importer's.
+struct NamedState
+{
+    std::map<std::string, MaterialState, std::less<>> Materials;
+
+    // The files of image map textures.
+    std::map<std::string, std::filesystem::path, std::less<>> Textures;
+
+    std::map<std::string, glm::mat4, std::less<>> CoordinateSystems;
+};
+
+struct ObjectInstance
+{
+    std::string Name;
+    glm::mat4 Transform;
+};
+
+struct PendingImport
+{
+    std::filesystem::path Path;
+    GraphicsState State;
+    NamedState Names;
+};
+
+// What a file and the files it includes yield. Imported files are parsed into ImportedFiles
+// afterwards.
+struct ParsedFile
+{
+    std::optional<SceneCamera> Camera;
+
+    std::vector<SceneGeometry> Geometries;
+    std::vector<ObjectInstance> Instances;
+    std::vector<SphereLight> Lights;
+
+    // The geometries of each object, with the transforms they had in its definition.
+    std::map<std::string, std::vector<SceneGeometry>> Objects;
+
+    std::set<std::string> Warnings;
+
+    std::vector<PendingImport> Imports;
+    std::vector<ParsedFile> ImportedFiles;
+};
+
+class Parser
+{
+public:
+    Parser(std::filesystem::path directory, const GraphicsState& state, NamedState names,
+           ParsedFile* file)
+        : m_directory(std::move(directory)), m_state(state), m_names(std::move(names)),
+          m_file(file)
+    {
+    }
+
+    // Included files are parsed by the same parser, so they share its state.
+    void Parse(const std::filesystem::path& path)
+    {
+        Tokenizer tokenizer(path);
+
+        for (std::string_view directive = tokenizer.Next(); !directive.empty();
+             directive = tokenizer.Next())
+        {
+            ParseDirective(directive, &tokenizer);
+        }
+    }
+
+private:
+    struct SavedState
+    {
+        GraphicsState State;
+
+        // TransformBegin only saves the transform.
+        bool TransformOnly;
+    };
+
+    std::filesystem::path Resolve(const std::string& path) const
+    {
+        std::filesystem::path resolved(path);
+
+        return resolved.is_absolute() ? resolved : m_directory / resolved;
+    }
+
+    void Warn(std::string message)
+    {
+        m_file->Warnings.insert(std::move(message));
+    }
+
+    void Begin(bool transformOnly)
+    {
+        m_saved.push_back({m_state, transformOnly});
+    }
+
+    void End(std::string_view directive, Tokenizer* tokenizer)
+    {
+        if (m_saved.empty())
+            tokenizer->Fail("Unmatched " + std::string(directive) + ".");
+
+        if (m_saved.back().TransformOnly)
+            m_state.Ctm = m_saved.back().State.Ctm;
+        else
+            m_state = m_saved.back().State;
+
+        m_saved.pop_back();
+    }
+
+    void ParseDirective(std::string_view directive, Tokenizer* tokenizer)
+    {
+        glm::mat4& ctm = m_state.Ctm;
+
+        if (directive == "Include")
+        {
+            Parse(Resolve(ReadString(tokenizer)));
+        }
+        else if (directive == "Import")
+        {
+            if (m_objectName)
+                tokenizer->Fail("Import inside an object isn't supported.");
+
+            m_file->Imports.push_back({Resolve(ReadString(tokenizer)), m_state, m_names});
+        }
+        else if (directive == "Identity")
+        {
+            ctm = glm::mat4(1.f);
+        }
+        else if (directive == "Translate")
+        {
+            ctm = glm::translate(ctm, ToVec3(ReadNumbers(tokenizer, 3)));
+        }
+        else if (directive == "Scale")
+        {
+            ctm = glm::scale(ctm, ToVec3(ReadNumbers(tokenizer, 3)));
+        }
+        else if (directive == "Rotate")
+        {
+            std::vector<double> values = ReadNumbers(tokenizer, 4);
+
+            ctm = glm::rotate(ctm, glm::radians(static_cast<float>(values[0])),
+                              ToVec3(values, 1));
+        }
+        else if (directive == "LookAt")
+        {
+            std::vector<double> values = ReadNumbers(tokenizer, 9);
+
+            ctm = ctm * LookAt(ToVec3(values, 0), ToVec3(values, 3), ToVec3(values, 6),
+                               tokenizer);
+        }
+        else if (directive == "Transform")
+        {
+            ctm = ToMat4(ReadNumbers(tokenizer, 16));
+        }
+        else if (directive == "ConcatTransform")
+        {
+            ctm = ctm * ToMat4(ReadNumbers(tokenizer, 16));
+        }
+        else if (directive == "CoordinateSystem")
+        {
+            m_names.CoordinateSystems[ReadString(tokenizer)] = ctm;
+        }
+        else if (directive == "CoordSysTransform")
+        {
+            std::string name = ReadString(tokenizer);
+            auto it = m_names.CoordinateSystems.find(name);
+
+            if (it == m_names.CoordinateSystems.end())
+                Warn("Coordinate system \"" + name + "\" is undefined and was ignored");
+            else
+                ctm = it->second;
+        }
+        else if (directive == "TransformTimes")
+        {
+            ReadNumbers(tokenizer, 2);
+        }
+        else if (directive == "ActiveTransform")
+        {
+            if (tokenizer->Next() != "All")
+                Warn("Animated transforms aren't supported, so only the start time's is used");
+        }
+        else if (directive == "ReverseOrientation" || directive == "WorldEnd")
+        {
+        }
+        else if (directive == "AttributeBegin" || directive == "TransformBegin")
+        {
+            Begin(directive == "TransformBegin");
+        }
+        else if (directive == "AttributeEnd" || directive == "TransformEnd")
+        {
+            End(directive, tokenizer);
+        }
+        else if (directive == "WorldBegin")
+        {
+            ctm = glm::mat4(1.f);
+            m_names.CoordinateSystems["world"] = ctm;
+        }
+        else if (directive == "Camera")
+        {
+            std::string type = ReadString(tokenizer);
+            ParameterList parameters = ReadParameters(tokenizer);
+
+            if (type != "perspective")
+                Warn("Camera \"" + type + "\" isn't supported and is drawn as perspective");
+
+            m_file->Camera = MakeCamera(ctm, GetFloat(parameters, "fov", 90.f));
+            m_names.CoordinateSystems["camera"] = glm::inverse(ctm);
+        }
+        else if (directive == "Option")
+        {
+            ReadParameters(tokenizer);
+        }
+        else if (directive == "ColorSpace")
+        {
+            ReadString(tokenizer);
+        }
+        else if (directive == "Film" || directive == "Sampler" || directive == "Integrator" ||
+                 directive == "PixelFilter" || directive == "Accelerator")
+        {
+            ReadString(tokenizer);
+            ReadParameters(tokenizer);
+        }
+        else if (directive == "Attribute")
+        {
+            std::string target = ReadString(tokenizer);
+            ReadParameters(tokenizer);
+
+            Warn("Attribute \"" + target + "\" isn't supported");
+        }
+        else if (directive == "MakeNamedMedium")
+        {
+            ReadString(tokenizer);
+            ReadParameters(tokenizer);
+
+            Warn("Participating media aren't supported");
+        }
+        else if (directive == "MediumInterface")
+        {
+            ReadString(tokenizer);
+
+            if (IsQuoted(tokenizer->Peek()))
+                ReadString(tokenizer);
+        }
+        else if (directive == "LightSource")
+        {
+            std::string type = ReadString(tokenizer);
+            ReadParameters(tokenizer);
+
+            Warn("LightSource \"" + type + "\" isn't supported");
+        }
+        else if (directive == "AreaLightSource")
+        {
+            std::string type = ReadString(tokenizer);
+            ParameterList parameters = ReadParameters(tokenizer);
+
+            ParseAreaLight(type, parameters);
+        }
+        else if (directive == "Material")
+        {
+            std::string type = ReadString(tokenizer);
+            ParameterList parameters = ReadParameters(tokenizer);
+
+            m_state.Material = MakeMaterial(type, parameters);
+        }
+        else if (directive == "MakeNamedMaterial")
+        {
+            std::string name = ReadString(tokenizer);
+            ParameterList parameters = ReadParameters(tokenizer);
+
+            m_names.Materials[name] = MakeMaterial(GetString(parameters, "type"), parameters);
+        }
+        else if (directive == "NamedMaterial")
+        {
+            std::string name = ReadString(tokenizer);
+            auto it = m_names.Materials.find(name);
+
+            if (it == m_names.Materials.end())
+                tokenizer->Fail("Material \"" + name + "\" is undefined.");
+
+            m_state.Material = it->second;
+        }
+        else if (directive == "Texture")
+        {
+            std::string name = ReadString(tokenizer);
+            ReadString(tokenizer);
+            std::string textureClass = ReadString(tokenizer);
+            ParameterList parameters = ReadParameters(tokenizer);
+
+            if (textureClass == "imagemap")
+                m_names.Textures[name] = Resolve(GetString(parameters, "filename"));
+            else
+                m_names.Textures.erase(name);
+        }
+        else if (directive == "Shape")
+        {
+            std::string type = ReadString(tokenizer);
+            ParameterList parameters = ReadParameters(tokenizer);
+
+            AddShape(type, parameters, tokenizer);
+        }
+        else if (directive == "ObjectBegin")
+        {
+            if (m_objectName)
+                tokenizer->Fail("ObjectBegin inside an object.");
+
+            Begin(false);
+            m_objectName = ReadString(tokenizer);
+        }
+        else if (directive == "ObjectEnd")
+        {
+            if (!m_objectName)
+                tokenizer->Fail("ObjectEnd outside of an object.");
+
+            if (!m_file->Objects.try_emplace(*m_objectName, std::move(m_objectGeometries)).second)
+                Warn("Object \"" + *m_objectName + "\" is defined more than once");
+
+            m_objectName.reset();
+            m_objectGeometries.clear();
+
+            End(directive, tokenizer);
+        }
+        else if (directive == "ObjectInstance")
+        {
+            if (m_objectName)
+                tokenizer->Fail("ObjectInstance inside an object.");
+
+            m_file->Instances.push_back({ReadString(tokenizer), ctm});
+        }
+        else
+        {
+            tokenizer->Fail("Unknown directive '" + std::string(directive) + "'.");
+        }
+    }
+
+    void ParseAreaLight(const std::string& type, const ParameterList& parameters)
+    {
+        if (type != "diffuse")
+        {
+            Warn("AreaLightSource \"" + type + "\" isn't supported");
+            m_state.AreaLight.reset();
+            return;
+        }
+
+        // pbrt's default is the color space's illuminant, which is white.
+        glm::vec3 L(1.f, 1.f, 1.f);
+
+        if (const Parameter* radiance = FindParameter(parameters, "L"))
+        {
+            if (radiance->Type == "rgb" && radiance->Numbers.size() == 3)
+                L = ToVec3(radiance->Numbers);
+            else
+                Warn("Only rgb area light radiance is supported, others are drawn as white");
+        }
+
+        m_state.AreaLight = L * GetFloat(parameters, "scale", 1.f);
+    }
+
+    MaterialState MakeMaterial(const std::string& type, const ParameterList& parameters)
+    {
+        MaterialState material;
+
+        if (type == "interface")
+        {
+            material.IsInterface = true;
+            return material;
+        }
+
+        if (type != "diffuse")
+            Warn("Material \"" + type + "\" isn't supported and is drawn as diffuse");
+
+        const Parameter* reflectance = FindParameter(parameters, "reflectance");
+
+        if (!reflectance || reflectance->Type != "texture" || reflectance->Strings.empty())
+            return material;
+
+        const std::string& textureName = reflectance->Strings[0];
+        auto it = m_names.Textures.find(textureName);
+
+        if (it == m_names.Textures.end())
+            Warn("Texture \"" + textureName + "\" isn't an image map and was ignored");
+        else
+            material.Texture = it->second;
+
+        return material;
+    }
+
+    void AddShape(const std::string& type, const ParameterList& parameters, Tokenizer* tokenizer)
+    {
+        if (m_state.Material.IsInterface)
+            return;
+
+        if (type == "sphere")
+        {
+            AddSphere(parameters);
+            return;
+        }
+
+        if (type != "plymesh" && type != "trianglemesh")
+        {
+            Warn("Shape \"" + type + "\" isn't supported");
+            return;
+        }
+
+        if (m_state.AreaLight)
+            Warn("Only spheres can be area lights, other shapes don't emit");
+
+        SceneGeometry geometry;
+        geometry.Texture = m_state.Material.Texture;
+        geometry.Transform = m_state.Ctm;
+
+        if (type == "plymesh")
+        {
+            std::string filename = GetString(parameters, "filename");
+
+            if (filename.empty())
+                tokenizer->Fail("Shape \"plymesh\" without a filename.");
+
+            geometry.Mesh = Resolve(filename);
+        }
+        else
+        {
+            geometry.InlineMesh = MakeTriangleMesh(parameters, tokenizer);
+        }
+
+        if (m_objectName)
+            m_objectGeometries.push_back(std::move(geometry));
+        else
+            m_file->Geometries.push_back(std::move(geometry));
+    }
+
+    void AddSphere(const ParameterList& parameters)
+    {
+        if (!m_state.AreaLight)
+        {
+            Warn("Spheres are only supported as area lights");
+            return;
+        }
+
+        if (m_objectName)
+        {
+            Warn("Area lights in objects aren't supported");
+            return;
+        }
+
+        // Spheres stay spheres under uniform scales, which are all that is supported.
+        float scale = std::cbrt(std::abs(glm::determinant(glm::mat3(m_state.Ctm))));
+
+        SphereLight light{};
+        light.Position = glm::vec3(m_state.Ctm * glm::vec4(0.f, 0.f, 0.f, 1.f));
+        light.Radius = GetFloat(parameters, "radius", 1.f) * scale;
+        light.L = *m_state.AreaLight;
+
+        m_file->Lights.push_back(light);
+    }
+
+    // Vertices without normals get the area weighted normal of their triangles, and ones without
+    // UVs get zeros.
+    std::shared_ptr<const Mesh> MakeTriangleMesh(const ParameterList& parameters,
+                                                 Tokenizer* tokenizer)
+    {
+        const Parameter* positions = FindParameter(parameters, "P");
+
+        if (!positions || positions->Numbers.empty() || positions->Numbers.size() % 3 != 0)
+            tokenizer->Fail("Shape \"trianglemesh\" needs \"point3 P\".");
+
+        size_t vertexCount = positions->Numbers.size() / 3;
+
+        auto mesh = std::make_shared<Mesh>();
+        mesh->Positions.resize(vertexCount);
+
+        for (size_t i = 0; i < vertexCount; ++i)
+            mesh->Positions[i] = ToVec3(positions->Numbers, 3 * i);
+
+        if (const Parameter* indices = FindParameter(parameters, "indices"))
+        {
+            for (double index : indices->Numbers)
+            {
+                if (index < 0.0 || index >= static_cast<double>(vertexCount))
+                    tokenizer->Fail("Shape \"trianglemesh\" has an index out of range.");
+
+                mesh->Indices.push_back(static_cast<uint32_t>(index));
+            }
+        }
+        else if (vertexCount == 3)
+        {
+            mesh->Indices = {0, 1, 2};
+        }
+
+        if (mesh->Indices.empty() || mesh->Indices.size() % 3 != 0)
+            tokenizer->Fail("Shape \"trianglemesh\" needs \"integer indices\" of triangles.");
+
+        const Parameter* normals = FindParameter(parameters, "N");
+
+        if (normals && normals->Numbers.size() == 3 * vertexCount)
+        {
+            mesh->Normals.resize(vertexCount);
+
+            for (size_t i = 0; i < vertexCount; ++i)
+                mesh->Normals[i] = ToVec3(normals->Numbers, 3 * i);
+        }
+        else
+        {
+            mesh->Normals.assign(vertexCount, glm::vec3(0.f));
+
+            for (size_t i = 0; i < mesh->Indices.size(); i += 3)
+            {
+                uint32_t v0 = mesh->Indices[i];
+                uint32_t v1 = mesh->Indices[i + 1];
+                uint32_t v2 = mesh->Indices[i + 2];
+
+                glm::vec3 n = glm::cross(mesh->Positions[v1] - mesh->Positions[v0],
+                                         mesh->Positions[v2] - mesh->Positions[v0]);
+
+                mesh->Normals[v0] += n;
+                mesh->Normals[v1] += n;
+                mesh->Normals[v2] += n;
+            }
+
+            for (glm::vec3& n : mesh->Normals)
+                n = glm::dot(n, n) > 0.f ? glm::normalize(n) : glm::vec3(0.f, 0.f, 1.f);
+        }
+
+        const Parameter* uvs = FindParameter(parameters, "uv");
+
+        if (!uvs)
+            uvs = FindParameter(parameters, "st");
+
+        mesh->UVs.assign(vertexCount, glm::vec2(0.f));
+
+        if (uvs && uvs->Numbers.size() == 2 * vertexCount)
+        {
+            for (size_t i = 0; i < vertexCount; ++i)
+            {
+                mesh->UVs[i] = glm::vec2(static_cast<float>(uvs->Numbers[2 * i]),
+                                         static_cast<float>(uvs->Numbers[2 * i + 1]));
+            }
+        }
+
+        return mesh;
+    }
+
+    std::filesystem::path m_directory;
+
+    GraphicsState m_state;
+    std::vector<SavedState> m_saved;
+
+    NamedState m_names;
+
+    // Set between ObjectBegin and ObjectEnd.
+    std::optional<std::string> m_objectName;
+    std::vector<SceneGeometry> m_objectGeometries;
+
+    ParsedFile* m_file;
+};
+
+// Objects can be instanced from any file, whichever defines them.
+void CollectObjects(ParsedFile* file, std::map<std::string, std::vector<SceneGeometry>>* objects,
+                    std::set<std::string>* warnings)
+{
+    for (auto& [name, geometries] : file->Objects)
+    {
+        if (!objects->try_emplace(name, std::move(geometries)).second)
+            warnings->insert("Object \"" + name + "\" is defined more than once");
+    }
+
+    for (ParsedFile& imported : file->ImportedFiles)
+        CollectObjects(&imported, objects, warnings);
+}
+
+// Each file's geometries, its instances' and its lights, then those of the files it imports.
+void Flatten(ParsedFile* file, const std::map<std::string, std::vector<SceneGeometry>>& objects,
+             SceneDescription* scene, std::set<std::string>* warnings)
+{
+    warnings->insert(file->Warnings.begin(), file->Warnings.end());
+
+    for (SceneGeometry& geometry : file->Geometries)
+        scene->Geometries.push_back(std::move(geometry));
+
+    for (const ObjectInstance& instance : file->Instances)
+    {
+        auto it = objects.find(instance.Name);
+
+        if (it == objects.end())
+        {
+            warnings->insert("Object \"" + instance.Name + "\" is undefined and wasn't drawn");
+            continue;
+        }
+
+        for (const SceneGeometry& geometry : it->second)
+        {
+            SceneGeometry& placed = scene->Geometries.emplace_back(geometry);
+            placed.Transform = instance.Transform * geometry.Transform;
+        }
+    }
+
+    scene->Lights.insert(scene->Lights.end(), file->Lights.begin(), file->Lights.end());
+
+    for (ParsedFile& imported : file->ImportedFiles)
+        Flatten(&imported, objects, scene, warnings);
+}
+
+} // namespace
+
+SceneDescription LoadPbrtScene(const std::filesystem::path& path, ThreadPool* pool)
+{
+    std::filesystem::path directory = path.parent_path();
+
+    ParsedFile root;
+    Parser(directory, GraphicsState{}, NamedState{}, &root).Parse(path);
+
+    // Each wave parses the files that the previous wave's files import.
+    std::vector<ParsedFile*> wave = {&root};
+
+    while (!wave.empty())
+    {
+        std::vector<std::pair<ParsedFile*, size_t>> imports;
+
+        for (ParsedFile* file : wave)
+        {
+            file->ImportedFiles.resize(file->Imports.size());
+
+            for (size_t i = 0; i < file->Imports.size(); ++i)
+                imports.emplace_back(file, i);
+        }
+
+        auto parseImport = [&](size_t importIdx)
+        {
+            auto [file, i] = imports[importIdx];
+            PendingImport& import = file->Imports[i];
+
+            Parser(directory, import.State, std::move(import.Names), &file->ImportedFiles[i])
+                .Parse(import.Path);
+        };
+
+        if (pool)
+        {
+            pool->ParallelFor(imports.size(), parseImport);
+        }
+        else
+        {
+            for (size_t i = 0; i < imports.size(); ++i)
+                parseImport(i);
+        }
+
+        wave.clear();
+
+        for (auto [file, i] : imports)
+            wave.push_back(&file->ImportedFiles[i]);
+    }
+
+    SceneDescription scene;
+    std::set<std::string> warnings;
+
+    // pbrt's default camera sits at the origin of the world and looks down z.
+    scene.Camera = root.Camera ? *root.Camera : MakeCamera(glm::mat4(1.f), 90.f);
+
+    std::map<std::string, std::vector<SceneGeometry>> objects;
+    CollectObjects(&root, &objects, &warnings);
+
+    Flatten(&root, objects, &scene, &warnings);
+
+    for (const std::string& warning : warnings)
+        std::cout << path.filename().string() << ": " << warning << "\n";
+
+    return scene;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Scene.h"
+#include "ThreadPool.h"
+
+#include <filesystem>
+
+// Parses a pbrt-v4 scene file into a SceneDescription: the perspective camera, plymesh and
+// trianglemesh shapes with the image texture of their material's reflectance, and spheres with a
+// diffuse area light as sphere lights. Anything else the renderers can't draw is skipped with a
+// warning. Paths resolve against the file's directory, including those of included and imported
+// files, as in pbrt.
+//
+// Imported files are parsed in parallel on the pool once the file that imports them has been, each
+// starting from the graphics state and names at its Import. Objects they define can be instanced
+// anywhere; their other names stay their own. Throws std::runtime_error with the file and line of
+// the first syntax error.
+SceneDescription LoadPbrtScene(const std::filesystem::path& path, ThreadPool* pool = nullptr);
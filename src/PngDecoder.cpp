@@ -0,0 +1,405 @@
+#include "ImageCodecs.h"
+#include "Inflate.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace
+{
+
+uint32_t ReadBigEndian32(const std::byte* data)
+{
+    return static_cast<uint32_t>(data[0]) << 24 | static_cast<uint32_t>(data[1]) << 16 |
+           static_cast<uint32_t>(data[2]) << 8 | static_cast<uint32_t>(data[3]);
+}
+
+enum ColorType : uint8_t
+{
+    Gray = 0,
+    RGB = 2,
+    Palette = 3,
+    GrayAlpha = 4,
+    RGBA = 6
+};
+
+struct PngHeader
+{
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+
+    uint8_t BitDepth = 0;
+    uint8_t ColorType = 0;
+    bool Interlaced = false;
+
+    uint32_t Channels = 0;
+};
+
+// Adam7 passes: the first column and row of each and the spacing between them.
+struct Pass
+{
+    uint32_t X;
+    uint32_t Y;
+    uint32_t StepX;
+    uint32_t StepY;
+};
+
+constexpr Pass kAdam7Passes[7] = {{0, 0, 8, 8}, {4, 0, 8, 8}, {0, 4, 4, 8}, {2, 0, 4, 4},
+                                  {0, 2, 2, 4}, {1, 0, 2, 2}, {0, 1, 1, 2}};
+
+uint8_t Paeth(uint8_t a, uint8_t b, uint8_t c)
+{
+    int p = a + b - c;
+    int pa = std::abs(p - a);
+    int pb = std::abs(p - b);
+    int pc = std::abs(p - c);
+
+    if (pa <= pb && pa <= pc)
+        return a;
+
+    return pb <= pc ? b : c;
+}
+
+// Undoes the filter of a row in place, given the unfiltered row above it. bpp is the distance in
+// bytes to the corresponding byte of the pixel to the left, at least 1.
+void Unfilter(uint8_t filter, uint8_t* row, const uint8_t* prior, size_t size, size_t bpp)
+{
+    switch (filter)
+    {
+    case 0:
+        break;
+    case 1:
+        for (size_t i = bpp; i < size; ++i)
+            row[i] = static_cast<uint8_t>(row[i] + row[i - bpp]);
+        break;
+    case 2:
+        for (size_t i = 0; i < size; ++i)
+            row[i] = static_cast<uint8_t>(row[i] + prior[i]);
+        break;
+    case 3:
+        for (size_t i = 0; i < bpp; ++i)
+            row[i] = static_cast<uint8_t>(row[i] + prior[i] / 2);
+
+        for (size_t i = bpp; i < size; ++i)
+            row[i] = static_cast<uint8_t>(row[i] + (row[i - bpp] + prior[i]) / 2);
+        break;
+    case 4:
+        for (size_t i = 0; i < bpp; ++i)
+            row[i] = static_cast<uint8_t>(row[i] + prior[i]);
+
+        for (size_t i = bpp; i < size; ++i)
+            row[i] = static_cast<uint8_t>(row[i] + Paeth(row[i - bpp], prior[i], prior[i - bpp]));
+        break;
+    default:
+        throw std::runtime_error("Invalid filter type.");
+    }
+}
+
+class PngDecoder
+{
+public:
+    PngDecoder(std::span<const std::byte> file, ImageSink* sink) : m_sink(sink)
+    {
+        ReadChunks(file);
+    }
+
+    void Decode()
+    {
+        ImageInfo info;
+        info.Width = m_header.Width;
+        info.Height = m_header.Height;
+        info.Format = PixelFormat::RGBA8;
+
+        AllocateSink(info, m_sink);
+
+        Inflater inflater(m_data);
+
+        if (!m_header.Interlaced)
+        {
+            DecodePass(&inflater, {0, 0, 1, 1});
+            return;
+        }
+
+        for (const Pass& pass : kAdam7Passes)
+            DecodePass(&inflater, pass);
+    }
+
+private:
+    void ReadChunks(std::span<const std::byte> file)
+    {
+        size_t pos = 8;
+        bool ended = false;
+
+        while (!ended)
+        {
+            if (file.size() - pos < 12)
+                throw std::runtime_error("Truncated chunk.");
+
+            uint32_t size = ReadBigEndian32(&file[pos]);
+            std::string_view type(reinterpret_cast<const char*>(&file[pos + 4]), 4);
+
+            if (size > file.size() - pos - 12)
+                throw std::runtime_error("Truncated chunk.");
+
+            std::span<const std::byte> data = file.subspan(pos + 8, size);
+            pos += 12 + size;
+
+            if (type == "IHDR")
+                ReadHeader(data);
+            else if (m_header.Width == 0)
+                throw std::runtime_error("Missing IHDR chunk.");
+            else if (type == "PLTE")
+                ReadPalette(data);
+            else if (type == "tRNS")
+                ReadTransparency(data);
+            else if (type == "IDAT")
+                m_data.push_back(data);
+            else if (type == "IEND")
+                ended = true;
+            else if ((static_cast<uint8_t>(type[0]) & 0x20) == 0)
+                throw std::runtime_error("Unknown critical chunk " + std::string(type) + ".");
+        }
+
+        if (m_data.empty())
+            throw std::runtime_error("Missing IDAT chunk.");
+
+        if (m_header.ColorType == Palette && m_paletteSize == 0)
+            throw std::runtime_error("Missing PLTE chunk.");
+    }
+
+    void ReadHeader(std::span<const std::byte> data)
+    {
+        if (data.size() != 13)
+            throw std::runtime_error("Invalid IHDR chunk.");
+
+        m_header.Width = ReadBigEndian32(&data[0]);
+        m_header.Height = ReadBigEndian32(&data[4]);
+        m_header.BitDepth = static_cast<uint8_t>(data[8]);
+        m_header.ColorType = static_cast<uint8_t>(data[9]);
+
+        uint8_t compression = static_cast<uint8_t>(data[10]);
+        uint8_t filter = static_cast<uint8_t>(data[11]);
+        uint8_t interlace = static_cast<uint8_t>(data[12]);
+
+        if (compression != 0 || filter != 0 || interlace > 1 || m_header.Width == 0)
+            throw std::runtime_error("Invalid IHDR chunk.");
+
+        m_header.Interlaced = interlace == 1;
+
+        uint8_t depth = m_header.BitDepth;
+        bool validDepth = false;
+
+        switch (m_header.ColorType)
+        {
+        case Gray:
+            m_header.Channels = 1;
+            validDepth = depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16;
+            break;
+        case RGB:
+            m_header.Channels = 3;
+            validDepth = depth == 8 || depth == 16;
+            break;
+        case Palette:
+            m_header.Channels = 1;
+            validDepth = depth == 1 || depth == 2 || depth == 4 || depth == 8;
+            break;
+        case GrayAlpha:
+            m_header.Channels = 2;
+            validDepth = depth == 8 || depth == 16;
+            break;
+        case RGBA:
+            m_header.Channels = 4;
+            validDepth = depth == 8 || depth == 16;
+            break;
+        }
+
+        if (!validDepth)
+            throw std::runtime_error("Invalid color type and bit depth.");
+    }
+
+    void ReadPalette(std::span<const std::byte> data)
+    {
+        if (data.size() % 3 != 0 || data.size() > 3 * 256)
+            throw std::runtime_error("Invalid PLTE chunk.");
+
+        m_paletteSize = static_cast<uint32_t>(data.size() / 3);
+
+        for (uint32_t i = 0; i < m_paletteSize; ++i)
+        {
+            m_palette[4 * i + 0] = static_cast<uint8_t>(data[3 * i + 0]);
+            m_palette[4 * i + 1] = static_cast<uint8_t>(data[3 * i + 1]);
+            m_palette[4 * i + 2] = static_cast<uint8_t>(data[3 * i + 2]);
+            m_palette[4 * i + 3] = 255;
+        }
+    }
+
+    void ReadTransparency(std::span<const std::byte> data)
+    {
+        if (m_header.ColorType == Palette)
+        {
+            if (data.size() > 256)
+                throw std::runtime_error("Invalid tRNS chunk.");
+
+            for (size_t i = 0; i < data.size(); ++i)
+                m_palette[4 * i + 3] = static_cast<uint8_t>(data[i]);
+        }
+        else if (m_header.ColorType == Gray || m_header.ColorType == RGB)
+        {
+            if (data.size() != 2 * m_header.Channels)
+                throw std::runtime_error("Invalid tRNS chunk.");
+
+            for (uint32_t c = 0; c < m_header.Channels; ++c)
+            {
+                m_transparentKey[c] = static_cast<uint16_t>(
+                    static_cast<uint8_t>(data[2 * c]) << 8 | static_cast<uint8_t>(data[2 * c + 1]));
+            }
+
+            m_hasTransparentKey = true;
+        }
+    }
+
+    // Sample c of pixel x of an unfiltered row, at the file's bit depth.
+    uint32_t GetSample(const uint8_t* row, uint32_t x, uint32_t c) const
+    {
+        uint32_t depth = m_header.BitDepth;
+
+        if (depth == 8)
+            return row[x * m_header.Channels + c];
+
+        if (depth == 16)
+        {
+            const uint8_t* sample = row + 2 * (x * m_header.Channels + c);
+            return static_cast<uint32_t>(sample[0]) << 8 | sample[1];
+        }
+
+        // Packed samples are single channel, with the leftmost pixel in the high bits.
+        uint32_t bit = x * depth;
+        return (row[bit / 8] >> (8 - depth - bit % 8)) & ((1u << depth) - 1);
+    }
+
+    // Converts a sample at the file's bit depth to 8 bits.
+    uint8_t ToByte(uint32_t sample) const
+    {
+        switch (m_header.BitDepth)
+        {
+        case 16:
+            return static_cast<uint8_t>(sample >> 8);
+        case 8:
+            return static_cast<uint8_t>(sample);
+        default:
+            return static_cast<uint8_t>(sample * 255 / ((1u << m_header.BitDepth) - 1));
+        }
+    }
+
+    // Writes count pixels of an unfiltered row to dst, step pixels apart.
+    void ConvertRow(const uint8_t* row, uint32_t count, uint8_t* dst, uint32_t step) const
+    {
+        if (m_header.BitDepth == 8 && m_header.ColorType == RGBA && step == 1)
+        {
+            memcpy(dst, row, 4 * static_cast<size_t>(count));
+            return;
+        }
+
+        for (uint32_t x = 0; x < count; ++x, dst += 4 * step)
+        {
+            if (m_header.ColorType == Palette)
+            {
+                uint32_t index = GetSample(row, x, 0);
+
+                if (index >= m_paletteSize)
+                    throw std::runtime_error("Palette index out of range.");
+
+                memcpy(dst, &m_palette[4 * index], 4);
+                continue;
+            }
+
+            uint32_t samples[4] = {};
+
+            for (uint32_t c = 0; c < m_header.Channels; ++c)
+                samples[c] = GetSample(row, x, c);
+
+            switch (m_header.ColorType)
+            {
+            case Gray:
+            case GrayAlpha:
+                dst[0] = dst[1] = dst[2] = ToByte(samples[0]);
+                dst[3] = m_header.ColorType == GrayAlpha ? ToByte(samples[1]) : 255;
+                break;
+            default:
+                dst[0] = ToByte(samples[0]);
+                dst[1] = ToByte(samples[1]);
+                dst[2] = ToByte(samples[2]);
+                dst[3] = m_header.ColorType == RGBA ? ToByte(samples[3]) : 255;
+                break;
+            }
+
+            if (m_hasTransparentKey &&
+                std::equal(samples, samples + m_header.Channels, m_transparentKey))
+            {
+                dst[3] = 0;
+            }
+        }
+    }
+
+    // Inflates the rows of the pass one at a time, unfilters them against the previous one and
+    // converts them into the sink.
+    void DecodePass(Inflater* inflater, const Pass& pass)
+    {
+        if (pass.X >= m_header.Width || pass.Y >= m_header.Height)
+            return;
+
+        uint32_t width = (m_header.Width - pass.X + pass.StepX - 1) / pass.StepX;
+        uint32_t height = (m_header.Height - pass.Y + pass.StepY - 1) / pass.StepY;
+
+        size_t bitsPerPixel = static_cast<size_t>(m_header.Channels) * m_header.BitDepth;
+        size_t rowSize = (width * bitsPerPixel + 7) / 8;
+        size_t bpp = std::max<size_t>(bitsPerPixel / 8, 1);
+
+        // The filter byte, then the row.
+        m_row.assign(1 + rowSize, 0);
+        m_prior.assign(1 + rowSize, 0);
+
+        ImageInfo info{m_header.Width, m_header.Height, PixelFormat::RGBA8};
+
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            inflater->Read(std::as_writable_bytes(std::span(m_row)));
+
+            Unfilter(m_row[0], &m_row[1], &m_prior[1], rowSize, bpp);
+
+            uint8_t* dst = reinterpret_cast<uint8_t*>(
+                GetSinkRow(*m_sink, info, pass.Y + y * pass.StepY));
+
+            ConvertRow(&m_row[1], width, dst + 4 * pass.X, pass.StepX);
+
+            std::swap(m_row, m_prior);
+        }
+    }
+
+    ImageSink* m_sink;
+
+    PngHeader m_header;
+
+    // RGBA, with the alpha of tRNS.
+    uint8_t m_palette[4 * 256] = {};
+    uint32_t m_paletteSize = 0;
+
+    uint16_t m_transparentKey[3] = {};
+    bool m_hasTransparentKey = false;
+
+    std::vector<std::span<const std::byte>> m_data;
+
+    std::vector<uint8_t> m_row;
+    std::vector<uint8_t> m_prior;
+};
+
+} // namespace
+
+void DecodePng(std::span<const std::byte> file, ImageSink* sink)
+{
+    PngDecoder decoder(file, sink);
+    decoder.Decode();
+}
@@ -1,5 +1,7 @@
 #include "ResourceManager.h"
 
+#include "Mipmap.h"
+
 #include <d3dx12.h>
 
 using winrt::check_hresult;
@@ -26,9 +28,6 @@ ResourceManager::ResourceManager(ID3D12Device* device) : m_device(device)
     ++m_fenceValue;
 
     m_fenceEvent = CreateEvent(nullptr, false, false, nullptr);
-
-    check_hresult(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER,
-                                   IID_PPV_ARGS(m_wicFactory.put())));
 }
 
 com_ptr<ID3D12Resource> ResourceManager::CreateBuffer(size_t size, D3D12_RESOURCE_FLAGS flags,
@@ -63,120 +62,86 @@ com_ptr<ID3D12Resource> ResourceManager::CreateUploadBuffer(size_t size)
 
 com_ptr<ID3D12Resource> ResourceManager::LoadImage(std::filesystem::path path)
 {
-    com_ptr<IWICBitmapDecoder> decoder;
-    check_hresult(m_wicFactory->CreateDecoderFromFilename(path.wstring().c_str(), nullptr,
-                                                          GENERIC_READ,
-                                                          WICDecodeMetadataCacheOnLoad,
-                                                          decoder.put()));
-
-    com_ptr<IWICBitmapFrameDecode> decoderFrame;
-    check_hresult(decoder->GetFrame(0, decoderFrame.put()));
-
-    WICPixelFormatGUID srcFormat;
-    check_hresult(decoderFrame->GetPixelFormat(&srcFormat));
-
-    com_ptr<IWICFormatConverter> formatConverter;
-    check_hresult(m_wicFactory->CreateFormatConverter(formatConverter.put()));
-
-    static WICPixelFormatGUID dstFormat = GUID_WICPixelFormat32bppRGBA;
-
-    BOOL canConvert = false;
-    check_hresult(formatConverter->CanConvert(srcFormat, dstFormat, &canConvert));
-
-    assert(canConvert);
-
-    check_hresult(formatConverter->Initialize(decoderFrame.get(), dstFormat,
-                                              WICBitmapDitherTypeNone, nullptr, 0.f,
-                                              WICBitmapPaletteTypeCustom));
-
-    com_ptr<IWICBitmap> bitmap;
-    check_hresult(m_wicFactory->CreateBitmapFromSource(formatConverter.get(), WICBitmapCacheOnLoad,
-                                                       bitmap.put()));
+    TextureUpload upload;
+    CopyMipChainToUpload(BuildMipChain(DecodeImage(path), nullptr), &upload);
 
-    com_ptr<IWICBitmapLock> bitmapLock;
-    check_hresult(bitmap->Lock(nullptr, WICBitmapLockRead, bitmapLock.put()));
+    return CreateTextureFromUpload(upload);
+}
 
-    uint32_t bitmapBufferSize = 0;
-    BYTE* bitmapBuffer = nullptr;
+void ResourceManager::CopyMipChainToUpload(std::span<const Image> chain, TextureUpload* upload)
+{
+    const ImageInfo& info = chain[0].Info;
 
-    check_hresult(bitmapLock->GetDataPointer(&bitmapBufferSize, &bitmapBuffer));
+    DXGI_FORMAT format = info.Format == PixelFormat::RGBA32F ? DXGI_FORMAT_R32G32B32A32_FLOAT
+                                                             : DXGI_FORMAT_R8G8B8A8_UNORM;
 
-    uint32_t bitmapWidth = 0;
-    uint32_t bitmapHeight = 0;
-    check_hresult(formatConverter->GetSize(&bitmapWidth, &bitmapHeight));
+    uint32_t levelCount = static_cast<uint32_t>(chain.size());
 
-    CD3DX12_RESOURCE_DESC textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM,
-                                                                     bitmapWidth, bitmapHeight);
+    upload->Desc = CD3DX12_RESOURCE_DESC::Tex2D(format, info.Width, info.Height, 1,
+                                                static_cast<uint16_t>(levelCount));
+    upload->Footprints.resize(levelCount);
 
-    D3D12_PLACED_SUBRESOURCE_FOOTPRINT copySrcLayout{};
     uint64_t uploadBufferSize = 0;
-    m_device->GetCopyableFootprints(&textureDesc, 0, 1, 0, &copySrcLayout, nullptr, nullptr,
-                                    &uploadBufferSize);
-
-    com_ptr<ID3D12Resource> uploadBuffer;
-
-     {
-        CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_UPLOAD);
-        CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize);
+    m_device->GetCopyableFootprints(&upload->Desc, 0, levelCount, 0, upload->Footprints.data(),
+                                    nullptr, nullptr, &uploadBufferSize);
 
-        check_hresult(m_device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE,
-                                                        &bufferDesc,
-                                                        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-                                                        IID_PPV_ARGS(uploadBuffer.put())));
-    }
+    upload->UploadBuffer = CreateUploadBuffer(uploadBufferSize);
 
     std::byte* uploadPtr = nullptr;
-    check_hresult(uploadBuffer->Map(0, nullptr, reinterpret_cast<void**>(&uploadPtr)));
+    check_hresult(upload->UploadBuffer->Map(0, nullptr, reinterpret_cast<void**>(&uploadPtr)));
 
-    std::byte* bitmapPtr = reinterpret_cast<std::byte*>(bitmapBuffer);
-
-    // Flips the image in y - for pbrt, texture coordinate (0,0) is at the lower left corner.
-    for (size_t i = 0; i < copySrcLayout.Footprint.Height; ++i)
+    for (uint32_t i = 0; i < levelCount; ++i)
     {
-        memcpy(uploadPtr + i * copySrcLayout.Footprint.RowPitch,
-               bitmapPtr + (copySrcLayout.Footprint.Height - i - 1) * bitmapWidth * 4,
-               bitmapWidth * 4);
+        const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& footprint = upload->Footprints[i];
+        const Image& level = chain[i];
+
+        size_t rowSize = level.Info.Width * GetPixelSize(level.Info.Format);
+
+        for (uint32_t y = 0; y < level.Info.Height; ++y)
+        {
+            memcpy(uploadPtr + footprint.Offset + y * footprint.Footprint.RowPitch,
+                   level.Pixels.data() + y * rowSize, rowSize);
+        }
     }
 
-    uploadBuffer->Unmap(0, nullptr);
+    upload->UploadBuffer->Unmap(0, nullptr);
+}
 
+com_ptr<ID3D12Resource> ResourceManager::CreateTextureFromUpload(const TextureUpload& upload)
+{
     com_ptr<ID3D12Resource> resource;
 
     {
         CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_DEFAULT);
         check_hresult(m_device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE,
-                                                        &textureDesc, D3D12_RESOURCE_STATE_COMMON,
+                                                        &upload.Desc, D3D12_RESOURCE_STATE_COMMON,
                                                         nullptr, IID_PPV_ARGS(resource.put())));
     }
 
     check_hresult(m_cmdAllocator->Reset());
     check_hresult(m_cmdList->Reset(m_cmdAllocator.get(), nullptr));
 
-    D3D12_TEXTURE_COPY_LOCATION copySrc{};
-    copySrc.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
-    copySrc.pResource = uploadBuffer.get();
-    copySrc.PlacedFootprint = copySrcLayout;
+    for (uint32_t i = 0; i < upload.Footprints.size(); ++i)
+    {
+        D3D12_TEXTURE_COPY_LOCATION copySrc{};
+        copySrc.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+        copySrc.pResource = upload.UploadBuffer.get();
+        copySrc.PlacedFootprint = upload.Footprints[i];
 
-    D3D12_TEXTURE_COPY_LOCATION copyDst;
-    copyDst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-    copyDst.pResource = resource.get();
-    copyDst.SubresourceIndex = 0;
+        D3D12_TEXTURE_COPY_LOCATION copyDst;
+        copyDst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+        copyDst.pResource = resource.get();
+        copyDst.SubresourceIndex = i;
 
-    m_cmdList->CopyTextureRegion(&copyDst, 0, 0, 0, &copySrc, nullptr);
+        m_cmdList->CopyTextureRegion(&copyDst, 0, 0, 0, &copySrc, nullptr);
+    }
 
     check_hresult(m_cmdList->Close());
 
     ID3D12CommandList* cmdLists[] = { m_cmdList.get() };
     m_copyQueue->ExecuteCommandLists(static_cast<uint32_t>(std::size(cmdLists)), cmdLists);
 
-    check_hresult(m_copyQueue->Signal(m_fence.get(), m_fenceValue));
-
-    while (m_fence->GetCompletedValue() < m_fenceValue)
-    {
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
-    }
-
-    ++m_fenceValue;
+    WaitForGpu();
 
     return resource;
 }
@@ -223,6 +188,17 @@ void ResourceManager::UploadToBuffer(ID3D12Resource* dstResource, size_t dstOffs
     WaitForGpu();
 }
 
+com_ptr<ID3D12Resource> ResourceManager::CreateBufferFromUpload(ID3D12Resource* uploadBuffer,
+                                                                size_t size)
+{
+    uploadBuffer->Unmap(0, nullptr);
+
+    com_ptr<ID3D12Resource> resource = CreateBuffer(size);
+    UploadToBuffer(resource.get(), 0, uploadBuffer, size);
+
+    return resource;
+}
+
 void ResourceManager::WaitForGpu()
 {
     uint64_t waitValue = m_fenceValue;
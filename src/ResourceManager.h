@@ -1,12 +1,14 @@
 #pragma once
 
+#include "Image.h"
+
 #include <d3d12.h>
 #include <d3dx12.h>
-#include <wincodec.h>
 #include <winrt/base.h>
 
 #include <filesystem>
 #include <span>
+#include <vector>
 
 template<typename T>
 class UploadIterator
@@ -51,6 +53,15 @@ private:
     size_t m_currentOffset = 0;
 };
 
+// An upload buffer laid out for a texture with a full mip chain, one footprint per level.
+struct TextureUpload
+{
+    winrt::com_ptr<ID3D12Resource> UploadBuffer;
+
+    D3D12_RESOURCE_DESC Desc{};
+    std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> Footprints;
+};
+
 class ResourceManager
 {
 public:
@@ -65,6 +76,14 @@ public:
 
     winrt::com_ptr<ID3D12Resource> LoadImage(std::filesystem::path path);
 
+    // Creates the upload buffer of a texture and copies every level of the chain, as BuildMipChain
+    // makes it, into its footprint. The upload heap is write-combined, so it is only ever written.
+    // Only touches the device, so it is safe to call from worker threads.
+    void CopyMipChainToUpload(std::span<const Image> chain, TextureUpload* upload);
+
+    // Copies every level of the upload buffer into a new texture.
+    winrt::com_ptr<ID3D12Resource> CreateTextureFromUpload(const TextureUpload& upload);
+
     void UploadToBuffer(ID3D12Resource* dstResource, size_t dstOffset,
                         std::span<const std::byte> srcData);
 
@@ -97,6 +116,25 @@ public:
         return resource;
     }
 
+    // Creates an upload buffer for count elements of T and leaves it mapped, so that data can be
+    // written into it in place. Pass it to CreateBufferFromUpload once it has been filled. Only
+    // touches the device, so it is safe to call from worker threads.
+    template<typename T>
+    winrt::com_ptr<ID3D12Resource> CreateUploadBufferAndMap(size_t count, std::span<T>* data)
+    {
+        winrt::com_ptr<ID3D12Resource> resource = CreateUploadBuffer(count * sizeof(T));
+
+        T* ptr = nullptr;
+        winrt::check_hresult(resource->Map(0, nullptr, reinterpret_cast<void**>(&ptr)));
+
+        *data = std::span<T>(ptr, count);
+
+        return resource;
+    }
+
+    winrt::com_ptr<ID3D12Resource> CreateBufferFromUpload(ID3D12Resource* uploadBuffer,
+                                                          size_t size);
+
 private:
     void WaitForGpu();
 
@@ -110,8 +148,6 @@ private:
     uint64_t m_fenceValue = 0;
 
     HANDLE m_fenceEvent;
-
-    winrt::com_ptr<IWICImagingFactory> m_wicFactory;
 };
 
 class DescriptorHeap
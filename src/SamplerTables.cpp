@@ -0,0 +1,57 @@
+#include "SamplerTables.h"
+
+#include <stdexcept>
+#include <string>
+
+SamplerType ParseSamplerType(std::string_view name)
+{
+    if (name == "halton")
+        return SamplerType::Halton;
+    if (name == "sobol")
+        return SamplerType::PaddedSobol;
+    if (name == "zsobol")
+        return SamplerType::ZSobol;
+
+    throw std::runtime_error("Unknown sampler: " + std::string(name));
+}
+
+const char* GetSamplerTypeName(SamplerType type)
+{
+    switch (type)
+    {
+        case SamplerType::Halton:
+            return "halton";
+        case SamplerType::PaddedSobol:
+            return "sobol";
+        case SamplerType::ZSobol:
+            return "zsobol";
+    }
+
+    return "unknown";
+}
+
+Sampler SamplerTables::CreateSampler(glm::uvec2 resolution) const
+{
+    HaltonSampler halton = Halton ? Halton->CreateSampler(resolution)
+                                  : HaltonSampler(nullptr, nullptr, resolution);
+
+    SobolSampler sobol(SobolMatrices.data(), static_cast<uint32_t>(Type), resolution,
+                       SamplesPerPixel, Seed);
+
+    return Sampler(static_cast<uint32_t>(Type), halton, sobol);
+}
+
+SamplerTables GetSamplerTables(SamplerType type, uint32_t samplesPerPixel, uint32_t seed,
+                               ThreadPool* pool)
+{
+    SamplerTables tables;
+    tables.Type = type;
+    tables.SamplesPerPixel = samplesPerPixel;
+    tables.Seed = seed;
+    tables.SobolMatrices = GetSobolMatrices();
+
+    if (type == SamplerType::Halton)
+        tables.Halton = GetHaltonTables(seed, pool);
+
+    return tables;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Halton.h"
+#include "Sobol.h"
+#include "ThreadPool.h"
+
+#include "shaders/Sampler.h"
+
+#include <memory>
+#include <span>
+#include <string_view>
+
+enum class SamplerType : uint32_t
+{
+    // pbrt-v4's Halton sampler with permuted digits.
+    Halton = SAMPLER_HALTON,
+
+    // The first two Sobol dimensions, padded, with a fast Owen scramble per pixel and dimension.
+    PaddedSobol = SAMPLER_PADDED_SOBOL,
+
+    // One Sobol sequence over the whole film in Morton order, shuffled so that the error of
+    // neighbouring pixels is blue noise.
+    ZSobol = SAMPLER_ZSOBOL
+};
+
+SamplerType ParseSamplerType(std::string_view name);
+
+const char* GetSamplerTypeName(SamplerType type);
+
+// Everything the samplers of one render read.
+struct SamplerTables
+{
+    SamplerType Type = SamplerType::Halton;
+
+    // ZSobol lays out this many samples per pixel, rounded up to a power of two.
+    uint32_t SamplesPerPixel = 1;
+
+    uint32_t Seed = 0;
+
+    // Null unless Type is Halton.
+    std::shared_ptr<const HaltonTables> Halton;
+
+    std::span<const uint32_t> SobolMatrices;
+
+    Sampler CreateSampler(glm::uvec2 resolution) const;
+};
+
+// Only generates the Halton tables when the Halton sampler is the one chosen.
+SamplerTables GetSamplerTables(SamplerType type, uint32_t samplesPerPixel, uint32_t seed,
+                               ThreadPool* pool = nullptr);
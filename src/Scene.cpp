@@ -0,0 +1,39 @@
+#include "Scene.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+SceneDescription GetPbrtBookScene()
+{
+    SceneDescription scene{};
+
+    scene.Camera.Origin = glm::vec3(0.f, 2.1088f, 13.574f);
+    scene.Camera.Fov = 26.5f;
+
+    glm::mat4 bookTransform =
+        glm::translate(glm::mat4(1.f), glm::vec3(0.f, 2.2f, 0.f)) *
+        glm::rotate(glm::mat4(1.f), 1.35f, glm::vec3(0.403f, -0.755f, -0.517f)) *
+        glm::scale(glm::mat4(1.f), glm::vec3(0.5f));
+
+    scene.Geometries = {
+        {"scenes/pbrt-book/geometry/mesh_00002.ply", "scenes/pbrt-book/texture/book_pages.png",
+         bookTransform},
+        {"scenes/pbrt-book/geometry/mesh_00003.ply", "scenes/pbrt-book/texture/book_pbrt.png",
+         bookTransform},
+        {"scenes/pbrt-book/geometry/mesh_00001.ply", std::nullopt,
+         glm::scale(glm::mat4(1.f), glm::vec3(0.213f))},
+    };
+
+    SphereLight light{};
+
+    light.Position = glm::vec3(34.92f, 55.92f, -15.351f);
+    light.Radius = 7.5f;
+    light.L = glm::vec3(41.5594f, 43.3127f, 45.066f);
+    scene.Lights.push_back(light);
+
+    light.Position = glm::vec3(-32.892f, 55.92f, 36.293f);
+    light.Radius = 7.5f;
+    light.L = glm::vec3(65.066f, 63.3127f, 61.5594f);
+    scene.Lights.push_back(light);
+
+    return scene;
+}
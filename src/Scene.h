@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include "shaders/Common.h"
+
+#include <glm/glm.hpp>
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// What a renderer needs to load a scene, independent of how it renders it.
+
+// A pinhole camera looking down Forward, with Right and Up spanning the film. Fov is the angle in
+// degrees that the shorter side of the film spans, as in pbrt.
+struct SceneCamera
+{
+    glm::vec3 Origin = glm::vec3(0.f, 0.f, 0.f);
+    glm::vec3 Right = glm::vec3(1.f, 0.f, 0.f);
+    glm::vec3 Up = glm::vec3(0.f, 1.f, 0.f);
+    glm::vec3 Forward = glm::vec3(0.f, 0.f, -1.f);
+
+    float Fov = 90.f;
+};
+
+struct SceneGeometry
+{
+    // A PLY file, unless InlineMesh is set.
+    std::filesystem::path Mesh;
+    std::optional<std::filesystem::path> Texture;
+
+    glm::mat4 Transform = glm::mat4(1.f);
+
+    // Instances of the same inline mesh share it.
+    std::shared_ptr<const ::Mesh> InlineMesh{};
+
+    // For messages.
+    std::string GetName() const
+    {
+        return InlineMesh ? "trianglemesh" : Mesh.filename().string();
+    }
+};
+
+struct SceneDescription
+{
+    SceneCamera Camera;
+
+    std::vector<SceneGeometry> Geometries;
+    std::vector<SphereLight> Lights;
+};
+
+// The pbrt-book scene from pbrt-v4-scenes, with paths relative to the working directory.
+SceneDescription GetPbrtBookScene();
@@ -0,0 +1,466 @@
+#include "SceneIR.h"
+
+#include "LoadQueue.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "PbrtParser.h"
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const char kSceneSnapshotMagic[8] = {'P', 'B', 'R', 'T', 'S', 'C', 'N', '\0'};
+
+// What BuildSceneIR's spans point into.
+struct SceneIRArrays
+{
+    std::vector<glm::vec3> Positions;
+    std::vector<glm::vec3> Normals;
+    std::vector<glm::vec2> UVs;
+    std::vector<uint32_t> Indices;
+
+    std::vector<SceneIRMesh> Meshes;
+    std::vector<glm::mat4> Transforms;
+    std::vector<SceneIRMaterial> Materials;
+    std::vector<SceneIRTexture> Textures;
+    std::vector<char> Strings;
+    std::vector<SceneIRInstance> Instances;
+    std::vector<SphereLight> Lights;
+};
+
+uint32_t ToIndex(size_t count, const char* what)
+{
+    if (count > std::numeric_limits<uint32_t>::max())
+        throw std::runtime_error(std::string("Too many ") + what + " for a scene.");
+
+    return static_cast<uint32_t>(count);
+}
+
+// Adds the value to the map unless it is already in it, and returns its index either way.
+template<typename Key>
+uint32_t GetOrAddIndex(std::map<Key, uint32_t>* indices, const Key& key, size_t nextIdx,
+                       bool* added)
+{
+    auto [it, inserted] = indices->try_emplace(key, static_cast<uint32_t>(nextIdx));
+    *added = inserted;
+
+    return it->second;
+}
+
+// The sections in SceneSnapshotHeader order.
+std::array<std::span<const std::byte>, SceneSnapshotHeader::NUM_SECTIONS> GetSections(
+    const SceneIR& scene)
+{
+    return {
+        std::as_bytes(scene.Positions),
+        std::as_bytes(scene.Normals),
+        std::as_bytes(scene.UVs),
+        std::as_bytes(scene.Indices),
+        std::as_bytes(scene.Meshes),
+        std::as_bytes(scene.Transforms),
+        std::as_bytes(scene.Materials),
+        std::as_bytes(scene.Textures),
+        std::as_bytes(scene.Strings),
+        std::as_bytes(scene.Instances),
+        std::as_bytes(scene.Lights),
+    };
+}
+
+void Validate(const SceneIR& scene)
+{
+    auto fail = [] { throw std::runtime_error("Scene snapshot has an index out of range."); };
+
+    if (scene.Normals.size() != scene.Positions.size() ||
+        scene.UVs.size() != scene.Positions.size())
+    {
+        fail();
+    }
+
+    for (const SceneIRMesh& mesh : scene.Meshes)
+    {
+        if (static_cast<uint64_t>(mesh.FirstVertex) + mesh.VertexCount > scene.Positions.size() ||
+            static_cast<uint64_t>(mesh.FirstIndex) + mesh.IndexCount > scene.Indices.size())
+        {
+            fail();
+        }
+
+        // Backends read vertices through the indices unchecked.
+        for (uint32_t index : scene.GetIndices(mesh))
+        {
+            if (index >= mesh.VertexCount)
+                fail();
+        }
+    }
+
+    for (const SceneIRTexture& texture : scene.Textures)
+    {
+        if (static_cast<uint64_t>(texture.PathOffset) + texture.PathSize > scene.Strings.size())
+            fail();
+    }
+
+    for (const SceneIRMaterial& material : scene.Materials)
+    {
+        if (material.TextureIdx != kSceneIRNoTexture &&
+            material.TextureIdx >= scene.Textures.size())
+        {
+            fail();
+        }
+    }
+
+    for (const SceneIRInstance& instance : scene.Instances)
+    {
+        if (instance.MeshIdx >= scene.Meshes.size() ||
+            instance.TransformIdx >= scene.Transforms.size() ||
+            instance.MaterialIdx >= scene.Materials.size())
+        {
+            fail();
+        }
+    }
+}
+
+} // namespace
+
+SceneIR BuildSceneIR(const SceneDescription& description, ThreadPool* pool)
+{
+    auto arrays = std::make_shared<SceneIRArrays>();
+
+    // Geometries that name the same file, or share an inline mesh, share a mesh.
+    std::map<std::filesystem::path, uint32_t> meshIndices;
+    std::map<const Mesh*, uint32_t> inlineMeshIndices;
+    std::map<std::string, uint32_t> textureIndices;
+    std::map<uint32_t, uint32_t> materialIndices;
+    std::map<std::array<float, 16>, uint32_t> transformIndices;
+
+    // The first geometry of each mesh.
+    std::vector<const SceneGeometry*> meshSources;
+
+    for (const SceneGeometry& source : description.Geometries)
+    {
+        SceneIRInstance& instance = arrays->Instances.emplace_back();
+        bool added = false;
+
+        instance.MeshIdx =
+            source.InlineMesh
+                ? GetOrAddIndex(&inlineMeshIndices, source.InlineMesh.get(), meshSources.size(),
+                                &added)
+                : GetOrAddIndex(&meshIndices, source.Mesh.lexically_normal(), meshSources.size(),
+                                &added);
+
+        if (added)
+            meshSources.push_back(&source);
+
+        std::array<float, 16> transform;
+        static_assert(sizeof(transform) == sizeof(glm::mat4));
+        memcpy(transform.data(), &source.Transform, sizeof(transform));
+
+        instance.TransformIdx = GetOrAddIndex(&transformIndices, transform,
+                                              arrays->Transforms.size(), &added);
+        if (added)
+            arrays->Transforms.push_back(source.Transform);
+
+        uint32_t textureIdx = kSceneIRNoTexture;
+
+        if (source.Texture)
+        {
+            std::string path = source.Texture->lexically_normal().generic_string();
+            textureIdx = GetOrAddIndex(&textureIndices, path, arrays->Textures.size(), &added);
+
+            if (added)
+            {
+                SceneIRTexture& texture = arrays->Textures.emplace_back();
+                texture.PathOffset = ToIndex(arrays->Strings.size(), "characters");
+                texture.PathSize = ToIndex(path.size(), "characters");
+
+                arrays->Strings.insert(arrays->Strings.end(), path.begin(), path.end());
+            }
+        }
+
+        instance.MaterialIdx = GetOrAddIndex(&materialIndices, textureIdx,
+                                             arrays->Materials.size(), &added);
+        if (added)
+            arrays->Materials.push_back({textureIdx});
+
+        instance.Unused = 0;
+    }
+
+    // Meshes are decoded straight into their ranges of the arrays, which are laid out first from
+    // the sizes in the cache or ply headers. Files whose sizes are only known once they are loaded
+    // are loaded up front and held until they are copied into theirs.
+    std::vector<MeshSizes> sizes(meshSources.size());
+    std::vector<Mesh> heldMeshes(meshSources.size());
+
+    auto getSizes = [&](size_t i) {
+        const SceneGeometry& source = *meshSources[i];
+
+        if (source.InlineMesh)
+        {
+            sizes[i] = {source.InlineMesh->Positions.size(), source.InlineMesh->Indices.size()};
+        }
+        else if (!GetMeshSizesCached(source.Mesh, &sizes[i]))
+        {
+            LoadMeshCached(source.Mesh, &heldMeshes[i]);
+            sizes[i] = {heldMeshes[i].Positions.size(), heldMeshes[i].Indices.size()};
+        }
+    };
+
+    if (pool)
+    {
+        pool->ParallelFor(meshSources.size(), getSizes);
+    }
+    else
+    {
+        for (size_t i = 0; i < meshSources.size(); ++i)
+            getSizes(i);
+    }
+
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+
+    for (const MeshSizes& meshSizes : sizes)
+    {
+        SceneIRMesh& irMesh = arrays->Meshes.emplace_back();
+        irMesh.FirstVertex = ToIndex(vertexCount, "vertices");
+        irMesh.VertexCount = ToIndex(meshSizes.VertexCount, "vertices");
+        irMesh.FirstIndex = ToIndex(indexCount, "indices");
+        irMesh.IndexCount = ToIndex(meshSizes.IndexCount, "indices");
+
+        vertexCount += meshSizes.VertexCount;
+        indexCount += meshSizes.IndexCount;
+    }
+
+    ToIndex(vertexCount, "vertices");
+    ToIndex(indexCount, "indices");
+
+    arrays->Positions.resize(vertexCount);
+    arrays->Normals.resize(vertexCount);
+    arrays->UVs.resize(vertexCount);
+    arrays->Indices.resize(indexCount);
+
+    {
+        LoadQueue queue(pool);
+
+        for (size_t i = 0; i < meshSources.size(); ++i)
+        {
+            queue.Add(meshSources[i]->GetName(), [&, i] {
+                const SceneGeometry& source = *meshSources[i];
+                const SceneIRMesh& irMesh = arrays->Meshes[i];
+
+                MeshSinks sinks{};
+                sinks.Allocate = [&](const MeshSizes& decodedSizes) {
+                    // The file changed since its sizes were read.
+                    if (decodedSizes.VertexCount != irMesh.VertexCount ||
+                        decodedSizes.IndexCount != irMesh.IndexCount)
+                    {
+                        throw std::runtime_error(source.GetName() + " changed while loading.");
+                    }
+
+                    sinks.Positions = std::span(arrays->Positions)
+                                          .subspan(irMesh.FirstVertex, irMesh.VertexCount);
+                    sinks.Normals = std::span(arrays->Normals)
+                                        .subspan(irMesh.FirstVertex, irMesh.VertexCount);
+                    sinks.UVs =
+                        std::span(arrays->UVs).subspan(irMesh.FirstVertex, irMesh.VertexCount);
+                    sinks.Indices =
+                        std::span(arrays->Indices).subspan(irMesh.FirstIndex, irMesh.IndexCount);
+                };
+
+                if (source.InlineMesh)
+                {
+                    CopyMeshToSinks(*source.InlineMesh, &sinks);
+                }
+                else if (!heldMeshes[i].Positions.empty())
+                {
+                    CopyMeshToSinks(heldMeshes[i], &sinks);
+                    heldMeshes[i] = Mesh{};
+                }
+                else
+                {
+                    LoadMeshCached(source.Mesh, &sinks);
+                }
+            });
+        }
+
+        size_t jobIdx = 0;
+
+        while (queue.WaitNext(&jobIdx))
+        {
+        }
+    }
+
+    arrays->Lights = description.Lights;
+
+    SceneIR scene;
+    scene.Camera = description.Camera;
+    scene.Positions = arrays->Positions;
+    scene.Normals = arrays->Normals;
+    scene.UVs = arrays->UVs;
+    scene.Indices = arrays->Indices;
+    scene.Meshes = arrays->Meshes;
+    scene.Transforms = arrays->Transforms;
+    scene.Materials = arrays->Materials;
+    scene.Textures = arrays->Textures;
+    scene.Strings = arrays->Strings;
+    scene.Instances = arrays->Instances;
+    scene.Lights = arrays->Lights;
+    scene.Storage = std::move(arrays);
+
+    return scene;
+}
+
+float GetUVLodOffset(const SceneIR& scene, uint32_t instanceIdx)
+{
+    const SceneIRInstance& instance = scene.Instances[instanceIdx];
+    const SceneIRMesh& mesh = scene.Meshes[instance.MeshIdx];
+    const glm::mat4& transform = scene.Transforms[instance.TransformIdx];
+
+    std::span<const glm::vec3> positions = scene.GetVertices(scene.Positions, mesh);
+    std::span<const glm::vec2> uvs = scene.GetVertices(scene.UVs, mesh);
+    std::span<const uint32_t> indices = scene.GetIndices(mesh);
+
+    double uvArea = 0.0;
+    double worldArea = 0.0;
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        glm::vec3 p[3];
+        glm::vec2 uv[3];
+
+        for (int j = 0; j < 3; ++j)
+        {
+            p[j] = glm::vec3(transform * glm::vec4(positions[indices[i + j]], 1.f));
+            uv[j] = uvs[indices[i + j]];
+        }
+
+        glm::vec2 du = uv[1] - uv[0];
+        glm::vec2 dv = uv[2] - uv[0];
+
+        uvArea += std::abs(du.x * dv.y - du.y * dv.x);
+        worldArea += glm::length(glm::cross(p[1] - p[0], p[2] - p[0]));
+    }
+
+    if (uvArea == 0.0 || worldArea == 0.0)
+        return 0.f;
+
+    return static_cast<float>(0.5 * std::log2(uvArea / worldArea));
+}
+
+void WriteSceneSnapshot(const SceneIR& scene, const std::filesystem::path& path)
+{
+    SceneSnapshotHeader header{};
+    memcpy(header.Magic, kSceneSnapshotMagic, sizeof(kSceneSnapshotMagic));
+    header.Version = kSceneSnapshotVersion;
+    header.Camera = scene.Camera;
+
+    auto sections = GetSections(scene);
+
+    auto align = [](uint64_t offset) {
+        return (offset + (kSceneSnapshotSectionAlignment - 1)) &
+               ~(kSceneSnapshotSectionAlignment - 1);
+    };
+
+    uint64_t offset = align(sizeof(header));
+
+    for (int i = 0; i < SceneSnapshotHeader::NUM_SECTIONS; ++i)
+    {
+        header.Sections[i].Offset = offset;
+        header.Sections[i].Size = sections[i].size();
+
+        offset = align(offset + sections[i].size());
+    }
+
+    ReplaceFile(path, [&](std::ostream& file) {
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        for (int i = 0; i < SceneSnapshotHeader::NUM_SECTIONS; ++i)
+        {
+            file.seekp(static_cast<std::streamoff>(header.Sections[i].Offset));
+            file.write(reinterpret_cast<const char*>(sections[i].data()),
+                       static_cast<std::streamsize>(sections[i].size()));
+        }
+
+        // Pads the last section, so that every section, even an empty one, lies within the file.
+        if (static_cast<uint64_t>(file.tellp()) < offset)
+        {
+            file.seekp(static_cast<std::streamoff>(offset - 1));
+            file.put('\0');
+        }
+    });
+}
+
+SceneIR LoadSceneSnapshot(const std::filesystem::path& path)
+{
+    if (!std::filesystem::is_regular_file(path))
+        throw std::runtime_error("Could not open " + path.string() + ".");
+
+    auto file = std::make_shared<MappedFile>(path);
+    std::span<const std::byte> data = file->Data();
+
+    auto fail = [&](const char* reason) {
+        throw std::runtime_error(path.string() + " is not a scene snapshot: " + reason);
+    };
+
+    if (data.size() < sizeof(SceneSnapshotHeader))
+        fail("too small.");
+
+    SceneSnapshotHeader header;
+    memcpy(&header, data.data(), sizeof(header));
+
+    if (memcmp(header.Magic, kSceneSnapshotMagic, sizeof(kSceneSnapshotMagic)) != 0)
+        fail("wrong magic.");
+
+    if (header.Version != kSceneSnapshotVersion)
+        fail("wrong version.");
+
+    auto getSection = [&]<typename T>(int sectionIdx, std::span<const T>* section) {
+        const SceneSnapshotHeader::Section& range = header.Sections[sectionIdx];
+
+        if (range.Offset > data.size() || range.Size > data.size() - range.Offset ||
+            range.Offset % kSceneSnapshotSectionAlignment != 0 || range.Size % sizeof(T) != 0)
+        {
+            fail("a section is out of range.");
+        }
+
+        *section = std::span(reinterpret_cast<const T*>(data.data() + range.Offset),
+                             range.Size / sizeof(T));
+    };
+
+    SceneIR scene;
+    scene.Camera = header.Camera;
+
+    getSection(SceneSnapshotHeader::Positions, &scene.Positions);
+    getSection(SceneSnapshotHeader::Normals, &scene.Normals);
+    getSection(SceneSnapshotHeader::UVs, &scene.UVs);
+    getSection(SceneSnapshotHeader::Indices, &scene.Indices);
+    getSection(SceneSnapshotHeader::Meshes, &scene.Meshes);
+    getSection(SceneSnapshotHeader::Transforms, &scene.Transforms);
+    getSection(SceneSnapshotHeader::Materials, &scene.Materials);
+    getSection(SceneSnapshotHeader::Textures, &scene.Textures);
+    getSection(SceneSnapshotHeader::Strings, &scene.Strings);
+    getSection(SceneSnapshotHeader::Instances, &scene.Instances);
+    getSection(SceneSnapshotHeader::Lights, &scene.Lights);
+
+    Validate(scene);
+
+    scene.Storage = std::move(file);
+
+    return scene;
+}
+
+SceneIR LoadSceneIR(const std::filesystem::path& path, ThreadPool* pool)
+{
+    if (path.empty())
+        return BuildSceneIR(GetPbrtBookScene(), pool);
+
+    if (path.extension() == ".pbrtscene")
+        return LoadSceneSnapshot(path);
+
+    return BuildSceneIR(LoadPbrtScene(path, pool), pool);
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "Scene.h"
+#include "ThreadPool.h"
+
+#include "shaders/Common.h"
+
+#include <glm/glm.hpp>
+
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+
+// A scene flattened into arrays that refer to each other by index, which is all a backend needs
+// to build its buffers and acceleration structures. Meshes are loaded and deduplicated, so nothing
+// is left to parse.
+//
+// The arrays are views into storage the SceneIR shares ownership of: the vectors BuildSceneIR
+// fills, or the mapping of a snapshot, so copies are cheap and loading a snapshot copies nothing.
+
+static constexpr uint32_t kSceneIRNoTexture = ~0u;
+
+// A range of the vertex arrays and a range of the index array, whose indices are relative to
+// FirstVertex.
+struct SceneIRMesh
+{
+    uint32_t FirstVertex;
+    uint32_t VertexCount;
+
+    uint32_t FirstIndex;
+    uint32_t IndexCount;
+};
+
+// The image file of a texture, as a range of SceneIR::Strings.
+struct SceneIRTexture
+{
+    uint32_t PathOffset;
+    uint32_t PathSize;
+};
+
+struct SceneIRMaterial
+{
+    // Of the reflectance, or kSceneIRNoTexture.
+    uint32_t TextureIdx;
+};
+
+struct SceneIRInstance
+{
+    uint32_t MeshIdx;
+    uint32_t TransformIdx;
+    uint32_t MaterialIdx;
+    uint32_t Unused;
+};
+
+struct SceneIR
+{
+    SceneCamera Camera;
+
+    // The vertices of every mesh, back to back.
+    std::span<const glm::vec3> Positions;
+    std::span<const glm::vec3> Normals;
+    std::span<const glm::vec2> UVs;
+    std::span<const uint32_t> Indices;
+
+    std::span<const SceneIRMesh> Meshes;
+
+    // Object to world, shared by instances that have the same one.
+    std::span<const glm::mat4> Transforms;
+
+    std::span<const SceneIRMaterial> Materials;
+    std::span<const SceneIRTexture> Textures;
+    std::span<const char> Strings;
+
+    // An instance per SceneGeometry, in the same order.
+    std::span<const SceneIRInstance> Instances;
+
+    std::span<const SphereLight> Lights;
+
+    // Keeps the arrays alive.
+    std::shared_ptr<const void> Storage;
+
+    std::filesystem::path GetTexturePath(uint32_t textureIdx) const
+    {
+        const SceneIRTexture& texture = Textures[textureIdx];
+
+        return std::string(Strings.data() + texture.PathOffset, texture.PathSize);
+    }
+
+    template<typename T>
+    std::span<const T> GetVertices(std::span<const T> vertices, const SceneIRMesh& mesh) const
+    {
+        return vertices.subspan(mesh.FirstVertex, mesh.VertexCount);
+    }
+
+    std::span<const uint32_t> GetIndices(const SceneIRMesh& mesh) const
+    {
+        return Indices.subspan(mesh.FirstIndex, mesh.IndexCount);
+    }
+};
+
+// Loads every distinct mesh on the pool, through the mesh cache, and flattens the description.
+// Texture paths are stored as given, so relative ones stay relative to the working directory.
+SceneIR BuildSceneIR(const SceneDescription& description, ThreadPool* pool);
+
+// The part of the ray cone texture LOD of an instance's hits that its geometry decides: half the
+// log2 of the uv area of its triangles over their world space area. Adding half the log2 of a
+// texture's texel count makes it the Delta0 of Akenine-Moller et al., "Texture Level of Detail
+// Strategies for Real-Time Ray Tracing". 0 for instances without any area.
+float GetUVLodOffset(const SceneIR& scene, uint32_t instanceIdx);
+
+// .pbrtscene snapshots hold a SceneIR in a single file: a SceneSnapshotHeader followed by a
+// section per array, each aligned to kSceneSnapshotSectionAlignment so that the arrays can be used
+// in place once the file is mapped. Snapshots are native endian and tied to the struct layouts,
+// which kSceneSnapshotVersion tracks.
+
+static constexpr uint32_t kSceneSnapshotVersion = 1;
+static constexpr size_t kSceneSnapshotSectionAlignment = 256;
+
+struct SceneSnapshotHeader
+{
+    char Magic[8];
+    uint32_t Version;
+    uint32_t Unused;
+
+    SceneCamera Camera;
+
+    struct Section
+    {
+        uint64_t Offset;
+        uint64_t Size;
+    };
+
+    enum
+    {
+        Positions = 0,
+        Normals,
+        UVs,
+        Indices,
+        Meshes,
+        Transforms,
+        Materials,
+        Textures,
+        Strings,
+        Instances,
+        Lights,
+        NUM_SECTIONS
+    };
+
+    Section Sections[NUM_SECTIONS];
+};
+
+void WriteSceneSnapshot(const SceneIR& scene, const std::filesystem::path& path);
+
+// Maps the snapshot and points the arrays into it. Throws std::runtime_error if the file isn't a
+// snapshot of this version, or if its sections or indices are out of range, which reads every
+// vertex index.
+SceneIR LoadSceneSnapshot(const std::filesystem::path& path);
+
+// The built-in pbrt-book scene for an empty path, a snapshot for a .pbrtscene file and a parsed
+// pbrt-v4 scene for anything else.
+SceneIR LoadSceneIR(const std::filesystem::path& path, ThreadPool* pool);
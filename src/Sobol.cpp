@@ -0,0 +1,29 @@
+#include "Sobol.h"
+
+#include <array>
+
+static constexpr size_t kSobolColumnCount = SOBOL_DIMENSION_COUNT * SOBOL_MATRIX_SIZE;
+
+// Dimension 0 is the van der Corput sequence, whose matrix is the identity. Dimension 1 comes from
+// the primitive polynomial x + 1, for which each direction number is the previous one xored with
+// itself shifted by a bit. Both match pbrt-v4's SobolMatrices32.
+static constexpr std::array<uint32_t, kSobolColumnCount> kSobolMatrices = [] {
+    std::array<uint32_t, kSobolColumnCount> matrices{};
+
+    uint32_t v = 1u << 31;
+
+    for (uint32_t i = 0; i < SOBOL_MATRIX_SIZE; ++i)
+    {
+        matrices[i] = i < 32 ? 1u << (31 - i) : 0;
+
+        matrices[SOBOL_MATRIX_SIZE + i] = v;
+        v ^= v >> 1;
+    }
+
+    return matrices;
+}();
+
+std::span<const uint32_t> GetSobolMatrices()
+{
+    return kSobolMatrices;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "shaders/SobolSampler.h"
+
+#include <span>
+
+// The generator matrices of the first two Sobol dimensions, SOBOL_MATRIX_SIZE columns each, as the
+// Sobol samplers read them. Computed at compile time.
+std::span<const uint32_t> GetSobolMatrices();
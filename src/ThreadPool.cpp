@@ -0,0 +1,166 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <exception>
+
+namespace
+{
+
+// Identifies the pool and worker running on the current thread, if any.
+thread_local const ThreadPool* t_pool = nullptr;
+thread_local size_t t_workerIdx = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+    m_workers.reserve(threadCount);
+
+    for (size_t i = 0; i < threadCount; ++i)
+        m_workers.push_back(std::make_unique<Worker>());
+
+    for (size_t i = 0; i < threadCount; ++i)
+        m_workers[i]->Thread = std::thread(&ThreadPool::WorkerMain, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_wakeCondition.notify_all();
+
+    for (auto& worker : m_workers)
+        worker->Thread.join();
+}
+
+void ThreadPool::Submit(std::function<void()> job)
+{
+    size_t workerIdx = 0;
+
+    {
+        std::lock_guard lock(m_mutex);
+
+        if (t_pool == this)
+            workerIdx = t_workerIdx;
+        else
+            workerIdx = m_nextWorker++ % m_workers.size();
+
+        ++m_queuedJobs;
+    }
+
+    {
+        std::lock_guard lock(m_workers[workerIdx]->Mutex);
+        m_workers[workerIdx]->Jobs.push_back(std::move(job));
+    }
+
+    m_wakeCondition.notify_one();
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& fn)
+{
+    if (count == 0)
+        return;
+
+    std::atomic<size_t> nextIdx = 0;
+
+    std::mutex mutex;
+    std::condition_variable doneCondition;
+    size_t runningJobs = std::min(count, m_workers.size());
+    std::exception_ptr error;
+
+    for (size_t i = 0, jobCount = runningJobs; i < jobCount; ++i)
+    {
+        Submit([&] {
+            try
+            {
+                for (size_t idx = nextIdx++; idx < count; idx = nextIdx++)
+                    fn(idx);
+            }
+            catch (...)
+            {
+                nextIdx = count;
+
+                std::lock_guard lock(mutex);
+
+                if (!error)
+                    error = std::current_exception();
+            }
+
+            // Notify while holding the lock, since the waiter owns the condition variable.
+            std::lock_guard lock(mutex);
+
+            if (--runningJobs == 0)
+                doneCondition.notify_one();
+        });
+    }
+
+    std::unique_lock lock(mutex);
+    doneCondition.wait(lock, [&] { return runningJobs == 0; });
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+bool ThreadPool::TryPop(size_t workerIdx, std::function<void()>* job)
+{
+    {
+        Worker& worker = *m_workers[workerIdx];
+        std::lock_guard lock(worker.Mutex);
+
+        if (!worker.Jobs.empty())
+        {
+            *job = std::move(worker.Jobs.back());
+            worker.Jobs.pop_back();
+            return true;
+        }
+    }
+
+    for (size_t i = 1; i < m_workers.size(); ++i)
+    {
+        Worker& victim = *m_workers[(workerIdx + i) % m_workers.size()];
+        std::lock_guard lock(victim.Mutex);
+
+        if (!victim.Jobs.empty())
+        {
+            *job = std::move(victim.Jobs.front());
+            victim.Jobs.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::WorkerMain(size_t workerIdx)
+{
+    t_pool = this;
+    t_workerIdx = workerIdx;
+
+    while (true)
+    {
+        {
+            std::unique_lock lock(m_mutex);
+            m_wakeCondition.wait(lock, [this] { return m_stop || m_queuedJobs > 0; });
+
+            if (m_queuedJobs == 0)
+                return;
+
+            // Claim a job before looking for it, so that each queued job wakes exactly one worker.
+            --m_queuedJobs;
+        }
+
+        std::function<void()> job;
+
+        // The claimed job may still be in flight between Submit's two critical sections.
+        while (!TryPop(workerIdx, &job))
+            std::this_thread::yield();
+
+        job();
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads. Each worker owns a deque of jobs: it pops its own jobs from
+// the back and steals from the front of other workers' deques when it runs out.
+class ThreadPool
+{
+public:
+    // A thread count of 0 uses one thread per hardware thread.
+    explicit ThreadPool(size_t threadCount = 0);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t GetThreadCount() const
+    {
+        return m_workers.size();
+    }
+
+    // Jobs submitted from a worker go to that worker's deque, other jobs are spread round-robin.
+    void Submit(std::function<void()> job);
+
+    // Calls fn(i) for every i in [0, count) across the workers and blocks until all calls have
+    // returned. Indices are handed out one at a time, so uneven work balances itself. Rethrows the
+    // first exception thrown by fn, after which no further indices are started. Must not be called
+    // from one of this pool's workers.
+    void ParallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+private:
+    struct Worker
+    {
+        std::mutex Mutex;
+        std::deque<std::function<void()>> Jobs;
+
+        std::thread Thread;
+    };
+
+    bool TryPop(size_t workerIdx, std::function<void()>* job);
+
+    void WorkerMain(size_t workerIdx);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeCondition;
+
+    size_t m_queuedJobs = 0;
+    size_t m_nextWorker = 0;
+    bool m_stop = false;
+};
@@ -0,0 +1,238 @@
+#include "VertexLayout.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+VertexLayout ParseVertexLayout(std::string_view name)
+{
+    if (name == "separate")
+        return VertexLayout::Separate;
+    if (name == "interleaved")
+        return VertexLayout::Interleaved;
+    if (name == "quantized")
+        return VertexLayout::Quantized;
+
+    throw std::runtime_error("Unknown vertex layout: " + std::string(name));
+}
+
+const char* GetVertexLayoutName(VertexLayout layout)
+{
+    switch (layout)
+    {
+        case VertexLayout::Separate:
+            return "separate";
+        case VertexLayout::Interleaved:
+            return "interleaved";
+        case VertexLayout::Quantized:
+            return "quantized";
+    }
+
+    return "unknown";
+}
+
+static int16_t FloatToSnorm16(float value)
+{
+    return static_cast<int16_t>(std::round(std::clamp(value, -1.f, 1.f) * 32767.f));
+}
+
+static float Snorm16ToFloat(int16_t value)
+{
+    return std::max(static_cast<float>(value) / 32767.f, -1.f);
+}
+
+static float SignNotZero(float value)
+{
+    return value >= 0.f ? 1.f : -1.f;
+}
+
+uint32_t EncodeOctahedralNormal(glm::vec3 n)
+{
+    float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+
+    // Degenerate normals would otherwise encode as NaN.
+    if (length == 0.f)
+        return EncodeOctahedralNormal(glm::vec3(0.f, 0.f, 1.f));
+
+    n /= length;
+
+    glm::vec2 p(n.x, n.y);
+
+    // Fold the lower hemisphere over the diagonals.
+    if (n.z < 0.f)
+    {
+        p = glm::vec2((1.f - std::abs(n.y)) * SignNotZero(n.x),
+                      (1.f - std::abs(n.x)) * SignNotZero(n.y));
+    }
+
+    auto x = static_cast<uint16_t>(FloatToSnorm16(p.x));
+    auto y = static_cast<uint16_t>(FloatToSnorm16(p.y));
+
+    return static_cast<uint32_t>(x) | (static_cast<uint32_t>(y) << 16);
+}
+
+glm::vec3 DecodeOctahedralNormal(uint32_t encoded)
+{
+    glm::vec2 p(Snorm16ToFloat(static_cast<int16_t>(encoded & 0xffff)),
+                Snorm16ToFloat(static_cast<int16_t>(encoded >> 16)));
+
+    glm::vec3 n(p.x, p.y, 1.f - std::abs(p.x) - std::abs(p.y));
+
+    if (n.z < 0.f)
+    {
+        n.x = (1.f - std::abs(p.y)) * SignNotZero(p.x);
+        n.y = (1.f - std::abs(p.x)) * SignNotZero(p.y);
+    }
+
+    return glm::normalize(n);
+}
+
+uint16_t FloatToHalf(float value)
+{
+    uint32_t bits = std::bit_cast<uint32_t>(value);
+
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t exponent = (bits >> 23) & 0xff;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    // Infinity and NaN. NaNs keep a non-zero mantissa.
+    if (exponent == 0xff)
+        return static_cast<uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+
+    int halfExponent = static_cast<int>(exponent) - 127 + 15;
+
+    if (halfExponent >= 0x1f)
+        return static_cast<uint16_t>(sign | 0x7c00);
+
+    if (halfExponent <= 0)
+    {
+        // Denormal or zero. Shift the mantissa (with its implicit bit) into place, rounding to
+        // nearest even.
+        if (halfExponent < -10)
+            return static_cast<uint16_t>(sign);
+
+        mantissa |= 0x800000;
+
+        uint32_t shift = static_cast<uint32_t>(14 - halfExponent);
+        uint32_t halfMantissa = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+
+        if (remainder > halfway || (remainder == halfway && (halfMantissa & 1)))
+            ++halfMantissa;
+
+        return static_cast<uint16_t>(sign | halfMantissa);
+    }
+
+    uint32_t half = sign | (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1fff;
+
+    // A carry out of the mantissa correctly bumps the exponent, up to infinity.
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+        ++half;
+
+    return static_cast<uint16_t>(half);
+}
+
+float HalfToFloat(uint16_t value)
+{
+    uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+
+    if (exponent == 0x1f)
+        return std::bit_cast<float>(sign | 0x7f800000 | (mantissa << 13));
+
+    if (exponent == 0)
+    {
+        float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -magnitude : magnitude;
+    }
+
+    return std::bit_cast<float>(sign | ((exponent - 15 + 127) << 23) | (mantissa << 13));
+}
+
+template<typename T>
+static std::vector<std::byte> ToBytes(const std::vector<T>& data)
+{
+    std::vector<std::byte> bytes(data.size() * sizeof(T));
+    memcpy(bytes.data(), data.data(), bytes.size());
+
+    return bytes;
+}
+
+PackedMesh PackMesh(const Mesh& mesh, const VertexLayoutOptions& options)
+{
+    PackedMesh packed{};
+    packed.Layout = options.Layout;
+    packed.VertexCount = static_cast<uint32_t>(mesh.Positions.size());
+    packed.IndexCount = static_cast<uint32_t>(mesh.Indices.size());
+
+    switch (options.Layout)
+    {
+        case VertexLayout::Separate:
+        {
+            packed.Positions = ToBytes(mesh.Positions);
+            packed.PositionStride = sizeof(glm::vec3);
+
+            packed.Normals = ToBytes(mesh.Normals);
+            packed.UVs = ToBytes(mesh.UVs);
+            break;
+        }
+
+        case VertexLayout::Interleaved:
+        {
+            std::vector<InterleavedVertex> vertices(mesh.Positions.size());
+
+            for (size_t i = 0; i < vertices.size(); ++i)
+                vertices[i] = {mesh.Positions[i], mesh.Normals[i], mesh.UVs[i]};
+
+            packed.Positions = ToBytes(vertices);
+            packed.PositionStride = sizeof(InterleavedVertex);
+            break;
+        }
+
+        case VertexLayout::Quantized:
+        {
+            packed.Positions = ToBytes(mesh.Positions);
+            packed.PositionStride = sizeof(glm::vec3);
+
+            std::vector<QuantizedVertexAttributes> attributes(mesh.Positions.size());
+
+            for (size_t i = 0; i < attributes.size(); ++i)
+            {
+                attributes[i].Normal = EncodeOctahedralNormal(mesh.Normals[i]);
+                attributes[i].UV = static_cast<uint32_t>(FloatToHalf(mesh.UVs[i].x)) |
+                                   (static_cast<uint32_t>(FloatToHalf(mesh.UVs[i].y)) << 16);
+            }
+
+            packed.Normals = ToBytes(attributes);
+            break;
+        }
+    }
+
+    if (options.Layout == VertexLayout::Quantized && options.Allow16BitIndices &&
+        mesh.Positions.size() < 0x10000)
+    {
+        std::vector<uint16_t> indices(mesh.Indices.begin(), mesh.Indices.end());
+
+        packed.Indices = ToBytes(indices);
+        packed.IndexSize = sizeof(uint16_t);
+    }
+    else
+    {
+        packed.Indices = ToBytes(mesh.Indices);
+        packed.IndexSize = sizeof(uint32_t);
+    }
+
+    return packed;
+}
+
+size_t GetUnpackedMeshSize(const Mesh& mesh)
+{
+    return mesh.Positions.size() * sizeof(glm::vec3) + mesh.Normals.size() * sizeof(glm::vec3) +
+           mesh.UVs.size() * sizeof(glm::vec2) + mesh.Indices.size() * sizeof(uint32_t);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include "shaders/Common.h"
+
+#include <string_view>
+
+enum class VertexLayout : uint32_t
+{
+    // Positions, normals and uvs in three buffers, as loaded.
+    Separate = VERTEX_LAYOUT_SEPARATE,
+
+    // One buffer of InterleavedVertex, used for both the acceleration structure and shading.
+    Interleaved = VERTEX_LAYOUT_INTERLEAVED,
+
+    // Float positions for the acceleration structure plus one buffer of QuantizedVertexAttributes.
+    Quantized = VERTEX_LAYOUT_QUANTIZED
+};
+
+VertexLayout ParseVertexLayout(std::string_view name);
+
+const char* GetVertexLayoutName(VertexLayout layout);
+
+struct VertexLayoutOptions
+{
+    VertexLayout Layout = VertexLayout::Separate;
+
+    // Only applies to the quantized layout, and only when every index fits.
+    bool Allow16BitIndices = true;
+};
+
+// A mesh converted to the buffers that are uploaded for it.
+struct PackedMesh
+{
+    VertexLayout Layout = VertexLayout::Separate;
+
+    uint32_t VertexCount = 0;
+    uint32_t IndexCount = 0;
+
+    // Read by the acceleration structure build, PositionStride bytes apart. For the interleaved
+    // layout this is the only vertex buffer.
+    std::vector<std::byte> Positions;
+    uint32_t PositionStride = 0;
+
+    // Bound as g_normals and g_uvs. Only the separate layout uses both; the quantized layout keeps
+    // everything in Normals, and the interleaved layout leaves both empty.
+    std::vector<std::byte> Normals;
+    std::vector<std::byte> UVs;
+
+    std::vector<std::byte> Indices;
+    uint32_t IndexSize = sizeof(uint32_t);
+
+    size_t GetSize() const
+    {
+        return Positions.size() + Normals.size() + UVs.size() + Indices.size();
+    }
+};
+
+PackedMesh PackMesh(const Mesh& mesh, const VertexLayoutOptions& options);
+
+// Size of the mesh in the separate layout with 32-bit indices, to compare packed sizes against.
+size_t GetUnpackedMeshSize(const Mesh& mesh);
+
+uint32_t EncodeOctahedralNormal(glm::vec3 n);
+glm::vec3 DecodeOctahedralNormal(uint32_t encoded);
+
+// Rounds to nearest even. Values out of range become infinity.
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t value);
@@ -0,0 +1,196 @@
+#include "Bench.h"
+
+#include "CpuScene.h"
+#include "PathTracer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+
+struct RenderResult
+{
+    double Ms = 0.0;
+    double Rmse = 0.0;
+    double RelMse = 0.0;
+    double MeanSpp = 0.0;
+    uint32_t Passes = 0;
+
+    // Pixels with fewer samples than a batch or more than the maximum.
+    size_t BadSampleCounts = 0;
+};
+
+// Mean of the squared error relative to the squared reference, which is how noise is perceived
+// and what a relative error threshold aims at. The offset keeps black pixels from dominating.
+double ComputeRelMse(const Film& film, const Film& reference)
+{
+    double sum = 0.0;
+
+    for (uint32_t y = 0; y < film.GetHeight(); ++y)
+    {
+        for (uint32_t x = 0; x < film.GetWidth(); ++x)
+        {
+            glm::vec3 ref = reference.GetPixel(x, y);
+            glm::vec3 diff = film.GetPixel(x, y) - ref;
+
+            sum += glm::dot(diff * diff, 1.f / (ref * ref + 0.01f));
+        }
+    }
+
+    return sum / (3.0 * film.GetWidth() * film.GetHeight());
+}
+
+RenderResult Render(const CpuScene& scene, const RenderOptions& options, ThreadPool* pool,
+                    const Film& reference)
+{
+    Film film(reference.GetWidth(), reference.GetHeight());
+    RenderStats stats{};
+
+    RenderResult result;
+    result.Ms = TimeMs(1, [&] { stats = RenderScene(scene, options, pool, &film); });
+    result.Rmse = ComputeRmse(film, reference);
+    result.RelMse = ComputeRelMse(film, reference);
+    result.MeanSpp = stats.CameraRays / (static_cast<double>(film.GetWidth()) * film.GetHeight());
+    result.Passes = stats.Passes;
+
+    uint32_t minSpp = std::min(options.AdaptiveBatchSize, options.SamplesPerPixel);
+
+    for (uint32_t y = 0; y < film.GetHeight(); ++y)
+    {
+        for (uint32_t x = 0; x < film.GetWidth(); ++x)
+        {
+            uint32_t spp = film.GetSampleCount(x, y);
+            result.BadSampleCounts += spp < minSpp || spp > options.SamplesPerPixel;
+        }
+    }
+
+    return result;
+}
+
+// How much faster than uniform sampling a render got to its error, by the given metric. The time
+// uniform sampling takes is interpolated in log-log space between the uniform renders, which have
+// to be in order of increasing samples. Negative when the error is outside of their range.
+double GetSpeedup(std::span<const RenderResult> uniform, const RenderResult& result,
+                  double RenderResult::*error)
+{
+    double target = result.*error;
+
+    for (size_t i = 0; i + 1 < uniform.size(); ++i)
+    {
+        double a = uniform[i].*error;
+        double b = uniform[i + 1].*error;
+
+        if (target > a || target < b)
+            continue;
+
+        double t = std::log(target / a) / std::log(b / a);
+
+        return uniform[i].Ms * std::pow(uniform[i + 1].Ms / uniform[i].Ms, t) / result.Ms;
+    }
+
+    return -1.0;
+}
+
+void PrintResult(const std::string& name, const RenderResult& result)
+{
+    std::cout << std::left << std::setw(16) << name << std::right << std::setprecision(1)
+              << std::setw(10) << result.Ms << std::setw(10) << result.MeanSpp << std::setw(8)
+              << result.Passes << std::setprecision(5) << std::setw(12) << result.Rmse
+              << std::scientific << std::setprecision(2) << std::setw(12) << result.RelMse
+              << std::fixed;
+}
+
+} // namespace
+
+int RunAdaptiveBench(std::span<const std::string> argSpan)
+{
+    std::vector<std::string> args(argSpan.begin(), argSpan.end());
+
+    int threadCount = TakeIntOption(&args, "--threads", 0);
+    int width = TakeIntOption(&args, "--width", 128);
+    int height = TakeIntOption(&args, "--height", 72);
+    int referenceSpp = TakeIntOption(&args, "--reference-spp", 2048);
+    int maxSpp = TakeIntOption(&args, "--max-spp", 512);
+    int batchSize = TakeIntOption(&args, "--batch", 16);
+
+    if (width <= 0 || height <= 0 || referenceSpp <= 0 || maxSpp <= 0 || batchSize <= 0)
+        throw std::runtime_error("Sizes and sample counts must be positive.");
+
+    ThreadPool pool(static_cast<size_t>(threadCount));
+
+    CpuScene scene;
+    LoadCpuScene(GetPbrtBookScene(), &pool, &scene);
+
+    RenderOptions options;
+    options.SamplesPerPixel = static_cast<uint32_t>(referenceSpp);
+    options.Seed = kReferenceSeed;
+
+    Film reference(width, height);
+    RenderScene(scene, options, &pool, &reference);
+
+    options.Seed = 1;
+    options.AdaptiveBatchSize = static_cast<uint32_t>(batchSize);
+
+    std::cout << std::fixed << width << "x" << height << ", reference of " << referenceSpp
+              << " spp. Speedups are of the time to the same error as uniform sampling.\n\n"
+              << std::left << std::setw(16) << "sampling" << std::right << std::setw(10) << "ms"
+              << std::setw(10) << "spp" << std::setw(8) << "passes" << std::setw(12) << "RMSE"
+              << std::setw(12) << "relMSE" << std::setw(14) << "RMSE speedup" << std::setw(16)
+              << "relMSE speedup" << "\n";
+
+    SamplerTables sharedTables = GetSamplerTables(options.Sampler, 1, options.Seed, &pool);
+
+    std::vector<RenderResult> uniform;
+
+    for (int spp = batchSize; spp <= maxSpp; spp *= 2)
+    {
+        options.SamplesPerPixel = static_cast<uint32_t>(spp);
+
+        uniform.push_back(Render(scene, options, &pool, reference));
+
+        PrintResult("uniform", uniform.back());
+        std::cout << "\n";
+    }
+
+    options.SamplesPerPixel = static_cast<uint32_t>(maxSpp);
+
+    size_t badSampleCounts = 0;
+
+    for (float threshold : {0.2f, 0.1f, 0.05f, 0.02f, 0.01f})
+    {
+        options.AdaptiveThreshold = threshold;
+
+        RenderResult result = Render(scene, options, &pool, reference);
+        badSampleCounts += result.BadSampleCounts;
+
+        std::ostringstream name;
+        name << "adaptive " << std::setprecision(2) << threshold;
+
+        PrintResult(name.str(), result);
+
+        std::cout << std::setprecision(2);
+
+        for (double RenderResult::*error : {&RenderResult::Rmse, &RenderResult::RelMse})
+        {
+            double speedup = GetSpeedup(uniform, result, error);
+            int columnWidth = error == &RenderResult::Rmse ? 13 : 15;
+
+            if (speedup < 0.0)
+                std::cout << std::setw(columnWidth + 1) << "-";
+            else
+                std::cout << std::setw(columnWidth) << speedup << "x";
+        }
+
+        std::cout << "\n";
+    }
+
+    std::cout << "\n"
+              << badSampleCounts << " pixels with fewer samples than a batch or more than the "
+              << "maximum" << (badSampleCounts == 0 ? "" : "  MISMATCH") << std::endl;
+
+    return badSampleCounts == 0 ? 0 : 1;
+}
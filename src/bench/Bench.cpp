@@ -0,0 +1,154 @@
+#include "Bench.h"
+
+#include "Film.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+size_t GetPeakRss()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+
+    return counters.PeakWorkingSetSize;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+
+    // ru_maxrss is in kilobytes on Linux.
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+CacheMissCounter::CacheMissCounter()
+{
+#ifdef __linux__
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1;
+
+    m_fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+}
+
+CacheMissCounter::~CacheMissCounter()
+{
+#ifdef __linux__
+    if (m_fd >= 0)
+        close(m_fd);
+#endif
+}
+
+uint64_t CacheMissCounter::Read() const
+{
+    uint64_t count = 0;
+
+#ifdef __linux__
+    if (m_fd >= 0 && read(m_fd, &count, sizeof(count)) != sizeof(count))
+        count = 0;
+#endif
+
+    return count;
+}
+
+int TakeIntOption(std::vector<std::string>* args, const std::string& name, int defaultValue)
+{
+    auto it = std::find(args->begin(), args->end(), name);
+
+    if (it == args->end())
+        return defaultValue;
+
+    if (it + 1 == args->end())
+        throw std::runtime_error("Missing value for " + name + ".");
+
+    int value = std::stoi(*(it + 1));
+    args->erase(it, it + 2);
+
+    return value;
+}
+
+std::vector<std::filesystem::path> CollectFiles(std::span<const std::string> args,
+                                                const std::string& extension,
+                                                const std::filesystem::path& defaultDir)
+{
+    std::vector<std::filesystem::path> inputs(args.begin(), args.end());
+
+    if (inputs.empty())
+        inputs.push_back(defaultDir);
+
+    std::vector<std::filesystem::path> files;
+
+    for (const auto& input : inputs)
+    {
+        if (!std::filesystem::is_directory(input))
+        {
+            files.push_back(input);
+            continue;
+        }
+
+        for (const auto& entry : std::filesystem::directory_iterator(input))
+        {
+            if (entry.is_regular_file() && entry.path().extension() == extension)
+                files.push_back(entry.path());
+        }
+    }
+
+    std::sort(files.begin(), files.end());
+
+    return files;
+}
+
+double ComputeRmse(const Film& film, const Film& reference)
+{
+    double sum = 0.0;
+
+    for (uint32_t y = 0; y < film.GetHeight(); ++y)
+    {
+        for (uint32_t x = 0; x < film.GetWidth(); ++x)
+        {
+            glm::vec3 diff = film.GetPixel(x, y) - reference.GetPixel(x, y);
+            sum += glm::dot(diff, diff);
+        }
+    }
+
+    return std::sqrt(sum / (3.0 * film.GetWidth() * film.GetHeight()));
+}
+
+void GetMeanLuminance(const Film& film, double* mean, double* meanVariance)
+{
+    double pixelCount = static_cast<double>(film.GetWidth()) * film.GetHeight();
+
+    *mean = 0.0;
+    *meanVariance = 0.0;
+
+    for (uint32_t y = 0; y < film.GetHeight(); ++y)
+    {
+        for (uint32_t x = 0; x < film.GetWidth(); ++x)
+        {
+            *mean += Luminance(film.GetPixel(x, y));
+            *meanVariance += film.GetVariance(x, y) / film.GetSampleCount(x, y);
+        }
+    }
+
+    *mean /= pixelCount;
+    *meanVariance /= pixelCount * pixelCount;
+}
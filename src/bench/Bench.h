@@ -0,0 +1,98 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+class Film;
+
+// Benchmarks are run as `PbrtBench <name> [args...]`. Relative scene paths resolve the same way
+// as in PbrtDX, i.e. against a `scenes` directory next to the working directory.
+static const char* const kDefaultGeometryDir = "scenes/pbrt-book/geometry";
+static const char* const kDefaultTextureDir = "scenes/pbrt-book/texture";
+
+// Reference renders use a seed no other render uses, so that their error is independent of the
+// errors measured against them.
+static constexpr uint32_t kReferenceSeed = 0x5eed;
+
+// Returns the mean wall time of fn over the given number of iterations, in milliseconds.
+template<typename F>
+double TimeMs(int iterations, F&& fn)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < iterations; ++i)
+        fn();
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count() / iterations;
+}
+
+// Removes `name value` from args and returns value, or defaultValue if the option is absent.
+int TakeIntOption(std::vector<std::string>* args, const std::string& name, int defaultValue);
+
+// Expands each argument into the files it names. Directories are searched (non-recursively) for
+// files with the given extension. Falls back to defaultDir when args is empty.
+std::vector<std::filesystem::path> CollectFiles(std::span<const std::string> args,
+                                                const std::string& extension,
+                                                const std::filesystem::path& defaultDir);
+
+// Returns the peak resident set size of this process so far, in bytes.
+size_t GetPeakRss();
+
+// Counts the last level cache misses of the thread that creates it and of the threads started
+// after it, which only add theirs once they have exited. Needs hardware performance counters on
+// Linux; elsewhere, or when the kernel doesn't expose them, it isn't available.
+class CacheMissCounter
+{
+public:
+    CacheMissCounter();
+    ~CacheMissCounter();
+
+    CacheMissCounter(const CacheMissCounter&) = delete;
+    CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+    bool IsAvailable() const
+    {
+        return m_fd >= 0;
+    }
+
+    // Zero when not available.
+    uint64_t Read() const;
+
+private:
+    int m_fd = -1;
+};
+
+// Root mean square difference of the two films' pixel means, over every color channel.
+double ComputeRmse(const Film& film, const Film& reference);
+
+// The mean luminance of the film's pixels, and the variance of that mean, estimated from the sample
+// variance of each pixel's luminance.
+void GetMeanLuminance(const Film& film, double* mean, double* meanVariance);
+
+int RunPlyLoadBench(std::span<const std::string> args);
+int RunPlyIngestBench(std::span<const std::string> args);
+int RunSceneLoadBench(std::span<const std::string> args);
+int RunMeshCacheBench(std::span<const std::string> args);
+int RunMeshOptimizeBench(std::span<const std::string> args);
+int RunVertexLayoutBench(std::span<const std::string> args);
+int RunBvhBench(std::span<const std::string> args);
+int RunRayKernelBench(std::span<const std::string> args);
+int RunHaltonBench(std::span<const std::string> args);
+int RunSamplerBench(std::span<const std::string> args);
+int RunRenderScalingBench(std::span<const std::string> args);
+int RunFilmPrecisionBench(std::span<const std::string> args);
+int RunAdaptiveBench(std::span<const std::string> args);
+int RunWavefrontBench(std::span<const std::string> args);
+int RunRaySortBench(std::span<const std::string> args);
+int RunRouletteBench(std::span<const std::string> args);
+int RunLightSamplingBench(std::span<const std::string> args);
+int RunPbrtParseBench(std::span<const std::string> args);
+int RunSceneSnapshotBench(std::span<const std::string> args);
+int RunTextureDecodeBench(std::span<const std::string> args);
+int RunTextureLodBench(std::span<const std::string> args);
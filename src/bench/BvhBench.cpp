@@ -0,0 +1,233 @@
+#include "Bench.h"
+
+#include "Bvh.h"
+#include "Scene.h"
+#include "Tlas.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+// The given ply files, untransformed, or the pbrt-book scene when none are given.
+static std::vector<SceneGeometry> GetGeometries(std::span<const std::string> args)
+{
+    std::vector<SceneGeometry> geometries;
+
+    if (args.empty())
+    {
+        geometries = GetPbrtBookScene().Geometries;
+    }
+    else
+    {
+        for (const auto& file : CollectFiles(args, ".ply", kDefaultGeometryDir))
+            geometries.push_back({file, std::nullopt, glm::mat4(1.f)});
+    }
+
+    if (geometries.empty())
+        throw std::runtime_error("No ply files found.");
+
+    return geometries;
+}
+
+// Rays from a sphere around the bounds towards random points inside them, so flat scenes are not
+// traced edge-on.
+static std::vector<Ray> GenerateRays(const Aabb& bounds, int rayCount)
+{
+    glm::vec3 center = (bounds.Min + bounds.Max) * 0.5f;
+    float radius = glm::length(bounds.Max - bounds.Min);
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> dist(0.f, 1.f);
+    std::normal_distribution<float> normal;
+
+    std::vector<Ray> rays(rayCount);
+
+    for (auto& ray : rays)
+    {
+        glm::vec3 dir(normal(rng), normal(rng), normal(rng));
+        glm::vec3 target =
+            bounds.Min + (bounds.Max - bounds.Min) * glm::vec3(dist(rng), dist(rng), dist(rng));
+
+        ray.Origin = center + glm::normalize(dir) * radius;
+        ray.Direction = glm::normalize(target - ray.Origin);
+        ray.TMin = 0.f;
+        ray.TMax = std::numeric_limits<float>::max();
+    }
+
+    return rays;
+}
+
+// Thin slabs, side by side along x, so large in y and z that every split costs about the same.
+// Binned SAH then splits off one bin at a time, into a tree that would be far deeper than
+// kBvhMaxDepth without the cap on it.
+static std::vector<Aabb> GetDegenerateBounds()
+{
+    std::vector<Aabb> bounds(100000);
+
+    for (size_t i = 0; i < bounds.size(); ++i)
+    {
+        float x = static_cast<float>(i) * 1e-7f;
+
+        bounds[i].Grow(glm::vec3(x, -1e6f, -1e6f));
+        bounds[i].Grow(glm::vec3(x, 1e6f, 1e6f));
+    }
+
+    return bounds;
+}
+
+static double ToMb(size_t bytes)
+{
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+int RunBvhBench(std::span<const std::string> argSpan)
+{
+    std::vector<std::string> args(argSpan.begin(), argSpan.end());
+
+    int threadCount = TakeIntOption(&args, "--threads", 0);
+    int rayCount = TakeIntOption(&args, "--rays", 1000000);
+    int copyCount = std::max(TakeIntOption(&args, "--instances", 1), 1);
+
+    std::vector<SceneGeometry> geometries = GetGeometries(args);
+
+    std::vector<Mesh> meshes(geometries.size());
+    Aabb sceneBounds;
+
+    for (size_t i = 0; i < geometries.size(); ++i)
+    {
+        LoadMeshFromPlyFile(geometries[i].Mesh, &meshes[i]);
+
+        for (const glm::vec3& p : meshes[i].Positions)
+            sceneBounds.Grow(glm::vec3(geometries[i].Transform * glm::vec4(p, 1.f)));
+    }
+
+    // Copies of the scene on a square grid in xz, each placing every mesh once.
+    int gridSize = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(copyCount))));
+    glm::vec3 spacing = (sceneBounds.Max - sceneBounds.Min) * 1.1f;
+
+    std::vector<TlasInstance> instances;
+
+    for (int copy = 0; copy < copyCount; ++copy)
+    {
+        glm::vec3 offset(spacing.x * static_cast<float>(copy % gridSize), 0.f,
+                         spacing.z * static_cast<float>(copy / gridSize));
+
+        for (size_t i = 0; i < geometries.size(); ++i)
+        {
+            TlasInstance& instance = instances.emplace_back();
+            instance.Transform = glm::translate(glm::mat4(1.f), offset) * geometries[i].Transform;
+            instance.BlasIdx = static_cast<uint32_t>(i);
+        }
+    }
+
+    std::vector<BvhTriangle> triangles;
+
+    for (size_t i = 0; i < instances.size(); ++i)
+    {
+        const Mesh& mesh = meshes[instances[i].BlasIdx];
+
+        size_t first = triangles.size();
+        triangles.resize(first + mesh.Indices.size() / 3);
+
+        TransformTriangles(mesh, instances[i].Transform, static_cast<uint32_t>(i),
+                           std::span(triangles).subspan(first));
+    }
+
+    ThreadPool pool(static_cast<size_t>(threadCount));
+
+    Bvh serialBvh;
+    serialBvh.Build(triangles);
+
+    Bvh bvh;
+    bvh.Build(triangles, &pool);
+
+    BvhStats serialStats = serialBvh.GetStats();
+    BvhStats stats = bvh.GetStats();
+
+    // The parallel build splits the same way, so the trees have to agree.
+    bool match = serialStats.NodeCount == stats.NodeCount && serialStats.SahCost == stats.SahCost;
+
+    std::vector<Bvh> blases(meshes.size());
+
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        std::vector<BvhTriangle> meshTriangles(meshes[i].Indices.size() / 3);
+        TransformTriangles(meshes[i], glm::mat4(1.f), 0, meshTriangles);
+
+        blases[i].Build(std::move(meshTriangles), &pool);
+    }
+
+    Tlas tlas;
+    tlas.Build(std::move(blases), std::move(instances), &pool);
+
+    TlasStats tlasStats = tlas.GetStats();
+
+    std::vector<BvhNode> degenerateNodes;
+    std::vector<uint32_t> degenerateOrder;
+    BuildBvhNodes(GetDegenerateBounds(), &pool, &degenerateNodes, &degenerateOrder);
+
+    uint32_t degenerateDepth = ComputeBvhStats(degenerateNodes).MaxDepth;
+    bool depthCapped = degenerateDepth <= kBvhMaxDepth;
+
+    std::vector<Ray> rays = GenerateRays(bvh.GetBounds(), rayCount);
+
+    std::vector<RayHit> hits(rayCount);
+    std::vector<char> found(rayCount);
+
+    double flatMs = TimeMs(1, [&] {
+        for (int i = 0; i < rayCount; ++i)
+            found[i] = bvh.Intersect(rays[i], FaceCulling::None, &hits[i]);
+    });
+
+    size_t hitCount = 0;
+    size_t mismatchCount = 0;
+
+    double tlasMs = TimeMs(1, [&] {
+        for (int i = 0; i < rayCount; ++i)
+        {
+            RayHit hit{};
+            bool tlasFound = tlas.Intersect(rays[i], ~0u, false, &hit);
+
+            hitCount += tlasFound;
+
+            // Object space tests round differently, so only count hits on a different surface.
+            if (tlasFound != static_cast<bool>(found[i]) ||
+                (tlasFound && std::abs(hit.T - hits[i].T) > 1e-3f * std::max(hits[i].T, 1.f)))
+            {
+                ++mismatchCount;
+            }
+        }
+    });
+
+    // Rays grazing an edge may go either way, but more than a handful means the two disagree.
+    bool hitsAgree = mismatchCount <= static_cast<size_t>(rayCount) / 10000;
+
+    std::cout << std::fixed << std::setprecision(1) << triangles.size() << " triangles\n"
+              << "serial build:   " << serialStats.BuildMs << " ms\n"
+              << "parallel build: " << stats.BuildMs << " ms on " << pool.GetThreadCount()
+              << " threads (" << std::setprecision(2) << serialStats.BuildMs / stats.BuildMs
+              << "x)" << (match ? "" : "  MISMATCH") << "\n"
+              << "SAH cost:       " << stats.SahCost << "\n"
+              << "max depth:      " << stats.MaxDepth << "\n"
+              << "nodes:          " << stats.NodeCount << " (" << stats.LeafCount << " leaves)\n"
+              << "leaf sizes:    ";
+
+    for (size_t size = 1; size < stats.LeafSizes.size(); ++size)
+        std::cout << " " << size << ":" << stats.LeafSizes[size];
+
+    std::cout << "\ntrace:          " << rayCount / (flatMs * 1000.0) << " Mrays/s, " << hitCount
+              << " of " << rayCount << " rays hit\n"
+              << "two-level:      " << tlasStats.InstanceCount << " instances of "
+              << tlasStats.BlasCount << " BLASes in " << ToMb(tlasStats.MemoryBytes) << " MB, "
+              << ToMb(bvh.GetMemoryBytes()) << " MB flattened, TLAS built in "
+              << tlasStats.BuildMs << " ms\n"
+              << "two-level trace: " << rayCount / (tlasMs * 1000.0) << " Mrays/s, "
+              << mismatchCount << " hits differ" << (hitsAgree ? "" : "  MISMATCH") << "\n"
+              << "degenerate input: " << degenerateDepth << " levels deep, at most "
+              << kBvhMaxDepth << " allowed" << (depthCapped ? "" : "  MISMATCH") << std::endl;
+
+    return match && hitsAgree && depthCapped ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+#include "Bench.h"
+
+#include "shaders/FilmAccumulator.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace
+{
+
+// The ways a pixel's mean has been kept, each against the mean in double.
+struct PixelState
+{
+    double Sum = 0.0;
+
+    // The GPU film before it was float: a running mean, stored to R8G8B8A8_UNORM every sample.
+    float Unorm8Mean = 0.f;
+
+    // The same running mean in float.
+    float FloatMean = 0.f;
+
+    float FloatSum = 0.f;
+
+    FilmAccumulator Accumulator{};
+};
+
+enum Method
+{
+    Unorm8Mean,
+    FloatMean,
+    FloatSum,
+    Accumulator,
+    kMethodCount
+};
+
+const char* const kMethodNames[kMethodCount] = {"unorm8 mean", "float mean", "float sum",
+                                                "compensated"};
+
+float StoreUnorm8(float value)
+{
+    return std::round(std::clamp(value, 0.f, 1.f) * 255.f) / 255.f;
+}
+
+// Mostly dark samples with a long bright tail, like those of a path traced pixel. With fireflies,
+// one in a hundred is up to a hundred times brighter than the rest.
+float DrawSample(std::mt19937* rng, bool fireflies)
+{
+    std::uniform_real_distribution<float> dist(0.f, 1.f);
+
+    float u = dist(*rng);
+    float sample = u * u * u * u;
+
+    if (fireflies && dist(*rng) < 0.01f)
+        sample += 100.f * dist(*rng);
+
+    return sample;
+}
+
+} // namespace
+
+int RunFilmPrecisionBench(std::span<const std::string> argSpan)
+{
+    std::vector<std::string> args(argSpan.begin(), argSpan.end());
+
+    int maxSamples = TakeIntOption(&args, "--samples", 4096);
+    int pixelCount = TakeIntOption(&args, "--pixels", 4096);
+
+    if (maxSamples <= 0 || pixelCount <= 0)
+        throw std::runtime_error("Sample and pixel counts must be positive.");
+
+    bool accurate = true;
+
+    for (bool fireflies : {false, true})
+    {
+        std::cout << (fireflies ? "\nwith fireflies" : "without fireflies")
+                  << ", largest error relative to the exact mean, in FLT_EPSILON\n"
+                  << std::left << std::setw(10) << "samples" << std::right;
+
+        for (const char* name : kMethodNames)
+            std::cout << std::setw(14) << name;
+
+        std::cout << "\n";
+
+        std::mt19937 rng(1);
+        std::vector<PixelState> pixels(static_cast<size_t>(pixelCount));
+
+        for (int sampleCount = 1, nextReport = 16; sampleCount <= maxSamples; ++sampleCount)
+        {
+            float N = static_cast<float>(sampleCount);
+
+            for (PixelState& pixel : pixels)
+            {
+                float sample = DrawSample(&rng, fireflies);
+
+                pixel.Sum += sample;
+                pixel.Unorm8Mean =
+                    StoreUnorm8(((N - 1.f) / N) * pixel.Unorm8Mean + (1.f / N) * sample);
+                pixel.FloatMean = ((N - 1.f) / N) * pixel.FloatMean + (1.f / N) * sample;
+                pixel.FloatSum += sample;
+                pixel.Accumulator.Add(glm::vec3(sample), 1.f);
+            }
+
+            if (sampleCount != nextReport && sampleCount != maxSamples)
+                continue;
+
+            nextReport *= 2;
+
+            double maxErrors[kMethodCount] = {};
+
+            for (PixelState& pixel : pixels)
+            {
+                double exact = pixel.Sum / sampleCount;
+
+                double means[kMethodCount] = {};
+                means[Unorm8Mean] = pixel.Unorm8Mean;
+                means[FloatMean] = pixel.FloatMean;
+                means[FloatSum] = pixel.FloatSum / N;
+                means[Accumulator] = pixel.Accumulator.GetMean().x;
+
+                for (int method = 0; method < kMethodCount; ++method)
+                {
+                    double error = std::abs(means[method] - exact) / exact;
+                    maxErrors[method] = std::max(maxErrors[method], error / FLT_EPSILON);
+                }
+            }
+
+            std::cout << std::left << std::setw(10) << sampleCount << std::right
+                      << std::setprecision(3);
+
+            for (double error : maxErrors)
+                std::cout << std::setw(14) << error;
+
+            std::cout << "\n";
+
+            accurate = accurate && maxErrors[Accumulator] <= 1.0;
+        }
+    }
+
+    std::cout << "\n"
+              << (accurate ? "compensated means within FLT_EPSILON of the exact ones"
+                           : "compensated means off by more than FLT_EPSILON  MISMATCH")
+              << std::endl;
+
+    return accurate ? 0 : 1;
+}
@@ -0,0 +1,613 @@
+#include "Bench.h"
+
+#include "Halton.h"
+
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+
+namespace
+{
+
+// pbrt-v4's Halton sampler, transcribed as directly as possible from its samplers.h,
+// lowdiscrepancy.h and hash.h, to check the shared one against. Nothing here is shared with
+// Halton.cpp, not even the primes.
+namespace reference
+{
+
+std::vector<int> ComputePrimes(int count)
+{
+    std::vector<int> primes;
+
+    for (int candidate = 2; static_cast<int>(primes.size()) < count; ++candidate)
+    {
+        bool isPrime = true;
+
+        for (int prime : primes)
+        {
+            if (prime * prime > candidate)
+                break;
+
+            if (candidate % prime == 0)
+            {
+                isPrime = false;
+                break;
+            }
+        }
+
+        if (isPrime)
+            primes.push_back(candidate);
+    }
+
+    return primes;
+}
+
+const std::vector<int> Primes = ComputePrimes(HALTON_DIMENSION_COUNT);
+
+uint64_t MurmurHash64A(const unsigned char* key, size_t len, uint64_t seed)
+{
+    const uint64_t m = 0xc6a4a7935bd1e995ull;
+    const int r = 47;
+
+    uint64_t h = seed ^ (len * m);
+
+    const unsigned char* end = key + 8 * (len / 8);
+
+    while (key != end)
+    {
+        uint64_t k;
+        std::memcpy(&k, key, sizeof(uint64_t));
+        key += 8;
+
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+
+        h ^= k;
+        h *= m;
+    }
+
+    switch (len & 7)
+    {
+    case 7:
+        h ^= uint64_t(key[6]) << 48;
+        [[fallthrough]];
+    case 6:
+        h ^= uint64_t(key[5]) << 40;
+        [[fallthrough]];
+    case 5:
+        h ^= uint64_t(key[4]) << 32;
+        [[fallthrough]];
+    case 4:
+        h ^= uint64_t(key[3]) << 24;
+        [[fallthrough]];
+    case 3:
+        h ^= uint64_t(key[2]) << 16;
+        [[fallthrough]];
+    case 2:
+        h ^= uint64_t(key[1]) << 8;
+        [[fallthrough]];
+    case 1:
+        h ^= uint64_t(key[0]);
+        h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+
+    return h;
+}
+
+uint64_t Hash(int base, int digitIndex, uint32_t seed)
+{
+    unsigned char buf[sizeof(base) + sizeof(digitIndex) + sizeof(seed)];
+    std::memcpy(buf, &base, sizeof(base));
+    std::memcpy(buf + sizeof(base), &digitIndex, sizeof(digitIndex));
+    std::memcpy(buf + sizeof(base) + sizeof(digitIndex), &seed, sizeof(seed));
+
+    return MurmurHash64A(buf, sizeof(buf), 0);
+}
+
+int PermutationElement(uint32_t i, uint32_t l, uint32_t p)
+{
+    uint32_t w = l - 1;
+    w |= w >> 1;
+    w |= w >> 2;
+    w |= w >> 4;
+    w |= w >> 8;
+    w |= w >> 16;
+
+    do
+    {
+        i ^= p;
+        i *= 0xe170893d;
+        i ^= p >> 16;
+        i ^= (i & w) >> 4;
+        i ^= p >> 8;
+        i *= 0x0929eb3f;
+        i ^= p >> 23;
+        i ^= (i & w) >> 1;
+        i *= 1 | p >> 27;
+        i *= 0x6935fa69;
+        i ^= (i & w) >> 11;
+        i *= 0x74dcb303;
+        i ^= (i & w) >> 2;
+        i *= 0x9e501cc3;
+        i ^= (i & w) >> 2;
+        i *= 0xc860a3df;
+        i &= w;
+        i ^= i >> 5;
+    } while (i >= l);
+
+    return (i + p) % l;
+}
+
+struct DigitPermutation
+{
+    DigitPermutation(int base, uint32_t seed) : base(base)
+    {
+        float invBase = 1.f / static_cast<float>(base);
+        float invBaseM = 1.f;
+
+        nDigits = 0;
+
+        while (1 - static_cast<float>(base - 1) * invBaseM < 1)
+        {
+            ++nDigits;
+            invBaseM *= invBase;
+        }
+
+        permutations.resize(static_cast<size_t>(nDigits) * base);
+
+        for (int digitIndex = 0; digitIndex < nDigits; ++digitIndex)
+        {
+            uint64_t dseed = Hash(base, digitIndex, seed);
+
+            for (int digitValue = 0; digitValue < base; ++digitValue)
+            {
+                int index = digitIndex * base + digitValue;
+                permutations[index] = static_cast<uint16_t>(
+                    PermutationElement(digitValue, base, static_cast<uint32_t>(dseed)));
+            }
+        }
+    }
+
+    int Permute(int digitIndex, int digitValue) const
+    {
+        return permutations[digitIndex * base + digitValue];
+    }
+
+    int base;
+    int nDigits;
+    std::vector<uint16_t> permutations;
+};
+
+float RadicalInverse(int baseIndex, uint64_t a)
+{
+    unsigned int base = Primes[baseIndex];
+
+    uint64_t limit = ~0ull / base - base;
+    float invBase = 1.f / static_cast<float>(base);
+    float invBaseM = 1.f;
+    uint64_t reversedDigits = 0;
+
+    while (a && reversedDigits < limit)
+    {
+        uint64_t next = a / base;
+        uint64_t digit = a - next * base;
+        reversedDigits = reversedDigits * base + digit;
+        invBaseM *= invBase;
+        a = next;
+    }
+
+    return std::min(static_cast<float>(reversedDigits) * invBaseM, ONE_MINUS_EPSILON);
+}
+
+float ScrambledRadicalInverse(int baseIndex, uint64_t a, const DigitPermutation& perm)
+{
+    int base = Primes[baseIndex];
+
+    float invBase = 1.f / static_cast<float>(base);
+    float invBaseM = 1.f;
+    uint64_t reversedDigits = 0;
+    int digitIndex = 0;
+
+    while (1 - static_cast<float>(base - 1) * invBaseM < 1)
+    {
+        uint64_t next = a / base;
+        int digitValue = static_cast<int>(a - next * base);
+        reversedDigits = reversedDigits * base + perm.Permute(digitIndex, digitValue);
+        invBaseM *= invBase;
+        ++digitIndex;
+        a = next;
+    }
+
+    return std::min(invBaseM * static_cast<float>(reversedDigits), ONE_MINUS_EPSILON);
+}
+
+uint64_t InverseRadicalInverse(uint64_t inverse, int base, int nDigits)
+{
+    uint64_t index = 0;
+
+    for (int i = 0; i < nDigits; ++i)
+    {
+        uint64_t digit = inverse % base;
+        inverse /= base;
+        index = index * base + digit;
+    }
+
+    return index;
+}
+
+void ExtendedGCD(int64_t a, int64_t b, int64_t* x, int64_t* y)
+{
+    if (b == 0)
+    {
+        *x = 1;
+        *y = 0;
+        return;
+    }
+
+    int64_t d = a / b, xp, yp;
+    ExtendedGCD(b, a % b, &xp, &yp);
+    *x = yp;
+    *y = xp - (d * yp);
+}
+
+int64_t Mod(int64_t a, int64_t b)
+{
+    int64_t result = a - (a / b) * b;
+    return (result < 0) ? result + b : result;
+}
+
+uint64_t MultiplicativeInverse(int64_t a, int64_t n)
+{
+    int64_t x, y;
+    ExtendedGCD(a, n, &x, &y);
+    return Mod(x, n);
+}
+
+class HaltonSampler
+{
+public:
+    static constexpr int MaxHaltonResolution = 128;
+
+    HaltonSampler(const std::vector<DigitPermutation>* digitPermutations, glm::ivec2 fullRes)
+        : digitPermutations(digitPermutations)
+    {
+        for (int i = 0; i < 2; ++i)
+        {
+            int base = (i == 0) ? 2 : 3;
+            int scale = 1, exp = 0;
+
+            while (scale < std::min(fullRes[i], MaxHaltonResolution))
+            {
+                scale *= base;
+                ++exp;
+            }
+
+            baseScales[i] = scale;
+            baseExponents[i] = exp;
+        }
+
+        multInverse[0] = static_cast<int>(MultiplicativeInverse(baseScales[1], baseScales[0]));
+        multInverse[1] = static_cast<int>(MultiplicativeInverse(baseScales[0], baseScales[1]));
+    }
+
+    void StartPixelSample(glm::ivec2 p, int sampleIndex)
+    {
+        haltonIndex = 0;
+        int sampleStride = baseScales[0] * baseScales[1];
+
+        if (sampleStride > 1)
+        {
+            glm::ivec2 pm(static_cast<int>(Mod(p[0], MaxHaltonResolution)),
+                          static_cast<int>(Mod(p[1], MaxHaltonResolution)));
+
+            for (int i = 0; i < 2; ++i)
+            {
+                uint64_t dimOffset = (i == 0)
+                                         ? InverseRadicalInverse(pm[i], 2, baseExponents[i])
+                                         : InverseRadicalInverse(pm[i], 3, baseExponents[i]);
+                haltonIndex += static_cast<int64_t>(dimOffset * (sampleStride / baseScales[i]) *
+                                                    multInverse[i]);
+            }
+
+            haltonIndex %= sampleStride;
+        }
+
+        haltonIndex += static_cast<int64_t>(sampleIndex) * sampleStride;
+        dimension = 2;
+    }
+
+    glm::vec2 Get2D()
+    {
+        if (dimension + 1 >= static_cast<int>(Primes.size()))
+            dimension = 2;
+
+        int dim = dimension;
+        dimension += 2;
+
+        return {SampleDimension(dim), SampleDimension(dim + 1)};
+    }
+
+    glm::vec2 GetPixel2D()
+    {
+        return {RadicalInverse(0, haltonIndex >> baseExponents[0]),
+                RadicalInverse(1, haltonIndex / baseScales[1])};
+    }
+
+private:
+    float SampleDimension(int dimension) const
+    {
+        return ScrambledRadicalInverse(dimension, haltonIndex, (*digitPermutations)[dimension]);
+    }
+
+    const std::vector<DigitPermutation>* digitPermutations;
+    int baseScales[2];
+    int baseExponents[2];
+    int multInverse[2];
+    int64_t haltonIndex = 0;
+    int dimension = 0;
+};
+
+std::vector<DigitPermutation> ComputeRadicalInversePermutations(uint32_t seed)
+{
+    std::vector<DigitPermutation> perms;
+
+    for (int prime : Primes)
+        perms.emplace_back(prime, seed);
+
+    return perms;
+}
+
+} // namespace reference
+
+// Pixels to compare: all of small films, otherwise the corners and a spread of others.
+std::vector<glm::uvec2> GetTestPixels(glm::uvec2 resolution)
+{
+    std::vector<glm::uvec2> pixels;
+
+    if (resolution.x * resolution.y <= 64 * 64)
+    {
+        for (uint32_t y = 0; y < resolution.y; ++y)
+        {
+            for (uint32_t x = 0; x < resolution.x; ++x)
+                pixels.emplace_back(x, y);
+        }
+
+        return pixels;
+    }
+
+    for (uint32_t i = 0; i < 256; ++i)
+        pixels.emplace_back((i * 7919u) % resolution.x, (i * 104729u) % resolution.y);
+
+    pixels.emplace_back(resolution.x - 1, 0);
+    pixels.emplace_back(0, resolution.y - 1);
+    pixels.emplace_back(resolution.x - 1, resolution.y - 1);
+
+    return pixels;
+}
+
+// DivideByMagic and DivideByMagic64 against the division operator for every prime, on values
+// around multiples of the prime, near the limits and spread over the whole range. Returns how
+// many differ.
+size_t CountDivisionMismatches(std::span<const HaltonEntry> entries)
+{
+    std::mt19937_64 rng(1);
+
+    size_t mismatchCount = 0;
+
+    for (const HaltonEntry& entry : entries)
+    {
+        uint32_t d = entry.Prime;
+
+        auto check = [&](uint64_t a) {
+            uint32_t a32 = static_cast<uint32_t>(a);
+
+            mismatchCount += DivideByMagic(a32, entry.DivisionMagic, entry.DivisionShift) !=
+                             a32 / d;
+            mismatchCount += DivideByMagic64(a, d, entry.DivisionMagic, entry.DivisionShift) !=
+                             a / d;
+        };
+
+        for (uint64_t multiple : {uint64_t(1), uint64_t(0xffffffffu) / d, ~uint64_t(0) / d})
+        {
+            for (uint64_t offset = 0; offset < 2 * d && offset <= multiple * d; ++offset)
+            {
+                check(multiple * d - offset);
+                check(multiple * d + offset);
+            }
+        }
+
+        for (int i = 0; i < 4096; ++i)
+        {
+            uint64_t a = rng();
+
+            check(a);
+            check(a >> 16);
+            check(a >> 32);
+        }
+    }
+
+    return mismatchCount;
+}
+
+// Dimensions sampled per second, starting at sample index firstSample.
+template<typename Sampler, typename StartPixelSample>
+double MeasureSampling(Sampler* sampler, StartPixelSample startPixelSample, int firstSample)
+{
+    constexpr int kTimedSamples = 1 << 16;
+    constexpr int kTimedDims = 16;
+
+    double ms = TimeMs(1, [&] {
+        float sum = 0.f;
+
+        for (int sampleIdx = firstSample; sampleIdx < firstSample + kTimedSamples; ++sampleIdx)
+        {
+            startPixelSample(sampler, glm::uvec2(sampleIdx % 1920, sampleIdx % 1080), sampleIdx);
+
+            for (int dim = 0; dim < kTimedDims; dim += 2)
+            {
+                glm::vec2 u = sampler->Get2D();
+                sum += u.x + u.y;
+            }
+        }
+
+        // Keeps the samples from being optimized away.
+        volatile float sink = sum;
+        (void)sink;
+    });
+
+    return kTimedSamples * kTimedDims / (ms * 1000.0);
+}
+
+} // namespace
+
+int RunHaltonBench(std::span<const std::string> argSpan)
+{
+    std::vector<std::string> args(argSpan.begin(), argSpan.end());
+
+    int threadCount = TakeIntOption(&args, "--threads", 0);
+    int sampleCount = TakeIntOption(&args, "--samples", 64);
+
+    ThreadPool pool(static_cast<size_t>(threadCount));
+
+    const uint32_t seeds[] = {0, 7, 0x9e3779b9};
+    const glm::uvec2 resolutions[] = {{1, 1}, {7, 5}, {100, 60}, {128, 243}, {512, 288},
+                                      {1920, 1080}};
+
+    // Enough Get2D calls to wrap around past the last dimension for some of the samples.
+    constexpr int kLongSampleDims = HALTON_DIMENSION_COUNT;
+
+    // Besides the first --samples, some whose Halton index no longer fits in 32 bits.
+    std::vector<int> sampleIndices;
+
+    for (int sampleIdx = 0; sampleIdx < sampleCount; ++sampleIdx)
+        sampleIndices.push_back(sampleIdx);
+
+    for (int sampleIdx : {1 << 20, (1 << 24) + 1, std::numeric_limits<int>::max()})
+        sampleIndices.push_back(sampleIdx);
+
+    size_t valueCount = 0;
+    size_t mismatchCount = 0;
+    size_t strataMismatchCount = 0;
+
+    auto compare = [&](float value, float expected) {
+        ++valueCount;
+        mismatchCount += std::memcmp(&value, &expected, sizeof(float)) != 0;
+    };
+
+    for (uint32_t seed : seeds)
+    {
+        std::shared_ptr<const HaltonTables> tables = GetHaltonTables(seed, &pool);
+
+        std::vector<reference::DigitPermutation> referencePerms =
+            reference::ComputeRadicalInversePermutations(seed);
+
+        for (glm::uvec2 resolution : resolutions)
+        {
+            HaltonSampler sampler = tables->CreateSampler(resolution);
+            reference::HaltonSampler referenceSampler(&referencePerms, glm::ivec2(resolution));
+
+            for (glm::uvec2 pixel : GetTestPixels(resolution))
+            {
+                for (int sampleIdx : sampleIndices)
+                {
+                    sampler.StartPixelSample(pixel, static_cast<uint32_t>(sampleIdx));
+                    referenceSampler.StartPixelSample(glm::ivec2(pixel), sampleIdx);
+
+                    glm::vec2 pixel2D = sampler.GetPixel2D();
+                    glm::vec2 expectedPixel2D = referenceSampler.GetPixel2D();
+
+                    compare(pixel2D.x, expectedPixel2D.x);
+                    compare(pixel2D.y, expectedPixel2D.y);
+
+                    // Independently of pbrt-v4, the first two dimensions have to land in the
+                    // pixel's strata, which their leading digits give.
+                    const HaltonPixelConstants& c = sampler.m_constants;
+                    uint64_t haltonIdx = sampler.m_haltonIdx;
+
+                    uint64_t strataX =
+                        InverseRadicalInverse(haltonIdx % c.BaseScale0, 2, c.BaseExp0);
+                    uint64_t strataY =
+                        InverseRadicalInverse(haltonIdx % c.BaseScale1, 3, c.BaseExp1);
+
+                    strataMismatchCount += strataX != pixel.x % MAX_HALTON_RESOLUTION;
+                    strataMismatchCount += strataY != pixel.y % MAX_HALTON_RESOLUTION;
+
+                    int dims = sampleIdx == 0 ? kLongSampleDims : 32;
+
+                    for (int dim = 0; dim < dims; dim += 2)
+                    {
+                        glm::vec2 u = sampler.Get2D();
+                        glm::vec2 expected = referenceSampler.Get2D();
+
+                        compare(u.x, expected.x);
+                        compare(u.y, expected.y);
+                    }
+                }
+            }
+        }
+    }
+
+    // Generation and sampling speed, on a fresh seed so that nothing is cached.
+    uint32_t timingSeed = 12345;
+
+    double serialMs = TimeMs(1, [&] { CreateHaltonPermutations(timingSeed); });
+    double parallelMs = TimeMs(1, [&] { CreateHaltonPermutations(timingSeed, &pool); });
+
+    std::shared_ptr<const HaltonTables> tables = GetHaltonTables(timingSeed, &pool);
+    double cachedMs = TimeMs(100, [&] { GetHaltonTables(timingSeed, &pool); });
+
+    size_t divisionMismatchCount = CountDivisionMismatches(tables->Entries);
+
+    // The shared sampler against pbrt-v4's, which divides, at small Halton indices and at ones
+    // past 32 bits.
+    HaltonSampler sampler = tables->CreateSampler(glm::uvec2(1920, 1080));
+
+    std::vector<reference::DigitPermutation> referencePerms =
+        reference::ComputeRadicalInversePermutations(timingSeed);
+    reference::HaltonSampler referenceSampler(&referencePerms, glm::ivec2(1920, 1080));
+
+    auto start = [](HaltonSampler* sampler, glm::uvec2 pixel, int sampleIdx) {
+        sampler->StartPixelSample(pixel, static_cast<uint32_t>(sampleIdx));
+    };
+
+    auto startReference = [](reference::HaltonSampler* sampler, glm::uvec2 pixel,
+                             int sampleIdx) {
+        sampler->StartPixelSample(glm::ivec2(pixel), sampleIdx);
+    };
+
+    constexpr int kHighSampleIdx = 1 << 20;
+
+    double lowRate = MeasureSampling(&sampler, start, 0);
+    double highRate = MeasureSampling(&sampler, start, kHighSampleIdx);
+    double referenceLowRate = MeasureSampling(&referenceSampler, startReference, 0);
+    double referenceHighRate = MeasureSampling(&referenceSampler, startReference, kHighSampleIdx);
+
+    bool match = mismatchCount == 0 && strataMismatchCount == 0 && divisionMismatchCount == 0;
+
+    std::cout << std::fixed << std::setprecision(1) << valueCount
+              << " sample values compared with pbrt-v4: " << mismatchCount << " differ"
+              << (mismatchCount == 0 ? "" : "  MISMATCH") << "\n"
+              << "pixel strata: " << strataMismatchCount << " samples outside their pixel"
+              << (strataMismatchCount == 0 ? "" : "  MISMATCH") << "\n"
+              << "division by multiplication: " << divisionMismatchCount << " quotients differ"
+              << (divisionMismatchCount == 0 ? "" : "  MISMATCH") << "\n"
+              << "tables: " << tables->Permutations.size() * sizeof(uint16_t) / (1024.0 * 1024.0)
+              << " MB of permutations\n"
+              << "generate: " << serialMs << " ms serial, " << parallelMs << " ms on "
+              << pool.GetThreadCount() << " threads, " << std::setprecision(4) << cachedMs
+              << " ms cached\n"
+              << std::setprecision(1) << "sample: " << lowRate << " M dimensions/s, "
+              << highRate << " past 32-bit indices\n"
+              << "pbrt-v4 reference: " << referenceLowRate << " M dimensions/s, "
+              << referenceHighRate << " past 32-bit indices" << std::endl;
+
+    return match ? 0 : 1;
+}
@@ -0,0 +1,204 @@
+#include "Bench.h"
+
+#include "CpuScene.h"
+#include "PathTracer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace
+{
+
+struct LightSamplingResult
+{
+    double Ms = 0.0;
+    double ShadowRaysPerPixel = 0.0;
+    double Mse = 0.0;
+
+    // From GetMeanLuminance.
+    double Mean = 0.0;
+    double MeanVariance = 0.0;
+
+    std::vector<glm::vec3> Image;
+};
+
+LightSamplingResult Render(const CpuScene& scene, const RenderOptions& options, ThreadPool* pool,
+                           const Film& reference)
+{
+    uint32_t width = reference.GetWidth();
+    uint32_t height = reference.GetHeight();
+
+    Film film(width, height);
+    RenderStats stats{};
+
+    LightSamplingResult result;
+    result.Ms = TimeMs(1, [&] { stats = RenderScene(scene, options, pool, &film); });
+
+    result.ShadowRaysPerPixel = stats.ShadowRays / (static_cast<double>(width) * height);
+
+    double rmse = ComputeRmse(film, reference);
+    result.Mse = rmse * rmse;
+
+    GetMeanLuminance(film, &result.Mean, &result.MeanVariance);
+    result.Image = film.Resolve();
+
+    return result;
+}
+
+// lightCount lights scattered over the upper half of the scene and a little above it, their
+// total area and so their total power about that of the scene's own two.
+std::vector<SphereLight> GenerateLights(const Aabb& bounds, uint32_t lightCount)
+{
+    std::mt19937 rng(lightCount);
+    std::uniform_real_distribution<float> uniform(0.f, 1.f);
+
+    glm::vec3 extent = bounds.Max - bounds.Min;
+    float radius = 7.5f * std::sqrt(2.f / lightCount);
+
+    std::vector<SphereLight> lights(lightCount);
+
+    for (SphereLight& light : lights)
+    {
+        light.Position.x = bounds.Min.x + uniform(rng) * extent.x;
+        light.Position.y = bounds.Min.y + (0.5f + 0.75f * uniform(rng)) * extent.y;
+        light.Position.z = bounds.Min.z + uniform(rng) * extent.z;
+        light.Radius = radius;
+        light.L = glm::vec3(40.f + 25.f * uniform(rng), 40.f + 25.f * uniform(rng),
+                            40.f + 25.f * uniform(rng));
+    }
+
+    return lights;
+}
+
+} // namespace
+
+int RunLightSamplingBench(std::span<const std::string> argSpan)
+{
+    std::vector<std::string> args(argSpan.begin(), argSpan.end());
+
+    int threadCount = TakeIntOption(&args, "--threads", 0);
+    int width = TakeIntOption(&args, "--width", 64);
+    int height = TakeIntOption(&args, "--height", 36);
+    int spp = TakeIntOption(&args, "--spp", 16);
+    int referenceSpp = TakeIntOption(&args, "--reference-spp", 1024);
+
+    if (width <= 0 || height <= 0 || spp <= 0 || referenceSpp <= 0)
+        throw std::runtime_error("Sizes and sample counts must be positive.");
+
+    ThreadPool pool(static_cast<size_t>(threadCount));
+
+    CpuScene scene;
+    LoadCpuScene(GetPbrtBookScene(), &pool, &scene);
+
+    std::vector<SphereLight> sceneLights = scene.Lights;
+
+    RenderOptions options;
+
+    SamplerTables sharedTables = GetSamplerTables(options.Sampler, 1, options.Seed, &pool);
+
+    std::cout << std::fixed << width << "x" << height << " at " << spp << " spp, against a "
+              << "reference of " << referenceSpp << " spp of the BVH sampler.\nSampling every "
+              << "light takes fewer samples per pixel as lights are added. Equal-noise ms is the "
+              << "time to the MSE of sampling every light,\nassuming the MSE falls with the "
+              << "inverse of the samples.\n\n"
+              << std::setw(8) << "lights" << std::setw(10) << "sampler" << std::setw(6)
+              << "spp" << std::setw(10) << "ms" << std::setw(16) << "shadow rays/px"
+              << std::setw(12) << "MSE" << std::setw(16) << "equal-noise ms" << std::setw(10)
+              << "speedup" << "\n";
+
+    const LightSamplerType samplers[] = {LightSamplerType::All, LightSamplerType::Power,
+                                         LightSamplerType::Bvh};
+
+    bool unbiased = true;
+    bool identical = true;
+
+    for (uint32_t lightCount : {2u, 64u, 4096u})
+    {
+        scene.Lights = lightCount == sceneLights.size()
+                           ? sceneLights
+                           : GenerateLights(scene.Accel.GetBounds(), lightCount);
+        scene.LightTables = BuildLightSamplerTables(scene.Lights);
+
+        options.LightSampler = LightSamplerType::Bvh;
+        options.SamplesPerPixel = static_cast<uint32_t>(referenceSpp);
+        options.Seed = kReferenceSeed;
+        options.Integrator = IntegratorType::Megakernel;
+
+        Film reference(width, height);
+        RenderScene(scene, options, &pool, &reference);
+
+        double referenceMean = 0.0;
+        double referenceMeanVariance = 0.0;
+        GetMeanLuminance(reference, &referenceMean, &referenceMeanVariance);
+
+        options.Seed = 1;
+
+        double allMs = 0.0;
+        double allMse = 0.0;
+
+        for (LightSamplerType sampler : samplers)
+        {
+            options.LightSampler = sampler;
+            options.Integrator = IntegratorType::Megakernel;
+
+            // About as many shadow rays per pixel as the samplers that pick one light take, but
+            // at least two samples, without which the pixels have no variance.
+            uint32_t samplerSpp = static_cast<uint32_t>(spp);
+
+            if (sampler == LightSamplerType::All)
+                samplerSpp = std::max(2u, samplerSpp * 2 / lightCount);
+
+            options.SamplesPerPixel = samplerSpp;
+
+            LightSamplingResult result = Render(scene, options, &pool, reference);
+
+            double equalNoiseMs = 0.0;
+
+            if (sampler == LightSamplerType::All)
+            {
+                allMs = result.Ms;
+                allMse = result.Mse;
+                equalNoiseMs = result.Ms;
+            }
+            else
+            {
+                equalNoiseMs = result.Ms * result.Mse / allMse;
+            }
+
+            std::cout << std::setw(8) << lightCount << std::setw(10)
+                      << GetLightSamplerTypeName(sampler) << std::setw(6) << samplerSpp
+                      << std::setprecision(1) << std::setw(10) << result.Ms << std::setw(16)
+                      << result.ShadowRaysPerPixel << std::scientific << std::setprecision(2)
+                      << std::setw(12) << result.Mse << std::fixed << std::setprecision(1)
+                      << std::setw(16) << equalNoiseMs << std::setprecision(2) << std::setw(9)
+                      << allMs / equalNoiseMs << "x\n";
+
+            // Every sampler is unbiased, so the image means may only differ by their noise.
+            double difference = std::abs(result.Mean - referenceMean);
+            unbiased = unbiased && difference <= 5.0 * std::sqrt(result.MeanVariance +
+                                                                 referenceMeanVariance);
+
+            // Both integrators pick the same lights with the same numbers.
+            if (sampler != LightSamplerType::All)
+            {
+                options.Integrator = IntegratorType::Wavefront;
+
+                identical = identical &&
+                            Render(scene, options, &pool, reference).Image == result.Image;
+            }
+        }
+    }
+
+    std::cout << "\n"
+              << (unbiased ? "image means of every sampler within noise of the reference's"
+                           : "image means of a sampler biased  MISMATCH")
+              << "\n"
+              << (identical ? "wavefront images identical to the megakernel ones"
+                            : "wavefront images differ from the megakernel ones  MISMATCH")
+              << std::endl;
+
+    return unbiased && identical ? 0 : 1;
+}
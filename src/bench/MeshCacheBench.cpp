@@ -0,0 +1,65 @@
+#include "Bench.h"
+
+#include "MeshCache.h"
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+static bool MeshesEqual(const Mesh& a, const Mesh& b)
+{
+    auto equal = [](const auto& x, const auto& y) {
+        return x.size() == y.size() && memcmp(x.data(), y.data(), x.size() * sizeof(x[0])) == 0;
+    };
+
+    return equal(a.Positions, b.Positions) && equal(a.Normals, b.Normals) &&
+           equal(a.UVs, b.UVs) && equal(a.Indices, b.Indices);
+}
+
+int RunMeshCacheBench(std::span<const std::string> argSpan)
+{
+    std::vector<std::string> args(argSpan.begin(), argSpan.end());
+
+    int iterations = TakeIntOption(&args, "--iterations", 3);
+
+    auto files = CollectFiles(args, ".ply", kDefaultGeometryDir);
+
+    if (files.empty())
+        throw std::runtime_error("No ply files found.");
+
+    std::cout << std::left << std::setw(40) << "file" << std::right << std::setw(12) << "ply ms"
+              << std::setw(12) << "rebuild ms" << std::setw(12) << "cached ms" << std::setw(10)
+              << "speedup" << std::endl;
+
+    bool allMatch = true;
+
+    for (const auto& file : files)
+    {
+        Mesh plyMesh;
+        Mesh cachedMesh;
+
+        double plyMs = TimeMs(iterations, [&] {
+            plyMesh = Mesh{};
+            LoadMeshFromPlyFile(file, &plyMesh);
+        });
+
+        std::filesystem::remove(GetMeshCachePath(file));
+
+        double rebuildMs = TimeMs(1, [&] { LoadMeshCached(file, &cachedMesh); });
+
+        double cachedMs = TimeMs(iterations, [&] {
+            cachedMesh = Mesh{};
+            LoadMeshCached(file, &cachedMesh);
+        });
+
+        bool match = MeshesEqual(plyMesh, cachedMesh);
+        allMatch = allMatch && match;
+
+        std::cout << std::left << std::setw(40) << file.filename().string() << std::right
+                  << std::fixed << std::setprecision(2) << std::setw(12) << plyMs << std::setw(12)
+                  << rebuildMs << std::setw(12) << cachedMs << std::setw(9) << plyMs / cachedMs
+                  << "x" << (match ? "" : "  MISMATCH") << std::endl;
+    }
+
+    return allMatch ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+#include "Bench.h"
+
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+using TriangleKey = std::array<float, 24>;
+
+// Every triangle as the attributes of its three vertices, in a canonical order, so meshes can be
+// compared regardless of how their vertices and triangles are numbered.
+static std::vector<TriangleKey> GetSortedTriangles(const Mesh& mesh)
+{
+    std::vector<TriangleKey> triangles(mesh.Indices.size() / 3);
+
+    for (size_t i = 0; i < triangles.size(); ++i)
+    {
+        float* key = triangles[i].data();
+
+        for (size_t corner = 0; corner < 3; ++corner)
+        {
+            uint32_t index = mesh.Indices[i * 3 + corner];
+
+            memcpy(key, &mesh.Positions[index], sizeof(glm::vec3));
+            memcpy(key + 3, &mesh.Normals[index], sizeof(glm::vec3));
+            memcpy(key + 6, &mesh.UVs[index], sizeof(glm::vec2));
+            key += 8;
+        }
+    }
+
+    auto less = [](const TriangleKey& a, const TriangleKey& b) {
+        return memcmp(a.data(), b.data(), sizeof(TriangleKey)) < 0;
+    };
+
+    std::sort(triangles.begin(), triangles.end(), less);
+
+    return triangles;
+}
+
+static bool MeshesIdentical(const Mesh& a, const Mesh& b)
+{
+    auto equal = [](const auto& x, const auto& y) {
+        return x.size() == y.size() && memcmp(x.data(), y.data(), x.size() * sizeof(x[0])) == 0;
+    };
+
+    return equal(a.Positions, b.Positions) && equal(a.Normals, b.Normals) &&
+           equal(a.UVs, b.UVs) && equal(a.Indices, b.Indices);
+}
+
+int RunMeshOptimizeBench(std::span<const std::string> args)
+{
+    auto files = CollectFiles(args, ".ply", kDefaultGeometryDir);
+
+    if (files.empty())
+        throw std::runtime_error("No ply files found.");
+
+    std::cout << std::left << std::setw(40) << "file" << std::right << std::setw(12) << "verts"
+              << std::setw(12) << "welded" << std::setw(12) << "acmr" << std::setw(12)
+              << "optimized" << std::setw(12) << "ms" << std::endl;
+
+    bool allValid = true;
+
+    for (const auto& file : files)
+    {
+        Mesh original;
+        LoadMeshFromPlyFile(file, &original);
+
+        Mesh optimized;
+        MeshOptimizationStats stats{};
+
+        double ms = TimeMs(1, [&] {
+            optimized = original;
+            OptimizeMesh(&optimized, &stats);
+        });
+
+        // The same input has to give the same bytes, and the same triangles.
+        Mesh again = original;
+        OptimizeMesh(&again);
+
+        bool deterministic = MeshesIdentical(optimized, again);
+        bool sameTriangles = GetSortedTriangles(original) == GetSortedTriangles(optimized);
+
+        allValid = allValid && deterministic && sameTriangles;
+
+        std::cout << std::left << std::setw(40) << file.filename().string() << std::right
+                  << std::setw(12) << stats.VerticesBefore << std::setw(12) << stats.VerticesAfter
+                  << std::fixed << std::setprecision(3) << std::setw(12) << stats.AcmrBefore
+                  << std::setw(12) << stats.AcmrAfter << std::setprecision(2) << std::setw(12)
+                  << ms << (deterministic ? "" : "  NONDETERMINISTIC")
+                  << (sameTriangles ? "" : "  TRIANGLES CHANGED") << std::endl;
+    }
+
+    return allValid ? 0 : 1;
+}
@@ -0,0 +1,145 @@
+#include "Bench.h"
+
+#include "PbrtParser.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace
+{
+
+// A main file that imports fileCount files, each a trianglemesh of a grid with triangleCount
+// triangles and an instance of an object the main file defines. Returns the main file's path.
+std::filesystem::path WriteScene(const std::filesystem::path& directory, int fileCount,
+                                 int triangleCount)
+{
+    std::filesystem::create_directories(directory);
+
+    std::filesystem::path mainPath = directory / "main.pbrt";
+    std::ofstream main(mainPath);
+
+    main << "LookAt 0 0 10  0 0 0  0 1 0\nCamera \"perspective\" \"float fov\" 45\n"
+         << "WorldBegin\n"
+         << "AttributeBegin\n  AreaLightSource \"diffuse\" \"rgb L\" [10 10 10]\n"
+         << "  Translate 0 20 0\n  Shape \"sphere\" \"float radius\" 2\nAttributeEnd\n"
+         << "ObjectBegin \"quad\"\n  Shape \"trianglemesh\" \"point3 P\" [0 0 0 1 0 0 1 1 0 0 1 0] "
+         << "\"integer indices\" [0 1 2 0 2 3]\nObjectEnd\n";
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+
+    int side = 1;
+
+    while (2 * side * side < triangleCount)
+        ++side;
+
+    for (int fileIdx = 0; fileIdx < fileCount; ++fileIdx)
+    {
+        std::string name = "part" + std::to_string(fileIdx) + ".pbrt";
+        main << "Import \"" << name << "\"\n";
+
+        std::ofstream part(directory / name);
+        part << std::setprecision(6) << "AttributeBegin\nTranslate " << fileIdx << " 0 0\n"
+             << "Shape \"trianglemesh\"\n  \"point3 P\" [";
+
+        for (int y = 0; y <= side; ++y)
+        {
+            for (int x = 0; x <= side; ++x)
+                part << "\n    " << x << " " << y << " " << uniform(rng);
+        }
+
+        part << " ]\n  \"integer indices\" [";
+
+        for (int y = 0; y < side; ++y)
+        {
+            for (int x = 0; x < side; ++x)
+            {
+                int v = y * (side + 1) + x;
+
+                part << "\n    " << v << " " << v + 1 << " " << v + side + 2 << " " << v << " "
+                     << v + side + 2 << " " << v + side + 1;
+            }
+        }
+
+        part << " ]\nObjectInstance \"quad\"\nAttributeEnd\n";
+    }
+
+    return mainPath;
+}
+
+bool IsSame(const SceneDescription& a, const SceneDescription& b)
+{
+    if (a.Geometries.size() != b.Geometries.size() || a.Lights.size() != b.Lights.size())
+        return false;
+
+    for (size_t i = 0; i < a.Geometries.size(); ++i)
+    {
+        const SceneGeometry& ga = a.Geometries[i];
+        const SceneGeometry& gb = b.Geometries[i];
+
+        for (int column = 0; column < 4; ++column)
+        {
+            if (ga.Transform[column] != gb.Transform[column])
+                return false;
+        }
+
+        if (ga.InlineMesh->Positions != gb.InlineMesh->Positions ||
+            ga.InlineMesh->Indices != gb.InlineMesh->Indices)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+int RunPbrtParseBench(std::span<const std::string> argSpan)
+{
+    std::vector<std::string> args(argSpan.begin(), argSpan.end());
+
+    int threadCount = TakeIntOption(&args, "--threads", 0);
+    int fileCount = TakeIntOption(&args, "--files", 16);
+    int triangleCount = TakeIntOption(&args, "--triangles", 100000);
+    int iterations = TakeIntOption(&args, "--iterations", 3);
+
+    if (fileCount <= 0 || triangleCount <= 0 || iterations <= 0)
+        throw std::runtime_error("Counts must be positive.");
+
+    std::filesystem::path directory =
+        std::filesystem::temp_directory_path() / "PbrtBench-pbrt-parse";
+    std::filesystem::path mainPath = WriteScene(directory, fileCount, triangleCount);
+
+    uintmax_t bytes = 0;
+
+    for (const auto& entry : std::filesystem::directory_iterator(directory))
+        bytes += entry.file_size();
+
+    ThreadPool pool(static_cast<size_t>(threadCount));
+
+    SceneDescription serial;
+    SceneDescription parallel;
+
+    double serialMs = TimeMs(iterations, [&] { serial = LoadPbrtScene(mainPath); });
+    double parallelMs = TimeMs(iterations, [&] { parallel = LoadPbrtScene(mainPath, &pool); });
+
+    bool same = IsSame(serial, parallel);
+
+    std::filesystem::remove_all(directory);
+
+    std::cout << std::fixed << std::setprecision(1) << fileCount << " imported files, "
+              << bytes / (1024.0 * 1024.0) << " MB, " << serial.Geometries.size()
+              << " geometries\n"
+              << "serial:   " << serialMs << " ms (" << bytes / (serialMs * 1000.0) << " MB/s)\n"
+              << "parallel: " << parallelMs << " ms (" << bytes / (parallelMs * 1000.0)
+              << " MB/s) on " << pool.GetThreadCount() << " threads (" << std::setprecision(2)
+              << serialMs / parallelMs << "x)\n"
+              << (same ? "parallel scene identical to the serial one"
+                       : "parallel scene differs from the serial one  MISMATCH")
+              << std::endl;
+
+    return same ? 0 : 1;
+}
@@ -0,0 +1,116 @@
+#include "Bench.h"
+
+#include "Mesh.h"
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+namespace
+{
+
+// Stands in for the mapped upload heap that PbrtDX decodes meshes into.
+struct UploadBlock
+{
+    std::unique_ptr<std::byte[]> Data;
+    size_t Size = 0;
+
+    template<typename T>
+    std::span<T> Allocate(size_t count)
+    {
+        auto span = std::span<T>(reinterpret_cast<T*>(Data.get() + Size), count);
+        Size += span.size_bytes();
+
+        return span;
+    }
+};
+
+size_t GetMeshSize(const MeshSizes& sizes)
+{
+    return sizes.VertexCount * (2 * sizeof(glm::vec3) + sizeof(glm::vec2)) +
+           sizes.IndexCount * sizeof(uint32_t);
+}
+
+// The old path: decode into std::vectors, then copy every vector into the upload block.
+size_t IngestWithCopy(const std::filesystem::path& file)
+{
+    Mesh mesh{};
+    LoadMeshFromPlyFile(file, &mesh);
+
+    size_t size = GetMeshSize({mesh.Positions.size(), mesh.Indices.size()});
+
+    UploadBlock block{std::make_unique_for_overwrite<std::byte[]>(size)};
+
+    auto copy = [&](const auto& vector) {
+        using T = std::remove_cvref_t<decltype(vector[0])>;
+        memcpy(block.Allocate<T>(vector.size()).data(), vector.data(), vector.size() * sizeof(T));
+    };
+
+    copy(mesh.Positions);
+    copy(mesh.Normals);
+    copy(mesh.UVs);
+    copy(mesh.Indices);
+
+    return size;
+}
+
+// The sink path: size the upload block from the header and decode straight into it.
+size_t IngestWithSinks(const std::filesystem::path& file)
+{
+    UploadBlock block{};
+
+    MeshSinks sinks{};
+
+    sinks.Allocate = [&](const MeshSizes& sizes) {
+        block.Data = std::make_unique_for_overwrite<std::byte[]>(GetMeshSize(sizes));
+
+        sinks.Positions = block.Allocate<glm::vec3>(sizes.VertexCount);
+        sinks.Normals = block.Allocate<glm::vec3>(sizes.VertexCount);
+        sinks.UVs = block.Allocate<glm::vec2>(sizes.VertexCount);
+        sinks.Indices = block.Allocate<uint32_t>(sizes.IndexCount);
+    };
+
+    LoadMeshInto(file, &sinks);
+
+    return block.Size;
+}
+
+} // namespace
+
+// Peak RSS only ever grows, so each invocation measures a single mode on a single file.
+int RunPlyIngestBench(std::span<const std::string> argSpan)
+{
+    std::vector<std::string> args(argSpan.begin(), argSpan.end());
+
+    bool useCopy = std::erase(args, "--copy") > 0;
+    int maxRatioPercent = TakeIntOption(&args, "--max-ratio-percent", 0);
+
+    auto files = CollectFiles(args, ".ply", kDefaultGeometryDir);
+
+    if (files.size() != 1)
+        throw std::runtime_error("Expected exactly one ply file.");
+
+    size_t baseline = GetPeakRss();
+
+    size_t meshSize = 0;
+    double ms = TimeMs(1, [&] {
+        meshSize = useCopy ? IngestWithCopy(files[0]) : IngestWithSinks(files[0]);
+    });
+
+    size_t peak = GetPeakRss() - baseline;
+    double ratio = static_cast<double>(peak) / static_cast<double>(meshSize);
+
+    std::cout << std::fixed << std::setprecision(2) << files[0].filename().string() << " ("
+              << (useCopy ? "copy" : "sinks") << "): mesh " << meshSize / double(1 << 20)
+              << " MB, peak RSS +" << peak / double(1 << 20) << " MB (" << ratio << "x), " << ms
+              << " ms" << std::endl;
+
+    if (maxRatioPercent > 0 && ratio * 100.0 > maxRatioPercent)
+    {
+        std::cout << "Peak RSS ratio exceeds " << maxRatioPercent / 100.0 << "x." << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include "Bench.h"
+
+#include "Mesh.h"
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+template<typename T>
+static bool VectorsEqual(const std::vector<T>& a, const std::vector<T>& b)
+{
+    return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+static bool MeshesEqual(const Mesh& a, const Mesh& b)
+{
+    return VectorsEqual(a.Positions, b.Positions) && VectorsEqual(a.Normals, b.Normals) &&
+           VectorsEqual(a.UVs, b.UVs) && VectorsEqual(a.Indices, b.Indices);
+}
+
+int RunPlyLoadBench(std::span<const std::string> argSpan)
+{
+    std::vector<std::string> args(argSpan.begin(), argSpan.end());
+
+    int iterations = TakeIntOption(&args, "--iterations", 3);
+
+    auto files = CollectFiles(args, ".ply", kDefaultGeometryDir);
+
+    if (files.empty())
+        throw std::runtime_error("No ply files found.");
+
+    std::cout << std::left << std::setw(40) << "file" << std::right << std::setw(12) << "MB"
+              << std::setw(12) << "rply ms" << std::setw(12) << "native ms" << std::setw(10)
+              << "speedup" << std::endl;
+
+    double totalRplyMs = 0.0;
+    double totalNativeMs = 0.0;
+
+    bool allMatch = true;
+
+    for (const auto& file : files)
+    {
+        Mesh rplyMesh;
+        Mesh nativeMesh;
+
+        double rplyMs = TimeMs(iterations, [&] {
+            rplyMesh = Mesh{};
+            LoadMeshFromPlyFileRply(file, &rplyMesh);
+        });
+
+        double nativeMs = TimeMs(iterations, [&] {
+            nativeMesh = Mesh{};
+            LoadMeshFromPlyFile(file, &nativeMesh);
+        });
+
+        bool match = MeshesEqual(rplyMesh, nativeMesh);
+        allMatch = allMatch && match;
+
+        totalRplyMs += rplyMs;
+        totalNativeMs += nativeMs;
+
+        double megabytes = static_cast<double>(std::filesystem::file_size(file)) / (1 << 20);
+
+        std::cout << std::left << std::setw(40) << file.filename().string() << std::right
+                  << std::fixed << std::setprecision(2) << std::setw(12) << megabytes
+                  << std::setw(12) << rplyMs << std::setw(12) << nativeMs << std::setw(9)
+                  << rplyMs / nativeMs << "x" << (match ? "" : "  MISMATCH") << std::endl;
+    }
+
+    std::cout << std::left << std::setw(52) << "total" << std::right << std::setw(12)
+              << totalRplyMs << std::setw(12) << totalNativeMs << std::setw(9)
+              << totalRplyMs / totalNativeMs << "x" << std::endl;
+
+    return allMatch ? 0 : 1;
+}
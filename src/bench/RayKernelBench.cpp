@@ -0,0 +1,271 @@
+#include "Bench.h"
+
+#include "CpuScene.h"
+#include "PathTracer.h"
+#include "WideBvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+
+namespace
+{
+
+constexpr float PI = 3.14159265358979323846f;
+
+// Index of the shadow rays in GenerateRaySets' result.
+constexpr size_t kShadowSet = 1;
+
+struct RaySet
+{
+    const char* Name;
+    std::vector<Ray> Rays;
+};
+
+struct TraceResult
+{
+    std::vector<RayHit> Hits;
+    std::vector<char> Found;
+    double Ms = 0.0;
+};
+
+// Any vector perpendicular to n.
+glm::vec3 GetPerpendicular(glm::vec3 n)
+{
+    glm::vec3 axis = std::abs(n.x) < 0.9f ? glm::vec3(1.f, 0.f, 0.f) : glm::vec3(0.f, 1.f, 0.f);
+
+    return glm::normalize(glm::cross(n, axis));
+}
+
+// Camera rays at pixel centres in scanline order, then shadow rays towards a random point on each
+// light and cosine distributed bounce rays from every camera hit. The latter two are incoherent.
+std::vector<RaySet> GenerateRaySets(const CpuScene& scene, glm::uvec2 dimensions)
+{
+    RaySet primary{"primary", {}};
+    RaySet shadow{"shadow", {}};
+    RaySet bounce{"bounce", {}};
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> dist(0.f, 1.f);
+    std::normal_distribution<float> normal;
+
+    for (uint32_t y = 0; y < dimensions.y; ++y)
+    {
+        for (uint32_t x = 0; x < dimensions.x; ++x)
+        {
+            Ray ray = GenerateCameraRay(scene.Camera, glm::vec2(x, y) + 0.5f, dimensions);
+            primary.Rays.push_back(ray);
+
+            RayHit hit{};
+
+            if (!scene.Accel.Intersect(ray, ~0u, false, &hit))
+                continue;
+
+            glm::vec3 n = GetShadingNormal(scene, hit);
+
+            if (glm::dot(n, ray.Direction) > 0.f)
+                n = -n;
+
+            glm::vec3 p = ray.Origin + ray.Direction * hit.T + n * 0.001f;
+
+            for (const SphereLight& light : scene.Lights)
+            {
+                glm::vec3 target = light.Position + light.Radius * glm::normalize(glm::vec3(
+                                                                       normal(rng), normal(rng),
+                                                                       normal(rng)));
+
+                Ray& shadowRay = shadow.Rays.emplace_back();
+                shadowRay.Origin = p;
+                shadowRay.Direction = glm::normalize(target - p);
+                shadowRay.TMin = 0.f;
+                shadowRay.TMax = glm::distance(p, target);
+            }
+
+            float r = std::sqrt(dist(rng));
+            float phi = 2.f * PI * dist(rng);
+            glm::vec3 t = GetPerpendicular(n);
+            glm::vec3 b = glm::cross(n, t);
+
+            Ray& bounceRay = bounce.Rays.emplace_back();
+            bounceRay.Origin = p;
+            bounceRay.Direction =
+                glm::normalize(t * (r * std::cos(phi)) + b * (r * std::sin(phi)) +
+                               n * std::sqrt(std::max(0.f, 1.f - r * r)));
+            bounceRay.TMin = 0.f;
+            bounceRay.TMax = std::numeric_limits<float>::max();
+        }
+    }
+
+    return {std::move(primary), std::move(shadow), std::move(bounce)};
+}
+
+TraceResult Trace(const Tlas& tlas, std::span<const Ray> rays, bool packets)
+{
+    TraceResult result;
+    result.Hits.resize(rays.size());
+    result.Found.resize(rays.size());
+
+    result.Ms = TimeMs(1, [&] {
+        if (packets)
+        {
+            for (size_t first = 0; first < rays.size(); first += Bvh::kMaxPacketSize)
+            {
+                size_t count = std::min<size_t>(Bvh::kMaxPacketSize, rays.size() - first);
+                uint32_t found = tlas.IntersectPacket(rays.subspan(first, count), ~0u, false,
+                                                      &result.Hits[first]);
+
+                for (size_t i = 0; i < count; ++i)
+                    result.Found[first + i] = (found >> i) & 1;
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < rays.size(); ++i)
+                result.Found[i] = tlas.Intersect(rays[i], ~0u, false, &result.Hits[i]);
+        }
+    });
+
+    return result;
+}
+
+// Rays that hit something other than what the reference hit, allowing for the kernels rounding
+// the hit distance differently.
+size_t CountMismatches(const TraceResult& result, const TraceResult& reference)
+{
+    size_t count = 0;
+
+    for (size_t i = 0; i < result.Found.size(); ++i)
+    {
+        float tolerance = 1e-3f * std::max(reference.Hits[i].T, 1.f);
+
+        if (result.Found[i] != reference.Found[i] ||
+            (result.Found[i] && std::abs(result.Hits[i].T - reference.Hits[i].T) > tolerance))
+        {
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+} // namespace
+
+int RunRayKernelBench(std::span<const std::string> argSpan)
+{
+    std::vector<std::string> args(argSpan.begin(), argSpan.end());
+
+    int threadCount = TakeIntOption(&args, "--threads", 0);
+    int width = TakeIntOption(&args, "--width", 512);
+    int height = TakeIntOption(&args, "--height", 288);
+
+    if (width <= 0 || height <= 0)
+        throw std::runtime_error("The image size has to be positive.");
+
+    ThreadPool pool(static_cast<size_t>(threadCount));
+
+    CpuScene scene;
+    LoadCpuScene(GetPbrtBookScene(), &pool, &scene);
+
+    std::vector<RaySet> raySets = GenerateRaySets(scene, glm::uvec2(width, height));
+
+    std::cout << std::fixed << std::setprecision(1);
+
+    for (const RaySet& set : raySets)
+        std::cout << set.Rays.size() << " " << set.Name << " rays\n";
+
+    std::vector<TraceResult> references;
+    bool allAgree = true;
+
+    std::cout << "\n" << std::left << std::setw(16) << "Mrays/s";
+
+    for (const RaySet& set : raySets)
+        std::cout << std::right << std::setw(12) << set.Name;
+
+    std::cout << std::setw(12) << "any-hit" << "\n";
+
+    for (BvhKernel kernel : {BvhKernel::Scalar, BvhKernel::Sse, BvhKernel::Avx2})
+    {
+        if (!IsBvhKernelSupported(kernel))
+        {
+            std::cout << std::left << std::setw(16) << GetBvhKernelName(kernel)
+                      << "not supported\n";
+            continue;
+        }
+
+        scene.Accel.SetKernel(kernel, &pool);
+
+        // Camera rays are coherent enough to be worth tracing as packets too.
+        for (bool packets : {false, true})
+        {
+            std::string name = GetBvhKernelName(kernel);
+            size_t setCount = packets ? 1 : raySets.size();
+            size_t mismatchCount = 0;
+
+            std::cout << std::left << std::setw(16) << (packets ? name + " packets" : name);
+
+            std::vector<TraceResult> results;
+
+            for (size_t i = 0; i < setCount; ++i)
+            {
+                TraceResult& result =
+                    results.emplace_back(Trace(scene.Accel, raySets[i].Rays, packets));
+
+                std::cout << std::right << std::setw(12)
+                          << raySets[i].Rays.size() / (result.Ms * 1000.0);
+
+                if (references.size() < raySets.size())
+                    references.push_back(result);
+                else
+                    mismatchCount += CountMismatches(result, references[i]);
+            }
+
+            // The shadow rays again as occlusion queries, which have to agree exactly with whether
+            // the same kernel found a closest hit.
+            size_t occlusionMismatchCount = 0;
+
+            if (!packets)
+            {
+                std::span<const Ray> shadowRays = raySets[kShadowSet].Rays;
+                std::vector<char> occluded(shadowRays.size());
+
+                double ms = TimeMs(1, [&] {
+                    for (size_t i = 0; i < shadowRays.size(); ++i)
+                        occluded[i] = scene.Accel.Occluded(shadowRays[i], ~0u, false);
+                });
+
+                for (size_t i = 0; i < shadowRays.size(); ++i)
+                    occlusionMismatchCount += occluded[i] != results[kShadowSet].Found[i];
+
+                std::cout << std::setw(12) << shadowRays.size() / (ms * 1000.0);
+            }
+            else
+            {
+                std::cout << std::setw(12 * static_cast<int>(raySets.size())) << "";
+            }
+
+            // Rays grazing an edge may go either way, but more than a handful means a kernel is
+            // wrong.
+            size_t rayCount = 0;
+
+            for (size_t i = 0; i < setCount; ++i)
+                rayCount += raySets[i].Rays.size();
+
+            bool agree = mismatchCount <= rayCount / 10000 && occlusionMismatchCount == 0;
+            allAgree = allAgree && agree;
+
+            std::cout << "   " << mismatchCount << " hits differ from scalar";
+
+            if (occlusionMismatchCount > 0)
+                std::cout << ", " << occlusionMismatchCount << " occlusion queries differ";
+
+            std::cout << (agree ? "" : "  MISMATCH") << "\n";
+        }
+    }
+
+    std::cout << std::flush;
+
+    return allAgree ? 0 : 1;
+}
@@ -0,0 +1,214 @@
+#include "Bench.h"
+
+#include "CpuScene.h"
+#include "PathTracer.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+
+struct SortResult
+{
+    // The fastest of the iterations.
+    double Ms = 0.0;
+    double SortMs = 0.0;
+
+    // The time of every depth, which includes shading and sorting.
+    double DepthMs = 0.0;
+
+    // Of the fastest iteration. Zero without hardware counters.
+    uint64_t CacheMisses = 0;
+
+    std::vector<glm::vec3> Image;
+};
+
+// A wave never spans film tiles, so the tiles have to hold at least a wave's paths.
+uint32_t GetTileSize(const RenderOptions& options)
+{
+    uint32_t tileSize = 16;
+
+    while (static_cast<uint64_t>(tileSize) * tileSize * options.SamplesPerPixel <
+           options.WavefrontSize)
+    {
+        tileSize *= 2;
+    }
+
+    return tileSize;
+}
+
+// Each iteration gets a pool of its own, started after its cache miss counter so that the
+// counter sees the misses of the pool's threads once they have exited.
+SortResult Render(const CpuScene& scene, const RenderOptions& options, uint32_t threadCount,
+                  uint32_t width, uint32_t height, int iterations)
+{
+    SortResult result;
+
+    for (int i = 0; i < iterations; ++i)
+    {
+        CacheMissCounter counter;
+        Film film(width, height, GetTileSize(options));
+        RenderStats stats{};
+        double ms = 0.0;
+
+        {
+            ThreadPool pool(threadCount);
+            ms = TimeMs(1, [&] { stats = RenderScene(scene, options, &pool, &film); });
+        }
+
+        if (i > 0 && ms >= result.Ms)
+            continue;
+
+        result.Ms = ms;
+        result.SortMs = stats.SortMs;
+        result.DepthMs = 0.0;
+        result.CacheMisses = counter.Read();
+
+        for (const DepthStats& depth : stats.Depths)
+            result.DepthMs += depth.Ms;
+
+        if (i == 0)
+            result.Image = film.Resolve();
+    }
+
+    return result;
+}
+
+// 256, 1024, ... up to maxWaveSize, which is always included.
+std::vector<uint32_t> GetWaveSizes(uint32_t maxWaveSize)
+{
+    std::vector<uint32_t> sizes;
+
+    for (uint32_t size = 256; size < maxWaveSize; size *= 4)
+        sizes.push_back(size);
+
+    sizes.push_back(maxWaveSize);
+
+    return sizes;
+}
+
+} // namespace
+
+int RunRaySortBench(std::span<const std::string> argSpan)
+{
+    std::vector<std::string> args(argSpan.begin(), argSpan.end());
+
+    int threadCount = TakeIntOption(&args, "--threads", 0);
+    int width = TakeIntOption(&args, "--width", 256);
+    int height = TakeIntOption(&args, "--height", 144);
+    int spp = TakeIntOption(&args, "--spp", 16);
+    int maxDepth = TakeIntOption(&args, "--max-depth", 5);
+    int maxWaveSize = TakeIntOption(&args, "--max-wavefront-size", 65536);
+    int iterations = TakeIntOption(&args, "--iterations", 3);
+
+    if (width <= 0 || height <= 0 || spp <= 0 || maxDepth <= 0 || maxWaveSize <= 0 ||
+        iterations <= 0)
+    {
+        throw std::runtime_error("Sizes, counts and depths must be positive.");
+    }
+
+    CpuScene scene;
+
+    {
+        ThreadPool loadPool(static_cast<size_t>(threadCount));
+        LoadCpuScene(GetPbrtBookScene(), &loadPool, &scene);
+    }
+
+    RenderOptions options;
+    options.SamplesPerPixel = static_cast<uint32_t>(spp);
+    options.MaxDepth = static_cast<uint32_t>(maxDepth);
+    options.Integrator = IntegratorType::Wavefront;
+
+    SamplerTables sharedTables = GetSamplerTables(options.Sampler, 1, options.Seed);
+
+    // A ray visits the same nodes whatever order it is traced in, so sorting can only make the
+    // visits cheaper. Counted with both orders to make sure.
+    uint64_t visitedNodes[2] = {};
+
+    for (bool sort : {false, true})
+    {
+        RenderOptions counting = options;
+        counting.SortRays = sort;
+        counting.CountNodes = true;
+
+        ThreadPool pool(static_cast<size_t>(threadCount));
+        Film film(width, height);
+
+        visitedNodes[sort] = RenderScene(scene, counting, &pool, &film).VisitedNodes;
+    }
+
+    options.TimeDepths = true;
+
+    bool cacheMisses = CacheMissCounter().IsAvailable();
+    uint64_t rays = 0;
+
+    {
+        ThreadPool pool(static_cast<size_t>(threadCount));
+        Film film(width, height);
+        RenderStats stats = RenderScene(scene, options, &pool, &film);
+
+        rays = stats.CameraRays + stats.ShadowRays + stats.BounceRays;
+    }
+
+    std::cout << std::fixed << width << "x" << height << " at " << spp << " spp to depth "
+              << maxDepth << " with the wavefront integrator, fastest of " << iterations << ".\n"
+              << rays << " rays visit " << visitedNodes[0] << " nodes of the scalar kernel's "
+              << "trees. Trace is the time of every depth without sorting, summed over the "
+              << "threads.\nFilm tiles are made large enough for a wave.\n\n"
+              << std::left << std::setw(10) << "wave" << std::setw(8) << "sorted" << std::right
+              << std::setw(12) << "ms" << std::setw(12) << "sort ms" << std::setw(12)
+              << "trace ms" << std::setw(12) << "ns/node" << std::setw(14) << "misses/ray"
+              << std::setw(10) << "speedup" << "\n";
+
+    std::vector<glm::vec3> firstImage;
+    bool identical = visitedNodes[0] == visitedNodes[1];
+
+    for (uint32_t waveSize : GetWaveSizes(static_cast<uint32_t>(maxWaveSize)))
+    {
+        options.WavefrontSize = waveSize;
+
+        double unsortedMs = 0.0;
+
+        for (bool sort : {false, true})
+        {
+            options.SortRays = sort;
+
+            SortResult result = Render(scene, options, static_cast<uint32_t>(threadCount),
+                                       width, height, iterations);
+
+            if (firstImage.empty())
+                firstImage = result.Image;
+            else
+                identical = identical && result.Image == firstImage;
+
+            double traceMs = result.DepthMs - result.SortMs;
+
+            std::cout << std::left << std::setw(10) << waveSize << std::setw(8)
+                      << (sort ? "yes" : "no") << std::right << std::setprecision(1)
+                      << std::setw(12) << result.Ms << std::setw(12) << result.SortMs
+                      << std::setw(12) << traceMs << std::setprecision(2) << std::setw(12)
+                      << traceMs * 1e6 / visitedNodes[0] << std::setw(14);
+
+            if (cacheMisses)
+                std::cout << static_cast<double>(result.CacheMisses) / rays;
+            else
+                std::cout << "n/a";
+
+            if (sort)
+                std::cout << std::setw(9) << unsortedMs / result.Ms << "x";
+            else
+                unsortedMs = result.Ms;
+
+            std::cout << "\n";
+        }
+    }
+
+    std::cout << "\n"
+              << (identical ? "images and visited nodes identical with and without sorting"
+                            : "images or visited nodes differ with sorting  MISMATCH")
+              << std::endl;
+
+    return identical ? 0 : 1;
+}
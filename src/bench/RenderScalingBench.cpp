@@ -0,0 +1,105 @@
+#include "Bench.h"
+
+#include "CpuScene.h"
+#include "PathTracer.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+
+// 1, 2, 4, ... threads up to maxThreads, which is always included.
+std::vector<uint32_t> GetThreadCounts(uint32_t maxThreads)
+{
+    std::vector<uint32_t> counts;
+
+    for (uint32_t count = 1; count < maxThreads; count *= 2)
+        counts.push_back(count);
+
+    counts.push_back(maxThreads);
+
+    return counts;
+}
+
+} // namespace
+
+int RunRenderScalingBench(std::span<const std::string> argSpan)
+{
+    std::vector<std::string> args(argSpan.begin(), argSpan.end());
+
+    int maxThreads = TakeIntOption(&args, "--max-threads",
+                                   static_cast<int>(std::thread::hardware_concurrency()));
+    int width = TakeIntOption(&args, "--width", 256);
+    int height = TakeIntOption(&args, "--height", 144);
+    int spp = TakeIntOption(&args, "--spp", 16);
+    int tileSize = TakeIntOption(&args, "--tile-size", 16);
+
+    if (width <= 0 || height <= 0 || spp <= 0 || tileSize <= 0)
+        throw std::runtime_error("Sizes and sample counts must be positive.");
+
+    maxThreads = std::max(maxThreads, 1);
+
+    CpuScene scene;
+
+    {
+        ThreadPool loadPool(static_cast<size_t>(maxThreads));
+        LoadCpuScene(GetPbrtBookScene(), &loadPool, &scene);
+    }
+
+    RenderOptions options;
+    options.SamplesPerPixel = static_cast<uint32_t>(spp);
+
+    std::cout << width << "x" << height << " at " << spp << " spp in " << tileSize << "x"
+              << tileSize << " tiles, " << std::thread::hardware_concurrency()
+              << " hardware threads\n\n"
+              << std::left << std::setw(10) << "threads" << std::right << std::setw(12) << "ms"
+              << std::setw(12) << "Mrays/s" << std::setw(10) << "speedup" << std::setw(12)
+              << "efficiency" << std::setw(10) << "stolen" << "\n";
+
+    std::vector<glm::vec3> firstImage;
+    double firstMs = 0.0;
+    bool identical = true;
+
+    for (uint32_t threadCount : GetThreadCounts(static_cast<uint32_t>(maxThreads)))
+    {
+        ThreadPool pool(threadCount);
+
+        Film film(width, height, tileSize);
+        RenderStats stats{};
+
+        double ms = TimeMs(1, [&] { stats = RenderScene(scene, options, &pool, &film); });
+
+        uint64_t rays = stats.CameraRays + stats.ShadowRays + stats.BounceRays;
+
+        // Every pixel's samples are added in the same order whichever thread renders its tile.
+        std::vector<glm::vec3> image = film.Resolve();
+
+        if (threadCount == 1)
+        {
+            firstImage = std::move(image);
+            firstMs = ms;
+        }
+        else
+        {
+            identical = identical && image == firstImage;
+        }
+
+        double speedup = firstMs / ms;
+
+        std::cout << std::left << std::setw(10) << threadCount << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(12) << ms << std::setw(12)
+                  << rays / (ms * 1000.0) << std::setprecision(2) << std::setw(10) << speedup
+                  << std::setw(11) << std::setprecision(0) << 100.0 * speedup / threadCount
+                  << "%" << std::setw(10) << stats.StolenTiles << "\n";
+    }
+
+    std::cout << "\n"
+              << (identical ? "images identical across thread counts"
+                            : "images differ across thread counts  MISMATCH")
+              << std::endl;
+
+    return identical ? 0 : 1;
+}
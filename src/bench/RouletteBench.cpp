@@ -0,0 +1,144 @@
+#include "Bench.h"
+
+#include "CpuScene.h"
+#include "PathTracer.h"
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+
+struct RouletteResult
+{
+    double Ms = 0.0;
+    double RaysPerPixel = 0.0;
+
+    // The mean over the pixels of their sample variance.
+    double Variance = 0.0;
+
+    // From GetMeanLuminance.
+    double Mean = 0.0;
+    double MeanVariance = 0.0;
+
+    std::vector<glm::vec3> Image;
+};
+
+RouletteResult Render(const CpuScene& scene, const RenderOptions& options, ThreadPool* pool,
+                      uint32_t width, uint32_t height)
+{
+    Film film(width, height);
+    RenderStats stats{};
+
+    RouletteResult result;
+    result.Ms = TimeMs(1, [&] { stats = RenderScene(scene, options, pool, &film); });
+
+    double pixelCount = static_cast<double>(width) * height;
+
+    result.RaysPerPixel = (stats.CameraRays + stats.ShadowRays + stats.BounceRays) / pixelCount;
+
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+            result.Variance += film.GetVariance(x, y);
+    }
+
+    result.Variance /= pixelCount;
+    GetMeanLuminance(film, &result.Mean, &result.MeanVariance);
+    result.Image = film.Resolve();
+
+    return result;
+}
+
+} // namespace
+
+int RunRouletteBench(std::span<const std::string> argSpan)
+{
+    std::vector<std::string> args(argSpan.begin(), argSpan.end());
+
+    int threadCount = TakeIntOption(&args, "--threads", 0);
+    int width = TakeIntOption(&args, "--width", 128);
+    int height = TakeIntOption(&args, "--height", 72);
+    int spp = TakeIntOption(&args, "--spp", 64);
+    int rouletteDepth = TakeIntOption(&args, "--roulette-depth", 2);
+
+    if (width <= 0 || height <= 0 || spp <= 0 || rouletteDepth <= 0)
+        throw std::runtime_error("Sizes, counts and depths must be positive.");
+
+    ThreadPool pool(static_cast<size_t>(threadCount));
+
+    CpuScene scene;
+    LoadCpuScene(GetPbrtBookScene(), &pool, &scene);
+
+    RenderOptions options;
+    options.SamplesPerPixel = static_cast<uint32_t>(spp);
+
+    SamplerTables sharedTables = GetSamplerTables(options.Sampler, 1, options.Seed, &pool);
+
+    std::cout << std::fixed << width << "x" << height << " at " << spp << " spp, roulette from "
+              << "depth " << rouletteDepth << ". Variance is the mean of the pixels' sample "
+              << "variances of luminance.\nEfficiency is the inverse of variance times rays, "
+              << "relative to the render without roulette.\n\n"
+              << std::setw(10) << "max depth" << std::setw(10) << "roulette" << std::setw(10)
+              << "ms" << std::setw(12) << "rays/pixel" << std::setw(12) << "variance"
+              << std::setw(10) << "speedup" << std::setw(12) << "efficiency" << "\n";
+
+    bool unbiased = true;
+    bool identical = true;
+
+    for (uint32_t maxDepth : {3u, 8u, 16u})
+    {
+        options.MaxDepth = maxDepth;
+
+        RouletteResult results[2];
+
+        for (bool roulette : {false, true})
+        {
+            options.RouletteDepth = roulette ? static_cast<uint32_t>(rouletteDepth) : 0;
+            results[roulette] = Render(scene, options, &pool, width, height);
+
+            const RouletteResult& result = results[roulette];
+
+            std::cout << std::setw(10) << maxDepth << std::setw(10) << (roulette ? "on" : "off")
+                      << std::setprecision(1) << std::setw(10) << result.Ms << std::setw(12)
+                      << result.RaysPerPixel << std::setprecision(5) << std::setw(12)
+                      << result.Variance;
+
+            if (roulette)
+            {
+                const RouletteResult& off = results[0];
+
+                std::cout << std::setprecision(2) << std::setw(9) << off.Ms / result.Ms << "x"
+                          << std::setw(11)
+                          << (off.Variance * off.RaysPerPixel) /
+                                 (result.Variance * result.RaysPerPixel)
+                          << "x";
+            }
+
+            std::cout << "\n";
+        }
+
+        // Roulette only adds noise, so the image means may only differ by that noise.
+        double difference = std::abs(results[1].Mean - results[0].Mean);
+        unbiased = unbiased &&
+                   difference <= 5.0 * std::sqrt(results[0].MeanVariance + results[1].MeanVariance);
+
+        // Both integrators draw the roulette's numbers at the same point of a path.
+        RenderOptions wavefront = options;
+        wavefront.Integrator = IntegratorType::Wavefront;
+
+        identical = identical &&
+                    Render(scene, wavefront, &pool, width, height).Image == results[1].Image;
+    }
+
+    std::cout << "\n"
+              << (unbiased ? "image means with roulette within noise of those without"
+                           : "image means with roulette biased  MISMATCH")
+              << "\n"
+              << (identical ? "wavefront images with roulette identical to the megakernel ones"
+                            : "wavefront images with roulette differ  MISMATCH")
+              << std::endl;
+
+    return unbiased && identical ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+#include "Bench.h"
+
+#include "CpuScene.h"
+#include "PathTracer.h"
+#include "SamplerTables.h"
+
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+namespace
+{
+
+constexpr SamplerType kSamplerTypes[] = {SamplerType::Halton, SamplerType::PaddedSobol,
+                                         SamplerType::ZSobol};
+
+// Whether the first 2^log2Count samples of a pixel put exactly one point in each cell of every
+// grid of 2^log2Count cells whose sides are powers of two, which Sobol's first two dimensions do
+// for every pair of sample dimensions.
+bool IsStratified(std::span<const glm::vec2> points, uint32_t log2Count)
+{
+    for (uint32_t log2X = 0; log2X <= log2Count; ++log2X)
+    {
+        uint32_t cellsX = 1u << log2X;
+        uint32_t cellsY = 1u << (log2Count - log2X);
+
+        std::vector<int> counts(points.size());
+
+        for (glm::vec2 point : points)
+        {
+            uint32_t cellX = static_cast<uint32_t>(point.x * cellsX);
+            uint32_t cellY = static_cast<uint32_t>(point.y * cellsY);
+
+            if (++counts[cellY * cellsX + cellX] > 1)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+// Pixels and dimensions whose Sobol samples are not stratified, for a few sample counts.
+size_t CountUnstratified(const SamplerTables& tables, glm::uvec2 resolution)
+{
+    size_t count = 0;
+
+    // An odd power of two too, for which ZSobol's last digit is base 2.
+    for (uint32_t log2Count : {4u, 5u})
+    {
+        SamplerTables countTables = tables;
+        countTables.SamplesPerPixel = 1u << log2Count;
+
+        Sampler sampler = countTables.CreateSampler(resolution);
+
+        constexpr int kDimensionPairs = 8;
+
+        for (uint32_t y = 0; y < resolution.y; y += 7)
+        {
+            for (uint32_t x = 0; x < resolution.x; x += 5)
+            {
+                std::vector<glm::vec2> points[kDimensionPairs];
+
+                for (uint32_t sampleIdx = 0; sampleIdx < countTables.SamplesPerPixel; ++sampleIdx)
+                {
+                    sampler.StartPixelSample(glm::uvec2(x, y), sampleIdx);
+                    points[0].push_back(sampler.GetPixel2D());
+
+                    for (int pair = 1; pair < kDimensionPairs; ++pair)
+                        points[pair].push_back(sampler.Get2D());
+                }
+
+                for (const std::vector<glm::vec2>& pairPoints : points)
+                    count += !IsStratified(pairPoints, log2Count);
+            }
+        }
+    }
+
+    return count;
+}
+
+} // namespace
+
+int RunSamplerBench(std::span<const std::string> argSpan)
+{
+    std::vector<std::string> args(argSpan.begin(), argSpan.end());
+
+    int threadCount = TakeIntOption(&args, "--threads", 0);
+    int width = TakeIntOption(&args, "--width", 128);
+    int height = TakeIntOption(&args, "--height", 72);
+    int referenceSpp = TakeIntOption(&args, "--reference-spp", 1024);
+    int maxSpp = TakeIntOption(&args, "--max-spp", 64);
+
+    if (width <= 0 || height <= 0 || referenceSpp <= 0 || maxSpp <= 0)
+        throw std::runtime_error("Sizes and sample counts must be positive.");
+
+    ThreadPool pool(static_cast<size_t>(threadCount));
+
+    CpuScene scene;
+    LoadCpuScene(GetPbrtBookScene(), &pool, &scene);
+
+    glm::uvec2 resolution(width, height);
+
+    size_t unstratifiedCount = 0;
+
+    for (SamplerType type : {SamplerType::PaddedSobol, SamplerType::ZSobol})
+        unstratifiedCount += CountUnstratified(GetSamplerTables(type, 1, 0, &pool), resolution);
+
+    RenderOptions options;
+    options.SamplesPerPixel = static_cast<uint32_t>(referenceSpp);
+    options.Seed = kReferenceSeed;
+
+    Film reference(resolution.x, resolution.y);
+
+    double referenceMs = TimeMs(1, [&] { RenderScene(scene, options, &pool, &reference); });
+
+    std::cout << std::fixed << std::setprecision(1) << "reference: " << referenceSpp
+              << " spp of halton in " << referenceMs << " ms\n\n"
+              << std::left << std::setw(8) << "spp";
+
+    for (SamplerType type : kSamplerTypes)
+    {
+        std::cout << std::right << std::setw(12) << GetSamplerTypeName(type) << " RMSE"
+                  << std::setw(10) << "ms";
+    }
+
+    std::cout << "\n";
+
+    // The error of every sampler has to go down as samples are added.
+    double firstRmse[std::size(kSamplerTypes)] = {};
+    double lastRmse[std::size(kSamplerTypes)] = {};
+
+    options.Seed = 1;
+
+    std::shared_ptr<const HaltonTables> sharedHaltonTables = GetHaltonTables(options.Seed, &pool);
+
+    for (int spp = 1; spp <= maxSpp; spp *= 2)
+    {
+        std::cout << std::left << std::setw(8) << spp << std::setprecision(5);
+
+        for (size_t i = 0; i < std::size(kSamplerTypes); ++i)
+        {
+            options.Sampler = kSamplerTypes[i];
+            options.SamplesPerPixel = static_cast<uint32_t>(spp);
+
+            Film film(resolution.x, resolution.y);
+
+            double ms = TimeMs(1, [&] { RenderScene(scene, options, &pool, &film); });
+            double rmse = ComputeRmse(film, reference);
+
+            if (spp == 1)
+                firstRmse[i] = rmse;
+
+            lastRmse[i] = rmse;
+
+            std::cout << std::right << std::setw(17) << rmse << std::setprecision(1)
+                      << std::setw(10) << ms << std::setprecision(5);
+        }
+
+        std::cout << "\n";
+    }
+
+    bool converges = true;
+
+    for (size_t i = 0; i < std::size(kSamplerTypes); ++i)
+        converges = converges && lastRmse[i] < firstRmse[i];
+
+    std::cout << "\nstratification: " << unstratifiedCount
+              << " pixel and dimension pairs of the Sobol samplers not stratified"
+              << (unstratifiedCount == 0 ? "" : "  MISMATCH") << "\n"
+              << (converges ? "" : "an error failed to go down with more samples  MISMATCH\n")
+              << std::flush;
+
+    return unstratifiedCount == 0 && converges ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+#include "Bench.h"
+
+#include "LoadQueue.h"
+#include "Mesh.h"
+
+#include <iomanip>
+#include <iostream>
+
+int RunSceneLoadBench(std::span<const std::string> argSpan)
+{
+    std::vector<std::string> args(argSpan.begin(), argSpan.end());
+
+    int threadCount = TakeIntOption(&args, "--threads", 0);
+
+    auto files = CollectFiles(args, ".ply", kDefaultGeometryDir);
+
+    if (files.empty())
+        throw std::runtime_error("No ply files found.");
+
+    std::vector<Mesh> meshes(files.size());
+
+    double serialMs = TimeMs(1, [&] {
+        for (size_t i = 0; i < files.size(); ++i)
+            LoadMeshFromPlyFile(files[i], &meshes[i]);
+    });
+
+    meshes.assign(files.size(), Mesh{});
+
+    ThreadPool pool(static_cast<size_t>(threadCount));
+
+    size_t triangleCount = 0;
+
+    double parallelMs = TimeMs(1, [&] {
+        LoadQueue queue(&pool);
+
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            queue.Add(files[i].filename().string(),
+                      [&, i] { LoadMeshFromPlyFile(files[i], &meshes[i]); });
+        }
+
+        // This is where PbrtDX uploads each mesh.
+        size_t jobIdx = 0;
+
+        while (queue.WaitNext(&jobIdx))
+            triangleCount += meshes[jobIdx].Indices.size() / 3;
+    });
+
+    std::cout << std::fixed << std::setprecision(1) << files.size() << " files, "
+              << triangleCount << " triangles\n"
+              << "serial:   " << serialMs << " ms\n"
+              << "parallel: " << parallelMs << " ms on " << pool.GetThreadCount() << " threads ("
+              << std::setprecision(2) << serialMs / parallelMs << "x)" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,210 @@
+#include "Bench.h"
+
+#include "CpuScene.h"
+#include "Film.h"
+#include "PathTracer.h"
+#include "SceneIR.h"
+
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+
+template<typename T>
+bool IsSameArray(std::span<const T> a, std::span<const T> b)
+{
+    return a.size() == b.size() && memcmp(a.data(), b.data(), a.size_bytes()) == 0;
+}
+
+bool IsSame(const SceneIR& a, const SceneIR& b)
+{
+    return memcmp(&a.Camera, &b.Camera, sizeof(SceneCamera)) == 0 &&
+           IsSameArray(a.Positions, b.Positions) && IsSameArray(a.Normals, b.Normals) &&
+           IsSameArray(a.UVs, b.UVs) && IsSameArray(a.Indices, b.Indices) &&
+           IsSameArray(a.Meshes, b.Meshes) && IsSameArray(a.Transforms, b.Transforms) &&
+           IsSameArray(a.Materials, b.Materials) && IsSameArray(a.Textures, b.Textures) &&
+           IsSameArray(a.Strings, b.Strings) && IsSameArray(a.Instances, b.Instances) &&
+           IsSameArray(a.Lights, b.Lights);
+}
+
+// Reads every vertex and index, which a mapped snapshot pages in from the file.
+float TouchVertices(const SceneIR& scene)
+{
+    float sum = 0.f;
+
+    for (const glm::vec3& position : scene.Positions)
+        sum += position.x;
+
+    for (uint32_t index : scene.Indices)
+        sum += static_cast<float>(index);
+
+    return sum;
+}
+
+std::vector<glm::vec3> Render(const SceneIR& source, ThreadPool* pool, double* ms)
+{
+    Film film(64, 36);
+
+    *ms = TimeMs(1, [&] {
+        CpuScene scene;
+        LoadCpuScene(source, pool, &scene);
+
+        RenderOptions options;
+        options.SamplesPerPixel = 4;
+        RenderScene(scene, options, pool, &film);
+    });
+
+    return film.Resolve();
+}
+
+// Whether loading rejects a copy of the snapshot that corrupt has changed.
+bool RejectsCorrupted(const std::filesystem::path& snapshotPath,
+                      const std::function<void(const std::filesystem::path& path)>& corrupt)
+{
+    std::filesystem::path corruptedPath = snapshotPath;
+    corruptedPath += ".corrupted";
+
+    std::filesystem::copy_file(snapshotPath, corruptedPath,
+                               std::filesystem::copy_options::overwrite_existing);
+    corrupt(corruptedPath);
+
+    bool rejected = false;
+
+    try
+    {
+        LoadSceneSnapshot(corruptedPath);
+    }
+    catch (const std::runtime_error&)
+    {
+        rejected = true;
+    }
+
+    std::filesystem::remove(corruptedPath);
+
+    return rejected;
+}
+
+void Truncate(const std::filesystem::path& path)
+{
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) / 2);
+}
+
+// Points the last index of the snapshot past the vertices of its mesh.
+void BreakLastIndex(const std::filesystem::path& path)
+{
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+
+    SceneSnapshotHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    const SceneSnapshotHeader::Section& indices = header.Sections[SceneSnapshotHeader::Indices];
+    uint32_t index = ~0u;
+
+    if (indices.Size >= sizeof(index))
+    {
+        file.seekp(static_cast<std::streamoff>(indices.Offset + indices.Size - sizeof(index)));
+        file.write(reinterpret_cast<const char*>(&index), sizeof(index));
+    }
+}
+
+} // namespace
+
+int RunSceneSnapshotBench(std::span<const std::string> argSpan)
+{
+    std::vector<std::string> args(argSpan.begin(), argSpan.end());
+
+    int threadCount = TakeIntOption(&args, "--threads", 0);
+    int iterations = TakeIntOption(&args, "--iterations", 5);
+
+    if (iterations <= 0)
+        throw std::runtime_error("Iterations must be positive.");
+
+    // The pbrt-book scene unless a pbrt-v4 file is given.
+    std::filesystem::path scenePath;
+
+    if (!args.empty())
+        scenePath = args[0];
+
+    ThreadPool pool(static_cast<size_t>(threadCount));
+
+    SceneIR built;
+
+    double buildMs = TimeMs(iterations, [&] { built = LoadSceneIR(scenePath, &pool); });
+
+    std::filesystem::path snapshotPath =
+        std::filesystem::temp_directory_path() / "PbrtBench-scene-snapshot.pbrtscene";
+
+    double writeMs = TimeMs(1, [&] { WriteSceneSnapshot(built, snapshotPath); });
+
+    SceneIR loaded;
+
+    // Volatile so that the reads aren't optimized away.
+    volatile float touched = 0.f;
+
+    double loadMs = TimeMs(iterations, [&] { loaded = LoadSceneSnapshot(snapshotPath); });
+    double touchMs = TimeMs(iterations, [&] {
+        touched = TouchVertices(LoadSceneSnapshot(snapshotPath));
+    });
+
+    bool same = IsSame(built, loaded);
+
+    // A snapshot of a loaded snapshot is the same file.
+    std::filesystem::path rewrittenPath = snapshotPath;
+    rewrittenPath += ".rewritten";
+    WriteSceneSnapshot(loaded, rewrittenPath);
+
+    auto readFile = [](const std::filesystem::path& path) {
+        std::ifstream file(path, std::ios::binary);
+
+        return std::vector<char>(std::istreambuf_iterator<char>(file), {});
+    };
+
+    bool stable = readFile(snapshotPath) == readFile(rewrittenPath);
+    bool rejectsTruncated = RejectsCorrupted(snapshotPath, Truncate);
+    bool rejectsBadIndex = RejectsCorrupted(snapshotPath, BreakLastIndex);
+
+    double builtRenderMs = 0.0;
+    double loadedRenderMs = 0.0;
+    bool identical =
+        Render(built, &pool, &builtRenderMs) == Render(loaded, &pool, &loadedRenderMs);
+
+    uintmax_t snapshotBytes = std::filesystem::file_size(snapshotPath);
+
+    loaded = SceneIR{};
+    std::filesystem::remove(snapshotPath);
+    std::filesystem::remove(rewrittenPath);
+
+    std::cout << std::fixed << std::setprecision(2) << built.Instances.size() << " instances of "
+              << built.Meshes.size() << " meshes, " << built.Positions.size() << " vertices, "
+              << snapshotBytes / 1024 << " KB snapshot\n"
+              << "from sources:               " << buildMs << " ms\n"
+              << "write snapshot:             " << writeMs << " ms\n"
+              << "map snapshot:               " << loadMs << " ms (" << buildMs / loadMs
+              << "x)\n"
+              << "map and read every vertex:  " << touchMs << " ms (" << buildMs / touchMs
+              << "x)\n"
+              << "load and render 4 spp:      " << builtRenderMs << " ms from sources, "
+              << loadedRenderMs << " ms from the snapshot\n"
+              << "\n"
+              << (same ? "snapshot round trips every array"
+                       : "snapshot differs from the scene  MISMATCH")
+              << "\n"
+              << (stable ? "snapshot of the snapshot identical"
+                         : "snapshot of the snapshot differs  MISMATCH")
+              << "\n"
+              << (rejectsTruncated ? "truncated snapshot rejected"
+                                   : "truncated snapshot loaded  MISMATCH")
+              << "\n"
+              << (rejectsBadIndex ? "snapshot with an index out of range rejected"
+                                  : "snapshot with an index out of range loaded  MISMATCH")
+              << "\n"
+              << (identical ? "images from sources and snapshot identical"
+                            : "images from sources and snapshot differ  MISMATCH")
+              << std::endl;
+
+    return same && stable && rejectsTruncated && rejectsBadIndex && identical ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+#include "Bench.h"
+
+#include "Image.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+
+// D3D12_TEXTURE_DATA_PITCH_ALIGNMENT, which the rows of a texture upload buffer are aligned to.
+constexpr size_t kRowPitchAlignment = 256;
+
+// Fills the padding at the end of each row, which decoding must leave alone.
+constexpr std::byte kGuardByte{0xCD};
+
+// Stands in for the upload buffer of a texture.
+struct PitchedImage
+{
+    ImageInfo Info;
+    size_t RowPitch = 0;
+
+    std::vector<std::byte> Pixels;
+};
+
+size_t GetRowSize(const ImageInfo& info)
+{
+    return info.Width * GetPixelSize(info.Format);
+}
+
+void Allocate(const ImageInfo& info, PitchedImage* image)
+{
+    image->Info = info;
+    image->RowPitch = (GetRowSize(info) + kRowPitchAlignment - 1) & ~(kRowPitchAlignment - 1);
+    image->Pixels.assign(image->RowPitch * info.Height, kGuardByte);
+}
+
+void DecodePitched(const std::filesystem::path& path, PitchedImage* image)
+{
+    ImageSink sink;
+
+    sink.Allocate = [&](const ImageInfo& info) {
+        Allocate(info, image);
+
+        sink.Pixels = image->Pixels;
+        sink.RowPitch = image->RowPitch;
+    };
+
+    DecodeImageInto(path, &sink);
+}
+
+// What loading a texture did before: decoding into a tightly packed image, then copying it to the
+// upload buffer a row at a time.
+void DecodeAndCopy(const std::filesystem::path& path, Image* tight, PitchedImage* image)
+{
+    *tight = DecodeImage(path);
+
+    Allocate(tight->Info, image);
+
+    size_t rowSize = GetRowSize(tight->Info);
+
+    for (uint32_t y = 0; y < tight->Info.Height; ++y)
+        memcpy(&image->Pixels[y * image->RowPitch], &tight->Pixels[y * rowSize], rowSize);
+}
+
+bool IsSame(const PitchedImage& a, const PitchedImage& b)
+{
+    return a.Info.Width == b.Info.Width && a.Info.Height == b.Info.Height &&
+           a.Info.Format == b.Info.Format && a.Pixels == b.Pixels;
+}
+
+bool IsPaddingIntact(const PitchedImage& image)
+{
+    size_t rowSize = GetRowSize(image.Info);
+
+    for (uint32_t y = 0; y < image.Info.Height; ++y)
+    {
+        auto row = image.Pixels.begin() + y * image.RowPitch;
+
+        if (std::any_of(row + rowSize, row + image.RowPitch,
+                        [](std::byte value) { return value != kGuardByte; }))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+int RunTextureDecodeBench(std::span<const std::string> argSpan)
+{
+    std::vector<std::string> args(argSpan.begin(), argSpan.end());
+
+    int threadCount = TakeIntOption(&args, "--threads", 0);
+    int iterations = TakeIntOption(&args, "--iterations", 5);
+
+    if (iterations <= 0)
+        throw std::runtime_error("Iterations must be positive.");
+
+    std::vector<std::filesystem::path> files;
+
+    for (const char* extension : {".exr", ".jpeg", ".jpg", ".png"})
+    {
+        auto found = CollectFiles(args, extension, kDefaultTextureDir);
+        files.insert(files.end(), found.begin(), found.end());
+    }
+
+    // Files given by name are collected once per extension.
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+
+    std::erase_if(files, [](const auto& file) { return !std::filesystem::exists(file); });
+
+    if (files.empty())
+        throw std::runtime_error("No png, jpeg or exr files found.");
+
+    ThreadPool pool(static_cast<size_t>(threadCount));
+
+    std::vector<Image> tight(files.size());
+    std::vector<PitchedImage> copied(files.size());
+    std::vector<PitchedImage> serial(files.size());
+    std::vector<PitchedImage> parallel(files.size());
+
+    double copyMs = TimeMs(iterations, [&] {
+        for (size_t i = 0; i < files.size(); ++i)
+            DecodeAndCopy(files[i], &tight[i], &copied[i]);
+    });
+
+    double serialMs = TimeMs(iterations, [&] {
+        for (size_t i = 0; i < files.size(); ++i)
+            DecodePitched(files[i], &serial[i]);
+    });
+
+    double parallelMs = TimeMs(iterations, [&] {
+        pool.ParallelFor(files.size(), [&](size_t i) { DecodePitched(files[i], &parallel[i]); });
+    });
+
+    uintmax_t fileBytes = 0;
+    size_t decodedBytes = 0;
+
+    bool same = true;
+    bool intact = true;
+
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        const ImageInfo& info = serial[i].Info;
+
+        std::cout << files[i].filename().string() << ": " << info.Width << "x" << info.Height
+                  << (info.Format == PixelFormat::RGBA32F ? " RGBA32F" : " RGBA8") << "\n";
+
+        fileBytes += std::filesystem::file_size(files[i]);
+        decodedBytes += tight[i].Pixels.size();
+
+        same = same && IsSame(serial[i], copied[i]) && IsSame(serial[i], parallel[i]);
+        intact = intact && IsPaddingIntact(serial[i]) && IsPaddingIntact(parallel[i]);
+    }
+
+    double decodedMB = decodedBytes / (1024.0 * 1024.0);
+
+    std::cout << std::fixed << std::setprecision(1) << "\n"
+              << files.size() << " files, " << fileBytes / (1024.0 * 1024.0) << " MB, "
+              << decodedMB << " MB decoded\n"
+              << "decode, then copy rows: " << copyMs << " ms (" << decodedMB * 1000.0 / copyMs
+              << " MB/s)\n"
+              << "decode at the pitch:    " << serialMs << " ms ("
+              << decodedMB * 1000.0 / serialMs << " MB/s, " << std::setprecision(2)
+              << copyMs / serialMs << "x)\n"
+              << std::setprecision(1) << "parallel at the pitch:  " << parallelMs << " ms ("
+              << decodedMB * 1000.0 / parallelMs << " MB/s) on " << pool.GetThreadCount()
+              << " threads (" << std::setprecision(2) << serialMs / parallelMs << "x)\n"
+              << (same ? "images identical however they are decoded"
+                       : "images differ by how they are decoded  MISMATCH")
+              << "\n"
+              << (intact ? "row padding untouched" : "row padding overwritten  MISMATCH")
+              << std::endl;
+
+    return same && intact ? 0 : 1;
+}
@@ -0,0 +1,375 @@
+#include "Bench.h"
+
+#include "CpuScene.h"
+#include "Mipmap.h"
+#include "PathTracer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <unordered_set>
+
+namespace
+{
+
+// The largest drift of a level's mean from the first level's that sRGB rounding may explain.
+constexpr double kMaxMeanDrift = 0.01;
+
+// Camera rays are traced a tile at a time, like the threads of a ray generation dispatch.
+constexpr uint32_t kTileSize = 8;
+
+constexpr size_t kCacheLineSize = 64;
+
+// A set associative cache with LRU replacement, standing in for the texture cache of a GPU.
+class CacheModel
+{
+public:
+    CacheModel(size_t size, size_t wayCount)
+        : m_wayCount(wayCount), m_setCount(size / (kCacheLineSize * wayCount)),
+          m_lines(m_setCount * wayCount, 0)
+    {
+    }
+
+    // Returns whether the line holding the address had to be fetched.
+    bool Access(uintptr_t address)
+    {
+        // 0 marks an empty way.
+        uint64_t line = address / kCacheLineSize + 1;
+        auto ways = m_lines.begin() + static_cast<ptrdiff_t>((line % m_setCount) * m_wayCount);
+
+        auto hit = std::find(ways, ways + static_cast<ptrdiff_t>(m_wayCount), line);
+        bool miss = hit == ways + static_cast<ptrdiff_t>(m_wayCount);
+
+        // Most recently used first.
+        if (miss)
+            hit = ways + static_cast<ptrdiff_t>(m_wayCount) - 1;
+
+        std::rotate(ways, hit, hit + 1);
+        *ways = line;
+
+        return miss;
+    }
+
+private:
+    size_t m_wayCount;
+    size_t m_setCount;
+
+    std::vector<uint64_t> m_lines;
+};
+
+struct TrafficResult
+{
+    uint64_t Taps = 0;
+    uint64_t FetchedBytes = 0;
+    size_t TouchedBytes = 0;
+
+    double SampleMs = 0.0;
+};
+
+// The texture lookups of the camera hits through the center of every pixel, a tile at a time.
+std::vector<TextureLookup> GetCameraLookups(const CpuScene& scene, uint32_t width,
+                                            uint32_t height)
+{
+    glm::uvec2 dimensions(width, height);
+    RayCone cone = GetCameraRayCone(scene.Camera, dimensions);
+
+    std::vector<TextureLookup> lookups;
+
+    for (uint32_t tileY = 0; tileY < height; tileY += kTileSize)
+    {
+        for (uint32_t tileX = 0; tileX < width; tileX += kTileSize)
+        {
+            for (uint32_t y = tileY; y < std::min(tileY + kTileSize, height); ++y)
+            {
+                for (uint32_t x = tileX; x < std::min(tileX + kTileSize, width); ++x)
+                {
+                    Ray ray = GenerateCameraRay(scene.Camera, glm::vec2(x, y) + 0.5f, dimensions);
+                    RayHit hit{};
+                    TextureLookup lookup;
+
+                    if (scene.Accel.Intersect(ray, ~0u, true, &hit) &&
+                        GetTextureLookup(scene, ray, hit, GetShadingNormal(scene, hit), cone,
+                                         &lookup))
+                    {
+                        lookups.push_back(lookup);
+                    }
+                }
+            }
+        }
+    }
+
+    return lookups;
+}
+
+TrafficResult MeasureTraffic(const CpuScene& scene, std::span<const TextureLookup> lookups,
+                             bool rayConeLod, int iterations)
+{
+    TrafficResult result;
+
+    // The L1 of a GPU's texture unit.
+    CacheModel cache(16 * 1024, 4);
+    std::unordered_set<uintptr_t> touched;
+
+    for (const TextureLookup& lookup : lookups)
+    {
+        const CpuTexture& texture = scene.Textures[lookup.TextureIdx];
+
+        TexelTap taps[kMaxTrilinearTaps];
+        uint32_t count =
+            GetTrilinearTaps(texture, lookup.UV, rayConeLod ? lookup.Lod : 0.f, taps);
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const Image& level = texture.Levels[taps[i].Level];
+
+            size_t texelIdx = static_cast<size_t>(taps[i].Y) * level.Info.Width + taps[i].X;
+            auto address = reinterpret_cast<uintptr_t>(
+                &level.Pixels[texelIdx * GetPixelSize(level.Info.Format)]);
+
+            if (cache.Access(address))
+                result.FetchedBytes += kCacheLineSize;
+
+            touched.insert(address / kCacheLineSize);
+        }
+
+        result.Taps += count;
+    }
+
+    result.TouchedBytes = touched.size() * kCacheLineSize;
+
+    result.SampleMs = TimeMs(iterations, [&] {
+        glm::vec4 sum(0.f);
+
+        for (const TextureLookup& lookup : lookups)
+        {
+            sum += SampleLevel(scene.Textures[lookup.TextureIdx], lookup.UV,
+                               rayConeLod ? lookup.Lod : 0.f);
+        }
+
+        // Keeps the lookups from being optimized away.
+        volatile float sink = sum.x;
+        (void)sink;
+    });
+
+    return result;
+}
+
+double SrgbToLinear(double value)
+{
+    return value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4);
+}
+
+// The mean of each color channel over the texels of a level, in linear space.
+glm::dvec3 GetLinearMean(const Image& image)
+{
+    glm::dvec3 sum(0.0);
+    size_t texelCount = static_cast<size_t>(image.Info.Width) * image.Info.Height;
+
+    for (size_t i = 0; i < texelCount; ++i)
+    {
+        const std::byte* texel = &image.Pixels[i * GetPixelSize(image.Info.Format)];
+
+        for (int c = 0; c < 3; ++c)
+        {
+            if (image.Info.Format == PixelFormat::RGBA32F)
+            {
+                float value = 0.f;
+                memcpy(&value, texel + c * sizeof(float), sizeof(value));
+                sum[c] += value;
+            }
+            else
+            {
+                sum[c] += SrgbToLinear(static_cast<uint8_t>(texel[c]) / 255.0);
+            }
+        }
+    }
+
+    return sum / static_cast<double>(texelCount);
+}
+
+std::vector<MipLevel> GetMipLevels(std::vector<Image>* chain)
+{
+    std::vector<MipLevel> levels(chain->size());
+
+    for (size_t i = 0; i < chain->size(); ++i)
+    {
+        Image& image = (*chain)[i];
+
+        levels[i].Width = image.Info.Width;
+        levels[i].Height = image.Info.Height;
+        levels[i].Pixels = image.Pixels;
+        levels[i].RowPitch = image.Info.Width * GetPixelSize(image.Info.Format);
+    }
+
+    return levels;
+}
+
+double RenderMs(const CpuScene& scene, const RenderOptions& options, ThreadPool* pool,
+                uint32_t width, uint32_t height, int iterations, std::vector<glm::vec3>* image)
+{
+    double ms = TimeMs(iterations, [&] {
+        Film film(width, height);
+        RenderScene(scene, options, pool, &film);
+
+        *image = film.Resolve();
+    });
+
+    return ms;
+}
+
+} // namespace
+
+int RunTextureLodBench(std::span<const std::string> argSpan)
+{
+    std::vector<std::string> args(argSpan.begin(), argSpan.end());
+
+    int threadCount = TakeIntOption(&args, "--threads", 0);
+    int iterations = TakeIntOption(&args, "--iterations", 3);
+    int width = TakeIntOption(&args, "--width", 640);
+    int height = TakeIntOption(&args, "--height", 360);
+    int spp = TakeIntOption(&args, "--spp", 4);
+
+    if (iterations <= 0 || width <= 0 || height <= 0 || spp <= 0)
+        throw std::runtime_error("Sizes and counts must be positive.");
+
+    ThreadPool pool(static_cast<size_t>(threadCount));
+
+    SceneIR source = BuildSceneIR(GetPbrtBookScene(), &pool);
+
+    CpuScene scene;
+    LoadCpuScene(source, &pool, &scene);
+
+    if (scene.Textures.empty())
+        throw std::runtime_error("The scene has no textures.");
+
+    std::cout << std::fixed << std::setprecision(2) << "mip chains, box filtered in linear "
+              << "space\n";
+
+    bool same = true;
+    double maxDrift = 0.0;
+
+    for (uint32_t i = 0; i < scene.Textures.size(); ++i)
+    {
+        // As LoadCpuScene built it, in parallel.
+        const std::vector<Image>& loaded = scene.Textures[i].Levels;
+
+        std::vector<Image> chain = loaded;
+        std::vector<MipLevel> levels = GetMipLevels(&chain);
+
+        PixelFormat format = chain[0].Info.Format;
+
+        double serialMs = TimeMs(iterations, [&] { GenerateMips(format, levels, nullptr); });
+        std::vector<Image> serial = chain;
+
+        double parallelMs = TimeMs(iterations, [&] { GenerateMips(format, levels, &pool); });
+
+        size_t chainBytes = 0;
+        glm::dvec3 mean = GetLinearMean(serial[0]);
+
+        for (size_t level = 0; level < serial.size(); ++level)
+        {
+            same = same && serial[level].Pixels == chain[level].Pixels &&
+                   serial[level].Pixels == loaded[level].Pixels;
+
+            glm::dvec3 drift = glm::abs(GetLinearMean(serial[level]) - mean);
+            maxDrift = std::max({maxDrift, drift.x, drift.y, drift.z});
+
+            chainBytes += serial[level].Pixels.size();
+        }
+
+        std::cout << source.GetTexturePath(i).filename().string() << ": "
+                  << serial[0].Info.Width << "x" << serial[0].Info.Height << ", "
+                  << serial.size() << " levels, " << std::setprecision(1)
+                  << chainBytes / (1024.0 * 1024.0) << " MB ("
+                  << static_cast<double>(chainBytes) / serial[0].Pixels.size() << "x), "
+                  << serialMs << " ms serial, " << parallelMs << " ms on "
+                  << pool.GetThreadCount() << " threads (" << std::setprecision(2)
+                  << serialMs / parallelMs << "x)\n";
+    }
+
+    std::vector<TextureLookup> lookups =
+        GetCameraLookups(scene, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+
+    TrafficResult results[2];
+
+    for (bool rayConeLod : {false, true})
+        results[rayConeLod] = MeasureTraffic(scene, lookups, rayConeLod, iterations);
+
+    double meanLod = 0.0;
+
+    for (const TextureLookup& lookup : lookups)
+        meanLod += lookup.Lod;
+
+    meanLod /= std::max<size_t>(lookups.size(), 1);
+
+    std::cout << "\n"
+              << width << "x" << height << ", " << lookups.size()
+              << " textured camera hits, mean ray cone LOD " << meanLod << ". Traffic through "
+              << "a 16 KB 4-way cache of 64 byte lines, in " << kTileSize << "x" << kTileSize
+              << " pixel tiles.\n\n"
+              << std::setw(10) << "lookups" << std::setw(10) << "taps" << std::setw(14)
+              << "fetched KB" << std::setw(14) << "touched KB" << std::setw(12) << "sample ms"
+              << "\n";
+
+    for (bool rayConeLod : {false, true})
+    {
+        const TrafficResult& result = results[rayConeLod];
+
+        std::cout << std::setw(10) << (rayConeLod ? "ray cone" : "mip 0") << std::setw(10)
+                  << result.Taps << std::setprecision(1) << std::setw(14)
+                  << result.FetchedBytes / 1024.0 << std::setw(14)
+                  << result.TouchedBytes / 1024.0 << std::setprecision(2) << std::setw(12)
+                  << result.SampleMs << "\n";
+    }
+
+    std::cout << std::setprecision(2) << "fetched "
+              << static_cast<double>(results[0].FetchedBytes) /
+                     std::max<uint64_t>(results[1].FetchedBytes, 1)
+              << "x less, sampled " << results[0].SampleMs / results[1].SampleMs
+              << "x faster with ray cones\n";
+
+    RenderOptions options;
+    options.SamplesPerPixel = static_cast<uint32_t>(spp);
+
+    std::vector<glm::vec3> images[2];
+    double renderMs[2] = {};
+
+    for (bool rayConeLod : {false, true})
+    {
+        options.RayConeLod = rayConeLod;
+        renderMs[rayConeLod] = RenderMs(scene, options, &pool, static_cast<uint32_t>(width),
+                                        static_cast<uint32_t>(height), iterations,
+                                        &images[rayConeLod]);
+    }
+
+    // Both integrators carry the cone through the bounces.
+    options.Integrator = IntegratorType::Wavefront;
+
+    std::vector<glm::vec3> wavefront;
+    RenderMs(scene, options, &pool, static_cast<uint32_t>(width), static_cast<uint32_t>(height),
+             1, &wavefront);
+
+    bool identical = wavefront == images[1];
+    bool reduced = results[1].FetchedBytes <= results[0].FetchedBytes;
+
+    std::cout << "\n"
+              << spp << " spp render: " << std::setprecision(1) << renderMs[0] << " ms at mip 0, "
+              << renderMs[1] << " ms with ray cones (" << std::setprecision(2)
+              << renderMs[0] / renderMs[1] << "x)\n"
+              << (same ? "mip chains identical serial and in parallel"
+                       : "mip chains differ serial and in parallel  MISMATCH")
+              << "\n"
+              << std::setprecision(4) << "level means within " << maxDrift
+              << " of the first level's in linear space"
+              << (maxDrift <= kMaxMeanDrift ? "" : "  MISMATCH") << "\n"
+              << (reduced ? "ray cones fetch no more than mip 0"
+                          : "ray cones fetch more than mip 0  MISMATCH")
+              << "\n"
+              << (identical ? "wavefront image with ray cones identical to the megakernel one"
+                            : "wavefront image with ray cones differs  MISMATCH")
+              << std::endl;
+
+    return same && maxDrift <= kMaxMeanDrift && reduced && identical ? 0 : 1;
+}
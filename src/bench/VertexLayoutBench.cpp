@@ -0,0 +1,111 @@
+#include "Bench.h"
+
+#include "VertexLayout.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <numbers>
+
+// Octahedral snorm16 normals are good to about 0.005 degrees.
+static const double kMaxNormalErrorDegrees = 0.02;
+
+// Half floats keep 11 significant bits, so rounding is off by at most half an ulp.
+static const double kMaxUVRelativeError = 1.0 / 2048;
+
+struct QuantizationError
+{
+    double NormalDegrees = 0.0;
+    double UVRelative = 0.0;
+};
+
+static QuantizationError MeasureQuantizationError(const Mesh& mesh)
+{
+    QuantizationError error{};
+
+    for (const glm::vec3& normal : mesh.Normals)
+    {
+        if (glm::length(normal) == 0.f)
+            continue;
+
+        glm::vec3 n = glm::normalize(normal);
+        glm::vec3 decoded = DecodeOctahedralNormal(EncodeOctahedralNormal(n));
+
+        // Measured as the distance between the unit vectors, in double, since acos of a float
+        // dot product can't resolve angles this small.
+        double dx = static_cast<double>(n.x) - decoded.x;
+        double dy = static_cast<double>(n.y) - decoded.y;
+        double dz = static_cast<double>(n.z) - decoded.z;
+
+        double chord = std::sqrt(dx * dx + dy * dy + dz * dz);
+        double angle = 2.0 * std::asin(std::min(chord / 2.0, 1.0));
+        error.NormalDegrees = std::max(error.NormalDegrees, angle * 180.0 / std::numbers::pi);
+    }
+
+    for (const glm::vec2& uv : mesh.UVs)
+    {
+        for (int i = 0; i < 2; ++i)
+        {
+            double value = uv[i];
+            double decoded = HalfToFloat(FloatToHalf(uv[i]));
+
+            // Absolute error below the smallest normal half, where the spacing stops shrinking.
+            double scale = std::max(std::abs(value), std::ldexp(1.0, -14));
+            error.UVRelative = std::max(error.UVRelative, std::abs(decoded - value) / scale);
+        }
+    }
+
+    return error;
+}
+
+int RunVertexLayoutBench(std::span<const std::string> args)
+{
+    auto files = CollectFiles(args, ".ply", kDefaultGeometryDir);
+
+    if (files.empty())
+        throw std::runtime_error("No ply files found.");
+
+    const VertexLayout layouts[] = {VertexLayout::Separate, VertexLayout::Interleaved,
+                                    VertexLayout::Quantized};
+
+    std::cout << std::left << std::setw(40) << "file" << std::right << std::setw(14) << "unpacked";
+
+    for (VertexLayout layout : layouts)
+        std::cout << std::setw(14) << GetVertexLayoutName(layout);
+
+    std::cout << std::setw(12) << "normal deg" << std::setw(12) << "uv rel" << std::endl;
+
+    bool withinBounds = true;
+
+    for (const auto& file : files)
+    {
+        Mesh mesh;
+        LoadMeshFromPlyFile(file, &mesh);
+
+        std::cout << std::left << std::setw(40) << file.filename().string() << std::right
+                  << std::setw(14) << GetUnpackedMeshSize(mesh);
+
+        for (VertexLayout layout : layouts)
+        {
+            VertexLayoutOptions options{};
+            options.Layout = layout;
+
+            std::cout << std::setw(14) << PackMesh(mesh, options).GetSize();
+        }
+
+        QuantizationError error = MeasureQuantizationError(mesh);
+
+        bool ok = error.NormalDegrees <= kMaxNormalErrorDegrees &&
+                  error.UVRelative <= kMaxUVRelativeError;
+        withinBounds = withinBounds && ok;
+
+        std::cout << std::scientific << std::setprecision(2) << std::setw(12)
+                  << error.NormalDegrees << std::setw(12) << error.UVRelative
+                  << (ok ? "" : "  OUT OF BOUNDS") << std::defaultfloat << std::endl;
+    }
+
+    return withinBounds ? 0 : 1;
+}
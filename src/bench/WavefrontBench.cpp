@@ -0,0 +1,163 @@
+#include "Bench.h"
+
+#include "CpuScene.h"
+#include "PathTracer.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+
+// The fastest of several renders, depth by depth.
+struct IntegratorResult
+{
+    // Of renders without RenderOptions::TimeDepths.
+    double Ms = 0.0;
+
+    std::vector<DepthStats> Depths;
+
+    std::vector<glm::vec3> Image;
+};
+
+IntegratorResult Render(const CpuScene& scene, const RenderOptions& options, ThreadPool* pool,
+                        uint32_t width, uint32_t height, int iterations)
+{
+    IntegratorResult result;
+
+    RenderOptions untimed = options;
+    untimed.TimeDepths = false;
+
+    for (int i = 0; i < iterations; ++i)
+    {
+        Film film(width, height);
+        double ms = TimeMs(1, [&] { RenderScene(scene, untimed, pool, &film); });
+
+        result.Ms = i == 0 ? ms : std::min(result.Ms, ms);
+    }
+
+    for (int i = 0; i < iterations; ++i)
+    {
+        Film film(width, height);
+        RenderStats stats = RenderScene(scene, options, pool, &film);
+
+        if (i == 0)
+        {
+            result.Depths = stats.Depths;
+            result.Image = film.Resolve();
+            continue;
+        }
+
+        for (size_t depthIdx = 0; depthIdx < stats.Depths.size(); ++depthIdx)
+        {
+            double& fastest = result.Depths[depthIdx].Ms;
+            fastest = std::min(fastest, stats.Depths[depthIdx].Ms);
+        }
+    }
+
+    return result;
+}
+
+void PrintThroughput(uint64_t rays, double ms)
+{
+    std::cout << std::setprecision(1) << std::setw(16) << ms << std::setw(20)
+              << rays / (ms * 1000.0);
+}
+
+} // namespace
+
+int RunWavefrontBench(std::span<const std::string> argSpan)
+{
+    std::vector<std::string> args(argSpan.begin(), argSpan.end());
+
+    int threadCount = TakeIntOption(&args, "--threads", 0);
+    int width = TakeIntOption(&args, "--width", 256);
+    int height = TakeIntOption(&args, "--height", 144);
+    int spp = TakeIntOption(&args, "--spp", 16);
+    int maxDepth = TakeIntOption(&args, "--max-depth", 5);
+    int waveSize = TakeIntOption(&args, "--wavefront-size", 4096);
+    int iterations = TakeIntOption(&args, "--iterations", 3);
+
+    if (width <= 0 || height <= 0 || spp <= 0 || maxDepth <= 0 || waveSize <= 0 ||
+        iterations <= 0)
+    {
+        throw std::runtime_error("Sizes, counts and depths must be positive.");
+    }
+
+    ThreadPool pool(static_cast<size_t>(threadCount));
+
+    CpuScene scene;
+    LoadCpuScene(GetPbrtBookScene(), &pool, &scene);
+
+    RenderOptions options;
+    options.SamplesPerPixel = static_cast<uint32_t>(spp);
+    options.WavefrontSize = static_cast<uint32_t>(waveSize);
+    options.MaxDepth = static_cast<uint32_t>(maxDepth);
+    options.TimeDepths = true;
+
+    SamplerTables sharedTables = GetSamplerTables(options.Sampler, 1, options.Seed, &pool);
+
+    IntegratorResult results[2];
+    const IntegratorType integrators[] = {IntegratorType::Megakernel, IntegratorType::Wavefront};
+
+    for (size_t i = 0; i < std::size(integrators); ++i)
+    {
+        options.Integrator = integrators[i];
+        results[i] = Render(scene, options, &pool, width, height, iterations);
+    }
+
+    const IntegratorResult& megakernel = results[0];
+    const IntegratorResult& wavefront = results[1];
+
+    bool identical = megakernel.Image == wavefront.Image;
+
+    std::cout << std::fixed << width << "x" << height << " at " << spp << " spp to depth "
+              << maxDepth << ", waves of " << waveSize << " paths, fastest of " << iterations
+              << " on " << pool.GetThreadCount() << " threads.\n"
+              << "A depth's rays are the camera or bounce rays traced at it and their shadow "
+              << "rays, its time that of tracing and shading them summed over the threads.\n"
+              << "The megakernel reads the clock at every bounce, which its depth times include, "
+              << "so the render times are the fair comparison.\n\n"
+              << std::left << std::setw(8) << "depth" << std::right << std::setw(12) << "rays";
+
+    for (IntegratorType integrator : integrators)
+    {
+        std::string name = GetIntegratorTypeName(integrator);
+        std::cout << std::setw(16) << name + " ms" << std::setw(20) << name + " Mrays/s";
+    }
+
+    std::cout << std::setw(10) << "speedup" << "\n";
+
+    uint64_t totalRays = 0;
+
+    for (size_t depthIdx = 0; depthIdx < megakernel.Depths.size(); ++depthIdx)
+    {
+        // Both integrators trace the same rays.
+        uint64_t rays = megakernel.Depths[depthIdx].Rays;
+        totalRays += rays;
+
+        std::cout << std::left << std::setw(8) << depthIdx + 1 << std::right << std::setw(12)
+                  << rays;
+
+        PrintThroughput(rays, megakernel.Depths[depthIdx].Ms);
+        PrintThroughput(rays, wavefront.Depths[depthIdx].Ms);
+
+        std::cout << std::setprecision(2) << std::setw(9)
+                  << megakernel.Depths[depthIdx].Ms / wavefront.Depths[depthIdx].Ms << "x\n";
+    }
+
+    // Wall time, which includes adding the samples to the film.
+    std::cout << std::left << std::setw(8) << "render" << std::right << std::setw(12)
+              << totalRays;
+
+    PrintThroughput(totalRays, megakernel.Ms);
+    PrintThroughput(totalRays, wavefront.Ms);
+
+    std::cout << std::setprecision(2) << std::setw(9) << megakernel.Ms / wavefront.Ms << "x\n\n"
+              << (identical ? "wavefront image identical to the megakernel one"
+                            : "wavefront image differs from the megakernel one  MISMATCH")
+              << std::endl;
+
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+#include "Bench.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+
+struct Benchmark
+{
+    const char* Name;
+    const char* Description;
+    int (*Run)(std::span<const std::string> args);
+};
+
+const Benchmark kBenchmarks[] = {
+    {"ply-load", "Native binary ply loader vs rply. Args: [files or dirs] [--iterations N]",
+     RunPlyLoadBench},
+    {"ply-ingest",
+     "Peak RSS of decoding into an upload block via sinks (default) or via Mesh vectors and a "
+     "copy. Args: <file> [--copy] [--max-ratio-percent N]",
+     RunPlyIngestBench},
+    {"scene-load",
+     "Serial vs thread pool loading of every ply file in a directory. Args: [files or dirs] "
+     "[--threads N]",
+     RunSceneLoadBench},
+    {"mesh-cache",
+     "Cold ply loads vs warm .pbrtmesh cache loads. Rebuilds the caches of the given files. "
+     "Args: [files or dirs] [--iterations N]",
+     RunMeshCacheBench},
+    {"mesh-optimize",
+     "Vertex welding, Morton triangle order and first-use vertex order. Checks that the result is "
+     "deterministic and keeps every triangle. Args: [files or dirs]",
+     RunMeshOptimizeBench},
+    {"vertex-layout",
+     "Packed size of each vertex layout and the round-trip error of quantized normals and uvs. "
+     "Fails if the error is out of bounds. Args: [files or dirs]",
+     RunVertexLayoutBench},
+    {"bvh",
+     "Serial vs parallel binned SAH BVH builds, tree quality and closest-hit trace rate, then the "
+     "same scene copied N times as instances of per-mesh BLASes vs flattened. Uses the pbrt-book "
+     "scene without args. Fails if the builds differ, the two-level hits differ from the flat "
+     "ones, or a degenerate input builds a tree deeper than the traversal stacks allow. "
+     "Args: [files or dirs] [--threads N] [--rays N] [--instances N]",
+     RunBvhBench},
+    {"ray-kernels",
+     "Primary, shadow and bounce ray rates of the pbrt-book scene with each BVH kernel the CPU "
+     "supports, shadow rays as any-hit occlusion queries, and camera ray packets. Fails if a "
+     "kernel's hits differ from the scalar ones or an occlusion query from its closest hit. "
+     "Args: [--width N] [--height N] [--threads N]",
+     RunRayKernelBench},
+    {"halton",
+     "Checks the shared Halton sampler against a transcription of pbrt-v4's, sample for sample, "
+     "and that pixels get their own strata, then times table generation and sampling. "
+     "Args: [--samples N] [--threads N]",
+     RunHaltonBench},
+    {"samplers",
+     "RMSE of the pbrt-book scene against a high sample count reference, by samples per pixel "
+     "and render time, for the Halton, padded Sobol and ZSobol samplers. Fails if a Sobol "
+     "sampler's pixel samples are not stratified or an error doesn't go down. "
+     "Args: [--width N] [--height N] [--reference-spp N] [--max-spp N] [--threads N]",
+     RunSamplerBench},
+    {"render-scaling",
+     "Render time of the pbrt-book scene on the CPU with 1, 2, 4, ... threads up to the hardware "
+     "thread count, and how many film tiles the scheduler moved between workers. Fails if the "
+     "image depends on the thread count. "
+     "Args: [--width N] [--height N] [--spp N] [--tile-size N] [--max-threads N]",
+     RunRenderScalingBench},
+    {"film-precision",
+     "Error of a pixel's mean after thousands of samples, kept as the old 8-bit running mean, a "
+     "float running mean, a float sum or the compensated sum of FilmAccumulator. Fails if the "
+     "compensated mean is off by more than FLT_EPSILON. Args: [--samples N] [--pixels N]",
+     RunFilmPrecisionBench},
+    {"adaptive",
+     "Time to quality of adaptive sampling against uniform sampling on the pbrt-book scene: the "
+     "RMSE against a reference of uniform renders and of adaptive ones at several error "
+     "thresholds, with the time uniform sampling takes to the same RMSE. Fails if a pixel gets "
+     "fewer samples than a batch or more than the maximum. Args: [--width N] [--height N] "
+     "[--reference-spp N] [--max-spp N] [--batch N] [--threads N]",
+     RunAdaptiveBench},
+    {"wavefront",
+     "Time and ray throughput of the megakernel and the wavefront integrator at each path depth "
+     "of the pbrt-book scene, and of whole renders. Fails if the two images differ. "
+     "Args: [--width N] [--height N] [--spp N] [--max-depth N] [--wavefront-size N] "
+     "[--iterations N] [--threads N]",
+     RunWavefrontBench},
+    {"ray-sorting",
+     "Render time of the pbrt-book scene with the wavefront integrator at several wave sizes, "
+     "with and without sorting bounce and shadow rays by origin cell and direction octant, with "
+     "the time per node visited and cache misses per ray where hardware counters allow. Fails if "
+     "sorting changes the image or the nodes visited. Args: [--width N] [--height N] [--spp N] "
+     "[--max-depth N] [--max-wavefront-size N] [--iterations N] [--threads N]",
+     RunRaySortBench},
+    {"roulette",
+     "Rays per pixel, variance and render time of the pbrt-book scene at path depths 3, 8 and "
+     "16, with and without Russian roulette. Fails if roulette moves the image's mean luminance "
+     "by more than its noise, or if the integrators' images with roulette differ. "
+     "Args: [--width N] [--height N] [--spp N] [--roulette-depth N] [--threads N]",
+     RunRouletteBench},
+    {"light-sampling",
+     "Time to equal noise of sampling every light, lights by power from an alias table and lights "
+     "down a light BVH, with 2, 64 and 4096 lights in the pbrt-book scene. Fails if a sampler "
+     "moves the image's mean luminance from the reference's by more than their noise, or if the "
+     "integrators' images differ. Args: [--width N] [--height N] [--spp N] [--reference-spp N] "
+     "[--threads N]",
+     RunLightSamplingBench},
+    {"pbrt-parse",
+     "Parses a generated pbrt-v4 scene that imports a trianglemesh from each of several files, "
+     "with the imports parsed one after another and in parallel. Fails if the scenes differ. "
+     "Args: [--files N] [--triangles N] [--iterations N] [--threads N]",
+     RunPbrtParseBench},
+    {"scene-snapshot",
+     "Time to load the pbrt-book scene, or a pbrt-v4 scene, from its sources through the mesh "
+     "cache against mapping a .pbrtscene snapshot of it. Fails if the snapshot doesn't round trip "
+     "every array, if a truncated snapshot or one with an index out of range loads, or if the "
+     "images rendered from the sources and the snapshot differ. "
+     "Args: [file.pbrt] [--iterations N] [--threads N]",
+     RunSceneSnapshotBench},
+    {"texture-decode",
+     "Decode time of png, jpeg and exr files, the pbrt-book textures by default: decoding into a "
+     "tightly packed image and copying its rows to the pitch of an upload buffer, decoding at "
+     "that pitch in place, and decoding the files in parallel. Fails if the images differ or a "
+     "decode writes into the padding of a row. Args: [files or dirs] [--iterations N] "
+     "[--threads N]",
+     RunTextureDecodeBench},
+    {"texture-lod",
+     "Mip chain generation time of the pbrt-book textures, serial and in parallel, and the "
+     "texture traffic of the camera hits through a simulated texture cache and the render time, "
+     "reading mip 0 and picking levels with ray cones. Fails if the chains differ serial and in "
+     "parallel, a level's mean drifts from the first level's, ray cones fetch more than mip 0 or "
+     "the wavefront image differs from the megakernel one. Args: [--width N] [--height N] "
+     "[--spp N] [--iterations N] [--threads N]",
+     RunTextureLodBench},
+};
+
+void PrintUsage()
+{
+    std::cout << "Usage: PbrtBench <benchmark> [args...]\n\nBenchmarks:\n";
+
+    for (const auto& benchmark : kBenchmarks)
+        std::cout << "  " << benchmark.Name << "\n      " << benchmark.Description << "\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    std::vector<std::string> args(argv + 2, argv + argc);
+
+    for (const auto& benchmark : kBenchmarks)
+    {
+        if (strcmp(argv[1], benchmark.Name) != 0)
+            continue;
+
+        try
+        {
+            return benchmark.Run(args);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << benchmark.Name << ": " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    PrintUsage();
+    return 1;
+}
@@ -0,0 +1,866 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+void TransformTriangles(const Mesh& mesh, const glm::mat4& transform, uint32_t geometryIdx,
+                        std::span<BvhTriangle> triangles)
+{
+    TransformTriangles(mesh.Positions, mesh.Indices, transform, geometryIdx, triangles);
+}
+
+void TransformTriangles(std::span<const glm::vec3> positions, std::span<const uint32_t> indices,
+                        const glm::mat4& transform, uint32_t geometryIdx,
+                        std::span<BvhTriangle> triangles)
+{
+    auto toWorld = [&](uint32_t index) {
+        return glm::vec3(transform * glm::vec4(positions[index], 1.f));
+    };
+
+    for (size_t tri = 0; tri < triangles.size(); ++tri)
+    {
+        BvhTriangle& triangle = triangles[tri];
+        triangle.V0 = toWorld(indices[tri * 3]);
+        triangle.V1 = toWorld(indices[tri * 3 + 1]);
+        triangle.V2 = toWorld(indices[tri * 3 + 2]);
+        triangle.GeometryIdx = geometryIdx;
+        triangle.PrimitiveIdx = static_cast<uint32_t>(tri);
+    }
+}
+
+namespace
+{
+
+constexpr int kBinCount = 16;
+
+// Cost of visiting a node, relative to testing a triangle.
+constexpr float kTraversalCost = 1.f;
+
+// Nodes below this many levels split their range at its object median rather than by SAH, which
+// halves it, so that trees of up to 2^32 primitives stay within kBvhMaxDepth levels.
+constexpr uint32_t kMaxSahDepth = 32;
+
+// Ranges at least this large are binned in parallel chunks of this size while splitting the upper
+// levels.
+constexpr uint32_t kParallelChunkSize = 1 << 16;
+
+struct Bin
+{
+    Aabb Bounds;
+    uint32_t Count = 0;
+};
+
+// Per-axis bins of a range, along with the bounds of the whole range.
+struct RangeBins
+{
+    Aabb Bounds;
+    Bin Bins[3][kBinCount];
+};
+
+struct BuildInput
+{
+    std::span<const Aabb> PrimitiveBounds;
+    std::vector<glm::vec3> Centroids;
+
+    // Primitive indices. Each node owns a contiguous range, which its split partitions.
+    std::vector<uint32_t> Order;
+};
+
+Aabb GetCentroidBounds(const BuildInput& input, uint32_t first, uint32_t count)
+{
+    Aabb bounds;
+
+    for (uint32_t i = first; i < first + count; ++i)
+        bounds.Grow(input.Centroids[input.Order[i]]);
+
+    return bounds;
+}
+
+int GetBinIdx(glm::vec3 centroid, const Aabb& centroidBounds, int axis)
+{
+    float extent = centroidBounds.Max[axis] - centroidBounds.Min[axis];
+    float offset = (centroid[axis] - centroidBounds.Min[axis]) / extent;
+
+    return std::min(static_cast<int>(offset * kBinCount), kBinCount - 1);
+}
+
+void BinRange(const BuildInput& input, uint32_t first, uint32_t count,
+              const Aabb& centroidBounds, RangeBins* bins)
+{
+    for (uint32_t i = first; i < first + count; ++i)
+    {
+        uint32_t primIdx = input.Order[i];
+
+        const Aabb& primBounds = input.PrimitiveBounds[primIdx];
+        bins->Bounds.Grow(primBounds);
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (centroidBounds.Max[axis] <= centroidBounds.Min[axis])
+                continue;
+
+            int binIdx = GetBinIdx(input.Centroids[primIdx], centroidBounds, axis);
+
+            Bin& bin = bins->Bins[axis][binIdx];
+            bin.Bounds.Grow(primBounds);
+            ++bin.Count;
+        }
+    }
+}
+
+// Bins the range, in parallel chunks when a pool is given and the range is large. Merging the
+// chunks gives exactly the same bins as a serial pass.
+RangeBins BinRangeParallel(const BuildInput& input, uint32_t first, uint32_t count,
+                           const Aabb& centroidBounds, ThreadPool* pool)
+{
+    RangeBins bins{};
+
+    if (!pool || count < kParallelChunkSize * 2)
+    {
+        BinRange(input, first, count, centroidBounds, &bins);
+        return bins;
+    }
+
+    size_t chunkCount = (count + kParallelChunkSize - 1) / kParallelChunkSize;
+    std::vector<RangeBins> chunkBins(chunkCount);
+
+    pool->ParallelFor(chunkCount, [&](size_t chunkIdx) {
+        uint32_t chunkFirst = first + static_cast<uint32_t>(chunkIdx) * kParallelChunkSize;
+        uint32_t chunkSize = std::min(kParallelChunkSize, first + count - chunkFirst);
+
+        BinRange(input, chunkFirst, chunkSize, centroidBounds, &chunkBins[chunkIdx]);
+    });
+
+    for (const auto& chunk : chunkBins)
+    {
+        bins.Bounds.Grow(chunk.Bounds);
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            for (int binIdx = 0; binIdx < kBinCount; ++binIdx)
+            {
+                bins.Bins[axis][binIdx].Bounds.Grow(chunk.Bins[axis][binIdx].Bounds);
+                bins.Bins[axis][binIdx].Count += chunk.Bins[axis][binIdx].Count;
+            }
+        }
+    }
+
+    return bins;
+}
+
+// Picks the cheapest binned split of the range of a node at the given level, the root's being 1,
+// and partitions it. Returns false if the range should become a leaf. Otherwise order[first, mid)
+// holds the left child.
+bool SplitRange(BuildInput* input, uint32_t first, uint32_t count, uint32_t depth,
+                ThreadPool* pool, Aabb* bounds, uint32_t* mid)
+{
+    Aabb centroidBounds = GetCentroidBounds(*input, first, count);
+
+    RangeBins bins = BinRangeParallel(*input, first, count, centroidBounds, pool);
+    *bounds = bins.Bounds;
+
+    if (count == 1)
+        return false;
+
+    if (depth > kMaxSahDepth)
+    {
+        if (count <= kBvhMaxLeafSize)
+            return false;
+
+        glm::vec3 extent = centroidBounds.Max - centroidBounds.Min;
+        int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+
+        auto begin = input->Order.begin() + first;
+
+        std::nth_element(begin, begin + count / 2, begin + count, [&](uint32_t a, uint32_t b) {
+            return input->Centroids[a][axis] < input->Centroids[b][axis];
+        });
+
+        *mid = first + count / 2;
+        return true;
+    }
+
+    float bestCost = std::numeric_limits<float>::max();
+    int bestAxis = -1;
+    int bestBin = 0;
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        if (centroidBounds.Max[axis] <= centroidBounds.Min[axis])
+            continue;
+
+        // Sweep from the right to get the cost of everything right of each boundary.
+        float rightCosts[kBinCount] = {};
+
+        Aabb rightBounds;
+        uint32_t rightCount = 0;
+
+        for (int binIdx = kBinCount - 1; binIdx > 0; --binIdx)
+        {
+            rightBounds.Grow(bins.Bins[axis][binIdx].Bounds);
+            rightCount += bins.Bins[axis][binIdx].Count;
+
+            rightCosts[binIdx] = rightBounds.HalfArea() * rightCount;
+        }
+
+        Aabb leftBounds;
+        uint32_t leftCount = 0;
+
+        for (int binIdx = 1; binIdx < kBinCount; ++binIdx)
+        {
+            leftBounds.Grow(bins.Bins[axis][binIdx - 1].Bounds);
+            leftCount += bins.Bins[axis][binIdx - 1].Count;
+
+            if (leftCount == 0 || leftCount == count)
+                continue;
+
+            float cost = leftBounds.HalfArea() * leftCount + rightCosts[binIdx];
+
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = binIdx;
+            }
+        }
+    }
+
+    float nodeArea = bounds->HalfArea();
+
+    if (bestAxis >= 0 && nodeArea > 0.f)
+        bestCost = kTraversalCost + bestCost / nodeArea;
+
+    float leafCost = static_cast<float>(count);
+
+    if (count <= kBvhMaxLeafSize && (bestAxis < 0 || leafCost <= bestCost))
+        return false;
+
+    auto begin = input->Order.begin() + first;
+
+    if (bestAxis < 0)
+    {
+        // Every centroid is in the same place, so no plane separates them.
+        *mid = first + count / 2;
+        return true;
+    }
+
+    auto split = std::partition(begin, begin + count, [&](uint32_t primIdx) {
+        return GetBinIdx(input->Centroids[primIdx], centroidBounds, bestAxis) < bestBin;
+    });
+
+    *mid = first + static_cast<uint32_t>(split - begin);
+
+    return true;
+}
+
+// Appends the subtree for order[first, first + count) to nodes, depth-first, and returns the
+// index of its root.
+uint32_t BuildSubtree(BuildInput* input, uint32_t first, uint32_t count, uint32_t depth,
+                      std::vector<BvhNode>* nodes)
+{
+    uint32_t nodeIdx = static_cast<uint32_t>(nodes->size());
+    nodes->emplace_back();
+
+    Aabb bounds;
+    uint32_t mid = 0;
+
+    bool split = SplitRange(input, first, count, depth, nullptr, &bounds, &mid);
+
+    (*nodes)[nodeIdx].Min = bounds.Min;
+    (*nodes)[nodeIdx].Max = bounds.Max;
+
+    if (!split)
+    {
+        (*nodes)[nodeIdx].Offset = first;
+        (*nodes)[nodeIdx].PrimitiveCount = count;
+        return nodeIdx;
+    }
+
+    BuildSubtree(input, first, mid - first, depth + 1, nodes);
+    uint32_t rightIdx = BuildSubtree(input, mid, first + count - mid, depth + 1, nodes);
+
+    (*nodes)[nodeIdx].Offset = rightIdx;
+
+    return nodeIdx;
+}
+
+// Upper levels of the tree, whose leaves are subtrees that are built in parallel.
+struct TopNode
+{
+    Aabb Bounds;
+
+    int Left = -1;
+    int Right = -1;
+
+    int SubtreeIdx = -1;
+};
+
+struct Subtree
+{
+    uint32_t First = 0;
+    uint32_t Count = 0;
+    uint32_t Depth = 0;
+
+    std::vector<BvhNode> Nodes;
+};
+
+int BuildTop(BuildInput* input, uint32_t first, uint32_t count, uint32_t depth,
+             uint32_t subtreeSize, ThreadPool* pool, std::vector<TopNode>* topNodes,
+             std::vector<Subtree>* subtrees)
+{
+    int nodeIdx = static_cast<int>(topNodes->size());
+    topNodes->emplace_back();
+
+    Aabb bounds;
+    uint32_t mid = 0;
+
+    if (count <= subtreeSize || !SplitRange(input, first, count, depth, pool, &bounds, &mid))
+    {
+        (*topNodes)[nodeIdx].SubtreeIdx = static_cast<int>(subtrees->size());
+        subtrees->push_back({first, count, depth, {}});
+        return nodeIdx;
+    }
+
+    int left = BuildTop(input, first, mid - first, depth + 1, subtreeSize, pool, topNodes,
+                        subtrees);
+    int right = BuildTop(input, mid, first + count - mid, depth + 1, subtreeSize, pool, topNodes,
+                         subtrees);
+
+    (*topNodes)[nodeIdx].Bounds = bounds;
+    (*topNodes)[nodeIdx].Left = left;
+    (*topNodes)[nodeIdx].Right = right;
+
+    return nodeIdx;
+}
+
+// Writes the top node and everything below it to nodes, depth-first.
+uint32_t FlattenTop(const std::vector<TopNode>& topNodes, const std::vector<Subtree>& subtrees,
+                    int topIdx, std::vector<BvhNode>* nodes)
+{
+    const TopNode& top = topNodes[topIdx];
+
+    uint32_t nodeIdx = static_cast<uint32_t>(nodes->size());
+
+    if (top.SubtreeIdx >= 0)
+    {
+        for (BvhNode node : subtrees[top.SubtreeIdx].Nodes)
+        {
+            if (node.PrimitiveCount == 0)
+                node.Offset += nodeIdx;
+
+            nodes->push_back(node);
+        }
+
+        return nodeIdx;
+    }
+
+    BvhNode& node = nodes->emplace_back();
+    node.Min = top.Bounds.Min;
+    node.Max = top.Bounds.Max;
+
+    FlattenTop(topNodes, subtrees, top.Left, nodes);
+    uint32_t rightIdx = FlattenTop(topNodes, subtrees, top.Right, nodes);
+
+    (*nodes)[nodeIdx].Offset = rightIdx;
+
+    return nodeIdx;
+}
+
+// Writes the triangles to packs of Width, padding the last one with degenerate triangles.
+template<int Width>
+void EmitPacks(std::span<const BvhTriangle> triangles, std::vector<TrianglePack<Width>>* packs)
+{
+    for (size_t first = 0; first < triangles.size(); first += Width)
+    {
+        TrianglePack<Width>& pack = packs->emplace_back();
+
+        for (size_t lane = 0; lane < Width && first + lane < triangles.size(); ++lane)
+        {
+            const BvhTriangle& tri = triangles[first + lane];
+
+            glm::vec3 e1 = tri.V1 - tri.V0;
+            glm::vec3 e2 = tri.V2 - tri.V0;
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                pack.V0[axis][lane] = tri.V0[axis];
+                pack.E1[axis][lane] = e1[axis];
+                pack.E2[axis][lane] = e2[axis];
+            }
+
+            pack.GeometryIdx[lane] = tri.GeometryIdx;
+            pack.PrimitiveIdx[lane] = tri.PrimitiveIdx;
+        }
+    }
+}
+
+// Appends a wide node for the binary node, depth-first, and returns its index. Its children are
+// found by repeatedly opening the interior child with the largest surface area.
+template<int Width>
+uint32_t CollapseNode(std::span<const BvhNode> nodes, std::span<const BvhTriangle> triangles,
+                      uint32_t nodeIdx, WideBvh<Width>* wide)
+{
+    uint32_t children[Width] = {nodeIdx};
+    int childCount = 1;
+
+    if (nodes[nodeIdx].PrimitiveCount == 0)
+    {
+        children[0] = nodeIdx + 1;
+        children[1] = nodes[nodeIdx].Offset;
+        childCount = 2;
+    }
+
+    while (childCount < Width)
+    {
+        int best = -1;
+        float bestArea = -1.f;
+
+        for (int i = 0; i < childCount; ++i)
+        {
+            const BvhNode& child = nodes[children[i]];
+
+            if (child.PrimitiveCount > 0)
+                continue;
+
+            Aabb bounds{child.Min, child.Max};
+
+            if (bounds.HalfArea() > bestArea)
+            {
+                best = i;
+                bestArea = bounds.HalfArea();
+            }
+        }
+
+        if (best < 0)
+            break;
+
+        uint32_t opened = children[best];
+        children[best] = opened + 1;
+        children[childCount++] = nodes[opened].Offset;
+    }
+
+    uint32_t wideIdx = static_cast<uint32_t>(wide->Nodes.size());
+
+    {
+        WideBvhNode<Width>& wideNode = wide->Nodes.emplace_back();
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            std::fill_n(wideNode.Min[axis], Width, std::numeric_limits<float>::infinity());
+            std::fill_n(wideNode.Max[axis], Width, -std::numeric_limits<float>::infinity());
+        }
+    }
+
+    for (int i = 0; i < childCount; ++i)
+    {
+        const BvhNode& child = nodes[children[i]];
+
+        uint32_t offset = 0;
+        uint32_t packCount = 0;
+
+        if (child.PrimitiveCount > 0)
+        {
+            offset = static_cast<uint32_t>(wide->Packs.size());
+            EmitPacks(triangles.subspan(child.Offset, child.PrimitiveCount), &wide->Packs);
+            packCount = static_cast<uint32_t>(wide->Packs.size()) - offset;
+        }
+        else
+        {
+            offset = CollapseNode(nodes, triangles, children[i], wide);
+        }
+
+        // The recursion may have reallocated the nodes.
+        WideBvhNode<Width>& wideNode = wide->Nodes[wideIdx];
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            wideNode.Min[axis][i] = child.Min[axis];
+            wideNode.Max[axis][i] = child.Max[axis];
+        }
+
+        wideNode.Offset[i] = offset;
+        wideNode.PackCount[i] = packCount;
+    }
+
+    return wideIdx;
+}
+
+template<int Width>
+void CollapseBvh(std::span<const BvhNode> nodes, std::span<const BvhTriangle> triangles,
+                 WideBvh<Width>* wide)
+{
+    *wide = {};
+
+    if (nodes.empty())
+        return;
+
+    wide->Nodes.reserve(nodes.size() / 2 / (Width / 2) + 1);
+    wide->Packs.reserve(triangles.size() / Width + 1);
+
+    CollapseNode(nodes, triangles, 0, wide);
+
+    wide->Nodes.shrink_to_fit();
+    wide->Packs.shrink_to_fit();
+}
+
+} // namespace
+
+void BuildBvhNodes(std::span<const Aabb> primitiveBounds, ThreadPool* pool,
+                   std::vector<BvhNode>* nodes, std::vector<uint32_t>* order)
+{
+    nodes->clear();
+    order->clear();
+
+    if (primitiveBounds.empty())
+        return;
+
+    uint32_t primitiveCount = static_cast<uint32_t>(primitiveBounds.size());
+
+    BuildInput input{};
+    input.PrimitiveBounds = primitiveBounds;
+    input.Centroids.resize(primitiveCount);
+    input.Order.resize(primitiveCount);
+
+    std::iota(input.Order.begin(), input.Order.end(), 0);
+
+    for (uint32_t i = 0; i < primitiveCount; ++i)
+        input.Centroids[i] = (primitiveBounds[i].Min + primitiveBounds[i].Max) * 0.5f;
+
+    // Aim for several subtrees per thread, so that uneven ones balance out.
+    uint32_t subtreeSize = primitiveCount;
+
+    if (pool && pool->GetThreadCount() > 1)
+    {
+        subtreeSize = std::max(primitiveCount / static_cast<uint32_t>(pool->GetThreadCount() * 8),
+                               kBvhMaxLeafSize);
+    }
+
+    std::vector<TopNode> topNodes;
+    std::vector<Subtree> subtrees;
+
+    BuildTop(&input, 0, primitiveCount, 1, subtreeSize, pool, &topNodes, &subtrees);
+
+    auto buildSubtree = [&](size_t subtreeIdx) {
+        Subtree& subtree = subtrees[subtreeIdx];
+        BuildSubtree(&input, subtree.First, subtree.Count, subtree.Depth, &subtree.Nodes);
+    };
+
+    if (pool)
+    {
+        pool->ParallelFor(subtrees.size(), buildSubtree);
+    }
+    else
+    {
+        for (size_t subtreeIdx = 0; subtreeIdx < subtrees.size(); ++subtreeIdx)
+            buildSubtree(subtreeIdx);
+    }
+
+    nodes->reserve(primitiveCount / 2);
+
+    FlattenTop(topNodes, subtrees, 0, nodes);
+
+    nodes->shrink_to_fit();
+
+    *order = std::move(input.Order);
+}
+
+BvhStats ComputeBvhStats(std::span<const BvhNode> nodes)
+{
+    BvhStats stats{};
+    stats.NodeCount = nodes.size();
+
+    if (nodes.empty())
+        return stats;
+
+    auto halfArea = [](const BvhNode& node) {
+        glm::vec3 extent = node.Max - node.Min;
+        return static_cast<double>(extent.x) * extent.y + static_cast<double>(extent.y) * extent.z +
+               static_cast<double>(extent.z) * extent.x;
+    };
+
+    double rootArea = halfArea(nodes[0]);
+
+    struct StackEntry
+    {
+        uint32_t NodeIdx;
+        uint32_t Depth;
+    };
+
+    std::vector<StackEntry> stack = {{0, 1}};
+
+    while (!stack.empty())
+    {
+        StackEntry entry = stack.back();
+        stack.pop_back();
+
+        const BvhNode& node = nodes[entry.NodeIdx];
+
+        stats.MaxDepth = std::max(stats.MaxDepth, entry.Depth);
+
+        double relativeArea = rootArea > 0.0 ? halfArea(node) / rootArea : 1.0;
+
+        if (node.PrimitiveCount > 0)
+        {
+            ++stats.LeafCount;
+            ++stats.LeafSizes[std::min(node.PrimitiveCount, kBvhMaxLeafSize)];
+
+            stats.SahCost += relativeArea * node.PrimitiveCount;
+            continue;
+        }
+
+        stats.SahCost += relativeArea * kTraversalCost;
+
+        stack.push_back({entry.NodeIdx + 1, entry.Depth + 1});
+        stack.push_back({node.Offset, entry.Depth + 1});
+    }
+
+    return stats;
+}
+
+void Bvh::Build(std::vector<BvhTriangle> triangles, ThreadPool* pool)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<Aabb> triangleBounds(triangles.size());
+
+    auto computeBounds = [&](size_t chunkIdx) {
+        size_t chunkFirst = chunkIdx * kParallelChunkSize;
+        size_t chunkEnd = std::min(chunkFirst + kParallelChunkSize, triangles.size());
+
+        for (size_t i = chunkFirst; i < chunkEnd; ++i)
+        {
+            triangleBounds[i].Grow(triangles[i].V0);
+            triangleBounds[i].Grow(triangles[i].V1);
+            triangleBounds[i].Grow(triangles[i].V2);
+        }
+    };
+
+    size_t chunkCount = (triangles.size() + kParallelChunkSize - 1) / kParallelChunkSize;
+
+    if (pool)
+    {
+        pool->ParallelFor(chunkCount, computeBounds);
+    }
+    else
+    {
+        for (size_t chunkIdx = 0; chunkIdx < chunkCount; ++chunkIdx)
+            computeBounds(chunkIdx);
+    }
+
+    std::vector<uint32_t> order;
+    BuildBvhNodes(triangleBounds, pool, &m_nodes, &order);
+
+    m_triangles.clear();
+    m_triangles.reserve(order.size());
+
+    for (uint32_t triIdx : order)
+        m_triangles.push_back(triangles[triIdx]);
+
+    SetKernel(m_kernel);
+
+    m_buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+                    .count();
+}
+
+void Bvh::SetKernel(BvhKernel kernel)
+{
+    if (!IsBvhKernelSupported(kernel))
+        throw std::runtime_error("This CPU doesn't support the BVH kernel.");
+
+    m_kernel = kernel;
+
+    m_wide4 = {};
+    m_wide8 = {};
+
+    if (kernel == BvhKernel::Sse)
+        CollapseBvh(m_nodes, m_triangles, &m_wide4);
+    else if (kernel == BvhKernel::Avx2)
+        CollapseBvh(m_nodes, m_triangles, &m_wide8);
+}
+
+Aabb Bvh::GetBounds() const
+{
+    Aabb bounds;
+
+    if (!m_nodes.empty())
+    {
+        bounds.Min = m_nodes[0].Min;
+        bounds.Max = m_nodes[0].Max;
+    }
+
+    return bounds;
+}
+
+size_t Bvh::GetMemoryBytes() const
+{
+    return m_nodes.size() * sizeof(BvhNode) + m_triangles.size() * sizeof(BvhTriangle) +
+           m_wide4.Nodes.size() * sizeof(WideBvhNode<4>) +
+           m_wide4.Packs.size() * sizeof(TrianglePack<4>) +
+           m_wide8.Nodes.size() * sizeof(WideBvhNode<8>) +
+           m_wide8.Packs.size() * sizeof(TrianglePack<8>);
+}
+
+BvhStats Bvh::GetStats() const
+{
+    BvhStats stats = ComputeBvhStats(m_nodes);
+    stats.BuildMs = m_buildMs;
+
+    return stats;
+}
+
+// Moller-Trumbore. The determinant is positive for front faces.
+static bool IntersectTriangle(const BvhTriangle& tri, const Ray& ray, FaceCulling culling,
+                              float tMax, float* t, glm::vec2* barycentrics)
+{
+    glm::vec3 e1 = tri.V1 - tri.V0;
+    glm::vec3 e2 = tri.V2 - tri.V0;
+
+    glm::vec3 p = glm::cross(ray.Direction, e2);
+    float det = glm::dot(e1, p);
+
+    if (det == 0.f || (culling == FaceCulling::Back && det < 0.f) ||
+        (culling == FaceCulling::Front && det > 0.f))
+    {
+        return false;
+    }
+
+    float invDet = 1.f / det;
+
+    glm::vec3 s = ray.Origin - tri.V0;
+    float u = glm::dot(s, p) * invDet;
+
+    if (u < 0.f || u > 1.f)
+        return false;
+
+    glm::vec3 q = glm::cross(s, e1);
+    float v = glm::dot(ray.Direction, q) * invDet;
+
+    if (v < 0.f || u + v > 1.f)
+        return false;
+
+    float hitT = glm::dot(e2, q) * invDet;
+
+    if (hitT < ray.TMin || hitT > tMax)
+        return false;
+
+    *t = hitT;
+    *barycentrics = glm::vec2(u, v);
+
+    return true;
+}
+
+bool Bvh::Intersect(const Ray& ray, FaceCulling culling, RayHit* hit) const
+{
+    if (m_kernel == BvhKernel::Sse)
+        return IntersectSse(m_wide4, ray, culling, hit);
+
+    if (m_kernel == BvhKernel::Avx2)
+        return IntersectAvx2(m_wide8, ray, culling, hit);
+
+    return Intersect(ray, culling, hit, nullptr);
+}
+
+bool Bvh::Intersect(const Ray& ray, FaceCulling culling, RayHit* hit,
+                    uint64_t* visitedNodes) const
+{
+    float closestT = ray.TMax;
+    bool found = false;
+
+    TraverseBvh(m_nodes, ray, &closestT, [&](const BvhNode& node, float* tMax) {
+        for (uint32_t i = node.Offset; i < node.Offset + node.PrimitiveCount; ++i)
+        {
+            float t = 0.f;
+            glm::vec2 barycentrics;
+
+            if (!IntersectTriangle(m_triangles[i], ray, culling, *tMax, &t, &barycentrics))
+                continue;
+
+            *tMax = t;
+            found = true;
+
+            hit->T = t;
+            hit->Barycentrics = barycentrics;
+            hit->GeometryIdx = m_triangles[i].GeometryIdx;
+            hit->PrimitiveIdx = m_triangles[i].PrimitiveIdx;
+        }
+
+        return false;
+    }, visitedNodes);
+
+    return found;
+}
+
+bool Bvh::Occluded(const Ray& ray, FaceCulling culling) const
+{
+    if (m_kernel == BvhKernel::Sse)
+        return OccludedSse(m_wide4, ray, culling);
+
+    if (m_kernel == BvhKernel::Avx2)
+        return OccludedAvx2(m_wide8, ray, culling);
+
+    return Occluded(ray, culling, nullptr);
+}
+
+bool Bvh::Occluded(const Ray& ray, FaceCulling culling, uint64_t* visitedNodes) const
+{
+    float closestT = ray.TMax;
+    bool occluded = false;
+
+    TraverseBvh(m_nodes, ray, &closestT, [&](const BvhNode& node, float* tMax) {
+        for (uint32_t i = node.Offset; i < node.Offset + node.PrimitiveCount; ++i)
+        {
+            float t = 0.f;
+            glm::vec2 barycentrics;
+
+            if (IntersectTriangle(m_triangles[i], ray, culling, *tMax, &t, &barycentrics))
+            {
+                occluded = true;
+                return true;
+            }
+        }
+
+        return false;
+    }, visitedNodes);
+
+    return occluded;
+}
+
+uint32_t Bvh::IntersectPacket(std::span<const Ray> rays, uint32_t activeMask, FaceCulling culling,
+                              RayHit* hits) const
+{
+    size_t rayCount = std::min<size_t>(rays.size(), kMaxPacketSize);
+    activeMask &= (1u << rayCount) - 1;
+
+    uint32_t hitMask = 0;
+
+    if (m_kernel == BvhKernel::Avx2)
+        return IntersectPacketAvx2(m_wide8, rays.data(), activeMask, culling, hits);
+
+    if (m_kernel == BvhKernel::Sse)
+    {
+        for (uint32_t first = 0; first < rayCount; first += 4)
+        {
+            uint32_t laneMask = (activeMask >> first) & 0xf;
+
+            if (laneMask != 0)
+            {
+                hitMask |= IntersectPacketSse(m_wide4, rays.data() + first, laneMask, culling,
+                                              hits + first)
+                           << first;
+            }
+        }
+
+        return hitMask;
+    }
+
+    for (uint32_t lane = 0; lane < rayCount; ++lane)
+    {
+        if ((activeMask & (1u << lane)) && Intersect(rays[lane], culling, &hits[lane]))
+            hitMask |= 1u << lane;
+    }
+
+    return hitMask;
+}
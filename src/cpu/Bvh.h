@@ -0,0 +1,261 @@
+#pragma once
+
+#include "Mesh.h"
+#include "Ray.h"
+#include "ThreadPool.h"
+#include "WideBvh.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <span>
+#include <vector>
+
+// A triangle and where it came from.
+struct BvhTriangle
+{
+    glm::vec3 V0;
+    glm::vec3 V1;
+    glm::vec3 V2;
+
+    uint32_t GeometryIdx = 0;
+    uint32_t PrimitiveIdx = 0;
+};
+
+// Writes the mesh's triangles, transformed by transform, to triangles, which must hold exactly
+// Indices.size() / 3 of them.
+void TransformTriangles(const Mesh& mesh, const glm::mat4& transform, uint32_t geometryIdx,
+                        std::span<BvhTriangle> triangles);
+
+void TransformTriangles(std::span<const glm::vec3> positions, std::span<const uint32_t> indices,
+                        const glm::mat4& transform, uint32_t geometryIdx,
+                        std::span<BvhTriangle> triangles);
+
+struct Aabb
+{
+    glm::vec3 Min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 Max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    void Grow(glm::vec3 p)
+    {
+        Min = glm::min(Min, p);
+        Max = glm::max(Max, p);
+    }
+
+    void Grow(const Aabb& other)
+    {
+        Min = glm::min(Min, other.Min);
+        Max = glm::max(Max, other.Max);
+    }
+
+    float HalfArea() const
+    {
+        glm::vec3 extent = Max - Min;
+
+        if (extent.x < 0.f)
+            return 0.f;
+
+        return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+    }
+};
+
+static constexpr uint32_t kBvhMaxLeafSize = 8;
+
+// Nodes are stored depth-first: the first child of an interior node directly follows it.
+struct alignas(32) BvhNode
+{
+    glm::vec3 Min;
+
+    // First primitive for leaves, the second child for interior nodes.
+    uint32_t Offset = 0;
+
+    glm::vec3 Max;
+
+    // Zero for interior nodes.
+    uint32_t PrimitiveCount = 0;
+};
+
+static_assert(sizeof(BvhNode) == 32);
+
+// Builds a binned SAH tree over primitives with the given bounds. Leaves refer to ranges of
+// order, which lists primitive indices. The upper levels are split on the calling thread, with
+// their binning spread over the pool, and the subtrees below them are then built in parallel.
+// Without a pool everything is built on the calling thread. The result is the same either way.
+void BuildBvhNodes(std::span<const Aabb> primitiveBounds, ThreadPool* pool,
+                   std::vector<BvhNode>* nodes, std::vector<uint32_t>* order);
+
+struct BvhStats
+{
+    double BuildMs = 0.0;
+
+    // Expected cost of tracing a ray that hits the root, counting a node visit and a primitive
+    // test as 1 each.
+    double SahCost = 0.0;
+
+    uint32_t MaxDepth = 0;
+    size_t NodeCount = 0;
+    size_t LeafCount = 0;
+
+    // Number of leaves holding each primitive count.
+    std::array<size_t, kBvhMaxLeafSize + 1> LeafSizes{};
+};
+
+// Walks the tree, so only call it when the numbers are wanted. BuildMs is left at zero.
+BvhStats ComputeBvhStats(std::span<const BvhNode> nodes);
+
+// Slab test. Returns the entry distance, or infinity on a miss.
+inline float IntersectBounds(glm::vec3 boundsMin, glm::vec3 boundsMax, const Ray& ray,
+                             glm::vec3 invDir, float tMax)
+{
+    glm::vec3 t0 = (boundsMin - ray.Origin) * invDir;
+    glm::vec3 t1 = (boundsMax - ray.Origin) * invDir;
+
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+
+    float entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, ray.TMin));
+    float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+
+    return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+}
+
+// Visits the leaves the ray reaches in [TMin, *closestT], nearer children first. Calls
+// intersectLeaf(node, closestT) for each, which tests the leaf's primitives and lowers
+// *closestT when it finds a closer hit. Returning true from it ends the traversal, which
+// occlusion queries do on the first hit. Adds the nodes it visits to *visitedNodes, if given.
+template<typename IntersectLeaf>
+void TraverseBvh(std::span<const BvhNode> nodes, const Ray& ray, float* closestT,
+                 IntersectLeaf&& intersectLeaf, uint64_t* visitedNodes = nullptr)
+{
+    static constexpr float kMiss = std::numeric_limits<float>::infinity();
+
+    if (nodes.empty())
+        return;
+
+    glm::vec3 invDir = 1.f / ray.Direction;
+
+    // Nodes to visit with their entry distance, which is rechecked since closestT may have
+    // shrunk by the time they are popped.
+    struct StackEntry
+    {
+        uint32_t NodeIdx;
+        float Entry;
+    };
+
+    StackEntry stack[kBvhMaxDepth];
+    int stackSize = 0;
+
+    float rootEntry = IntersectBounds(nodes[0].Min, nodes[0].Max, ray, invDir, *closestT);
+
+    if (rootEntry != kMiss)
+        stack[stackSize++] = {0, rootEntry};
+
+    while (stackSize > 0)
+    {
+        StackEntry entry = stack[--stackSize];
+
+        if (entry.Entry > *closestT)
+            continue;
+
+        if (visitedNodes)
+            ++*visitedNodes;
+
+        const BvhNode& node = nodes[entry.NodeIdx];
+
+        if (node.PrimitiveCount > 0)
+        {
+            if (intersectLeaf(node, closestT))
+                return;
+
+            continue;
+        }
+
+        StackEntry children[] = {{entry.NodeIdx + 1, 0.f}, {node.Offset, 0.f}};
+
+        for (StackEntry& child : children)
+        {
+            const BvhNode& childNode = nodes[child.NodeIdx];
+            child.Entry = IntersectBounds(childNode.Min, childNode.Max, ray, invDir, *closestT);
+        }
+
+        // Push the nearer child last, so that it is visited first and can shrink closestT for
+        // the other one.
+        if (children[1].Entry < children[0].Entry)
+            std::swap(children[0], children[1]);
+
+        for (int i = 1; i >= 0; --i)
+        {
+            if (children[i].Entry != kMiss)
+                stack[stackSize++] = children[i];
+        }
+    }
+}
+
+// Binary BVH over triangles, built with binned SAH. On its own it holds world space triangles;
+// as a BLAS it holds one mesh in object space.
+class Bvh
+{
+public:
+    // Rebuilds the wide copy for the current kernel too.
+    void Build(std::vector<BvhTriangle> triangles, ThreadPool* pool = nullptr);
+
+    // Wide kernels trace a copy of the tree collapsed to their width. Scalar frees it.
+    void SetKernel(BvhKernel kernel);
+
+    BvhKernel GetKernel() const
+    {
+        return m_kernel;
+    }
+
+    // Finds the closest hit in [TMin, TMax]. Back faces are triangles whose vertices appear
+    // counterclockwise from the ray origin, matching RAY_FLAG_CULL_BACK_FACING_TRIANGLES.
+    bool Intersect(const Ray& ray, FaceCulling culling, RayHit* hit) const;
+
+    // Whether anything is hit in [TMin, TMax]. Stops at the first hit found, like
+    // RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH, so it is cheaper than Intersect.
+    bool Occluded(const Ray& ray, FaceCulling culling) const;
+
+    // Intersect and Occluded with the scalar kernel whatever the kernel is set to, adding the
+    // nodes they visit to *visitedNodes. For statistics: the wide kernels visit fewer but wider
+    // nodes.
+    bool Intersect(const Ray& ray, FaceCulling culling, RayHit* hit,
+                   uint64_t* visitedNodes) const;
+    bool Occluded(const Ray& ray, FaceCulling culling, uint64_t* visitedNodes) const;
+
+    // Like Intersect for the rays whose lanes are set in activeMask, at most kMaxPacketSize of
+    // them, each up to its own TMax. The wide kernels trace them together, which pays off when
+    // they are coherent. Returns the lanes that found a hit.
+    uint32_t IntersectPacket(std::span<const Ray> rays, uint32_t activeMask, FaceCulling culling,
+                             RayHit* hits) const;
+
+    static constexpr uint32_t kMaxPacketSize = 8;
+
+    Aabb GetBounds() const;
+
+    size_t GetNodeCount() const
+    {
+        return m_nodes.size();
+    }
+
+    size_t GetTriangleCount() const
+    {
+        return m_triangles.size();
+    }
+
+    // Counts the wide copy too.
+    size_t GetMemoryBytes() const;
+
+    BvhStats GetStats() const;
+
+private:
+    std::vector<BvhNode> m_nodes;
+    std::vector<BvhTriangle> m_triangles;
+
+    BvhKernel m_kernel = BvhKernel::Scalar;
+    WideBvh<4> m_wide4;
+    WideBvh<8> m_wide8;
+
+    double m_buildMs = 0.0;
+};
@@ -0,0 +1,75 @@
+#include "CpuScene.h"
+
+#include "Mipmap.h"
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+void LoadCpuScene(const SceneIR& source, ThreadPool* pool, CpuScene* scene)
+{
+    scene->Source = source;
+    scene->Camera = source.Camera;
+
+    std::vector<Bvh> blases(source.Meshes.size());
+
+    scene->Meshes.resize(source.Meshes.size());
+
+    for (size_t i = 0; i < source.Meshes.size(); ++i)
+    {
+        const SceneIRMesh& irMesh = source.Meshes[i];
+
+        CpuMesh& mesh = scene->Meshes[i];
+        mesh.Normals = source.GetVertices(source.Normals, irMesh);
+        mesh.UVs = source.GetVertices(source.UVs, irMesh);
+        mesh.Indices = source.GetIndices(irMesh);
+
+        std::vector<BvhTriangle> triangles(mesh.Indices.size() / 3);
+        TransformTriangles(source.GetVertices(source.Positions, irMesh), mesh.Indices,
+                           glm::mat4(1.f), 0, triangles);
+
+        blases[i].Build(std::move(triangles), pool);
+    }
+
+    std::vector<Image> images(source.Textures.size());
+
+    pool->ParallelFor(images.size(), [&](size_t i) {
+        images[i] = DecodeImage(source.GetTexturePath(static_cast<uint32_t>(i)));
+    });
+
+    // The rows of each level are filtered in parallel instead.
+    scene->Textures.resize(images.size());
+
+    for (size_t i = 0; i < images.size(); ++i)
+        scene->Textures[i].Levels = BuildMipChain(std::move(images[i]), pool);
+
+    scene->Geometries.resize(source.Instances.size());
+
+    std::vector<TlasInstance> instances(source.Instances.size());
+
+    for (size_t i = 0; i < instances.size(); ++i)
+    {
+        const SceneIRInstance& instance = source.Instances[i];
+        const glm::mat4& transform = source.Transforms[instance.TransformIdx];
+
+        CpuGeometry& geometry = scene->Geometries[i];
+        geometry.MeshIdx = instance.MeshIdx;
+        geometry.NormalMatrix = glm::inverseTranspose(glm::mat3(transform));
+        geometry.TextureIdx = source.Materials[instance.MaterialIdx].TextureIdx;
+
+        if (geometry.TextureIdx != kSceneIRNoTexture)
+            geometry.UVLodOffset = GetUVLodOffset(source, static_cast<uint32_t>(i));
+
+        instances[i].Transform = transform;
+        instances[i].BlasIdx = instance.MeshIdx;
+        instances[i].InstanceContributionToHitGroupIndex = static_cast<uint32_t>(i);
+    }
+
+    scene->Lights.assign(source.Lights.begin(), source.Lights.end());
+    scene->LightTables = BuildLightSamplerTables(scene->Lights);
+
+    scene->Accel.Build(std::move(blases), std::move(instances), pool);
+}
+
+void LoadCpuScene(const SceneDescription& description, ThreadPool* pool, CpuScene* scene)
+{
+    LoadCpuScene(BuildSceneIR(description, pool), pool, scene);
+}
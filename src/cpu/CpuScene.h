@@ -0,0 +1,60 @@
+#pragma once
+
+#include "LightSamplerTables.h"
+#include "Scene.h"
+#include "SceneIR.h"
+#include "Texture.h"
+#include "ThreadPool.h"
+#include "Tlas.h"
+
+#include <glm/glm.hpp>
+
+#include <span>
+#include <vector>
+
+// Vertex data shared by every geometry that uses the same mesh, in CpuScene::Source.
+struct CpuMesh
+{
+    std::span<const glm::vec3> Normals;
+    std::span<const glm::vec2> UVs;
+    std::span<const uint32_t> Indices;
+};
+
+// The per-geometry data the closest hit shader reads, like a hit group record.
+struct CpuGeometry
+{
+    uint32_t MeshIdx = 0;
+
+    glm::mat3 NormalMatrix = glm::mat3(1.f);
+
+    // Of the reflectance, in CpuScene::Textures, or kSceneIRNoTexture.
+    uint32_t TextureIdx = kSceneIRNoTexture;
+
+    // HitGroupGeometryConstants::UVLodOffset.
+    float UVLodOffset = 0.f;
+};
+
+struct CpuScene
+{
+    // Holds the vertex data of the meshes.
+    SceneIR Source;
+
+    SceneCamera Camera;
+
+    std::vector<CpuMesh> Meshes;
+    std::vector<CpuGeometry> Geometries;
+    std::vector<CpuTexture> Textures;
+    std::vector<SphereLight> Lights;
+    LightSamplerTables LightTables;
+
+    // One BLAS per mesh and one instance per geometry, whose hit group index is the geometry's.
+    Tlas Accel;
+};
+
+// Builds a BLAS per mesh of the IR and an instance per instance of it on the pool, using its
+// vertex data in place, and decodes the textures and builds their mip chains on the pool. Throws
+// std::runtime_error for textures that can't be decoded.
+void LoadCpuScene(const SceneIR& source, ThreadPool* pool, CpuScene* scene);
+
+// Flattens the description with BuildSceneIR first.
+void LoadCpuScene(const SceneDescription& description, ThreadPool* pool, CpuScene* scene);
@@ -0,0 +1,280 @@
+#include "Film.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+Film::Film(uint32_t width, uint32_t height, uint32_t tileSize)
+    : m_width(width), m_height(height), m_tileSize(tileSize)
+{
+    if (tileSize == 0)
+        throw std::runtime_error("The film's tile size must be positive.");
+
+    m_tilesX = (width + tileSize - 1) / tileSize;
+    m_tilesY = (height + tileSize - 1) / tileSize;
+
+    size_t tilePixels = static_cast<size_t>(tileSize) * tileSize;
+
+    m_pixels.Resize(GetTileCount(), tilePixels);
+    m_variances.Resize(GetTileCount(), tilePixels);
+}
+
+FilmTile Film::GetTile(size_t tileIdx) const
+{
+    FilmTile tile{};
+    tile.Min.x = static_cast<uint32_t>(tileIdx % m_tilesX) * m_tileSize;
+    tile.Min.y = static_cast<uint32_t>(tileIdx / m_tilesX) * m_tileSize;
+    tile.Max.x = std::min(tile.Min.x + m_tileSize, m_width);
+    tile.Max.y = std::min(tile.Min.y + m_tileSize, m_height);
+
+    return tile;
+}
+
+glm::vec3 Film::GetPixel(uint32_t x, uint32_t y) const
+{
+    auto [tileIdx, tileOffset] = GetStorageIdx(x, y);
+
+    // The accessors are copied, since HLSL has no const methods.
+    FilmAccumulator pixel = m_pixels.At(tileIdx, tileOffset);
+
+    return pixel.GetMean();
+}
+
+uint32_t Film::GetSampleCount(uint32_t x, uint32_t y) const
+{
+    auto [tileIdx, tileOffset] = GetStorageIdx(x, y);
+
+    return static_cast<uint32_t>(m_variances.At(tileIdx, tileOffset).m_count);
+}
+
+float Film::GetVariance(uint32_t x, uint32_t y) const
+{
+    auto [tileIdx, tileOffset] = GetStorageIdx(x, y);
+
+    VarianceEstimator variance = m_variances.At(tileIdx, tileOffset);
+
+    return variance.GetVariance();
+}
+
+float Film::GetSquaredRelativeError(uint32_t x, uint32_t y) const
+{
+    auto [tileIdx, tileOffset] = GetStorageIdx(x, y);
+
+    VarianceEstimator variance = m_variances.At(tileIdx, tileOffset);
+
+    return variance.GetSquaredRelativeError();
+}
+
+std::vector<glm::vec3> Film::Resolve() const
+{
+    std::vector<glm::vec3> pixels(static_cast<size_t>(m_width) * m_height);
+
+    for (uint32_t y = 0; y < m_height; ++y)
+    {
+        for (uint32_t x = 0; x < m_width; ++x)
+            pixels[static_cast<size_t>(y) * m_width + x] = GetPixel(x, y);
+    }
+
+    return pixels;
+}
+
+namespace
+{
+
+// PFM and OpenEXR are written straight from memory.
+static_assert(std::endian::native == std::endian::little);
+
+uint8_t ToUnorm8(float value)
+{
+    return static_cast<uint8_t>(std::clamp(value, 0.f, 1.f) * 255.f + 0.5f);
+}
+
+std::ofstream OpenForWriting(const std::filesystem::path& path)
+{
+    std::ofstream file(path, std::ios::binary);
+
+    if (!file)
+        throw std::runtime_error("Could not open " + path.string() + " for writing");
+
+    return file;
+}
+
+void CheckWritten(const std::ofstream& file, const std::filesystem::path& path)
+{
+    if (!file)
+        throw std::runtime_error("Could not write " + path.string());
+}
+
+template<typename T>
+void Append(std::vector<char>* bytes, const T& value)
+{
+    const char* begin = reinterpret_cast<const char*>(&value);
+    bytes->insert(bytes->end(), begin, begin + sizeof(T));
+}
+
+void AppendString(std::vector<char>* bytes, const char* string)
+{
+    bytes->insert(bytes->end(), string, string + strlen(string) + 1);
+}
+
+// An OpenEXR header attribute, whose value the caller appends next.
+void AppendAttribute(std::vector<char>* bytes, const char* name, const char* type, int32_t size)
+{
+    AppendString(bytes, name);
+    AppendString(bytes, type);
+    Append(bytes, size);
+}
+
+} // namespace
+
+void Film::Write(const std::filesystem::path& path) const
+{
+    std::filesystem::path extension = path.extension();
+
+    if (extension == ".ppm")
+        WritePpm(path);
+    else if (extension == ".pfm")
+        WritePfm(path);
+    else if (extension == ".exr")
+        WriteExr(path);
+    else
+        throw std::runtime_error("Unknown image format: " + path.string());
+}
+
+void Film::WritePpm(const std::filesystem::path& path) const
+{
+    std::ofstream file = OpenForWriting(path);
+
+    file << "P6\n" << m_width << " " << m_height << "\n255\n";
+
+    std::vector<glm::vec3> pixels = Resolve();
+    std::vector<uint8_t> row(static_cast<size_t>(m_width) * 3);
+
+    for (uint32_t y = 0; y < m_height; ++y)
+    {
+        for (uint32_t x = 0; x < m_width; ++x)
+        {
+            const glm::vec3& pixel = pixels[static_cast<size_t>(y) * m_width + x];
+
+            row[x * 3] = ToUnorm8(pixel.x);
+            row[x * 3 + 1] = ToUnorm8(pixel.y);
+            row[x * 3 + 2] = ToUnorm8(pixel.z);
+        }
+
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+
+    CheckWritten(file, path);
+}
+
+void Film::WritePfm(const std::filesystem::path& path) const
+{
+    std::ofstream file = OpenForWriting(path);
+
+    // A negative scale means little endian.
+    file << "PF\n" << m_width << " " << m_height << "\n-1.0\n";
+
+    std::vector<glm::vec3> pixels = Resolve();
+
+    // Rows go from the bottom of the image to the top.
+    for (uint32_t y = m_height; y-- > 0;)
+    {
+        file.write(reinterpret_cast<const char*>(&pixels[static_cast<size_t>(y) * m_width]),
+                   static_cast<std::streamsize>(sizeof(glm::vec3)) * m_width);
+    }
+
+    CheckWritten(file, path);
+}
+
+void Film::WriteExr(const std::filesystem::path& path) const
+{
+    struct Channel
+    {
+        const char* Name;
+        int Component;
+    };
+
+    // Sorted by name, as OpenEXR requires.
+    static const Channel kChannels[] = {{"B", 2}, {"G", 1}, {"R", 0}};
+
+    constexpr int32_t kFloatPixels = 2;
+
+    std::vector<char> header;
+    Append(&header, uint32_t{20000630}); // Magic number.
+    Append(&header, uint32_t{2});        // Version 2, single part scanline file.
+
+    AppendAttribute(&header, "channels", "chlist", 3 * 18 + 1);
+
+    for (const Channel& channel : kChannels)
+    {
+        AppendString(&header, channel.Name);
+        Append(&header, kFloatPixels);
+        Append(&header, uint32_t{0}); // Not perceptually linear, then reserved bytes.
+        Append(&header, int32_t{1});  // x and y sampling.
+        Append(&header, int32_t{1});
+    }
+
+    header.push_back(0);
+
+    AppendAttribute(&header, "compression", "compression", 1);
+    header.push_back(0); // None.
+
+    // Inclusive bounds.
+    int32_t window[] = {0, 0, static_cast<int32_t>(m_width) - 1,
+                        static_cast<int32_t>(m_height) - 1};
+
+    AppendAttribute(&header, "dataWindow", "box2i", static_cast<int32_t>(sizeof(window)));
+    Append(&header, window);
+
+    AppendAttribute(&header, "displayWindow", "box2i", static_cast<int32_t>(sizeof(window)));
+    Append(&header, window);
+
+    AppendAttribute(&header, "lineOrder", "lineOrder", 1);
+    header.push_back(0); // Increasing y.
+
+    AppendAttribute(&header, "pixelAspectRatio", "float", 4);
+    Append(&header, 1.f);
+
+    AppendAttribute(&header, "screenWindowCenter", "v2f", 8);
+    Append(&header, 0.f);
+    Append(&header, 0.f);
+
+    AppendAttribute(&header, "screenWindowWidth", "float", 4);
+    Append(&header, 1.f);
+
+    header.push_back(0);
+
+    // Each scanline is its own block, made of its y, its size and then each channel in turn.
+    int32_t lineDataSize = static_cast<int32_t>(3 * sizeof(float) * m_width);
+    uint64_t lineSize = 2 * sizeof(int32_t) + lineDataSize;
+    uint64_t firstLineOffset = header.size() + sizeof(uint64_t) * m_height;
+
+    for (uint32_t y = 0; y < m_height; ++y)
+        Append(&header, firstLineOffset + y * lineSize);
+
+    std::ofstream file = OpenForWriting(path);
+    file.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+    std::vector<glm::vec3> pixels = Resolve();
+    std::vector<char> line;
+
+    for (uint32_t y = 0; y < m_height; ++y)
+    {
+        line.clear();
+        Append(&line, static_cast<int32_t>(y));
+        Append(&line, lineDataSize);
+
+        for (const Channel& channel : kChannels)
+        {
+            for (uint32_t x = 0; x < m_width; ++x)
+                Append(&line, pixels[static_cast<size_t>(y) * m_width + x][channel.Component]);
+        }
+
+        file.write(line.data(), static_cast<std::streamsize>(line.size()));
+    }
+
+    CheckWritten(file, path);
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "shaders/FilmAccumulator.h"
+
+#include <glm/glm.hpp>
+
+#include <filesystem>
+#include <vector>
+
+// Square block of pixels, clipped to the film. Max is exclusive.
+struct FilmTile
+{
+    glm::uvec2 Min;
+    glm::uvec2 Max;
+};
+
+// Accumulates weighted float RGB samples with the FilmAccumulator of the GPU film, and tracks the
+// variance of their luminance for adaptive sampling. Pixels are stored tile by tile, each tile
+// starting on its own cache line, so threads that own different tiles never write to the same
+// cache line and need no atomics. Only one thread may add samples to a tile at a time.
+class Film
+{
+public:
+    Film(uint32_t width, uint32_t height, uint32_t tileSize = 16);
+
+    uint32_t GetWidth() const
+    {
+        return m_width;
+    }
+
+    uint32_t GetHeight() const
+    {
+        return m_height;
+    }
+
+    uint32_t GetTileSize() const
+    {
+        return m_tileSize;
+    }
+
+    size_t GetTileCount() const
+    {
+        return static_cast<size_t>(m_tilesX) * m_tilesY;
+    }
+
+    // Tiles are numbered in scanline order.
+    FilmTile GetTile(size_t tileIdx) const;
+
+    // The variance only counts samples, not their weights.
+    void AddSample(uint32_t x, uint32_t y, glm::vec3 rgb, float weight = 1.f)
+    {
+        auto [tileIdx, tileOffset] = GetStorageIdx(x, y);
+
+        m_pixels.At(tileIdx, tileOffset).Add(rgb, weight);
+        m_variances.At(tileIdx, tileOffset).Add(Luminance(rgb));
+    }
+
+    // The weighted mean of the pixel's samples, or black if it has none.
+    glm::vec3 GetPixel(uint32_t x, uint32_t y) const;
+
+    uint32_t GetSampleCount(uint32_t x, uint32_t y) const;
+
+    // The sample variance of the pixel's luminances.
+    float GetVariance(uint32_t x, uint32_t y) const;
+
+    // See VarianceEstimator::GetSquaredRelativeError.
+    float GetSquaredRelativeError(uint32_t x, uint32_t y) const;
+
+    // Every pixel's mean, in scanline order.
+    std::vector<glm::vec3> Resolve() const;
+
+    // Picks the format from the extension: .ppm, .pfm or .exr.
+    void Write(const std::filesystem::path& path) const;
+
+    // Writes a binary PPM, clamped and quantized the same way as the display image of the GPU
+    // renderer.
+    void WritePpm(const std::filesystem::path& path) const;
+
+    // Writes the unclamped means as a little endian RGB PFM.
+    void WritePfm(const std::filesystem::path& path) const;
+
+    // Writes the unclamped means as an uncompressed scanline OpenEXR file of 32-bit float R, G
+    // and B channels.
+    void WriteExr(const std::filesystem::path& path) const;
+
+private:
+    // A value per pixel, the pixels of each tile on cache lines of their own.
+    template<typename T>
+    class TiledStorage
+    {
+    public:
+        void Resize(size_t tileCount, size_t tilePixels)
+        {
+            m_linesPerTile = (tilePixels + kPerLine - 1) / kPerLine;
+            m_lines.resize(tileCount * m_linesPerTile);
+        }
+
+        T& At(size_t tileIdx, size_t tileOffset)
+        {
+            return m_lines[tileIdx * m_linesPerTile + tileOffset / kPerLine]
+                .Values[tileOffset % kPerLine];
+        }
+
+        const T& At(size_t tileIdx, size_t tileOffset) const
+        {
+            return m_lines[tileIdx * m_linesPerTile + tileOffset / kPerLine]
+                .Values[tileOffset % kPerLine];
+        }
+
+    private:
+        static constexpr size_t kPerLine = 64 / sizeof(T);
+
+        struct alignas(64) Line
+        {
+            T Values[kPerLine];
+        };
+
+        size_t m_linesPerTile = 0;
+        std::vector<Line> m_lines;
+    };
+
+    struct StorageIdx
+    {
+        size_t TileIdx;
+        size_t TileOffset;
+    };
+
+    StorageIdx GetStorageIdx(uint32_t x, uint32_t y) const
+    {
+        StorageIdx idx{};
+        idx.TileIdx = static_cast<size_t>(y / m_tileSize) * m_tilesX + x / m_tileSize;
+        idx.TileOffset = static_cast<size_t>(y % m_tileSize) * m_tileSize + x % m_tileSize;
+
+        return idx;
+    }
+
+    uint32_t m_width;
+    uint32_t m_height;
+
+    uint32_t m_tileSize;
+    uint32_t m_tilesX;
+    uint32_t m_tilesY;
+
+    TiledStorage<FilmAccumulator> m_pixels;
+    TiledStorage<VarianceEstimator> m_variances;
+};
@@ -0,0 +1,1024 @@
+#include "PathTracer.h"
+
+#include "RaySorter.h"
+#include "TileScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+// Ports of the functions in Shader.hlsl, kept line for line so that the two can be compared.
+
+namespace
+{
+
+constexpr float PI = 3.14159265358979323846f;
+
+glm::vec3 SphericalDirection(float sinTheta, float cosTheta, float phi, glm::vec3 x,
+                             glm::vec3 y, glm::vec3 z)
+{
+    return sinTheta * std::cos(phi) * x + sinTheta * std::sin(phi) * y + cosTheta * z;
+}
+
+void CoordinateSystem(glm::vec3 v1, glm::vec3* v2, glm::vec3* v3)
+{
+    if (std::abs(v1.x) > std::abs(v1.y))
+    {
+        *v2 = glm::vec3(-v1.z, 0.f, v1.x) / std::sqrt(v1.x * v1.x + v1.z * v1.z);
+    }
+    else
+    {
+        *v2 = glm::vec3(0.f, v1.z, -v1.y) / std::sqrt(v1.y * v1.y + v1.z * v1.z);
+    }
+
+    *v3 = glm::cross(v1, *v2);
+}
+
+// The visibility ray of Sample_Li.
+Ray GetShadowRay(glm::vec3 origin, glm::vec3 direction, float tMax)
+{
+    Ray ray{};
+    ray.Origin = origin;
+    ray.Direction = direction;
+    ray.TMin = 0.001f;
+    ray.TMax = tMax;
+
+    return ray;
+}
+
+// Like Sample_Li's trace of the visibility ray, which ends the search at the first hit and skips
+// the closest hit shader.
+bool IsOccluded(const CpuScene& scene, const Ray& shadowRay)
+{
+    return scene.Accel.Occluded(shadowRay, ~0u, false);
+}
+
+// Sample_Li up to the visibility ray, which is left to the caller to trace.
+glm::vec3 SampleSphereLight(const SphereLight& light, glm::vec3 p, glm::vec2 u, glm::vec3* wi,
+                            float* pdf, Ray* shadowRay)
+{
+    float dc = glm::distance(p, light.Position);
+
+    glm::vec3 wc = glm::normalize(light.Position - p);
+    glm::vec3 wcX, wcY;
+    CoordinateSystem(wc, &wcX, &wcY);
+
+    float sinThetaMax = light.Radius / dc;
+    float invSinThetaMax = 1.f / sinThetaMax;
+
+    float cosThetaMax = std::sqrt(std::max(0.f, 1 - sinThetaMax * sinThetaMax));
+
+    float cosTheta = (cosThetaMax - 1.f) * u.x + 1.f;
+    float sinThetaSq = 1 - cosTheta * cosTheta;
+
+    float cosAlpha = sinThetaSq * invSinThetaMax +
+        cosTheta * std::sqrt(std::max(0.f, 1.f - sinThetaSq * invSinThetaMax * invSinThetaMax));
+    float sinAlpha = std::sqrt(std::max(0.f, 1.f - cosAlpha * cosAlpha));
+    float phi = u.y * 2.f * PI;
+
+    glm::vec3 dir = SphericalDirection(sinAlpha, cosAlpha, phi, -wcX, -wcY, -wc);
+
+    glm::vec3 lightSamplePos = light.Position + light.Radius * dir;
+
+    *wi = glm::normalize(lightSamplePos - p);
+    *pdf = 1.f / (2.f * PI * (1.f - cosThetaMax));
+
+    float lightDist = glm::distance(p, lightSamplePos);
+
+    *shadowRay = GetShadowRay(p, *wi, lightDist);
+
+    return light.L;
+}
+
+glm::vec3 SampleSphereLight(const CpuScene& scene, const SphereLight& light, glm::vec3 p,
+                            glm::vec2 u, glm::vec3* wi, float* pdf, bool* visible)
+{
+    Ray shadowRay{};
+    glm::vec3 Li = SampleSphereLight(light, p, u, wi, pdf, &shadowRay);
+
+    *visible = !IsOccluded(scene, shadowRay);
+
+    return Li;
+}
+
+glm::vec2 ConcentricSampleDisk(glm::vec2 u)
+{
+    glm::vec2 offset = 2.f * u - glm::vec2(1.f, 1.f);
+
+    if (offset.x == 0 && offset.y == 0)
+        return glm::vec2(0.f, 0.f);
+
+    float theta = 0.f;
+    float r = 0.f;
+
+    if (std::abs(offset.x) > std::abs(offset.y))
+    {
+        r = offset.x;
+        theta = PI / 4.f * (offset.y / offset.x);
+    }
+    else
+    {
+        r = offset.y;
+        theta = PI / 2.f * PI / 4.f * (offset.x / offset.y);
+    }
+
+    return r * glm::vec2(std::cos(theta), std::sin(theta));
+}
+
+glm::vec3 CosineSampleHemisphere(glm::vec2 u)
+{
+    glm::vec2 d = ConcentricSampleDisk(u);
+    float z = std::sqrt(std::max(0.f, 1.f - d.x * d.x - d.y * d.y));
+
+    return glm::vec3(d.x, d.y, z);
+}
+
+void Lambertian_Sample_f(glm::vec3 wo, glm::vec2 u, glm::vec3 n, glm::vec3* wi, float* pdf)
+{
+    glm::vec3 nx, ny;
+    CoordinateSystem(n, &nx, &ny);
+
+    wo = glm::vec3(glm::dot(wo, nx), glm::dot(wo, ny), glm::dot(wo, n));
+
+    *wi = CosineSampleHemisphere(u);
+    if (wo.z < 0.f)
+    {
+        wi->z *= -1.f;
+    }
+
+    *pdf = (wo.z * wi->z > 0) ? std::abs(wi->z) / PI : 0.f;
+
+    *wi = wi->x * nx + wi->y * ny + wi->z * n;
+}
+
+// How far the film's edges are from its center, at a distance of 1 in front of the camera.
+glm::vec2 GetMaxScreen(const SceneCamera& camera, glm::uvec2 dimensions)
+{
+    float fov = camera.Fov / 180.f * 3.142f;
+
+    // The field of view spans the shorter side of the film.
+    float aspect = static_cast<float>(dimensions.x) / dimensions.y;
+
+    float maxScreenY = std::tan(fov / 2.f);
+    float maxScreenX = maxScreenY * aspect;
+
+    if (aspect < 1.f)
+    {
+        maxScreenX = maxScreenY;
+        maxScreenY = maxScreenX / aspect;
+    }
+
+    return glm::vec2(maxScreenX, maxScreenY);
+}
+
+// The reflectance ClosestHitShader leaves in the payload, which is the default unless the hit's
+// geometry is textured.
+glm::vec3 GetReflectance(const CpuScene& scene, const RenderOptions& options, const Ray& ray,
+                         const RayHit& hit, glm::vec3 normal, RayCone cone)
+{
+    TextureLookup lookup;
+
+    if (!GetTextureLookup(scene, ray, hit, normal, cone, &lookup))
+        return glm::vec3(0.5f, 0.5f, 0.5f);
+
+    float lod = options.RayConeLod ? lookup.Lod : 0.f;
+
+    return glm::vec3(SampleLevel(scene.Textures[lookup.TextureIdx], lookup.UV, lod));
+}
+
+struct Payload
+{
+    glm::vec3 Normal;
+    glm::vec3 Reflectance;
+    float HitT = 0.f;
+
+    RayCone Cone{};
+};
+
+void SetPayload(const CpuScene& scene, const RenderOptions& options, const Ray& ray,
+                const RayHit& hit, Payload* payload)
+{
+    payload->Normal = GetShadingNormal(scene, hit);
+    payload->Reflectance = GetReflectance(scene, options, ray, hit, payload->Normal, payload->Cone);
+    payload->HitT = hit.T;
+}
+
+// ClosestHitShader. Returns false on a miss, leaving the payload untouched.
+bool TraceRay(const CpuScene& scene, const RenderOptions& options, const Ray& ray,
+              Payload* payload)
+{
+    RayHit hit{};
+
+    if (!scene.Accel.Intersect(ray, ~0u, true, &hit))
+        return false;
+
+    SetPayload(scene, options, ray, hit, payload);
+
+    return true;
+}
+
+// Adds the time and rays of each path depth to RenderStats::Depths when RenderOptions::TimeDepths
+// is set, and does nothing otherwise.
+class DepthTimer
+{
+public:
+    DepthTimer(bool enabled, RenderStats* stats) : m_enabled(enabled), m_stats(stats)
+    {
+    }
+
+    // Stops timing the depth being timed, if any, and starts timing depth.
+    void Start(uint32_t depth)
+    {
+        if (!m_enabled)
+            return;
+
+        auto now = std::chrono::steady_clock::now();
+
+        if (m_depth != 0)
+            GetDepthStats(m_depth).Ms += GetMs(now - m_start);
+
+        m_depth = depth;
+        m_start = now;
+    }
+
+    void Stop()
+    {
+        if (!m_enabled || m_depth == 0)
+            return;
+
+        GetDepthStats(m_depth).Ms += GetMs(std::chrono::steady_clock::now() - m_start);
+        m_depth = 0;
+    }
+
+    void AddRays(uint32_t depth, uint64_t count)
+    {
+        if (m_enabled)
+            GetDepthStats(depth).Rays += count;
+    }
+
+private:
+    static double GetMs(std::chrono::steady_clock::duration duration)
+    {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    DepthStats& GetDepthStats(uint32_t depth)
+    {
+        if (m_stats->Depths.size() < depth)
+            m_stats->Depths.resize(depth);
+
+        return m_stats->Depths[depth - 1];
+    }
+
+    bool m_enabled;
+    RenderStats* m_stats;
+
+    // 0 when no depth is being timed.
+    uint32_t m_depth = 0;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// The exposure RayGenShader scales a path's radiance by before it goes to the film.
+float GetImagingRatio()
+{
+    static const float iso = 150.f;
+    static const float exposureTime = 1.f;
+
+    return exposureTime * iso / 100.f;
+}
+
+// RayGenShader's Russian roulette for a path that has just sampled its bounce at depth. Returns
+// whether the path goes on, its throughput scaled up to make up for the paths that don't.
+bool SurviveRoulette(const RenderOptions& options, uint32_t depth, Sampler* sampler,
+                     glm::vec3* throughput)
+{
+    if (options.RouletteDepth == 0 || depth < options.RouletteDepth)
+        return true;
+
+    float q = GetSurvivalProbability(*throughput);
+
+    if (q >= 1.f)
+        return true;
+
+    if (sampler->Get1D() >= q)
+        return false;
+
+    *throughput /= q;
+
+    return true;
+}
+
+// How many lights each shading point sends shadow rays to, if none are left out.
+uint32_t GetLightSampleCount(const CpuScene& scene, const RenderOptions& options)
+{
+    if (options.LightSampler == LightSamplerType::All)
+        return static_cast<uint32_t>(scene.Lights.size());
+
+    return options.LightSamples;
+}
+
+// A shading point's sampleIdx-th light and the weight of what it adds, picked the way
+// RayGenShader does. Null when the light sampler finds none that matters.
+const SphereLight* PickLight(const CpuScene& scene, const RenderOptions& options,
+                             uint32_t sampleIdx, glm::vec3 p, glm::vec3 n, Sampler* sampler,
+                             float* weight)
+{
+    if (options.LightSampler == LightSamplerType::All)
+    {
+        *weight = 1.f;
+        return &scene.Lights[sampleIdx];
+    }
+
+    LightSampler lightSampler = scene.LightTables.CreateSampler(options.LightSampler);
+    LightSample sample = lightSampler.Sample(p, n, sampler->Get1D());
+
+    if (sample.Pmf == 0.f)
+        return nullptr;
+
+    *weight = 1.f / (sample.Pmf * options.LightSamples);
+
+    return &scene.Lights[sample.LightIdx];
+}
+
+// The rest of RayGenShader once the camera ray has been traced. cameraHit is null on a miss.
+glm::vec3 TracePath(const CpuScene& scene, const RenderOptions& options, Sampler* sampler,
+                    Ray ray, RayCone cone, const RayHit* cameraHit, DepthTimer* timer,
+                    RenderStats* stats)
+{
+    glm::vec3 L(0.f, 0.f, 0.f);
+    glm::vec3 throughput(1.f, 1.f, 1.f);
+
+    uint32_t lightSampleCount = GetLightSampleCount(scene, options);
+
+    ++stats->CameraRays;
+
+    for (uint32_t depth = 1;; ++depth)
+    {
+        timer->Start(depth);
+
+        Payload payload{};
+        payload.Reflectance = glm::vec3(0.5f, 0.5f, 0.5f);
+        payload.Cone = cone;
+
+        if (depth == 1)
+        {
+            if (!cameraHit)
+                break;
+
+            SetPayload(scene, options, ray, *cameraHit, &payload);
+        }
+        else if (!TraceRay(scene, options, ray, &payload))
+        {
+            break;
+        }
+
+        glm::vec3 position = ray.Origin + payload.HitT * ray.Direction;
+
+        glm::vec3 f = payload.Reflectance / PI;
+
+        for (uint32_t i = 0; i < lightSampleCount; ++i)
+        {
+            float weight = 0.f;
+            const SphereLight* light =
+                PickLight(scene, options, i, position, payload.Normal, sampler, &weight);
+
+            if (!light)
+                continue;
+
+            glm::vec3 wi(0.f, 0.f, 0.f);
+            float pdf = 0.f;
+            bool visible = false;
+
+            glm::vec3 Li = SampleSphereLight(scene, *light, position, sampler->Get2D(), &wi,
+                                             &pdf, &visible);
+
+            ++stats->ShadowRays;
+            timer->AddRays(depth, 1);
+
+            if (visible)
+            {
+                L += weight * throughput *
+                     (f * Li * std::abs(glm::dot(wi, payload.Normal)) / pdf);
+            }
+        }
+
+        if (depth == options.MaxDepth)
+            break;
+
+        glm::vec3 wo = -ray.Direction;
+
+        glm::vec3 wi(0.f, 0.f, 0.f);
+        float pdf = 0.f;
+        Lambertian_Sample_f(wo, sampler->Get2D(), payload.Normal, &wi, &pdf);
+
+        if (pdf == 0.f)
+            break;
+
+        throughput *= f * std::abs(glm::dot(wi, payload.Normal)) / pdf;
+
+        if (!SurviveRoulette(options, depth, sampler, &throughput))
+            break;
+
+        ray.Origin = position;
+        ray.Direction = wi;
+
+        cone.Width = GetRayConeWidth(cone, payload.HitT);
+
+        ++stats->BounceRays;
+        timer->AddRays(depth + 1, 1);
+    }
+
+    timer->Stop();
+
+    return GetImagingRatio() * L;
+}
+
+// TracePath turned inside out. Instead of following one path to its end, each stage runs over
+// every path of a wave that needs it before the next stage starts: generate camera rays,
+// intersect, shade and sample the lights, trace the shadow rays, and after the last bounce add
+// the paths to the film. Path state lives in arrays of one field each, and stages hand each other
+// the indices of the paths they leave work for in compacted queues, as buffers and an indirect
+// dispatch per stage would on the GPU. A wave adds the same samples in the same order as
+// TracePath, so the image is the same.
+class Wavefront
+{
+public:
+    Wavefront(const CpuScene& scene, const RenderOptions& options, const Sampler& sampler,
+              glm::uvec2 dimensions)
+        : m_scene(scene), m_options(options), m_dimensions(dimensions),
+          m_lightSampleCount(GetLightSampleCount(scene, options)),
+          m_cameraCone(GetCameraRayCone(scene.Camera, dimensions)),
+          m_sorter(scene.Accel.GetBounds())
+    {
+        m_samplers.resize(options.WavefrontSize, sampler);
+        m_pixels.resize(options.WavefrontSize);
+        m_rays.resize(options.WavefrontSize);
+        m_cones.resize(options.WavefrontSize);
+        m_hits.resize(options.WavefrontSize);
+        m_throughputs.resize(options.WavefrontSize);
+        m_radiances.resize(options.WavefrontSize);
+    }
+
+    // Renders sampleCount samples of each pixel from firstSample on, in waves of at most
+    // RenderOptions::WavefrontSize paths.
+    void Render(std::span<const glm::uvec2> pixels, uint32_t firstSample, uint32_t sampleCount,
+                Film* film, RenderStats* stats)
+    {
+        size_t pathCount = pixels.size() * sampleCount;
+
+        DepthTimer timer(m_options.TimeDepths, stats);
+
+        for (size_t first = 0; first < pathCount; first += m_options.WavefrontSize)
+        {
+            uint32_t count =
+                static_cast<uint32_t>(std::min<size_t>(m_options.WavefrontSize, pathCount - first));
+
+            timer.Start(1);
+
+            GenerateCameraRays(pixels, firstSample, sampleCount, first, count, &timer, stats);
+
+            for (uint32_t depth = 1; !m_rayQueue.empty(); ++depth)
+            {
+                timer.Start(depth);
+
+                Intersect(depth, stats);
+                Shade(depth, &timer, stats);
+                TraceShadowRays(stats);
+            }
+
+            timer.Stop();
+
+            for (uint32_t pathIdx = 0; pathIdx < count; ++pathIdx)
+            {
+                glm::uvec2 pixel = m_pixels[pathIdx];
+                film->AddSample(pixel.x, pixel.y, GetImagingRatio() * m_radiances[pathIdx]);
+            }
+        }
+    }
+
+private:
+    // Paths are numbered pixel by pixel, then sample by sample, from firstPath on.
+    void GenerateCameraRays(std::span<const glm::uvec2> pixels, uint32_t firstSample,
+                            uint32_t sampleCount, size_t firstPath, uint32_t count,
+                            DepthTimer* timer, RenderStats* stats)
+    {
+        m_rayQueue.clear();
+
+        for (uint32_t pathIdx = 0; pathIdx < count; ++pathIdx)
+        {
+            size_t path = firstPath + pathIdx;
+            glm::uvec2 pixel = pixels[path / sampleCount];
+
+            uint32_t sampleIdx = firstSample + static_cast<uint32_t>(path % sampleCount);
+
+            Sampler& sampler = m_samplers[pathIdx];
+            sampler.StartPixelSample(pixel, sampleIdx);
+
+            m_pixels[pathIdx] = pixel;
+            m_rays[pathIdx] = GenerateCameraRay(m_scene.Camera,
+                                                glm::vec2(pixel) + sampler.GetPixel2D(),
+                                                m_dimensions);
+            m_cones[pathIdx] = m_cameraCone;
+            m_throughputs[pathIdx] = glm::vec3(1.f, 1.f, 1.f);
+            m_radiances[pathIdx] = glm::vec3(0.f, 0.f, 0.f);
+
+            m_rayQueue.push_back(pathIdx);
+        }
+
+        stats->CameraRays += count;
+        timer->AddRays(1, count);
+    }
+
+    // Ray queue to hit queue. Camera rays are traced in packets of neighbouring queue entries,
+    // which are samples of the same pixel, when RenderOptions::CameraPackets is set, and bounce
+    // rays in the order of their sort keys when RenderOptions::SortRays is.
+    void Intersect(uint32_t depth, RenderStats* stats)
+    {
+        m_hitQueue.clear();
+
+        if (depth > 1 && m_options.SortRays)
+        {
+            auto start = std::chrono::steady_clock::now();
+
+            m_sorter.Sort(m_rayQueue, m_rays.data());
+
+            stats->SortMs += std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+        }
+
+        if (m_options.CountNodes)
+        {
+            for (uint32_t pathIdx : m_rayQueue)
+            {
+                if (m_scene.Accel.Intersect(m_rays[pathIdx], ~0u, true, &m_hits[pathIdx],
+                                            &stats->VisitedNodes))
+                {
+                    m_hitQueue.push_back(pathIdx);
+                }
+            }
+
+            return;
+        }
+
+        if (depth == 1 && m_options.CameraPackets)
+        {
+            Ray rays[Bvh::kMaxPacketSize];
+            RayHit hits[Bvh::kMaxPacketSize];
+
+            for (size_t first = 0; first < m_rayQueue.size(); first += Bvh::kMaxPacketSize)
+            {
+                uint32_t count = static_cast<uint32_t>(
+                    std::min<size_t>(Bvh::kMaxPacketSize, m_rayQueue.size() - first));
+
+                for (uint32_t lane = 0; lane < count; ++lane)
+                    rays[lane] = m_rays[m_rayQueue[first + lane]];
+
+                uint32_t hitMask =
+                    m_scene.Accel.IntersectPacket(std::span(rays, count), ~0u, true, hits);
+
+                for (uint32_t lane = 0; lane < count; ++lane)
+                {
+                    if (!(hitMask & (1u << lane)))
+                        continue;
+
+                    uint32_t pathIdx = m_rayQueue[first + lane];
+
+                    m_hits[pathIdx] = hits[lane];
+                    m_hitQueue.push_back(pathIdx);
+                }
+            }
+
+            return;
+        }
+
+        for (uint32_t pathIdx : m_rayQueue)
+        {
+            if (m_scene.Accel.Intersect(m_rays[pathIdx], ~0u, true, &m_hits[pathIdx]))
+                m_hitQueue.push_back(pathIdx);
+        }
+    }
+
+    // Hit queue to shadow queue and the ray queue of the next bounce. A shadow ray carries what
+    // its light adds to the path if it is visible.
+    void Shade(uint32_t depth, DepthTimer* timer, RenderStats* stats)
+    {
+        m_rayQueue.clear();
+        m_shadowQueue.clear();
+        m_shadowRays.clear();
+        m_shadowContributions.clear();
+
+        for (uint32_t pathIdx : m_hitQueue)
+        {
+            Ray& ray = m_rays[pathIdx];
+            RayCone& cone = m_cones[pathIdx];
+            const RayHit& hit = m_hits[pathIdx];
+            Sampler& sampler = m_samplers[pathIdx];
+            glm::vec3& throughput = m_throughputs[pathIdx];
+
+            glm::vec3 normal = GetShadingNormal(m_scene, hit);
+            glm::vec3 reflectance = GetReflectance(m_scene, m_options, ray, hit, normal, cone);
+
+            glm::vec3 position = ray.Origin + hit.T * ray.Direction;
+
+            glm::vec3 f = reflectance / PI;
+
+            for (uint32_t i = 0; i < m_lightSampleCount; ++i)
+            {
+                float weight = 0.f;
+                const SphereLight* light =
+                    PickLight(m_scene, m_options, i, position, normal, &sampler, &weight);
+
+                if (!light)
+                    continue;
+
+                glm::vec3 wi(0.f, 0.f, 0.f);
+                float pdf = 0.f;
+                Ray shadowRay{};
+
+                glm::vec3 Li = SampleSphereLight(*light, position, sampler.Get2D(), &wi, &pdf,
+                                                 &shadowRay);
+
+                m_shadowQueue.push_back(pathIdx);
+                m_shadowRays.push_back(shadowRay);
+                m_shadowContributions.push_back(
+                    weight * throughput * (f * Li * std::abs(glm::dot(wi, normal)) / pdf));
+
+                ++stats->ShadowRays;
+                timer->AddRays(depth, 1);
+            }
+
+            if (depth == m_options.MaxDepth)
+                continue;
+
+            glm::vec3 wo = -ray.Direction;
+
+            glm::vec3 wi(0.f, 0.f, 0.f);
+            float pdf = 0.f;
+            Lambertian_Sample_f(wo, sampler.Get2D(), normal, &wi, &pdf);
+
+            if (pdf == 0.f)
+                continue;
+
+            throughput *= f * std::abs(glm::dot(wi, normal)) / pdf;
+
+            if (!SurviveRoulette(m_options, depth, &sampler, &throughput))
+                continue;
+
+            ray.Origin = position;
+            ray.Direction = wi;
+
+            cone.Width = GetRayConeWidth(cone, hit.T);
+
+            ++stats->BounceRays;
+            timer->AddRays(depth + 1, 1);
+
+            m_rayQueue.push_back(pathIdx);
+        }
+    }
+
+    // The shadow rays may be traced in the order of their sort keys, but what they add is added
+    // in queue order. A path's shadow rays are queued in the order TracePath traces them, so its
+    // radiance is summed in the same order.
+    void TraceShadowRays(RenderStats* stats)
+    {
+        m_shadowOrder.resize(m_shadowQueue.size());
+        std::iota(m_shadowOrder.begin(), m_shadowOrder.end(), 0u);
+
+        if (m_options.SortRays)
+        {
+            auto start = std::chrono::steady_clock::now();
+
+            m_sorter.Sort(m_shadowOrder, m_shadowRays.data());
+
+            stats->SortMs += std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+        }
+
+        m_shadowVisible.resize(m_shadowQueue.size());
+
+        for (uint32_t shadowIdx : m_shadowOrder)
+        {
+            const Ray& shadowRay = m_shadowRays[shadowIdx];
+
+            bool occluded = m_options.CountNodes
+                ? m_scene.Accel.Occluded(shadowRay, ~0u, false, &stats->VisitedNodes)
+                : IsOccluded(m_scene, shadowRay);
+
+            m_shadowVisible[shadowIdx] = !occluded;
+        }
+
+        for (size_t shadowIdx = 0; shadowIdx < m_shadowQueue.size(); ++shadowIdx)
+        {
+            if (m_shadowVisible[shadowIdx])
+                m_radiances[m_shadowQueue[shadowIdx]] += m_shadowContributions[shadowIdx];
+        }
+    }
+
+    const CpuScene& m_scene;
+    const RenderOptions& m_options;
+    glm::uvec2 m_dimensions;
+    uint32_t m_lightSampleCount;
+    RayCone m_cameraCone;
+
+    // Path state, indexed by the path's position in the wave.
+    std::vector<glm::uvec2> m_pixels;
+    std::vector<Sampler> m_samplers;
+    std::vector<Ray> m_rays;
+    std::vector<RayCone> m_cones;
+    std::vector<RayHit> m_hits;
+    std::vector<glm::vec3> m_throughputs;
+    std::vector<glm::vec3> m_radiances;
+
+    std::vector<uint32_t> m_rayQueue;
+    std::vector<uint32_t> m_hitQueue;
+
+    // The shadow queue has a ray and contribution of its own per entry.
+    std::vector<uint32_t> m_shadowQueue;
+    std::vector<Ray> m_shadowRays;
+    std::vector<glm::vec3> m_shadowContributions;
+
+    // Shadow queue entries in the order they are traced, and what they found.
+    std::vector<uint32_t> m_shadowOrder;
+    std::vector<char> m_shadowVisible;
+
+    RaySorter m_sorter;
+};
+
+} // namespace
+
+IntegratorType ParseIntegratorType(std::string_view name)
+{
+    if (name == "megakernel")
+        return IntegratorType::Megakernel;
+    if (name == "wavefront")
+        return IntegratorType::Wavefront;
+
+    throw std::runtime_error("Unknown integrator: " + std::string(name));
+}
+
+const char* GetIntegratorTypeName(IntegratorType type)
+{
+    switch (type)
+    {
+        case IntegratorType::Megakernel:
+            return "megakernel";
+        case IntegratorType::Wavefront:
+            return "wavefront";
+    }
+
+    return "unknown";
+}
+
+Ray GenerateCameraRay(const SceneCamera& camera, glm::vec2 filmPos, glm::uvec2 dimensions)
+{
+    glm::vec2 maxScreen = GetMaxScreen(camera, dimensions);
+
+    float maxScreenX = maxScreen.x;
+    float maxScreenY = maxScreen.y;
+
+    auto lerp = [](float a, float b, float t) { return a + (b - a) * t; };
+
+    glm::vec3 rayDir = glm::normalize(
+        lerp(-maxScreenX, maxScreenX, filmPos.x / static_cast<float>(dimensions.x)) *
+            camera.Right +
+        lerp(maxScreenY, -maxScreenY, filmPos.y / static_cast<float>(dimensions.y)) * camera.Up +
+        camera.Forward);
+
+    Ray ray{};
+    ray.Origin = camera.Origin;
+    ray.Direction = rayDir;
+    ray.TMin = 0.1f;
+    ray.TMax = 1000.f;
+
+    return ray;
+}
+
+RayCone GetCameraRayCone(const SceneCamera& camera, glm::uvec2 dimensions)
+{
+    // A pixel's footprint widens by about the angle it spans at the center of the film.
+    RayCone cone{};
+    cone.Width = 0.f;
+    cone.SpreadAngle =
+        std::atan(2.f * GetMaxScreen(camera, dimensions).y / static_cast<float>(dimensions.y));
+
+    return cone;
+}
+
+glm::vec3 GetShadingNormal(const CpuScene& scene, const RayHit& hit)
+{
+    const CpuGeometry& geometry = scene.Geometries[hit.HitGroupIdx];
+    const CpuMesh& mesh = scene.Meshes[geometry.MeshIdx];
+
+    const uint32_t* indices = &mesh.Indices[static_cast<size_t>(hit.PrimitiveIdx) * 3];
+
+    glm::vec3 n0 = mesh.Normals[indices[0]];
+    glm::vec3 n1 = mesh.Normals[indices[1]];
+    glm::vec3 n2 = mesh.Normals[indices[2]];
+
+    glm::vec3 normal = n0 + hit.Barycentrics.x * (n1 - n0) + hit.Barycentrics.y * (n2 - n0);
+
+    return glm::normalize(geometry.NormalMatrix * normal);
+}
+
+bool GetTextureLookup(const CpuScene& scene, const Ray& ray, const RayHit& hit, glm::vec3 normal,
+                      RayCone cone, TextureLookup* lookup)
+{
+    const CpuGeometry& geometry = scene.Geometries[hit.HitGroupIdx];
+
+    if (geometry.TextureIdx == kSceneIRNoTexture)
+        return false;
+
+    const CpuMesh& mesh = scene.Meshes[geometry.MeshIdx];
+
+    const uint32_t* indices = &mesh.Indices[static_cast<size_t>(hit.PrimitiveIdx) * 3];
+
+    glm::vec2 uv0 = mesh.UVs[indices[0]];
+    glm::vec2 uv1 = mesh.UVs[indices[1]];
+    glm::vec2 uv2 = mesh.UVs[indices[2]];
+
+    const ImageInfo& info = scene.Textures[geometry.TextureIdx].Levels[0].Info;
+
+    lookup->TextureIdx = geometry.TextureIdx;
+    lookup->UV = uv0 + hit.Barycentrics.x * (uv1 - uv0) + hit.Barycentrics.y * (uv2 - uv0);
+    lookup->Lod = GetRayConeLod(GetRayConeWidth(cone, hit.T), glm::dot(ray.Direction, normal),
+                                geometry.UVLodOffset,
+                                glm::vec2(static_cast<float>(info.Width),
+                                          static_cast<float>(info.Height)));
+
+    return true;
+}
+
+RenderStats RenderScene(const CpuScene& scene, const RenderOptions& options, ThreadPool* pool,
+                        Film* film)
+{
+    bool adaptive = options.AdaptiveThreshold > 0.f;
+
+    if (adaptive && options.AdaptiveBatchSize == 0)
+        throw std::runtime_error("The adaptive sampling batch size must be positive.");
+
+    if (options.MaxDepth == 0 || options.WavefrontSize == 0 || options.LightSamples == 0)
+        throw std::runtime_error("The path depth, wavefront size and light samples must be "
+                                 "positive.");
+
+    SamplerTables tables =
+        GetSamplerTables(options.Sampler, options.SamplesPerPixel, options.Seed, pool);
+
+    glm::uvec2 dimensions(film->GetWidth(), film->GetHeight());
+
+    // The pixels of a film tile that still take samples.
+    struct TileWork
+    {
+        size_t TileIdx;
+        std::vector<glm::uvec2> Pixels;
+    };
+
+    std::vector<TileWork> work(film->GetTileCount());
+
+    for (size_t tileIdx = 0; tileIdx < work.size(); ++tileIdx)
+    {
+        FilmTile tile = film->GetTile(tileIdx);
+
+        work[tileIdx].TileIdx = tileIdx;
+
+        for (uint32_t y = tile.Min.y; y < tile.Max.y; ++y)
+        {
+            for (uint32_t x = tile.Min.x; x < tile.Max.x; ++x)
+                work[tileIdx].Pixels.emplace_back(x, y);
+        }
+    }
+
+    std::vector<RenderStats> tileStats(film->GetTileCount());
+
+    auto renderTile = [&](const TileWork& tileWork, uint32_t firstSample, uint32_t sampleCount) {
+        RenderStats& stats = tileStats[tileWork.TileIdx];
+        DepthTimer timer(options.TimeDepths, &stats);
+
+        std::vector<Sampler> samplers(Bvh::kMaxPacketSize, tables.CreateSampler(dimensions));
+        RayCone cameraCone = GetCameraRayCone(scene.Camera, dimensions);
+        Ray rays[Bvh::kMaxPacketSize];
+        RayHit hits[Bvh::kMaxPacketSize];
+
+        for (glm::uvec2 pixel : tileWork.Pixels)
+        {
+            // Samples of the same pixel make the most coherent packets.
+            uint32_t packetSize = options.CameraPackets ? Bvh::kMaxPacketSize : 1;
+            uint32_t endSample = firstSample + sampleCount;
+
+            for (uint32_t first = firstSample; first < endSample; first += packetSize)
+            {
+                uint32_t count = std::min(packetSize, endSample - first);
+
+                timer.Start(1);
+
+                for (uint32_t lane = 0; lane < count; ++lane)
+                {
+                    samplers[lane].StartPixelSample(pixel, first + lane);
+
+                    rays[lane] = GenerateCameraRay(scene.Camera,
+                                                   glm::vec2(pixel) + samplers[lane].GetPixel2D(),
+                                                   dimensions);
+                }
+
+                uint32_t hitMask = 0;
+
+                if (options.CameraPackets)
+                {
+                    hitMask =
+                        scene.Accel.IntersectPacket(std::span(rays, count), ~0u, true, hits);
+                }
+                else if (scene.Accel.Intersect(rays[0], ~0u, true, &hits[0]))
+                {
+                    hitMask = 1;
+                }
+
+                timer.AddRays(1, count);
+                timer.Stop();
+
+                for (uint32_t lane = 0; lane < count; ++lane)
+                {
+                    const RayHit* cameraHit = (hitMask & (1u << lane)) ? &hits[lane] : nullptr;
+
+                    film->AddSample(pixel.x, pixel.y,
+                                    TracePath(scene, options, &samplers[lane], rays[lane],
+                                              cameraCone, cameraHit, &timer, &stats));
+                }
+            }
+        }
+    };
+
+    float maxSquaredError = options.AdaptiveThreshold * options.AdaptiveThreshold;
+
+    uint32_t batchSize = adaptive ? options.AdaptiveBatchSize : options.SamplesPerPixel;
+
+    RenderStats stats{};
+
+    for (uint32_t first = 0; first < options.SamplesPerPixel && !work.empty(); first += batchSize)
+    {
+        uint32_t count = std::min(batchSize, options.SamplesPerPixel - first);
+
+        // Workers own whole tiles of the film, so they can add their samples without atomics.
+        TileScheduler scheduler(work.size(), pool->GetThreadCount());
+
+        pool->ParallelFor(scheduler.GetWorkerCount(), [&](size_t workerIdx) {
+            if (options.Integrator == IntegratorType::Megakernel)
+            {
+                for (size_t workIdx = 0; scheduler.Next(workerIdx, &workIdx);)
+                    renderTile(work[workIdx], first, count);
+
+                return;
+            }
+
+            // Each worker runs its own waves, one tile's samples at a time.
+            Wavefront wavefront(scene, options, tables.CreateSampler(dimensions), dimensions);
+
+            for (size_t workIdx = 0; scheduler.Next(workerIdx, &workIdx);)
+            {
+                const TileWork& tileWork = work[workIdx];
+
+                wavefront.Render(tileWork.Pixels, first, count, film,
+                                 &tileStats[tileWork.TileIdx]);
+            }
+        });
+
+        stats.StolenTiles += scheduler.GetStealCount();
+        ++stats.Passes;
+
+        if (!adaptive)
+            continue;
+
+        // Compacts the work list down to the pixels that haven't converged yet.
+        pool->ParallelFor(work.size(), [&](size_t workIdx) {
+            std::erase_if(work[workIdx].Pixels, [&](glm::uvec2 pixel) {
+                return film->GetSquaredRelativeError(pixel.x, pixel.y) < maxSquaredError;
+            });
+        });
+
+        std::erase_if(work, [](const TileWork& tileWork) { return tileWork.Pixels.empty(); });
+    }
+
+    for (const auto& tile : tileStats)
+    {
+        stats.CameraRays += tile.CameraRays;
+        stats.ShadowRays += tile.ShadowRays;
+        stats.BounceRays += tile.BounceRays;
+        stats.SortMs += tile.SortMs;
+        stats.VisitedNodes += tile.VisitedNodes;
+
+        if (stats.Depths.size() < tile.Depths.size())
+            stats.Depths.resize(tile.Depths.size());
+
+        for (size_t depthIdx = 0; depthIdx < tile.Depths.size(); ++depthIdx)
+        {
+            stats.Depths[depthIdx].Rays += tile.Depths[depthIdx].Rays;
+            stats.Depths[depthIdx].Ms += tile.Depths[depthIdx].Ms;
+        }
+    }
+
+    return stats;
+}
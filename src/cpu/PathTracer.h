@@ -0,0 +1,135 @@
+#pragma once
+
+#include "CpuScene.h"
+#include "Film.h"
+#include "SamplerTables.h"
+#include "ThreadPool.h"
+
+#include <string_view>
+#include <vector>
+
+enum class IntegratorType
+{
+    // RayGenShader's loop, which follows each path to its end before starting the next.
+    Megakernel,
+
+    // The same paths advanced a stage at a time over waves of many, with queues between stages.
+    Wavefront
+};
+
+IntegratorType ParseIntegratorType(std::string_view name);
+
+const char* GetIntegratorTypeName(IntegratorType type);
+
+struct RenderOptions
+{
+    uint32_t SamplesPerPixel = 16;
+
+    SamplerType Sampler = SamplerType::Halton;
+
+    // Seeds the Halton digit permutations or the Sobol scrambles. The GPU renderer seeds them from
+    // the clock.
+    uint32_t Seed = 0;
+
+    // Traces the camera rays of each pixel's samples together with Tlas::IntersectPacket. The
+    // image is the same either way.
+    bool CameraPackets = false;
+
+    IntegratorType Integrator = IntegratorType::Megakernel;
+
+    // Paths each worker of the wavefront integrator keeps in flight.
+    uint32_t WavefrontSize = 4096;
+
+    // Picks the mip level of each texture lookup from the width of the path's ray cone where it
+    // hits, as the GPU renderer does. Off, every lookup reads the first level.
+    bool RayConeLod = true;
+
+    // Bounces of a path, counting the camera ray's: DrawConstants::MaxDepth.
+    uint32_t MaxDepth = 3;
+
+    // Paths this deep or deeper face Russian roulette before each further bounce:
+    // DrawConstants::RouletteDepth. 0 turns it off, which leaves the image as it was.
+    uint32_t RouletteDepth = 0;
+
+    // How each shading point picks the lights it sends shadow rays to. Samplers other than All
+    // pick LightSamples of them, and weight each by the inverse of its probability.
+    LightSamplerType LightSampler = LightSamplerType::All;
+    uint32_t LightSamples = 1;
+
+    // Traces the bounce and shadow rays of each wave in the order of their RaySorter keys. The
+    // image is the same either way. Wavefront only.
+    bool SortRays = false;
+
+    // Traces with the scalar kernel and counts the nodes visited into RenderStats::VisitedNodes.
+    // Wavefront only.
+    bool CountNodes = false;
+
+    // Fills in RenderStats::Depths, which reads the clock at every bounce of the megakernel.
+    bool TimeDepths = false;
+
+    // Adaptive sampling. Samples are taken in passes of AdaptiveBatchSize, after each of which
+    // pixels whose relative standard error of the mean luminance is below the threshold stop
+    // taking any. Pixels never take more than SamplesPerPixel. 0 turns it off.
+    float AdaptiveThreshold = 0.f;
+    uint32_t AdaptiveBatchSize = 16;
+};
+
+struct DepthStats
+{
+    // Camera or bounce rays traced at the depth, and the shadow rays of their hits.
+    uint64_t Rays = 0;
+
+    // Summed over the threads. Doesn't include adding samples to the film.
+    double Ms = 0.0;
+};
+
+struct RenderStats
+{
+    uint64_t CameraRays = 0;
+    uint64_t ShadowRays = 0;
+    uint64_t BounceRays = 0;
+
+    // Tiles a worker took from another worker's run after finishing its own.
+    uint64_t StolenTiles = 0;
+
+    uint32_t Passes = 0;
+
+    // Summed over the threads.
+    double SortMs = 0.0;
+
+    // Top level and BLAS nodes, with RenderOptions::CountNodes.
+    uint64_t VisitedNodes = 0;
+
+    // Index 0 is the depth of camera rays. Empty unless RenderOptions::TimeDepths is set.
+    std::vector<DepthStats> Depths;
+};
+
+// The ray RayGenShader shoots through filmPos, in pixels.
+Ray GenerateCameraRay(const SceneCamera& camera, glm::vec2 filmPos, glm::uvec2 dimensions);
+
+// The ray cone RayGenShader starts every path with.
+RayCone GetCameraRayCone(const SceneCamera& camera, glm::uvec2 dimensions);
+
+// The interpolated world space normal ClosestHitShader computes for a hit.
+glm::vec3 GetShadingNormal(const CpuScene& scene, const RayHit& hit);
+
+// Where ClosestHitShader looks up the reflectance of a hit on textured geometry.
+struct TextureLookup
+{
+    uint32_t TextureIdx = 0;
+    glm::vec2 UV;
+
+    // From the width of the ray's cone at the hit, which may be past the last level.
+    float Lod = 0.f;
+};
+
+// False for hits on geometry without a texture. normal is the hit's shading normal.
+bool GetTextureLookup(const CpuScene& scene, const Ray& ray, const RayHit& hit, glm::vec3 normal,
+                      RayCone cone, TextureLookup* lookup);
+
+// Runs the integrator of RayGenShader, or its wavefront version, for every sample of every pixel
+// and adds the samples to the film, which sums them the same way as the GPU film. Each pass keeps
+// a work list of the pixels that still take samples, grouped by film tile, and schedules its tiles
+// across the pool's workers with a TileScheduler.
+RenderStats RenderScene(const CpuScene& scene, const RenderOptions& options, ThreadPool* pool,
+                        Film* film);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+struct Ray
+{
+    glm::vec3 Origin;
+    float TMin = 0.f;
+
+    glm::vec3 Direction;
+    float TMax = 0.f;
+};
+
+struct RayHit
+{
+    float T = 0.f;
+
+    // Weights of the second and third vertex, as in BuiltInTriangleIntersectionAttributes.
+    glm::vec2 Barycentrics;
+
+    uint32_t InstanceIdx = 0;
+    uint32_t GeometryIdx = 0;
+    uint32_t PrimitiveIdx = 0;
+
+    // The hit group record DXR would pick, with no ray contribution and a geometry multiplier of 1.
+    uint32_t HitGroupIdx = 0;
+};
+
+enum class FaceCulling
+{
+    None,
+    Back,
+    Front,
+};
@@ -0,0 +1,89 @@
+#include "RaySorter.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+
+constexpr uint32_t kCellCount = 1u << RaySorter::kCellBits;
+
+// Morton code bits and the three of the octant.
+constexpr uint32_t kKeyBits = 3 * RaySorter::kCellBits + 3;
+
+constexpr uint32_t kDigitBits = 8;
+
+// Spreads the low kCellBits bits of x out to every third bit.
+uint32_t ExpandBits(uint32_t x)
+{
+    x &= kCellCount - 1;
+    x = (x | (x << 16)) & 0x030000ff;
+    x = (x | (x << 8)) & 0x0300f00f;
+    x = (x | (x << 4)) & 0x030c30c3;
+    x = (x | (x << 2)) & 0x09249249;
+
+    return x;
+}
+
+} // namespace
+
+RaySorter::RaySorter(const Aabb& sceneBounds) : m_boundsMin(sceneBounds.Min)
+{
+    // Flat or empty bounds put every origin in the first cell along that axis.
+    glm::vec3 extent = glm::max(sceneBounds.Max - sceneBounds.Min, glm::vec3(0.f));
+    m_cellScale = glm::vec3(kCellCount) / glm::max(extent, glm::vec3(1e-20f));
+}
+
+uint32_t RaySorter::GetKey(const Ray& ray) const
+{
+    // Origins outside of the bounds go to the nearest cell.
+    glm::vec3 cell = glm::min(glm::max((ray.Origin - m_boundsMin) * m_cellScale, glm::vec3(0.f)),
+                              glm::vec3(kCellCount - 1));
+
+    uint32_t morton = (ExpandBits(static_cast<uint32_t>(cell.x)) << 2) |
+                      (ExpandBits(static_cast<uint32_t>(cell.y)) << 1) |
+                      ExpandBits(static_cast<uint32_t>(cell.z));
+
+    uint32_t octant = (ray.Direction.x < 0.f ? 1u : 0u) | (ray.Direction.y < 0.f ? 2u : 0u) |
+                      (ray.Direction.z < 0.f ? 4u : 0u);
+
+    return (morton << 3) | octant;
+}
+
+void RaySorter::Sort(std::span<uint32_t> indices, const Ray* rays)
+{
+    m_items.resize(indices.size());
+    m_scratch.resize(indices.size());
+
+    for (size_t i = 0; i < indices.size(); ++i)
+        m_items[i] = (static_cast<uint64_t>(GetKey(rays[indices[i]])) << 32) | indices[i];
+
+    for (uint32_t shift = 32; shift < 32 + kKeyBits; shift += kDigitBits)
+    {
+        size_t offsets[1u << kDigitBits] = {};
+
+        for (uint64_t item : m_items)
+            ++offsets[(item >> shift) & ((1u << kDigitBits) - 1)];
+
+        // Batches whose keys all share the digit, such as rays from one corner of the scene, skip
+        // the scatter.
+        if (std::find(std::begin(offsets), std::end(offsets), m_items.size()) !=
+            std::end(offsets))
+        {
+            continue;
+        }
+
+        size_t sum = 0;
+
+        for (size_t& offset : offsets)
+            sum += std::exchange(offset, sum);
+
+        for (uint64_t item : m_items)
+            m_scratch[offsets[(item >> shift) & ((1u << kDigitBits) - 1)]++] = item;
+
+        std::swap(m_items, m_scratch);
+    }
+
+    for (size_t i = 0; i < indices.size(); ++i)
+        indices[i] = static_cast<uint32_t>(m_items[i]);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Bvh.h"
+#include "Ray.h"
+
+#include <span>
+#include <vector>
+
+// Orders a batch of rays so that rays starting close to each other and heading into the same
+// direction octant are traced one after the other, and so walk the same parts of the
+// acceleration structure while they are still in cache. The key of a ray is the Morton code of
+// the cell of a grid over the scene bounds its origin is in, followed by its direction octant.
+// Keys are sorted with a least significant digit radix sort, which is stable, so rays with the
+// same key keep their order.
+class RaySorter
+{
+public:
+    explicit RaySorter(const Aabb& sceneBounds);
+
+    uint32_t GetKey(const Ray& ray) const;
+
+    // Reorders indices so that the keys of rays[indices[i]] are ascending.
+    void Sort(std::span<uint32_t> indices, const Ray* rays);
+
+    // Cells per axis of the grid over the scene bounds.
+    static constexpr uint32_t kCellBits = 7;
+
+private:
+    glm::vec3 m_boundsMin;
+    glm::vec3 m_cellScale;
+
+    // The key in the high half and the index in the low half.
+    std::vector<uint64_t> m_items;
+    std::vector<uint64_t> m_scratch;
+};
@@ -0,0 +1,90 @@
+#include "Texture.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+
+uint32_t Wrap(int64_t coord, uint32_t size)
+{
+    int64_t wrapped = coord % size;
+
+    return static_cast<uint32_t>(wrapped < 0 ? wrapped + size : wrapped);
+}
+
+// The four texels around uv, whose centers are half a texel in from its corners.
+uint32_t GetBilinearTaps(const Image& image, uint32_t level, glm::vec2 uv, float weight,
+                         TexelTap* taps)
+{
+    float x = uv.x * static_cast<float>(image.Info.Width) - 0.5f;
+    float y = uv.y * static_cast<float>(image.Info.Height) - 0.5f;
+
+    float x0 = std::floor(x);
+    float y0 = std::floor(y);
+
+    float fx = x - x0;
+    float fy = y - y0;
+
+    uint32_t left = Wrap(static_cast<int64_t>(x0), image.Info.Width);
+    uint32_t right = Wrap(static_cast<int64_t>(x0) + 1, image.Info.Width);
+    uint32_t bottom = Wrap(static_cast<int64_t>(y0), image.Info.Height);
+    uint32_t top = Wrap(static_cast<int64_t>(y0) + 1, image.Info.Height);
+
+    taps[0] = {level, left, bottom, weight * (1.f - fx) * (1.f - fy)};
+    taps[1] = {level, right, bottom, weight * fx * (1.f - fy)};
+    taps[2] = {level, left, top, weight * (1.f - fx) * fy};
+    taps[3] = {level, right, top, weight * fx * fy};
+
+    return 4;
+}
+
+} // namespace
+
+uint32_t GetTrilinearTaps(const CpuTexture& texture, glm::vec2 uv, float lod,
+                          TexelTap taps[kMaxTrilinearTaps])
+{
+    lod = std::clamp(lod, 0.f, static_cast<float>(texture.Levels.size() - 1));
+
+    uint32_t level = static_cast<uint32_t>(lod);
+    float blend = lod - static_cast<float>(level);
+
+    uint32_t count = GetBilinearTaps(texture.Levels[level], level, uv, 1.f - blend, taps);
+
+    if (blend > 0.f)
+        count += GetBilinearTaps(texture.Levels[level + 1], level + 1, uv, blend, taps + count);
+
+    return count;
+}
+
+glm::vec4 LoadTexel(const Image& level, uint32_t x, uint32_t y)
+{
+    size_t texelIdx = static_cast<size_t>(y) * level.Info.Width + x;
+    const std::byte* texel = &level.Pixels[texelIdx * GetPixelSize(level.Info.Format)];
+
+    if (level.Info.Format == PixelFormat::RGBA32F)
+    {
+        glm::vec4 value;
+        memcpy(&value, texel, sizeof(value));
+
+        return value;
+    }
+
+    return glm::vec4(static_cast<uint8_t>(texel[0]), static_cast<uint8_t>(texel[1]),
+                     static_cast<uint8_t>(texel[2]), static_cast<uint8_t>(texel[3])) /
+           255.f;
+}
+
+glm::vec4 SampleLevel(const CpuTexture& texture, glm::vec2 uv, float lod)
+{
+    TexelTap taps[kMaxTrilinearTaps];
+    uint32_t count = GetTrilinearTaps(texture, uv, lod, taps);
+
+    glm::vec4 value(0.f);
+
+    for (uint32_t i = 0; i < count; ++i)
+        value += taps[i].Weight * LoadTexel(texture.Levels[taps[i].Level], taps[i].X, taps[i].Y);
+
+    return value;
+}
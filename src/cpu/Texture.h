@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Image.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// A texture and its mip chain, as BuildMipChain makes it.
+struct CpuTexture
+{
+    std::vector<Image> Levels;
+};
+
+// A texel a lookup reads and how much it adds.
+struct TexelTap
+{
+    uint32_t Level = 0;
+    uint32_t X = 0;
+    uint32_t Y = 0;
+    float Weight = 0.f;
+};
+
+static constexpr uint32_t kMaxTrilinearTaps = 8;
+
+// The texels of the lookup SampleLevel makes, and their weights: bilinear filtering with wrapped
+// addressing in the two levels either side of lod, which is clamped to the chain, blended by where
+// lod falls between them. Returns how many taps there are.
+uint32_t GetTrilinearTaps(const CpuTexture& texture, glm::vec2 uv, float lod,
+                          TexelTap taps[kMaxTrilinearTaps]);
+
+// RGBA8 texels are read as UNORM, like the GPU texture, so sRGB texels are filtered as they are
+// encoded.
+glm::vec4 LoadTexel(const Image& level, uint32_t x, uint32_t y);
+
+// Texture2D::SampleLevel with the scene's sampler, D3D12_FILTER_MIN_MAG_MIP_LINEAR and
+// D3D12_TEXTURE_ADDRESS_MODE_WRAP.
+glm::vec4 SampleLevel(const CpuTexture& texture, glm::vec2 uv, float lod);
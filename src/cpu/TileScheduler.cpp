@@ -0,0 +1,109 @@
+#include "TileScheduler.h"
+
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+
+uint64_t PackRange(uint64_t begin, uint64_t end)
+{
+    return begin | (end << 32);
+}
+
+uint32_t GetBegin(uint64_t range)
+{
+    return static_cast<uint32_t>(range);
+}
+
+uint32_t GetEnd(uint64_t range)
+{
+    return static_cast<uint32_t>(range >> 32);
+}
+
+} // namespace
+
+TileScheduler::TileScheduler(size_t tileCount, size_t workerCount) : m_runs(workerCount)
+{
+    if (workerCount == 0)
+        throw std::runtime_error("A tile scheduler needs at least one worker.");
+
+    if (tileCount > std::numeric_limits<uint32_t>::max())
+        throw std::runtime_error("Too many tiles to schedule.");
+
+    for (size_t i = 0; i < workerCount; ++i)
+    {
+        uint64_t begin = tileCount * i / workerCount;
+        uint64_t end = tileCount * (i + 1) / workerCount;
+
+        m_runs[i].Range.store(PackRange(begin, end), std::memory_order_relaxed);
+    }
+}
+
+bool TileScheduler::Next(size_t workerIdx, size_t* tileIdx)
+{
+    if (TakeFront(&m_runs[workerIdx], tileIdx))
+        return true;
+
+    // Runs only ever shrink, so once a pass finds them all empty there is nothing left.
+    for (;;)
+    {
+        Run* victim = nullptr;
+        uint32_t victimSize = 0;
+
+        for (Run& run : m_runs)
+        {
+            uint64_t range = run.Range.load(std::memory_order_relaxed);
+            uint32_t size = GetEnd(range) - GetBegin(range);
+
+            if (size > victimSize)
+            {
+                victim = &run;
+                victimSize = size;
+            }
+        }
+
+        if (!victim)
+            return false;
+
+        if (TakeBack(victim, tileIdx))
+        {
+            m_stealCount.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+}
+
+bool TileScheduler::TakeFront(Run* run, size_t* tileIdx)
+{
+    uint64_t range = run->Range.load(std::memory_order_relaxed);
+
+    while (GetBegin(range) < GetEnd(range))
+    {
+        if (run->Range.compare_exchange_weak(range, PackRange(GetBegin(range) + 1, GetEnd(range)),
+                                             std::memory_order_relaxed))
+        {
+            *tileIdx = GetBegin(range);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool TileScheduler::TakeBack(Run* run, size_t* tileIdx)
+{
+    uint64_t range = run->Range.load(std::memory_order_relaxed);
+
+    while (GetBegin(range) < GetEnd(range))
+    {
+        if (run->Range.compare_exchange_weak(range, PackRange(GetBegin(range), GetEnd(range) - 1),
+                                             std::memory_order_relaxed))
+        {
+            *tileIdx = GetEnd(range) - 1;
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Hands out each of [0, tileCount) exactly once across a fixed set of workers, without locks.
+// Every worker starts with a contiguous run of tiles, which it takes from the front so that its
+// tiles stay neighbours. A worker whose run is empty steals from the back of the longest
+// remaining run.
+class TileScheduler
+{
+public:
+    TileScheduler(size_t tileCount, size_t workerCount);
+
+    size_t GetWorkerCount() const
+    {
+        return m_runs.size();
+    }
+
+    // Returns false once every tile has been handed out.
+    bool Next(size_t workerIdx, size_t* tileIdx);
+
+    // How many tiles were stolen from other workers' runs so far.
+    size_t GetStealCount() const
+    {
+        return m_stealCount.load(std::memory_order_relaxed);
+    }
+
+private:
+    // The remaining tiles [begin, end) of a worker, packed as begin | end << 32 so that the owner
+    // and the thieves can both claim tiles with a single compare and swap.
+    struct alignas(64) Run
+    {
+        std::atomic<uint64_t> Range;
+    };
+
+    bool TakeFront(Run* run, size_t* tileIdx);
+    bool TakeBack(Run* run, size_t* tileIdx);
+
+    std::vector<Run> m_runs;
+    std::atomic<size_t> m_stealCount = 0;
+};
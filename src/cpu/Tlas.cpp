@@ -0,0 +1,313 @@
+#include "Tlas.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+
+void Tlas::Build(std::vector<Bvh> blases, std::vector<TlasInstance> instances, ThreadPool* pool)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<Aabb> instanceBounds(instances.size());
+
+    for (size_t i = 0; i < instances.size(); ++i)
+    {
+        const TlasInstance& instance = instances[i];
+
+        if (instance.BlasIdx >= blases.size())
+            throw std::runtime_error("Instance refers to a missing BLAS.");
+
+        Aabb blasBounds = blases[instance.BlasIdx].GetBounds();
+
+        // An empty BLAS keeps its inverted bounds, which no ray can enter.
+        if (blasBounds.Min.x > blasBounds.Max.x)
+            continue;
+
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            glm::vec3 p((corner & 1) ? blasBounds.Max.x : blasBounds.Min.x,
+                        (corner & 2) ? blasBounds.Max.y : blasBounds.Min.y,
+                        (corner & 4) ? blasBounds.Max.z : blasBounds.Min.z);
+
+            instanceBounds[i].Grow(glm::vec3(instance.Transform * glm::vec4(p, 1.f)));
+        }
+    }
+
+    std::vector<uint32_t> order;
+    BuildBvhNodes(instanceBounds, pool, &m_nodes, &order);
+
+    m_instances.clear();
+    m_instances.reserve(order.size());
+
+    for (uint32_t instanceIdx : order)
+    {
+        const TlasInstance& source = instances[instanceIdx];
+
+        glm::mat3 linear(source.Transform);
+
+        Instance& instance = m_instances.emplace_back();
+        instance.InverseLinear = glm::inverse(linear);
+        instance.Translation = glm::vec3(source.Transform[3]);
+        instance.BlasIdx = source.BlasIdx;
+        instance.InstanceIdx = instanceIdx;
+        instance.InstanceMask = source.InstanceMask & 0xff;
+        instance.InstanceContributionToHitGroupIndex = source.InstanceContributionToHitGroupIndex;
+        instance.FlipsFacing = glm::determinant(linear) < 0.f;
+    }
+
+    m_blases = std::move(blases);
+
+    m_buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+                    .count();
+}
+
+// The direction isn't renormalized, so distances along the ray stay the same.
+Ray Tlas::ToObjectRay(const Instance& instance, const Ray& ray, float tMax)
+{
+    Ray objectRay{};
+    objectRay.Origin = instance.InverseLinear * (ray.Origin - instance.Translation);
+    objectRay.Direction = instance.InverseLinear * ray.Direction;
+    objectRay.TMin = ray.TMin;
+    objectRay.TMax = tMax;
+
+    return objectRay;
+}
+
+FaceCulling Tlas::GetCulling(const Instance& instance, bool cullBackFaces)
+{
+    if (!cullBackFaces)
+        return FaceCulling::None;
+
+    return instance.FlipsFacing ? FaceCulling::Front : FaceCulling::Back;
+}
+
+bool Tlas::Intersect(const Ray& ray, uint32_t instanceInclusionMask, bool cullBackFaces,
+                     RayHit* hit) const
+{
+    return Intersect(ray, instanceInclusionMask, cullBackFaces, hit, nullptr);
+}
+
+bool Tlas::Intersect(const Ray& ray, uint32_t instanceInclusionMask, bool cullBackFaces,
+                     RayHit* hit, uint64_t* visitedNodes) const
+{
+    float closestT = ray.TMax;
+    bool found = false;
+
+    TraverseBvh(m_nodes, ray, &closestT, [&](const BvhNode& node, float* tMax) {
+        for (uint32_t i = node.Offset; i < node.Offset + node.PrimitiveCount; ++i)
+        {
+            const Instance& instance = m_instances[i];
+
+            if ((instance.InstanceMask & instanceInclusionMask) == 0)
+                continue;
+
+            const Bvh& blas = m_blases[instance.BlasIdx];
+            Ray objectRay = ToObjectRay(instance, ray, *tMax);
+            FaceCulling culling = GetCulling(instance, cullBackFaces);
+
+            bool blasHit = visitedNodes ? blas.Intersect(objectRay, culling, hit, visitedNodes)
+                                        : blas.Intersect(objectRay, culling, hit);
+
+            if (!blasHit)
+                continue;
+
+            *tMax = hit->T;
+            found = true;
+
+            hit->InstanceIdx = instance.InstanceIdx;
+            hit->HitGroupIdx = instance.InstanceContributionToHitGroupIndex + hit->GeometryIdx;
+        }
+
+        return false;
+    }, visitedNodes);
+
+    return found;
+}
+
+bool Tlas::Occluded(const Ray& ray, uint32_t instanceInclusionMask, bool cullBackFaces) const
+{
+    return Occluded(ray, instanceInclusionMask, cullBackFaces, nullptr);
+}
+
+bool Tlas::Occluded(const Ray& ray, uint32_t instanceInclusionMask, bool cullBackFaces,
+                    uint64_t* visitedNodes) const
+{
+    float closestT = ray.TMax;
+    bool occluded = false;
+
+    TraverseBvh(m_nodes, ray, &closestT, [&](const BvhNode& node, float*) {
+        for (uint32_t i = node.Offset; i < node.Offset + node.PrimitiveCount; ++i)
+        {
+            const Instance& instance = m_instances[i];
+
+            if ((instance.InstanceMask & instanceInclusionMask) == 0)
+                continue;
+
+            const Bvh& blas = m_blases[instance.BlasIdx];
+            Ray objectRay = ToObjectRay(instance, ray, ray.TMax);
+            FaceCulling culling = GetCulling(instance, cullBackFaces);
+
+            if (visitedNodes ? blas.Occluded(objectRay, culling, visitedNodes)
+                             : blas.Occluded(objectRay, culling))
+            {
+                occluded = true;
+                return true;
+            }
+        }
+
+        return false;
+    }, visitedNodes);
+
+    return occluded;
+}
+
+uint32_t Tlas::IntersectPacket(std::span<const Ray> rays, uint32_t instanceInclusionMask,
+                               bool cullBackFaces, RayHit* hits) const
+{
+    uint32_t rayCount = static_cast<uint32_t>(std::min<size_t>(rays.size(), Bvh::kMaxPacketSize));
+
+    if (m_nodes.empty() || rayCount == 0)
+        return 0;
+
+    glm::vec3 invDirs[Bvh::kMaxPacketSize];
+    float closestT[Bvh::kMaxPacketSize];
+
+    for (uint32_t lane = 0; lane < rayCount; ++lane)
+    {
+        invDirs[lane] = 1.f / rays[lane].Direction;
+        closestT[lane] = rays[lane].TMax;
+    }
+
+    // Returns the lanes of mask whose rays enter the node before their closest hit.
+    auto enterNode = [&](const BvhNode& node, uint32_t mask) {
+        uint32_t entered = 0;
+
+        for (uint32_t lane = 0; lane < rayCount; ++lane)
+        {
+            if ((mask & (1u << lane)) &&
+                IntersectBounds(node.Min, node.Max, rays[lane], invDirs[lane], closestT[lane]) !=
+                    std::numeric_limits<float>::infinity())
+            {
+                entered |= 1u << lane;
+            }
+        }
+
+        return entered;
+    };
+
+    struct StackEntry
+    {
+        uint32_t NodeIdx;
+        uint32_t LaneMask;
+    };
+
+    StackEntry stack[kBvhMaxDepth];
+    int stackSize = 0;
+
+    uint32_t rootMask = enterNode(m_nodes[0], (1u << rayCount) - 1);
+
+    if (rootMask != 0)
+        stack[stackSize++] = {0, rootMask};
+
+    uint32_t hitMask = 0;
+
+    while (stackSize > 0)
+    {
+        StackEntry entry = stack[--stackSize];
+
+        const BvhNode& node = m_nodes[entry.NodeIdx];
+
+        if (node.PrimitiveCount == 0)
+        {
+            for (uint32_t childIdx : {node.Offset, entry.NodeIdx + 1})
+            {
+                uint32_t childMask = enterNode(m_nodes[childIdx], entry.LaneMask);
+
+                if (childMask != 0)
+                    stack[stackSize++] = {childIdx, childMask};
+            }
+
+            continue;
+        }
+
+        for (uint32_t i = node.Offset; i < node.Offset + node.PrimitiveCount; ++i)
+        {
+            const Instance& instance = m_instances[i];
+
+            if ((instance.InstanceMask & instanceInclusionMask) == 0)
+                continue;
+
+            Ray objectRays[Bvh::kMaxPacketSize];
+
+            for (uint32_t lane = 0; lane < rayCount; ++lane)
+                objectRays[lane] = ToObjectRay(instance, rays[lane], closestT[lane]);
+
+            uint32_t instanceHits = m_blases[instance.BlasIdx].IntersectPacket(
+                std::span(objectRays, rayCount), entry.LaneMask,
+                GetCulling(instance, cullBackFaces), hits);
+
+            for (uint32_t lane = 0; lane < rayCount; ++lane)
+            {
+                if ((instanceHits & (1u << lane)) == 0)
+                    continue;
+
+                closestT[lane] = hits[lane].T;
+
+                hits[lane].InstanceIdx = instance.InstanceIdx;
+                hits[lane].HitGroupIdx =
+                    instance.InstanceContributionToHitGroupIndex + hits[lane].GeometryIdx;
+            }
+
+            hitMask |= instanceHits;
+        }
+    }
+
+    return hitMask;
+}
+
+void Tlas::SetKernel(BvhKernel kernel, ThreadPool* pool)
+{
+    auto setKernel = [&](size_t blasIdx) { m_blases[blasIdx].SetKernel(kernel); };
+
+    if (pool)
+    {
+        pool->ParallelFor(m_blases.size(), setKernel);
+    }
+    else
+    {
+        for (size_t blasIdx = 0; blasIdx < m_blases.size(); ++blasIdx)
+            setKernel(blasIdx);
+    }
+}
+
+Aabb Tlas::GetBounds() const
+{
+    Aabb bounds;
+
+    if (!m_nodes.empty())
+    {
+        bounds.Min = m_nodes[0].Min;
+        bounds.Max = m_nodes[0].Max;
+    }
+
+    return bounds;
+}
+
+TlasStats Tlas::GetStats() const
+{
+    TlasStats stats{};
+    stats.BuildMs = m_buildMs;
+    stats.BlasCount = m_blases.size();
+    stats.InstanceCount = m_instances.size();
+
+    stats.MemoryBytes = m_nodes.size() * sizeof(BvhNode) + m_instances.size() * sizeof(Instance);
+
+    for (const Bvh& blas : m_blases)
+        stats.MemoryBytes += blas.GetMemoryBytes();
+
+    for (const Instance& instance : m_instances)
+        stats.FlattenedMemoryBytes += m_blases[instance.BlasIdx].GetMemoryBytes();
+
+    return stats;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Bvh.h"
+
+#include <glm/glm.hpp>
+
+#include <span>
+#include <vector>
+
+// The D3D12_RAYTRACING_INSTANCE_DESC fields the CPU backend uses.
+struct TlasInstance
+{
+    // Object to world. Must be affine.
+    glm::mat4 Transform = glm::mat4(1.f);
+
+    uint32_t BlasIdx = 0;
+
+    // Only the low 8 bits are used, as in DXR.
+    uint32_t InstanceMask = 0xff;
+
+    uint32_t InstanceContributionToHitGroupIndex = 0;
+};
+
+struct TlasStats
+{
+    double BuildMs = 0.0;
+
+    size_t BlasCount = 0;
+    size_t InstanceCount = 0;
+
+    // BLASes, instances and top level nodes.
+    size_t MemoryBytes = 0;
+
+    // What a single BVH with every instance's triangles baked in would take, estimated from the
+    // size of each instance's BLAS.
+    size_t FlattenedMemoryBytes = 0;
+};
+
+// Two-level acceleration structure: a BVH over the world space bounds of instances, each of which
+// places a BLAS built over one mesh in object space.
+class Tlas
+{
+public:
+    // The BLASes have to be built already. Instances may share them.
+    void Build(std::vector<Bvh> blases, std::vector<TlasInstance> instances,
+               ThreadPool* pool = nullptr);
+
+    // Like TraceRay: instances whose InstanceMask shares no bit with instanceInclusionMask are
+    // skipped. Facing is decided in world space, as if the transforms were baked into the
+    // triangles, so mirroring transforms don't flip which faces get culled.
+    bool Intersect(const Ray& ray, uint32_t instanceInclusionMask, bool cullBackFaces,
+                   RayHit* hit) const;
+
+    // The occlusion query of a shadow ray traced with RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH and
+    // RAY_FLAG_SKIP_CLOSEST_HIT_SHADER: whether anything is hit in [TMin, TMax], stopping at the
+    // first hit found.
+    bool Occluded(const Ray& ray, uint32_t instanceInclusionMask, bool cullBackFaces) const;
+
+    // Intersect and Occluded with every BLAS traced by the scalar kernel, adding the top level and
+    // BLAS nodes they visit to *visitedNodes. For statistics, see Bvh::Intersect.
+    bool Intersect(const Ray& ray, uint32_t instanceInclusionMask, bool cullBackFaces,
+                   RayHit* hit, uint64_t* visitedNodes) const;
+    bool Occluded(const Ray& ray, uint32_t instanceInclusionMask, bool cullBackFaces,
+                  uint64_t* visitedNodes) const;
+
+    // Traces up to Bvh::kMaxPacketSize rays together through the top level and each BLAS they
+    // reach. Returns the lanes that found a hit.
+    uint32_t IntersectPacket(std::span<const Ray> rays, uint32_t instanceInclusionMask,
+                             bool cullBackFaces, RayHit* hits) const;
+
+    // Sets the kernel of every BLAS. The top level is small and always traced as a binary tree.
+    void SetKernel(BvhKernel kernel, ThreadPool* pool = nullptr);
+
+    size_t GetNodeCount() const
+    {
+        return m_nodes.size();
+    }
+
+    // World space bounds of every instance.
+    Aabb GetBounds() const;
+
+    TlasStats GetStats() const;
+
+private:
+    struct Instance
+    {
+        // World to object, as the inverse of the linear part and the world space translation.
+        glm::mat3 InverseLinear;
+        glm::vec3 Translation;
+
+        uint32_t BlasIdx = 0;
+        uint32_t InstanceIdx = 0;
+        uint32_t InstanceMask = 0;
+        uint32_t InstanceContributionToHitGroupIndex = 0;
+
+        bool FlipsFacing = false;
+    };
+
+    static Ray ToObjectRay(const Instance& instance, const Ray& ray, float tMax);
+    static FaceCulling GetCulling(const Instance& instance, bool cullBackFaces);
+
+    std::vector<Bvh> m_blases;
+
+    // In leaf order.
+    std::vector<Instance> m_instances;
+
+    std::vector<BvhNode> m_nodes;
+
+    double m_buildMs = 0.0;
+};
@@ -0,0 +1,241 @@
+#include "WideBvh.h"
+
+#include <stdexcept>
+
+#if PBRT_X86_SIMD
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#endif
+
+#if PBRT_X86_SIMD
+
+static bool CpuSupportsAvx2()
+{
+#ifdef _MSC_VER
+    int info[4] = {};
+    __cpuid(info, 0);
+
+    if (info[0] < 7)
+        return false;
+
+    __cpuid(info, 1);
+
+    // The OS has to save the AVX registers too, which OSXSAVE and XCR0 tell.
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+        return false;
+
+    __cpuidex(info, 7, 0);
+
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+bool IsBvhKernelSupported(BvhKernel kernel)
+{
+    switch (kernel)
+    {
+    case BvhKernel::Scalar:
+        return true;
+#if PBRT_X86_SIMD
+    case BvhKernel::Sse:
+        return true;
+    case BvhKernel::Avx2:
+        return CpuSupportsAvx2();
+#endif
+    default:
+        return false;
+    }
+}
+
+BvhKernel GetBestBvhKernel()
+{
+    static const BvhKernel kernel = [] {
+        for (BvhKernel candidate : {BvhKernel::Avx2, BvhKernel::Sse})
+        {
+            if (IsBvhKernelSupported(candidate))
+                return candidate;
+        }
+
+        return BvhKernel::Scalar;
+    }();
+
+    return kernel;
+}
+
+BvhKernel ParseBvhKernel(const std::string& name)
+{
+    BvhKernel kernel = BvhKernel::Scalar;
+
+    if (name == "auto")
+        kernel = GetBestBvhKernel();
+    else if (name == "scalar")
+        kernel = BvhKernel::Scalar;
+    else if (name == "sse")
+        kernel = BvhKernel::Sse;
+    else if (name == "avx2")
+        kernel = BvhKernel::Avx2;
+    else
+        throw std::runtime_error("Unknown BVH kernel: " + name);
+
+    if (!IsBvhKernelSupported(kernel))
+        throw std::runtime_error("This CPU doesn't support the " + name + " BVH kernel.");
+
+    return kernel;
+}
+
+const char* GetBvhKernelName(BvhKernel kernel)
+{
+    switch (kernel)
+    {
+    case BvhKernel::Scalar:
+        return "scalar";
+    case BvhKernel::Sse:
+        return "sse";
+    case BvhKernel::Avx2:
+        return "avx2";
+    }
+
+    return "unknown";
+}
+
+#if PBRT_X86_SIMD
+
+namespace
+{
+
+// SSE2 is part of x86-64, so this needs no special compiler flags.
+struct Ops
+{
+    static constexpr int Width = 4;
+
+    using Float = __m128;
+
+    static Float Load(const float* p)
+    {
+        return _mm_load_ps(p);
+    }
+
+    static void Store(float* p, Float a)
+    {
+        _mm_store_ps(p, a);
+    }
+
+    static Float Set1(float a)
+    {
+        return _mm_set1_ps(a);
+    }
+
+    static Float Add(Float a, Float b)
+    {
+        return _mm_add_ps(a, b);
+    }
+
+    static Float Sub(Float a, Float b)
+    {
+        return _mm_sub_ps(a, b);
+    }
+
+    static Float Mul(Float a, Float b)
+    {
+        return _mm_mul_ps(a, b);
+    }
+
+    static Float Div(Float a, Float b)
+    {
+        return _mm_div_ps(a, b);
+    }
+
+    static Float Min(Float a, Float b)
+    {
+        return _mm_min_ps(a, b);
+    }
+
+    static Float Max(Float a, Float b)
+    {
+        return _mm_max_ps(a, b);
+    }
+
+    static Float And(Float a, Float b)
+    {
+        return _mm_and_ps(a, b);
+    }
+
+    static Float Less(Float a, Float b)
+    {
+        return _mm_cmplt_ps(a, b);
+    }
+
+    static Float LessEqual(Float a, Float b)
+    {
+        return _mm_cmple_ps(a, b);
+    }
+
+    static Float NotEqual(Float a, Float b)
+    {
+        return _mm_cmpneq_ps(a, b);
+    }
+
+    static Float Select(Float mask, Float a, Float b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    static int MoveMask(Float mask)
+    {
+        return _mm_movemask_ps(mask);
+    }
+
+    // Summed in the same order as glm::dot, so that hits match the scalar kernel.
+    static Float Dot(const Float a[3], const Float b[3])
+    {
+        return Add(Add(Mul(a[0], b[0]), Mul(a[1], b[1])), Mul(a[2], b[2]));
+    }
+};
+
+} // namespace
+
+#include "WideBvhKernels.h"
+
+bool IntersectSse(const WideBvh<4>& bvh, const Ray& ray, FaceCulling culling, RayHit* hit)
+{
+    return IntersectWide<Ops>(bvh, ray, culling, hit);
+}
+
+bool OccludedSse(const WideBvh<4>& bvh, const Ray& ray, FaceCulling culling)
+{
+    return OccludedWide<Ops>(bvh, ray, culling);
+}
+
+uint32_t IntersectPacketSse(const WideBvh<4>& bvh, const Ray* rays, uint32_t activeMask,
+                            FaceCulling culling, RayHit* hits)
+{
+    return IntersectPacketWide<Ops>(bvh, rays, activeMask, culling, hits);
+}
+
+#else
+
+bool IntersectSse(const WideBvh<4>&, const Ray&, FaceCulling, RayHit*)
+{
+    throw std::runtime_error("The SSE BVH kernel needs an x86-64 build.");
+}
+
+bool OccludedSse(const WideBvh<4>&, const Ray&, FaceCulling)
+{
+    throw std::runtime_error("The SSE BVH kernel needs an x86-64 build.");
+}
+
+uint32_t IntersectPacketSse(const WideBvh<4>&, const Ray*, uint32_t, FaceCulling, RayHit*)
+{
+    throw std::runtime_error("The SSE BVH kernel needs an x86-64 build.");
+}
+
+#endif
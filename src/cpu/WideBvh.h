@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Ray.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define PBRT_X86_SIMD 1
+#else
+#define PBRT_X86_SIMD 0
+#endif
+
+// Bvh trees have at most this many levels, so that the stacks that traverse them can't overflow.
+static constexpr uint32_t kBvhMaxDepth = 64;
+
+// Which code traces rays through a Bvh. The wide kernels trace a copy of the binary tree collapsed
+// to nodes with 4 or 8 children, and test 4 or 8 triangles at a time.
+enum class BvhKernel
+{
+    Scalar,
+    Sse,
+    Avx2,
+};
+
+bool IsBvhKernelSupported(BvhKernel kernel);
+
+// The widest kernel this CPU supports.
+BvhKernel GetBestBvhKernel();
+
+// "scalar", "sse", "avx2" or "auto", which picks GetBestBvhKernel.
+BvhKernel ParseBvhKernel(const std::string& name);
+const char* GetBvhKernelName(BvhKernel kernel);
+
+// Child bounds are stored per axis, so that a kernel can test every child at once. Unused slots
+// have inverted bounds, which the kernels' slab test never enters.
+template<int Width>
+struct alignas(64) WideBvhNode
+{
+    float Min[3][Width];
+    float Max[3][Width];
+
+    // Child node index for interior children, first triangle pack for leaves.
+    uint32_t Offset[Width];
+
+    // Zero for interior children and unused slots.
+    uint32_t PackCount[Width];
+};
+
+// Triangles in the layout the Moller-Trumbore kernels load. Padding lanes are degenerate, so they
+// are never hit.
+template<int Width>
+struct alignas(64) TrianglePack
+{
+    float V0[3][Width];
+    float E1[3][Width];
+    float E2[3][Width];
+
+    uint32_t GeometryIdx[Width];
+    uint32_t PrimitiveIdx[Width];
+};
+
+template<int Width>
+struct WideBvh
+{
+    std::vector<WideBvhNode<Width>> Nodes;
+    std::vector<TrianglePack<Width>> Packs;
+};
+
+// Each kernel finds the closest hit in [TMin, TMax] like Bvh::Intersect, or any hit like
+// Bvh::Occluded. The packet versions trace the rays whose lanes are set in activeMask, of at most
+// Width rays, each up to its own TMax, and return the lanes that found a hit. They suit coherent
+// rays, such as camera rays.
+
+bool IntersectSse(const WideBvh<4>& bvh, const Ray& ray, FaceCulling culling, RayHit* hit);
+bool OccludedSse(const WideBvh<4>& bvh, const Ray& ray, FaceCulling culling);
+uint32_t IntersectPacketSse(const WideBvh<4>& bvh, const Ray* rays, uint32_t activeMask,
+                            FaceCulling culling, RayHit* hits);
+
+bool IntersectAvx2(const WideBvh<8>& bvh, const Ray& ray, FaceCulling culling, RayHit* hit);
+bool OccludedAvx2(const WideBvh<8>& bvh, const Ray& ray, FaceCulling culling);
+uint32_t IntersectPacketAvx2(const WideBvh<8>& bvh, const Ray* rays, uint32_t activeMask,
+                             FaceCulling culling, RayHit* hits);
@@ -0,0 +1,155 @@
+#include "WideBvh.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#if PBRT_X86_SIMD
+
+#include <immintrin.h>
+
+// Only the code below is compiled for AVX2, rather than the whole file, so that inline functions
+// from the headers above, which other files share, are never emitted with AVX2 instructions.
+// MSVC accepts AVX2 intrinsics anywhere and needs no pragma.
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+namespace
+{
+
+struct Ops
+{
+    static constexpr int Width = 8;
+
+    using Float = __m256;
+
+    static Float Load(const float* p)
+    {
+        return _mm256_load_ps(p);
+    }
+
+    static void Store(float* p, Float a)
+    {
+        _mm256_store_ps(p, a);
+    }
+
+    static Float Set1(float a)
+    {
+        return _mm256_set1_ps(a);
+    }
+
+    static Float Add(Float a, Float b)
+    {
+        return _mm256_add_ps(a, b);
+    }
+
+    static Float Sub(Float a, Float b)
+    {
+        return _mm256_sub_ps(a, b);
+    }
+
+    static Float Mul(Float a, Float b)
+    {
+        return _mm256_mul_ps(a, b);
+    }
+
+    static Float Div(Float a, Float b)
+    {
+        return _mm256_div_ps(a, b);
+    }
+
+    static Float Min(Float a, Float b)
+    {
+        return _mm256_min_ps(a, b);
+    }
+
+    static Float Max(Float a, Float b)
+    {
+        return _mm256_max_ps(a, b);
+    }
+
+    static Float And(Float a, Float b)
+    {
+        return _mm256_and_ps(a, b);
+    }
+
+    static Float Less(Float a, Float b)
+    {
+        return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+    }
+
+    static Float LessEqual(Float a, Float b)
+    {
+        return _mm256_cmp_ps(a, b, _CMP_LE_OQ);
+    }
+
+    static Float NotEqual(Float a, Float b)
+    {
+        return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ);
+    }
+
+    static Float Select(Float mask, Float a, Float b)
+    {
+        return _mm256_blendv_ps(b, a, mask);
+    }
+
+    static int MoveMask(Float mask)
+    {
+        return _mm256_movemask_ps(mask);
+    }
+
+    // Summed in the same order as glm::dot, so that hits match the scalar kernel.
+    static Float Dot(const Float a[3], const Float b[3])
+    {
+        return Add(Add(Mul(a[0], b[0]), Mul(a[1], b[1])), Mul(a[2], b[2]));
+    }
+};
+
+} // namespace
+
+#include "WideBvhKernels.h"
+
+bool IntersectAvx2(const WideBvh<8>& bvh, const Ray& ray, FaceCulling culling, RayHit* hit)
+{
+    return IntersectWide<Ops>(bvh, ray, culling, hit);
+}
+
+bool OccludedAvx2(const WideBvh<8>& bvh, const Ray& ray, FaceCulling culling)
+{
+    return OccludedWide<Ops>(bvh, ray, culling);
+}
+
+uint32_t IntersectPacketAvx2(const WideBvh<8>& bvh, const Ray* rays, uint32_t activeMask,
+                             FaceCulling culling, RayHit* hits)
+{
+    return IntersectPacketWide<Ops>(bvh, rays, activeMask, culling, hits);
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#else
+
+bool IntersectAvx2(const WideBvh<8>&, const Ray&, FaceCulling, RayHit*)
+{
+    throw std::runtime_error("The AVX2 BVH kernel needs an x86-64 build.");
+}
+
+bool OccludedAvx2(const WideBvh<8>&, const Ray&, FaceCulling)
+{
+    throw std::runtime_error("The AVX2 BVH kernel needs an x86-64 build.");
+}
+
+uint32_t IntersectPacketAvx2(const WideBvh<8>&, const Ray*, uint32_t, FaceCulling, RayHit*)
+{
+    throw std::runtime_error("The AVX2 BVH kernel needs an x86-64 build.");
+}
+
+#endif
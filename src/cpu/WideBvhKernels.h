@@ -0,0 +1,517 @@
+#pragma once
+
+// Traversal shared by the SSE and AVX2 kernels, written against an Ops struct that wraps the
+// intrinsics of one instruction set. Only WideBvh.cpp and WideBvhAvx2.cpp include this, after
+// defining their Ops, and everything here has internal linkage so that code compiled for AVX2
+// can't be picked by the linker for the SSE kernels.
+
+#include "WideBvh.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+
+// Children of a wide node that the ray enters, to be pushed nearest last.
+template<int Width>
+struct ChildList
+{
+    uint32_t Offset[Width];
+    uint32_t PackCount[Width];
+    float Entry[Width];
+    int Count = 0;
+
+    void Insert(uint32_t offset, uint32_t packCount, float entry)
+    {
+        int i = Count++;
+
+        // Keep them sorted far to near.
+        for (; i > 0 && Entry[i - 1] < entry; --i)
+        {
+            Offset[i] = Offset[i - 1];
+            PackCount[i] = PackCount[i - 1];
+            Entry[i] = Entry[i - 1];
+        }
+
+        Offset[i] = offset;
+        PackCount[i] = packCount;
+        Entry[i] = entry;
+    }
+};
+
+struct WideStackEntry
+{
+    uint32_t Offset;
+    uint32_t PackCount;
+    float Entry;
+};
+
+// Bound on the stack, since each wide level pushes fewer than Width entries and the tree is no
+// deeper than the binary one.
+template<int Width>
+constexpr int kWideStackSize = Width * kBvhMaxDepth;
+
+// Tests one ray against every triangle of the pack. Returns the mask of lanes hit in
+// [tMin, tMax], with their distances and barycentrics.
+template<typename Ops>
+int TestPack(const TrianglePack<Ops::Width>& pack, const typename Ops::Float org[3],
+             const typename Ops::Float dir[3], typename Ops::Float tMin, typename Ops::Float tMax,
+             FaceCulling culling, typename Ops::Float* t, typename Ops::Float* u,
+             typename Ops::Float* v)
+{
+    using Float = typename Ops::Float;
+
+    Float e1[3] = {Ops::Load(pack.E1[0]), Ops::Load(pack.E1[1]), Ops::Load(pack.E1[2])};
+    Float e2[3] = {Ops::Load(pack.E2[0]), Ops::Load(pack.E2[1]), Ops::Load(pack.E2[2])};
+
+    Float p[3] = {Ops::Sub(Ops::Mul(dir[1], e2[2]), Ops::Mul(dir[2], e2[1])),
+                  Ops::Sub(Ops::Mul(dir[2], e2[0]), Ops::Mul(dir[0], e2[2])),
+                  Ops::Sub(Ops::Mul(dir[0], e2[1]), Ops::Mul(dir[1], e2[0]))};
+
+    Float det = Ops::Dot(e1, p);
+    Float zero = Ops::Set1(0.f);
+
+    Float valid = culling == FaceCulling::Back    ? Ops::Less(zero, det)
+                  : culling == FaceCulling::Front ? Ops::Less(det, zero)
+                                                  : Ops::NotEqual(det, zero);
+
+    if (Ops::MoveMask(valid) == 0)
+        return 0;
+
+    Float invDet = Ops::Div(Ops::Set1(1.f), det);
+
+    Float s[3] = {Ops::Sub(org[0], Ops::Load(pack.V0[0])),
+                  Ops::Sub(org[1], Ops::Load(pack.V0[1])),
+                  Ops::Sub(org[2], Ops::Load(pack.V0[2]))};
+
+    Float one = Ops::Set1(1.f);
+
+    *u = Ops::Mul(Ops::Dot(s, p), invDet);
+    valid = Ops::And(valid, Ops::And(Ops::LessEqual(zero, *u), Ops::LessEqual(*u, one)));
+
+    Float q[3] = {Ops::Sub(Ops::Mul(s[1], e1[2]), Ops::Mul(s[2], e1[1])),
+                  Ops::Sub(Ops::Mul(s[2], e1[0]), Ops::Mul(s[0], e1[2])),
+                  Ops::Sub(Ops::Mul(s[0], e1[1]), Ops::Mul(s[1], e1[0]))};
+
+    *v = Ops::Mul(Ops::Dot(dir, q), invDet);
+    valid = Ops::And(valid, Ops::And(Ops::LessEqual(zero, *v),
+                                     Ops::LessEqual(Ops::Add(*u, *v), one)));
+
+    *t = Ops::Mul(Ops::Dot(e2, q), invDet);
+    valid = Ops::And(valid, Ops::And(Ops::LessEqual(tMin, *t), Ops::LessEqual(*t, tMax)));
+
+    return Ops::MoveMask(valid);
+}
+
+// Returns the lane of the closest hit in the pack in [tMin, *tMax], or -1, lowering *tMax.
+template<typename Ops>
+int IntersectPack(const TrianglePack<Ops::Width>& pack, const typename Ops::Float org[3],
+                  const typename Ops::Float dir[3], typename Ops::Float tMin, float* tMax,
+                  FaceCulling culling, float* u, float* v)
+{
+    typename Ops::Float tt, uu, vv;
+
+    int mask = TestPack<Ops>(pack, org, dir, tMin, Ops::Set1(*tMax), culling, &tt, &uu, &vv);
+
+    if (mask == 0)
+        return -1;
+
+    alignas(32) float ts[Ops::Width];
+    Ops::Store(ts, tt);
+
+    int best = -1;
+
+    for (int lane = 0; lane < Ops::Width; ++lane)
+    {
+        if ((mask & (1 << lane)) && (best < 0 || ts[lane] < ts[best]))
+            best = lane;
+    }
+
+    alignas(32) float us[Ops::Width];
+    alignas(32) float vs[Ops::Width];
+    Ops::Store(us, uu);
+    Ops::Store(vs, vv);
+
+    *tMax = ts[best];
+    *u = us[best];
+    *v = vs[best];
+
+    return best;
+}
+
+template<typename Ops>
+bool IntersectWide(const WideBvh<Ops::Width>& bvh, const Ray& ray, FaceCulling culling,
+                   RayHit* hit)
+{
+    constexpr int Width = Ops::Width;
+
+    using Float = typename Ops::Float;
+
+    if (bvh.Nodes.empty())
+        return false;
+
+    glm::vec3 invDir = 1.f / ray.Direction;
+
+    Float org[3] = {Ops::Set1(ray.Origin.x), Ops::Set1(ray.Origin.y), Ops::Set1(ray.Origin.z)};
+    Float dir[3] = {Ops::Set1(ray.Direction.x), Ops::Set1(ray.Direction.y),
+                    Ops::Set1(ray.Direction.z)};
+    Float inv[3] = {Ops::Set1(invDir.x), Ops::Set1(invDir.y), Ops::Set1(invDir.z)};
+    Float tMin = Ops::Set1(ray.TMin);
+
+    // The near plane of each slab is the same for every child, so the bounds don't need
+    // sorting, and unused slots, whose bounds are inverted, always miss.
+    bool negative[3] = {invDir.x < 0.f, invDir.y < 0.f, invDir.z < 0.f};
+
+    float closestT = ray.TMax;
+    bool found = false;
+
+    WideStackEntry stack[kWideStackSize<Width>];
+    int stackSize = 0;
+
+    stack[stackSize++] = {0, 0, ray.TMin};
+
+    while (stackSize > 0)
+    {
+        WideStackEntry entry = stack[--stackSize];
+
+        if (entry.Entry > closestT)
+            continue;
+
+        if (entry.PackCount > 0)
+        {
+            for (uint32_t packIdx = entry.Offset; packIdx < entry.Offset + entry.PackCount;
+                 ++packIdx)
+            {
+                const TrianglePack<Width>& pack = bvh.Packs[packIdx];
+
+                float u = 0.f;
+                float v = 0.f;
+
+                int lane = IntersectPack<Ops>(pack, org, dir, tMin, &closestT, culling, &u, &v);
+
+                if (lane < 0)
+                    continue;
+
+                found = true;
+
+                hit->T = closestT;
+                hit->Barycentrics = glm::vec2(u, v);
+                hit->GeometryIdx = pack.GeometryIdx[lane];
+                hit->PrimitiveIdx = pack.PrimitiveIdx[lane];
+            }
+
+            continue;
+        }
+
+        const WideBvhNode<Width>& node = bvh.Nodes[entry.Offset];
+
+        Float tNear = tMin;
+        Float tFar = Ops::Set1(closestT);
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const float* nearPlane = negative[axis] ? node.Max[axis] : node.Min[axis];
+            const float* farPlane = negative[axis] ? node.Min[axis] : node.Max[axis];
+
+            Float t0 = Ops::Mul(Ops::Sub(Ops::Load(nearPlane), org[axis]), inv[axis]);
+            Float t1 = Ops::Mul(Ops::Sub(Ops::Load(farPlane), org[axis]), inv[axis]);
+
+            tNear = Ops::Max(tNear, t0);
+            tFar = Ops::Min(tFar, t1);
+        }
+
+        int mask = Ops::MoveMask(Ops::LessEqual(tNear, tFar));
+
+        if (mask == 0)
+            continue;
+
+        alignas(32) float entries[Width];
+        Ops::Store(entries, tNear);
+
+        ChildList<Width> children;
+
+        for (int child = 0; child < Width; ++child)
+        {
+            if (mask & (1 << child))
+                children.Insert(node.Offset[child], node.PackCount[child], entries[child]);
+        }
+
+        for (int i = 0; i < children.Count; ++i)
+        {
+            stack[stackSize++] = {children.Offset[i], children.PackCount[i], children.Entry[i]};
+        }
+    }
+
+    return found;
+}
+
+// Any hit in [TMin, TMax] ends the search, so children are visited in whatever order the node
+// lists them.
+template<typename Ops>
+bool OccludedWide(const WideBvh<Ops::Width>& bvh, const Ray& ray, FaceCulling culling)
+{
+    constexpr int Width = Ops::Width;
+
+    using Float = typename Ops::Float;
+
+    if (bvh.Nodes.empty())
+        return false;
+
+    glm::vec3 invDir = 1.f / ray.Direction;
+
+    Float org[3] = {Ops::Set1(ray.Origin.x), Ops::Set1(ray.Origin.y), Ops::Set1(ray.Origin.z)};
+    Float dir[3] = {Ops::Set1(ray.Direction.x), Ops::Set1(ray.Direction.y),
+                    Ops::Set1(ray.Direction.z)};
+    Float inv[3] = {Ops::Set1(invDir.x), Ops::Set1(invDir.y), Ops::Set1(invDir.z)};
+    Float tMin = Ops::Set1(ray.TMin);
+    Float tMax = Ops::Set1(ray.TMax);
+
+    bool negative[3] = {invDir.x < 0.f, invDir.y < 0.f, invDir.z < 0.f};
+
+    WideStackEntry stack[kWideStackSize<Width>];
+    int stackSize = 0;
+
+    stack[stackSize++] = {0, 0, ray.TMin};
+
+    while (stackSize > 0)
+    {
+        WideStackEntry entry = stack[--stackSize];
+
+        if (entry.PackCount > 0)
+        {
+            for (uint32_t packIdx = entry.Offset; packIdx < entry.Offset + entry.PackCount;
+                 ++packIdx)
+            {
+                Float t, u, v;
+
+                if (TestPack<Ops>(bvh.Packs[packIdx], org, dir, tMin, tMax, culling, &t, &u, &v))
+                    return true;
+            }
+
+            continue;
+        }
+
+        const WideBvhNode<Width>& node = bvh.Nodes[entry.Offset];
+
+        Float tNear = tMin;
+        Float tFar = tMax;
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const float* nearPlane = negative[axis] ? node.Max[axis] : node.Min[axis];
+            const float* farPlane = negative[axis] ? node.Min[axis] : node.Max[axis];
+
+            Float t0 = Ops::Mul(Ops::Sub(Ops::Load(nearPlane), org[axis]), inv[axis]);
+            Float t1 = Ops::Mul(Ops::Sub(Ops::Load(farPlane), org[axis]), inv[axis]);
+
+            tNear = Ops::Max(tNear, t0);
+            tFar = Ops::Min(tFar, t1);
+        }
+
+        int mask = Ops::MoveMask(Ops::LessEqual(tNear, tFar));
+
+        for (int child = 0; child < Width; ++child)
+        {
+            if (mask & (1 << child))
+                stack[stackSize++] = {node.Offset[child], node.PackCount[child], 0.f};
+        }
+    }
+
+    return false;
+}
+
+template<typename Ops>
+uint32_t IntersectPacketWide(const WideBvh<Ops::Width>& bvh, const Ray* rays,
+                             uint32_t activeMask, FaceCulling culling, RayHit* hits)
+{
+    constexpr int Width = Ops::Width;
+
+    using Float = typename Ops::Float;
+
+    if (bvh.Nodes.empty() || activeMask == 0)
+        return 0;
+
+    // One lane per ray. Inactive lanes get an empty interval, so they never hit anything.
+    alignas(32) float soa[11][Width];
+
+    for (int lane = 0; lane < Width; ++lane)
+    {
+        const Ray& ray = rays[(activeMask & (1u << lane)) ? lane : 0];
+        bool active = (activeMask & (1u << lane)) != 0;
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            soa[axis][lane] = ray.Origin[axis];
+            soa[3 + axis][lane] = ray.Direction[axis];
+            soa[6 + axis][lane] = 1.f / ray.Direction[axis];
+        }
+
+        soa[9][lane] = active ? ray.TMin : std::numeric_limits<float>::infinity();
+        soa[10][lane] = active ? ray.TMax : -std::numeric_limits<float>::infinity();
+    }
+
+    Float org[3] = {Ops::Load(soa[0]), Ops::Load(soa[1]), Ops::Load(soa[2])};
+    Float dir[3] = {Ops::Load(soa[3]), Ops::Load(soa[4]), Ops::Load(soa[5])};
+    Float inv[3] = {Ops::Load(soa[6]), Ops::Load(soa[7]), Ops::Load(soa[8])};
+    Float tMin = Ops::Load(soa[9]);
+    Float tMax = Ops::Load(soa[10]);
+
+    uint32_t hitMask = 0;
+
+    WideStackEntry stack[kWideStackSize<Width>];
+    int stackSize = 0;
+
+    stack[stackSize++] = {0, 0, -std::numeric_limits<float>::infinity()};
+
+    while (stackSize > 0)
+    {
+        WideStackEntry entry = stack[--stackSize];
+
+        // Skip entries behind the closest hit of every ray.
+        alignas(32) float closest[Width];
+        Ops::Store(closest, tMax);
+
+        if (entry.Entry > *std::max_element(closest, closest + Width))
+            continue;
+
+        if (entry.PackCount > 0)
+        {
+            for (uint32_t packIdx = entry.Offset; packIdx < entry.Offset + entry.PackCount;
+                 ++packIdx)
+            {
+                const TrianglePack<Width>& pack = bvh.Packs[packIdx];
+
+                for (int tri = 0; tri < Width; ++tri)
+                {
+                    Float v0[3] = {Ops::Set1(pack.V0[0][tri]), Ops::Set1(pack.V0[1][tri]),
+                                   Ops::Set1(pack.V0[2][tri])};
+                    Float e1[3] = {Ops::Set1(pack.E1[0][tri]), Ops::Set1(pack.E1[1][tri]),
+                                   Ops::Set1(pack.E1[2][tri])};
+                    Float e2[3] = {Ops::Set1(pack.E2[0][tri]), Ops::Set1(pack.E2[1][tri]),
+                                   Ops::Set1(pack.E2[2][tri])};
+
+                    Float p[3] = {Ops::Sub(Ops::Mul(dir[1], e2[2]), Ops::Mul(dir[2], e2[1])),
+                                  Ops::Sub(Ops::Mul(dir[2], e2[0]), Ops::Mul(dir[0], e2[2])),
+                                  Ops::Sub(Ops::Mul(dir[0], e2[1]), Ops::Mul(dir[1], e2[0]))};
+
+                    Float det = Ops::Dot(e1, p);
+                    Float zero = Ops::Set1(0.f);
+
+                    Float valid = culling == FaceCulling::Back    ? Ops::Less(zero, det)
+                                  : culling == FaceCulling::Front ? Ops::Less(det, zero)
+                                                                  : Ops::NotEqual(det, zero);
+
+                    if (Ops::MoveMask(valid) == 0)
+                        continue;
+
+                    Float invDet = Ops::Div(Ops::Set1(1.f), det);
+                    Float one = Ops::Set1(1.f);
+
+                    Float s[3] = {Ops::Sub(org[0], v0[0]), Ops::Sub(org[1], v0[1]),
+                                  Ops::Sub(org[2], v0[2])};
+
+                    Float u = Ops::Mul(Ops::Dot(s, p), invDet);
+                    valid = Ops::And(valid,
+                                     Ops::And(Ops::LessEqual(zero, u), Ops::LessEqual(u, one)));
+
+                    Float q[3] = {Ops::Sub(Ops::Mul(s[1], e1[2]), Ops::Mul(s[2], e1[1])),
+                                  Ops::Sub(Ops::Mul(s[2], e1[0]), Ops::Mul(s[0], e1[2])),
+                                  Ops::Sub(Ops::Mul(s[0], e1[1]), Ops::Mul(s[1], e1[0]))};
+
+                    Float v = Ops::Mul(Ops::Dot(dir, q), invDet);
+                    valid = Ops::And(valid, Ops::And(Ops::LessEqual(zero, v),
+                                                     Ops::LessEqual(Ops::Add(u, v), one)));
+
+                    Float t = Ops::Mul(Ops::Dot(e2, q), invDet);
+                    valid = Ops::And(valid,
+                                     Ops::And(Ops::LessEqual(tMin, t), Ops::LessEqual(t, tMax)));
+
+                    int mask = Ops::MoveMask(valid);
+
+                    if (mask == 0)
+                        continue;
+
+                    tMax = Ops::Select(valid, t, tMax);
+
+                    alignas(32) float ts[Width];
+                    alignas(32) float us[Width];
+                    alignas(32) float vs[Width];
+                    Ops::Store(ts, t);
+                    Ops::Store(us, u);
+                    Ops::Store(vs, v);
+
+                    for (int lane = 0; lane < Width; ++lane)
+                    {
+                        if ((mask & (1 << lane)) == 0)
+                            continue;
+
+                        RayHit& hit = hits[lane];
+                        hit.T = ts[lane];
+                        hit.Barycentrics = glm::vec2(us[lane], vs[lane]);
+                        hit.GeometryIdx = pack.GeometryIdx[tri];
+                        hit.PrimitiveIdx = pack.PrimitiveIdx[tri];
+                    }
+
+                    hitMask |= static_cast<uint32_t>(mask);
+                }
+            }
+
+            continue;
+        }
+
+        const WideBvhNode<Width>& node = bvh.Nodes[entry.Offset];
+
+        ChildList<Width> children;
+
+        for (int child = 0; child < Width; ++child)
+        {
+            // Unused slots point at the root, which is never a child.
+            if (node.PackCount[child] == 0 && node.Offset[child] == 0)
+                continue;
+
+            Float tNear = tMin;
+            Float tFar = tMax;
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                Float t0 = Ops::Mul(Ops::Sub(Ops::Set1(node.Min[axis][child]), org[axis]),
+                                    inv[axis]);
+                Float t1 = Ops::Mul(Ops::Sub(Ops::Set1(node.Max[axis][child]), org[axis]),
+                                    inv[axis]);
+
+                tNear = Ops::Max(tNear, Ops::Min(t0, t1));
+                tFar = Ops::Min(tFar, Ops::Max(t0, t1));
+            }
+
+            Float enters = Ops::LessEqual(tNear, tFar);
+            int mask = Ops::MoveMask(enters);
+
+            if (mask == 0)
+                continue;
+
+            // Order children by the nearest entry of any ray that enters them.
+            alignas(32) float entries[Width];
+            Ops::Store(entries, tNear);
+
+            float nearest = std::numeric_limits<float>::infinity();
+
+            for (int lane = 0; lane < Width; ++lane)
+            {
+                if (mask & (1 << lane))
+                    nearest = std::min(nearest, entries[lane]);
+            }
+
+            children.Insert(node.Offset[child], node.PackCount[child], nearest);
+        }
+
+        for (int i = 0; i < children.Count; ++i)
+        {
+            stack[stackSize++] = {children.Offset[i], children.PackCount[i], children.Entry[i]};
+        }
+    }
+
+    return hitMask;
+}
+
+} // namespace
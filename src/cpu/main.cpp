@@ -0,0 +1,215 @@
+#include "CpuScene.h"
+#include "PathTracer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+
+struct Options
+{
+    uint32_t Width = 1024;
+    uint32_t Height = 576;
+    uint32_t Threads = 0;
+
+    // The film's tiles are the units of work handed to the threads.
+    uint32_t TileSize = 16;
+
+    BvhKernel Kernel = GetBestBvhKernel();
+
+    RenderOptions Render;
+
+    // A pbrt-v4 file, a .pbrtscene snapshot, or empty for the built-in scene.
+    std::filesystem::path Scene;
+
+    // Where to write a snapshot of the loaded scene, if anywhere.
+    std::filesystem::path Snapshot;
+
+    std::filesystem::path Output = "film.ppm";
+};
+
+void PrintUsage()
+{
+    std::cout << "Usage: PbrtCpu [--scene file.pbrt|file.pbrtscene]\n"
+                 "               [--write-snapshot file.pbrtscene]\n"
+                 "               [--width N] [--height N] [--spp N] [--tile-size N] [--seed N]\n"
+                 "               [--sampler halton|sobol|zsobol] [--threads N]\n"
+                 "               [--adaptive-threshold X] [--adaptive-batch N]\n"
+                 "               [--integrator megakernel|wavefront] [--wavefront-size N]\n"
+                 "               [--sort-rays on|off] [--max-depth N] [--roulette-depth N]\n"
+                 "               [--light-sampler all|power|bvh] [--light-samples N]\n"
+                 "               [--bvh-kernel auto|scalar|sse|avx2] [--packets on|off]\n"
+                 "               [--ray-cones on|off]\n"
+                 "               [--output film.ppm|film.pfm|film.exr]\n\n"
+                 "Renders the pbrt-v4 scene or scene snapshot, or the pbrt-book scene without\n"
+                 "--scene, with the integrator of Shader.hlsl on the CPU.\n"
+                 "PFM and OpenEXR output keeps the unclamped float means of the pixels.\n"
+                 "Scene paths resolve against a `scenes` directory in the working directory.\n";
+}
+
+bool ParseOnOff(const std::string& arg, const std::string& value)
+{
+    if (value != "on" && value != "off")
+        throw std::runtime_error(arg + " takes on or off.");
+
+    return value == "on";
+}
+
+Options ParseOptions(int argc, char** argv)
+{
+    Options options{};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+
+        if (i + 1 == argc)
+            throw std::runtime_error("Missing value for " + arg + ".");
+
+        const char* value = argv[++i];
+
+        auto toUint = [&] { return static_cast<uint32_t>(std::stoul(value)); };
+
+        if (arg == "--scene")
+            options.Scene = value;
+        else if (arg == "--write-snapshot")
+            options.Snapshot = value;
+        else if (arg == "--width")
+            options.Width = toUint();
+        else if (arg == "--height")
+            options.Height = toUint();
+        else if (arg == "--spp")
+            options.Render.SamplesPerPixel = toUint();
+        else if (arg == "--tile-size")
+            options.TileSize = toUint();
+        else if (arg == "--seed")
+            options.Render.Seed = toUint();
+        else if (arg == "--sampler")
+            options.Render.Sampler = ParseSamplerType(value);
+        else if (arg == "--adaptive-threshold")
+            options.Render.AdaptiveThreshold = std::stof(value);
+        else if (arg == "--adaptive-batch")
+            options.Render.AdaptiveBatchSize = toUint();
+        else if (arg == "--integrator")
+            options.Render.Integrator = ParseIntegratorType(value);
+        else if (arg == "--wavefront-size")
+            options.Render.WavefrontSize = toUint();
+        else if (arg == "--sort-rays")
+            options.Render.SortRays = ParseOnOff(arg, value);
+        else if (arg == "--max-depth")
+            options.Render.MaxDepth = toUint();
+        else if (arg == "--roulette-depth")
+            options.Render.RouletteDepth = toUint();
+        else if (arg == "--light-sampler")
+            options.Render.LightSampler = ParseLightSamplerType(value);
+        else if (arg == "--light-samples")
+            options.Render.LightSamples = toUint();
+        else if (arg == "--threads")
+            options.Threads = toUint();
+        else if (arg == "--bvh-kernel")
+            options.Kernel = ParseBvhKernel(value);
+        else if (arg == "--packets")
+            options.Render.CameraPackets = ParseOnOff(arg, value);
+        else if (arg == "--ray-cones")
+            options.Render.RayConeLod = ParseOnOff(arg, value);
+        else if (arg == "--output")
+            options.Output = value;
+        else
+            throw std::runtime_error("Unknown argument: " + arg);
+    }
+
+    if (options.Width == 0 || options.Height == 0 || options.Render.SamplesPerPixel == 0 ||
+        options.TileSize == 0 || options.Render.WavefrontSize == 0)
+    {
+        throw std::runtime_error("Sizes and sample counts must be positive.");
+    }
+
+    return options;
+}
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc == 2 && (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0))
+    {
+        PrintUsage();
+        return 0;
+    }
+
+    try
+    {
+        Options options = ParseOptions(argc, argv);
+
+        ThreadPool pool(options.Threads);
+
+        auto start = std::chrono::steady_clock::now();
+
+        SceneIR source = LoadSceneIR(options.Scene, &pool);
+
+        if (!options.Snapshot.empty())
+            WriteSceneSnapshot(source, options.Snapshot);
+
+        CpuScene scene;
+        LoadCpuScene(source, &pool, &scene);
+        scene.Accel.SetKernel(options.Kernel, &pool);
+
+        TlasStats accelStats = scene.Accel.GetStats();
+        size_t savedBytes =
+            std::max(accelStats.FlattenedMemoryBytes, accelStats.MemoryBytes) -
+            accelStats.MemoryBytes;
+
+        std::cout << std::fixed << std::setprecision(1) << "Loaded scene with "
+                  << accelStats.InstanceCount << " instances of "
+                  << accelStats.BlasCount << " BLASes in " << MillisecondsSince(start) << " ms, "
+                  << accelStats.MemoryBytes / 1024 << " KB of acceleration structures ("
+                  << savedBytes / 1024 << " KB saved over flattening)" << std::endl;
+
+        Film film(options.Width, options.Height, options.TileSize);
+
+        start = std::chrono::steady_clock::now();
+
+        RenderStats stats = RenderScene(scene, options.Render, &pool, &film);
+
+        double renderMs = MillisecondsSince(start);
+        uint64_t rays = stats.CameraRays + stats.ShadowRays + stats.BounceRays;
+
+        std::cout << "Rendered " << options.Width << "x" << options.Height << " at "
+                  << options.Render.SamplesPerPixel << " spp of "
+                  << GetSamplerTypeName(options.Render.Sampler) << " with the "
+                  << GetIntegratorTypeName(options.Render.Integrator) << " integrator on "
+                  << pool.GetThreadCount()
+                  << " threads in " << renderMs << " ms (" << rays / (renderMs * 1000.0)
+                  << " Mrays/s)" << std::endl;
+
+        if (options.Render.AdaptiveThreshold > 0.f)
+        {
+            std::cout << "Adaptive sampling took "
+                      << stats.CameraRays / (static_cast<double>(options.Width) * options.Height)
+                      << " spp on average in " << stats.Passes << " passes" << std::endl;
+        }
+
+        film.Write(options.Output);
+
+        std::cout << "Wrote " << options.Output.string() << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "PbrtCpu: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
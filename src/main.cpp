@@ -3,6 +3,10 @@
 #include <windows.h>
 #include <winrt/base.h>
 
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
 using winrt::check_bool;
 
 static LRESULT WindowProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam)
@@ -17,11 +21,63 @@ static LRESULT WindowProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam)
     return DefWindowProc(hwnd, msg, wparam, lparam);
 }
 
-int WinMain(HINSTANCE hinstance, HINSTANCE, LPSTR, int cmdShow)
+static AppOptions ParseOptions(int argc, char** argv)
 {
-    // Needed by WIC, which is used in ImageLoader.
-    CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+    AppOptions options{};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view arg = argv[i];
+
+        if (arg == "--scene" && i + 1 < argc)
+        {
+            options.Scene = argv[++i];
+        }
+        else if (arg == "--vertex-layout" && i + 1 < argc)
+        {
+            options.Vertices.Layout = ParseVertexLayout(argv[++i]);
+        }
+        else if (arg == "--optimize-meshes")
+        {
+            options.OptimizeMeshes = true;
+        }
+        else if (arg == "--sampler" && i + 1 < argc)
+        {
+            options.Sampler = ParseSamplerType(argv[++i]);
+        }
+        else if (arg == "--max-depth" && i + 1 < argc)
+        {
+            options.MaxDepth = static_cast<uint32_t>(std::stoul(argv[++i]));
 
+            if (options.MaxDepth == 0)
+                throw std::runtime_error("The path depth must be positive.");
+        }
+        else if (arg == "--roulette-depth" && i + 1 < argc)
+        {
+            options.RouletteDepth = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--light-sampler" && i + 1 < argc)
+        {
+            options.LightSampler = ParseLightSamplerType(argv[++i]);
+        }
+        else if (arg == "--light-samples" && i + 1 < argc)
+        {
+            options.LightSamples = static_cast<uint32_t>(std::stoul(argv[++i]));
+
+            if (options.LightSamples == 0)
+                throw std::runtime_error("Shading points must sample at least one light.");
+        }
+        else
+        {
+            throw std::runtime_error("Unknown argument: " + std::string(arg));
+        }
+    }
+
+    return options;
+}
+
+static int Run(HINSTANCE hinstance, int cmdShow, const AppOptions& options)
+{
     WNDCLASSEX windowClass{};
     windowClass.cbSize = sizeof(WNDCLASSEX);
     windowClass.style = CS_HREDRAW | CS_VREDRAW;
@@ -47,7 +103,7 @@ int WinMain(HINSTANCE hinstance, HINSTANCE, LPSTR, int cmdShow)
                              nullptr, hinstance, nullptr);
     ShowWindow(hwnd, cmdShow);
 
-    App app(hwnd);
+    App app(hwnd, options);
 
     MSG msg{};
 
@@ -66,3 +122,26 @@ int WinMain(HINSTANCE hinstance, HINSTANCE, LPSTR, int cmdShow)
 
     return 0;
 }
+
+static void ReportError(const std::string& message)
+{
+    MessageBoxA(nullptr, message.c_str(), "PbrtDX", MB_OK | MB_ICONERROR);
+}
+
+int WinMain(HINSTANCE hinstance, HINSTANCE, LPSTR, int cmdShow)
+{
+    try
+    {
+        return Run(hinstance, cmdShow, ParseOptions(__argc, __argv));
+    }
+    catch (const std::exception& e)
+    {
+        ReportError(e.what());
+    }
+    catch (const winrt::hresult_error& e)
+    {
+        ReportError(winrt::to_string(e.message()));
+    }
+
+    return 1;
+}
@@ -3,6 +3,8 @@
 
 #ifndef HLSL
 #include "CppTypes.h"
+
+#include <cmath>
 #endif // #ifndef HLSL
 
 struct SphereLight
@@ -14,8 +16,168 @@ struct SphereLight
 
 struct HaltonEntry
 {
+    // Where the dimension's digit permutations start: DigitCount of them, Prime entries each.
     uint32_t PermutationOffset;
     uint16_t Prime;
+
+    // Digits that make a difference at float precision.
+    uint16_t DigitCount;
+
+    // Divide by Prime with DivideByMagic.
+    uint32_t DivisionMagic;
+    uint32_t DivisionShift;
+};
+
+// pbrt-v4's AliasTable::Bin. Bin i is picked with probability Q or its alias otherwise, so every
+// pick costs the same however many entries there are.
+struct AliasBin
+{
+    float Q;
+
+    // The probability of picking entry i in all.
+    float Pmf;
+
+    uint32_t Alias;
+};
+
+// A node of the light BVH. Nodes are in depth first order, so an interior node's first child
+// follows it.
+struct LightBvhNode
+{
+    float3 Min;
+
+    // The total power of the node's lights.
+    float Phi;
+
+    float3 Max;
+
+    // The second child of an interior node, or the light of a leaf.
+    uint32_t ChildOrLightIdx;
+
+    uint32_t IsLeaf;
+};
+
+// How RayGenShader picks the lights it samples at a shading point.
+static const uint32_t LIGHT_SAMPLER_ALL = 0;   // Every light, one shadow ray each.
+static const uint32_t LIGHT_SAMPLER_POWER = 1; // LightSamples lights, by power.
+static const uint32_t LIGHT_SAMPLER_BVH = 2;   // LightSamples lights, by importance to the point.
+
+// Which sampler RayGenShader draws from.
+static const uint32_t SAMPLER_HALTON = 0;
+static const uint32_t SAMPLER_PADDED_SOBOL = 1; // Owen scrambled per pixel.
+static const uint32_t SAMPLER_ZSOBOL = 2;       // Blue noise across pixels.
+
+struct DrawConstants
+{
+    uint32_t SampleIndex;
+
+    // SAMPLER_*.
+    uint32_t SamplerType;
+
+    // How many samples each pixel gets in all, which ZSobol needs up front.
+    uint32_t SamplesPerPixel;
+
+    uint32_t Seed;
+
+    // Paths end after this many intersections.
+    uint32_t MaxDepth;
+
+    // Paths that get this deep face Russian roulette at every further bounce. 0 turns it off.
+    uint32_t RouletteDepth;
+
+    // LIGHT_SAMPLER_*.
+    uint32_t LightSampler;
+
+    // The size of g_lights.
+    uint32_t LightCount;
+
+    // Lights each shading point samples, unless it samples all of them.
+    uint32_t LightSamples;
+};
+
+// The pinhole camera RayGenShader shoots its rays from, as in SceneCamera. Padded so no float3
+// straddles 16 bytes, as HLSL packs constant buffers.
+struct CameraConstants
+{
+    float3 Origin;
+
+    // In degrees, across the shorter side of the film.
+    float Fov;
+
+    float3 Right;
+    float Unused0;
+
+    float3 Up;
+    float Unused1;
+
+    float3 Forward;
+    float Unused2;
+};
+
+// How likely a path survives Russian roulette: its largest throughput component, so dimmer paths
+// are more likely to end, and certain once any component is at least one.
+inline float GetSurvivalProbability(float3 throughput)
+{
+    float maxComponent = throughput.x > throughput.y ? throughput.x : throughput.y;
+    maxComponent = maxComponent > throughput.z ? maxComponent : throughput.z;
+
+    return maxComponent < 1.f ? maxComponent : 1.f;
+}
+
+// The footprint of a pixel as its path bounces, as a cone around the ray (Akenine-Moller et al.,
+// "Texture Level of Detail Strategies for Real-Time Ray Tracing"): its width at the ray's origin
+// and the angle it widens by. Bounces don't change the angle, as if every surface were flat.
+struct RayCone
+{
+    float Width;
+    float SpreadAngle;
+};
+
+// The cone's width where its ray hits at t, which is its width at the origin of the next bounce.
+inline float GetRayConeWidth(RayCone cone, float t)
+{
+    return cone.Width + cone.SpreadAngle * t;
+}
+
+// The mip level that covers the width of a ray cone at a hit. cosTheta is between the ray and the
+// surface normal, and textureSize is the size of the first level.
+inline float GetRayConeLod(float width, float cosTheta, float uvLodOffset, float2 textureSize)
+{
+    cosTheta = cosTheta < 0.f ? -cosTheta : cosTheta;
+
+#ifdef HLSL
+    float lod = uvLodOffset + 0.5f * log2(textureSize.x * textureSize.y) + log2(width / cosTheta);
+#else
+    float lod = uvLodOffset + 0.5f * std::log2(textureSize.x * textureSize.y) +
+        std::log2(width / cosTheta);
+#endif // #ifdef HLSL
+
+    // Also catches the NaN of a cone with no width seen edge on.
+    return lod > 0.f ? lod : 0.f;
+}
+
+// ResolveShader's thread groups are this many pixels square.
+static const uint32_t RESOLVE_GROUP_SIZE = 8;
+
+// How the buffers bound as g_normals and g_uvs are laid out.
+static const uint32_t VERTEX_LAYOUT_SEPARATE = 0;    // float3 normals and float2 uvs.
+static const uint32_t VERTEX_LAYOUT_INTERLEAVED = 1; // InterleavedVertex in both.
+static const uint32_t VERTEX_LAYOUT_QUANTIZED = 2;   // QuantizedVertexAttributes in both.
+
+struct InterleavedVertex
+{
+    float3 Position;
+    float3 Normal;
+    float2 UV;
+};
+
+struct QuantizedVertexAttributes
+{
+    // Octahedral encoding, x in the low 16 bits and y in the high 16 bits, as snorm16.
+    uint32_t Normal;
+
+    // Half floats, u in the low 16 bits and v in the high 16 bits.
+    uint32_t UV;
 };
 
 struct HitGroupGeometryConstants
@@ -23,7 +185,13 @@ struct HitGroupGeometryConstants
     float4x4 NormalMatrix;
     uint32_t IsTextured;
 
-    float Unused[3];
+    uint32_t VertexLayout;
+
+    // 2 or 4.
+    uint32_t IndexSize;
+
+    // GetUVLodOffset of the geometry's instance, for GetRayConeLod.
+    float UVLodOffset;
 };
 
 #endif // SHADERS_COMMON_H
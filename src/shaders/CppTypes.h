@@ -2,5 +2,8 @@
 
 #include <glm/glm.hpp>
 
+using uint2 = glm::uvec2;
+using float2 = glm::vec2;
 using float3 = glm::vec3;
+using float4 = glm::vec4;
 using float4x4 = glm::mat4;
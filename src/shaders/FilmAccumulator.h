@@ -0,0 +1,86 @@
+#ifndef SHADERS_FILM_ACCUMULATOR_H
+#define SHADERS_FILM_ACCUMULATOR_H
+
+// How a pixel's samples are summed and their variance tracked, shared by RayGenShader,
+// ResolveShader and the CPU film.
+
+#include "Common.h"
+
+// HLSL may reassociate float math unless told not to, which would cancel the error term out.
+#ifdef HLSL
+#define FILM_PRECISE precise
+#else
+#define FILM_PRECISE
+#endif // #ifdef HLSL
+
+// Weighted sum of a pixel's samples, rgb in xyz and the weight in w. The rounding error of every
+// addition is kept in m_compensation with Knuth's TwoSum, so the mean stays within a rounding of
+// the exact one however many samples are added.
+struct FilmAccumulator
+{
+    float4 m_sum;
+    float4 m_compensation;
+
+    void Add(float3 rgb, float weight)
+    {
+        float4 value = float4(weight * rgb, weight);
+
+        FILM_PRECISE float4 sum = m_sum + value;
+        FILM_PRECISE float4 valuePart = sum - m_sum;
+        FILM_PRECISE float4 error = (m_sum - (sum - valuePart)) + (value - valuePart);
+
+        m_sum = sum;
+        m_compensation += error;
+    }
+
+    // Black without samples.
+    float3 GetMean()
+    {
+        FILM_PRECISE float4 total = m_sum + m_compensation;
+
+        if (total.w == 0.f)
+            return float3(0.f, 0.f, 0.f);
+
+        return float3(total.x, total.y, total.z) / total.w;
+    }
+};
+
+inline float Luminance(float3 rgb)
+{
+    return 0.2126f * rgb.x + 0.7152f * rgb.y + 0.0722f * rgb.z;
+}
+
+// Welford's running mean and variance of a pixel's sample luminances, for adaptive sampling.
+struct VarianceEstimator
+{
+    float m_mean;
+    float m_m2;
+    float m_count;
+
+    void Add(float x)
+    {
+        m_count += 1.f;
+
+        float delta = x - m_mean;
+        m_mean += delta / m_count;
+        m_m2 += delta * (x - m_mean);
+    }
+
+    float GetVariance()
+    {
+        return m_count > 1.f ? m_m2 / (m_count - 1.f) : 0.f;
+    }
+
+    // The square of the mean's standard error relative to the mean, squared so that it needs no
+    // sqrt in C++ or HLSL. Luminance is never negative, so a zero mean means every sample was
+    // black, which is as converged as a pixel gets.
+    float GetSquaredRelativeError()
+    {
+        if (m_mean == 0.f)
+            return 0.f;
+
+        return GetVariance() / (m_count * m_mean * m_mean);
+    }
+};
+
+#endif // SHADERS_FILM_ACCUMULATOR_H
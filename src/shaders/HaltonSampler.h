@@ -0,0 +1,332 @@
+#ifndef SHADERS_HALTON_SAMPLER_H
+#define SHADERS_HALTON_SAMPLER_H
+
+// pbrt-v4's HaltonSampler with RandomizeStrategy::PermuteDigits, shared by Shader.hlsl and the CPU
+// backend so that both draw the same samples. Its tables come from Halton.h; in HLSL they are
+// bound as g_haltonEntries and g_haltonPermutations, which have to be declared before this is
+// included.
+
+#include "Common.h"
+#include "SamplerCommon.h"
+
+#ifndef HLSL
+#include <cstdint>
+#endif // #ifndef HLSL
+
+// Pixels further apart than this share their first two sample dimensions.
+static const uint32_t MAX_HALTON_RESOLUTION = 128;
+
+// One dimension per prime. Get2D wraps around to dimension 2 after the last one.
+static const uint32_t HALTON_DIMENSION_COUNT = 1000;
+
+// Base 3 for DivideByMagic, as Halton.cpp computes it for every prime.
+static const uint32_t BASE3_DIVISION_MAGIC = 0x55555556;
+static const uint32_t BASE3_DIVISION_SHIFT = 1;
+
+// a / divisor for any 32-bit a, with a multiply and shifts in place of the division, after
+// Granlund and Montgomery's "Division by Invariant Integers using Multiplication". magic and shift
+// depend only on the divisor, and HaltonEntry stores them for each prime.
+inline uint32_t DivideByMagic(uint32_t a, uint32_t magic, uint32_t shift)
+{
+    uint32_t t = (uint32_t)(((uint64_t)a * magic) >> 32);
+
+    return (t + ((a - t) >> 1)) >> shift;
+}
+
+// The same for 64-bit a, as a long division in 32 and 16 bit pieces, which needs divisor < 2^16.
+inline uint64_t DivideByMagic64(uint64_t a, uint32_t divisor, uint32_t magic, uint32_t shift)
+{
+    uint32_t high = (uint32_t)(a >> 32);
+    uint32_t low = (uint32_t)a;
+
+    if (high == 0)
+        return DivideByMagic(low, magic, shift);
+
+    uint32_t q0 = DivideByMagic(high, magic, shift);
+    uint32_t r = high - q0 * divisor;
+
+    uint32_t a1 = (r << 16) | (low >> 16);
+    uint32_t q1 = DivideByMagic(a1, magic, shift);
+    r = a1 - q1 * divisor;
+
+    uint32_t a2 = (r << 16) | (low & 0xffff);
+    uint32_t q2 = DivideByMagic(a2, magic, shift);
+
+    return ((uint64_t)q0 << 32) | ((uint64_t)q1 << 16) | q2;
+}
+
+// The radical inverse in base 2 just reverses the bits. Scaling by a power of two is exact, so this
+// rounds the same as summing the digits would.
+inline float RadicalInverseBase2(uint64_t a)
+{
+    uint64_t reversedBits =
+        ((uint64_t)ReverseBits32((uint32_t)a) << 32) | ReverseBits32((uint32_t)(a >> 32));
+
+    float inverse = (float)reversedBits * 0x1p-64f;
+
+    return inverse < ONE_MINUS_EPSILON ? inverse : ONE_MINUS_EPSILON;
+}
+
+inline float RadicalInverseBase3(uint64_t a)
+{
+    // Stop before the next digit could overflow reversedDigits.
+    uint64_t limit = ~((uint64_t)0) / 3 - 3;
+
+    float invBaseM = 1.f;
+
+    uint64_t reversedDigits = 0;
+
+    while (a != 0 && reversedDigits < limit)
+    {
+        uint64_t next = DivideByMagic64(a, 3, BASE3_DIVISION_MAGIC, BASE3_DIVISION_SHIFT);
+        uint64_t digit = a - next * 3;
+
+        reversedDigits = reversedDigits * 3 + digit;
+        invBaseM *= 1.f / 3.f;
+        a = next;
+    }
+
+    float inverse = (float)reversedDigits * invBaseM;
+
+    return inverse < ONE_MINUS_EPSILON ? inverse : ONE_MINUS_EPSILON;
+}
+
+inline uint64_t InverseRadicalInverse(uint64_t inverse, uint32_t base, uint32_t digitCount)
+{
+    uint64_t idx = 0;
+
+    for (uint32_t i = 0; i < digitCount; ++i)
+    {
+        uint64_t digit = inverse % base;
+        inverse /= base;
+        idx = idx * base + digit;
+    }
+
+    return idx;
+}
+
+// The inverse of a modulo n, for coprime a and n.
+inline uint32_t MultiplicativeInverse(uint32_t a, uint32_t n)
+{
+    int t = 0;
+    int newT = 1;
+    int r = (int)n;
+    int newR = (int)(a % n);
+
+    while (newR != 0)
+    {
+        int q = r / newR;
+
+        int nextT = t - q * newT;
+        t = newT;
+        newT = nextT;
+
+        int nextR = r - q * newR;
+        r = newR;
+        newR = nextR;
+    }
+
+    return (uint32_t)(t < 0 ? t + (int)n : t);
+}
+
+// How the first two dimensions, which place samples in the pixel, are split between the pixels
+// of a MAX_HALTON_RESOLUTION square: 2^BaseExp0 strata in x and 3^BaseExp1 in y.
+struct HaltonPixelConstants
+{
+    uint32_t BaseScale0;
+    uint32_t BaseScale1;
+    uint32_t BaseExp0;
+    uint32_t BaseExp1;
+
+    // BaseScale1 inverted modulo BaseScale0, and BaseScale0 modulo BaseScale1.
+    uint32_t MultInv0;
+    uint32_t MultInv1;
+};
+
+inline HaltonPixelConstants ComputeHaltonPixelConstants(uint2 resolution)
+{
+    uint32_t maxX = resolution.x < MAX_HALTON_RESOLUTION ? resolution.x : MAX_HALTON_RESOLUTION;
+    uint32_t maxY = resolution.y < MAX_HALTON_RESOLUTION ? resolution.y : MAX_HALTON_RESOLUTION;
+
+    HaltonPixelConstants constants;
+    constants.BaseScale0 = 1;
+    constants.BaseExp0 = 0;
+
+    while (constants.BaseScale0 < maxX)
+    {
+        constants.BaseScale0 *= 2;
+        ++constants.BaseExp0;
+    }
+
+    constants.BaseScale1 = 1;
+    constants.BaseExp1 = 0;
+
+    while (constants.BaseScale1 < maxY)
+    {
+        constants.BaseScale1 *= 3;
+        ++constants.BaseExp1;
+    }
+
+    constants.MultInv0 = MultiplicativeInverse(constants.BaseScale1, constants.BaseScale0);
+    constants.MultInv1 = MultiplicativeInverse(constants.BaseScale0, constants.BaseScale1);
+
+    return constants;
+}
+
+struct HaltonSampler
+{
+    HaltonPixelConstants m_constants;
+
+    uint64_t m_haltonIdx;
+    uint32_t m_dimension;
+
+#ifdef HLSL
+    HaltonEntry LoadEntry(uint32_t dimension)
+    {
+        return g_haltonEntries[dimension];
+    }
+
+    uint32_t LoadPermutation(uint32_t idx)
+    {
+        return g_haltonPermutations.Load<uint16_t>(idx * 2);
+    }
+#else
+    const HaltonEntry* m_entries;
+    const uint16_t* m_permutations;
+
+    HaltonSampler(const HaltonEntry* entries, const uint16_t* permutations, uint2 resolution)
+        : m_entries(entries), m_permutations(permutations)
+    {
+        Init(resolution);
+    }
+
+    HaltonEntry LoadEntry(uint32_t dimension)
+    {
+        return m_entries[dimension];
+    }
+
+    uint32_t LoadPermutation(uint32_t idx)
+    {
+        return m_permutations[idx];
+    }
+#endif // #ifdef HLSL
+
+    // resolution is the film's, which decides how many pixels get distinct strata.
+    void Init(uint2 resolution)
+    {
+        m_constants = ComputeHaltonPixelConstants(resolution);
+        m_haltonIdx = 0;
+        m_dimension = 0;
+    }
+
+    void StartPixelSample(uint2 pixel, uint32_t sampleIdx)
+    {
+        uint64_t sampleStride = (uint64_t)m_constants.BaseScale0 * m_constants.BaseScale1;
+
+        m_haltonIdx = 0;
+
+        // Find the first index whose first two dimensions fall in this pixel's strata.
+        if (sampleStride > 1)
+        {
+            uint64_t dimOffset = InverseRadicalInverse(pixel.x % MAX_HALTON_RESOLUTION, 2,
+                                                       m_constants.BaseExp0);
+            m_haltonIdx +=
+                dimOffset * (sampleStride / m_constants.BaseScale0) * m_constants.MultInv0;
+
+            dimOffset = InverseRadicalInverse(pixel.y % MAX_HALTON_RESOLUTION, 3,
+                                              m_constants.BaseExp1);
+            m_haltonIdx +=
+                dimOffset * (sampleStride / m_constants.BaseScale1) * m_constants.MultInv1;
+
+            m_haltonIdx %= sampleStride;
+        }
+
+        m_haltonIdx += (uint64_t)sampleIdx * sampleStride;
+
+        m_dimension = 2;
+    }
+
+    // The sample's position in the pixel. Rather than dividing by BaseScale1, its digits are
+    // dropped one at a time.
+    float2 GetPixel2D()
+    {
+        uint64_t a = m_haltonIdx;
+
+        for (uint32_t i = 0; i < m_constants.BaseExp1; ++i)
+            a = DivideByMagic64(a, 3, BASE3_DIVISION_MAGIC, BASE3_DIVISION_SHIFT);
+
+        return float2(RadicalInverseBase2(m_haltonIdx >> m_constants.BaseExp0),
+                      RadicalInverseBase3(a));
+    }
+
+    float Get1D()
+    {
+        if (m_dimension >= HALTON_DIMENSION_COUNT)
+            m_dimension = 2;
+
+        return SampleDimension(m_dimension++);
+    }
+
+    float2 Get2D()
+    {
+        if (m_dimension + 1 >= HALTON_DIMENSION_COUNT)
+            m_dimension = 2;
+
+        uint32_t dimension = m_dimension;
+        m_dimension += 2;
+
+        return float2(SampleDimension(dimension), SampleDimension(dimension + 1));
+    }
+
+    // The radical inverse of the index in the dimension's base, with each digit permuted. Digits
+    // past the index's last one are zero but permuted too, down to float precision.
+    float SampleDimension(uint32_t dimension)
+    {
+        HaltonEntry entry = LoadEntry(dimension);
+
+        uint32_t base = entry.Prime;
+
+        float invBase = 1.f / (float)base;
+        float invBaseM = 1.f;
+
+        uint64_t reversedDigits = 0;
+        uint64_t a = m_haltonIdx;
+
+        uint32_t permOffset = entry.PermutationOffset;
+        uint32_t digitIdx = 0;
+
+        // Only indices of very high samples need 64 bits, and only for their leading digits.
+        for (; digitIdx < entry.DigitCount && (a >> 32) != 0; ++digitIdx)
+        {
+            uint64_t next =
+                DivideByMagic64(a, base, entry.DivisionMagic, entry.DivisionShift);
+            uint32_t digit = (uint32_t)(a - next * base);
+
+            reversedDigits = reversedDigits * base + LoadPermutation(permOffset + digit);
+            invBaseM *= invBase;
+            a = next;
+
+            permOffset += base;
+        }
+
+        uint32_t a32 = (uint32_t)a;
+
+        for (; digitIdx < entry.DigitCount; ++digitIdx)
+        {
+            uint32_t next = DivideByMagic(a32, entry.DivisionMagic, entry.DivisionShift);
+            uint32_t digit = a32 - next * base;
+
+            reversedDigits = reversedDigits * base + LoadPermutation(permOffset + digit);
+            invBaseM *= invBase;
+            a32 = next;
+
+            permOffset += base;
+        }
+
+        float inverse = (float)reversedDigits * invBaseM;
+
+        return inverse < ONE_MINUS_EPSILON ? inverse : ONE_MINUS_EPSILON;
+    }
+};
+
+#endif // SHADERS_HALTON_SAMPLER_H
@@ -0,0 +1,185 @@
+#ifndef SHADERS_LIGHT_SAMPLER_H
+#define SHADERS_LIGHT_SAMPLER_H
+
+// pbrt-v4's PowerLightSampler and BVHLightSampler for sphere lights, shared by Shader.hlsl and
+// the CPU backend. Their tables come from LightSamplerTables.h; in HLSL they are
+// g_lightAliasTable and g_lightBvh, which have to be declared before this header is included.
+
+#include "Common.h"
+#include "SamplerCommon.h"
+
+#ifndef HLSL
+#include <cmath>
+#endif // #ifndef HLSL
+
+// A picked light and the probability it was picked with, which is zero when none was.
+struct LightSample
+{
+    uint32_t LightIdx;
+    float Pmf;
+};
+
+inline LightSample MakeLightSample(uint32_t lightIdx, float pmf)
+{
+    LightSample sample;
+    sample.LightIdx = lightIdx;
+    sample.Pmf = pmf;
+
+    return sample;
+}
+
+inline float SafeSqrt(float x)
+{
+#ifdef HLSL
+    return sqrt(max(x, 0.f));
+#else
+    return x > 0.f ? std::sqrt(x) : 0.f;
+#endif // #ifdef HLSL
+}
+
+// pbrt-v4's LightBounds::Importance for lights that emit in every direction, as sphere lights do:
+// their power over the squared distance to the bounds, times the cosine of the smallest angle any
+// direction to the bounds makes with the normal n.
+inline float GetLightImportance(float3 boundsMin, float3 boundsMax, float phi, float3 p, float3 n)
+{
+    float3 toPoint = p - (boundsMin + boundsMax) / 2.f;
+    float3 diagonal = boundsMax - boundsMin;
+
+    float distanceSq = dot(toPoint, toPoint);
+    float radiusSq = dot(diagonal, diagonal) / 4.f;
+
+    // As in pbrt-v4, which keeps the distance of points inside the bounds from reaching zero.
+    float halfDiagonal = SafeSqrt(radiusSq);
+    float d2 = distanceSq > halfDiagonal ? distanceSq : halfDiagonal;
+
+    // Directions from inside the bounding sphere reach the bounds whatever the normal.
+    if (distanceSq <= radiusSq)
+        return phi / d2;
+
+    float cosThetaB = SafeSqrt(1.f - radiusSq / distanceSq);
+    float sinThetaB = SafeSqrt(1.f - cosThetaB * cosThetaB);
+
+    float cosThetaI = dot(toPoint, n) / SafeSqrt(distanceSq);
+    cosThetaI = cosThetaI < 0.f ? -cosThetaI : cosThetaI;
+    float sinThetaI = SafeSqrt(1.f - cosThetaI * cosThetaI);
+
+    // cos(max(0, thetaI - thetaB)).
+    float cosThetaPI = cosThetaI > cosThetaB ? 1.f : cosThetaI * cosThetaB + sinThetaI * sinThetaB;
+
+    return phi * cosThetaPI / d2;
+}
+
+struct LightSampler
+{
+    // LIGHT_SAMPLER_POWER or LIGHT_SAMPLER_BVH.
+    uint32_t m_type;
+
+    uint32_t m_lightCount;
+
+#ifdef HLSL
+    AliasBin LoadAliasBin(uint32_t idx)
+    {
+        return g_lightAliasTable[idx];
+    }
+
+    LightBvhNode LoadNode(uint32_t idx)
+    {
+        return g_lightBvh[idx];
+    }
+#else
+    const AliasBin* m_aliasTable;
+    const LightBvhNode* m_nodes;
+
+    LightSampler(uint32_t type, uint32_t lightCount, const AliasBin* aliasTable,
+                 const LightBvhNode* nodes)
+        : m_type(type), m_lightCount(lightCount), m_aliasTable(aliasTable), m_nodes(nodes)
+    {
+    }
+
+    AliasBin LoadAliasBin(uint32_t idx)
+    {
+        return m_aliasTable[idx];
+    }
+
+    LightBvhNode LoadNode(uint32_t idx)
+    {
+        return m_nodes[idx];
+    }
+#endif // #ifdef HLSL
+
+    // Picks a light for the shading point p with normal n.
+    LightSample Sample(float3 p, float3 n, float u)
+    {
+        if (m_lightCount == 0)
+            return MakeLightSample(0, 0.f);
+
+        if (m_type == LIGHT_SAMPLER_POWER)
+            return SamplePower(u);
+
+        return SampleBvh(p, n, u);
+    }
+
+    // AliasTable::Sample.
+    LightSample SamplePower(float u)
+    {
+        uint32_t offset = (uint32_t)(u * m_lightCount);
+        offset = offset < m_lightCount - 1 ? offset : m_lightCount - 1;
+
+        AliasBin bin = LoadAliasBin(offset);
+
+        if (u * m_lightCount - offset < bin.Q)
+            return MakeLightSample(offset, bin.Pmf);
+
+        return MakeLightSample(bin.Alias, LoadAliasBin(bin.Alias).Pmf);
+    }
+
+    // BVHLightSampler::Sample: down the tree, taking each child with a probability in proportion
+    // to its importance and reusing what is left of u for the next choice.
+    LightSample SampleBvh(float3 p, float3 n, float u)
+    {
+        uint32_t nodeIdx = 0;
+        float pmf = 1.f;
+
+        for (;;)
+        {
+            LightBvhNode node = LoadNode(nodeIdx);
+
+            if (node.IsLeaf != 0)
+            {
+                // Below the root, a leaf was only chosen if it matters.
+                if (nodeIdx > 0 || GetLightImportance(node.Min, node.Max, node.Phi, p, n) > 0.f)
+                    return MakeLightSample(node.ChildOrLightIdx, pmf);
+
+                return MakeLightSample(0, 0.f);
+            }
+
+            LightBvhNode first = LoadNode(nodeIdx + 1);
+            LightBvhNode second = LoadNode(node.ChildOrLightIdx);
+
+            float firstImportance = GetLightImportance(first.Min, first.Max, first.Phi, p, n);
+            float secondImportance = GetLightImportance(second.Min, second.Max, second.Phi, p, n);
+
+            if (firstImportance == 0.f && secondImportance == 0.f)
+                return MakeLightSample(0, 0.f);
+
+            float p0 = firstImportance / (firstImportance + secondImportance);
+
+            if (u < p0)
+            {
+                nodeIdx = nodeIdx + 1;
+                u = u / p0;
+                pmf *= p0;
+            }
+            else
+            {
+                nodeIdx = node.ChildOrLightIdx;
+                u = (u - p0) / (1.f - p0);
+                pmf *= 1.f - p0;
+            }
+
+            u = u < ONE_MINUS_EPSILON ? u : ONE_MINUS_EPSILON;
+        }
+    }
+};
+
+#endif // SHADERS_LIGHT_SAMPLER_H
@@ -0,0 +1,30 @@
+#include "Common.h"
+#include "FilmAccumulator.h"
+
+// Global descriptors, one table starting at the film RayGenShader accumulates into.
+
+RWTexture2D<float4> g_film : register(u0);
+RWTexture2D<float4> g_filmCompensation : register(u1);
+
+// R8G8B8A8_UNORM, copied to the swap chain.
+RWTexture2D<float4> g_display : register(u2);
+
+// Turns the accumulated samples into the displayed image. The means are only clamped, as in
+// PbrtCpu's PPM output.
+[numthreads(RESOLVE_GROUP_SIZE, RESOLVE_GROUP_SIZE, 1)]
+void ResolveShader(uint3 threadId : SV_DispatchThreadID)
+{
+    uint2 pixel = threadId.xy;
+
+    uint width, height;
+    g_display.GetDimensions(width, height);
+
+    if (pixel.x >= width || pixel.y >= height)
+        return;
+
+    FilmAccumulator film;
+    film.m_sum = g_film[pixel];
+    film.m_compensation = g_filmCompensation[pixel];
+
+    g_display[pixel] = float4(saturate(film.GetMean()), 1.f);
+}
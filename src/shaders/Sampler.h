@@ -0,0 +1,58 @@
+#ifndef SHADERS_SAMPLER_H
+#define SHADERS_SAMPLER_H
+
+// The sampler RayGenShader and the CPU backend draw from, one of SAMPLER_* picked at run time.
+// The choice is the same for a whole dispatch, so the branches never diverge.
+
+#include "HaltonSampler.h"
+#include "SobolSampler.h"
+
+struct Sampler
+{
+    uint32_t m_type;
+
+    HaltonSampler m_halton;
+    SobolSampler m_sobol;
+
+#ifndef HLSL
+    Sampler(uint32_t type, const HaltonSampler& halton, const SobolSampler& sobol)
+        : m_type(type), m_halton(halton), m_sobol(sobol)
+    {
+    }
+#endif // #ifndef HLSL
+
+    void StartPixelSample(uint2 pixel, uint32_t sampleIdx)
+    {
+        if (m_type == SAMPLER_HALTON)
+            m_halton.StartPixelSample(pixel, sampleIdx);
+        else
+            m_sobol.StartPixelSample(pixel, sampleIdx);
+    }
+
+    // Branches rather than ?:, which HLSL evaluates on both sides for vectors.
+    float2 GetPixel2D()
+    {
+        if (m_type == SAMPLER_HALTON)
+            return m_halton.GetPixel2D();
+
+        return m_sobol.GetPixel2D();
+    }
+
+    float Get1D()
+    {
+        if (m_type == SAMPLER_HALTON)
+            return m_halton.Get1D();
+
+        return m_sobol.Get1D();
+    }
+
+    float2 Get2D()
+    {
+        if (m_type == SAMPLER_HALTON)
+            return m_halton.Get2D();
+
+        return m_sobol.Get2D();
+    }
+};
+
+#endif // SHADERS_SAMPLER_H
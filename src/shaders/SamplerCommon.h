@@ -0,0 +1,111 @@
+#ifndef SHADERS_SAMPLER_COMMON_H
+#define SHADERS_SAMPLER_COMMON_H
+
+// Bit manipulation and hashing shared by the samplers, after pbrt-v4's.
+
+#include "Common.h"
+
+#ifndef HLSL
+#include <cstdint>
+#endif // #ifndef HLSL
+
+static const float ONE_MINUS_EPSILON = 0x1.fffffep-1f;
+
+inline uint32_t ReverseBits32(uint32_t v)
+{
+#ifdef HLSL
+    return reversebits(v);
+#else
+    v = (v << 16) | (v >> 16);
+    v = ((v & 0x00ff00ff) << 8) | ((v & 0xff00ff00) >> 8);
+    v = ((v & 0x0f0f0f0f) << 4) | ((v & 0xf0f0f0f0) >> 4);
+    v = ((v & 0x33333333) << 2) | ((v & 0xcccccccc) >> 2);
+    v = ((v & 0x55555555) << 1) | ((v & 0xaaaaaaaa) >> 1);
+
+    return v;
+#endif // #ifdef HLSL
+}
+
+inline uint64_t MixBits(uint64_t v)
+{
+    v ^= v >> 31;
+    v *= 0x7fb5d329728ea185ull;
+    v ^= v >> 27;
+    v *= 0x81dadef4bc2dd44dull;
+    v ^= v >> 33;
+
+    return v;
+}
+
+// Element i of a random permutation of [0, l) chosen by p, after Kensler's "Correlated
+// Multi-Jittered Sampling".
+inline uint32_t PermutationElement(uint32_t i, uint32_t l, uint32_t p)
+{
+    uint32_t w = l - 1;
+    w |= w >> 1;
+    w |= w >> 2;
+    w |= w >> 4;
+    w |= w >> 8;
+    w |= w >> 16;
+
+    do
+    {
+        i ^= p;
+        i *= 0xe170893d;
+        i ^= p >> 16;
+        i ^= (i & w) >> 4;
+        i ^= p >> 8;
+        i *= 0x0929eb3f;
+        i ^= p >> 23;
+        i ^= (i & w) >> 1;
+        i *= 1 | p >> 27;
+        i *= 0x6935fa69;
+        i ^= (i & w) >> 11;
+        i *= 0x74dcb303;
+        i ^= (i & w) >> 2;
+        i *= 0x9e501cc3;
+        i ^= (i & w) >> 2;
+        i *= 0xc860a3df;
+        i &= w;
+        i ^= i >> 5;
+    } while (i >= l);
+
+    return (i + p) % l;
+}
+
+static const uint64_t MURMUR_HASH_M = 0xc6a4a7935bd1e995ull;
+
+inline uint64_t MurmurHashBlock(uint64_t h, uint64_t k)
+{
+    k *= MURMUR_HASH_M;
+    k ^= k >> 47;
+    k *= MURMUR_HASH_M;
+
+    h ^= k;
+    h *= MURMUR_HASH_M;
+
+    return h;
+}
+
+inline uint64_t MurmurHashFinish(uint64_t h)
+{
+    h ^= h >> 47;
+    h *= MURMUR_HASH_M;
+    h ^= h >> 47;
+
+    return h;
+}
+
+// pbrt-v4's Hash of arguments that fill whole 8-byte blocks, which is MurmurHash64A of their bytes.
+// Blocks are read little endian, so the first of two 32-bit arguments is in the low bits.
+inline uint64_t HashWords(uint64_t k0)
+{
+    return MurmurHashFinish(MurmurHashBlock(8 * MURMUR_HASH_M, k0));
+}
+
+inline uint64_t HashWords(uint64_t k0, uint64_t k1)
+{
+    return MurmurHashFinish(MurmurHashBlock(MurmurHashBlock(16 * MURMUR_HASH_M, k0), k1));
+}
+
+#endif // SHADERS_SAMPLER_COMMON_H
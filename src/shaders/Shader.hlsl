@@ -4,26 +4,27 @@ struct RayPayload {
     float3 Normal;
     float3 Reflectance;
     float HitT;
+
+    // Of the ray being traced, which picks the mip level of the reflectance texture.
+    RayCone Cone;
 };
 
 typedef BuiltInTriangleIntersectionAttributes IntersectAttributes;
 
 struct VisibilityPayload {
-    float T;
+    bool Visible;
 };
 
 // Global descriptors.
 
-struct DrawConstants
-{
-    uint32_t SampleIndex;
-};
-
 RaytracingAccelerationStructure g_scene : register(t0);
 
+// FilmAccumulator's sum and compensation of every pixel.
 RWTexture2D<float4> g_film : register(u0);
+RWTexture2D<float4> g_filmCompensation : register(u1);
 
 ConstantBuffer<DrawConstants> g_drawConstants : register(b0);
+ConstantBuffer<CameraConstants> g_camera : register(b1);
 
 SamplerState g_sampler : register(s0);
 
@@ -32,114 +33,14 @@ StructuredBuffer<SphereLight> g_lights : register(t1);
 StructuredBuffer<HaltonEntry> g_haltonEntries : register(t2);
 ByteAddressBuffer g_haltonPermutations : register(t3);
 
-static const float ONE_MINUS_EPSILON = 0x1.fffffep-1;
-
-float RadicalInverse(int baseIdx, uint64_t a)
-{
-    uint base = g_haltonEntries[baseIdx].Prime;
-
-    float invBase = 1.f / (float)base;
-    float invBaseM = 1.f;
-
-    uint64_t reversedDigits = 0;
-
-    while (a)
-    {
-        uint64_t next = a / base;
-        uint64_t digit = a - next * base;
-
-        reversedDigits = reversedDigits * base + digit;
-        invBaseM *= invBase;
-        a = next;
-    }
-
-    return min((float)(reversedDigits) * invBaseM, ONE_MINUS_EPSILON);
-}
-
-float ScrambledRadicalInverse(int baseIdx, uint64_t a)
-{
-    uint base = g_haltonEntries[baseIdx].Prime;
-
-    float invBase = 1.f / (float)base;
-    float invBaseM = 1.f;
-
-    uint64_t reversedDigits = 0;
-
-    while (a)
-    {
-        uint64_t next = a / base;
-        uint64_t digit = a - next * base;
-
-        int permOffset = g_haltonEntries[baseIdx].PermutationOffset;
+StructuredBuffer<uint32_t> g_sobolMatrices : register(t4);
 
-        reversedDigits = reversedDigits * base +
-            g_haltonPermutations.Load<uint16_t>(permOffset + (int)digit);
-        invBaseM *= invBase;
-        a = next;
-    }
+StructuredBuffer<AliasBin> g_lightAliasTable : register(t5);
+StructuredBuffer<LightBvhNode> g_lightBvh : register(t6);
 
-    return min((float)(reversedDigits) * invBaseM, ONE_MINUS_EPSILON);
-}
-
-uint64_t InverseRadicalInverse(uint64_t inverse, int base, int numDigits)
-{
-    uint64_t idx = 0;
-
-    for (int i = 0; i < numDigits; ++i)
-    {
-        uint64_t digit = inverse % base;
-        inverse /= base;
-        idx = idx * base + digit;
-    }
-
-    return idx;
-}
-
-struct HaltonSampler
-{
-    float2 StartPixelSample(uint2 pixel, int sampleIdx)
-    {
-        // TODO: Calculate these properly.
-        static const int baseScale0 = 128;
-        static const int baseScale1 = 243;
-        static const int baseExp0 = 7;
-        static const int baseExp1 = 5;
-        static const int multInv0 = 59;
-        static const int multInv1 = 131;
-
-        int sampleStride = baseScale0 * baseScale1;
-
-        static const int maxHaltonResolution = 128;
-
-        m_haltonIdx = 0;
-
-        uint64_t dimOffset = InverseRadicalInverse(pixel.x % maxHaltonResolution, 2, baseExp0);
-        m_haltonIdx += dimOffset * (sampleStride / baseScale0) * multInv0;
-
-        dimOffset = InverseRadicalInverse(pixel.y % maxHaltonResolution, 3, baseExp1);
-        m_haltonIdx += dimOffset * (sampleStride / baseExp1) * multInv1;
-
-        m_haltonIdx %= sampleStride;
-
-        m_haltonIdx += sampleIdx * sampleStride;
-
-        m_dimension = 2;
-
-        return float2(RadicalInverse(0, m_haltonIdx >> baseExp0),
-                      RadicalInverse(1, m_haltonIdx / baseScale1));
-    }
-
-    float2 Get2D()
-    {
-        float2 res = float2(ScrambledRadicalInverse(m_dimension, m_haltonIdx),
-                            ScrambledRadicalInverse(m_dimension + 1, m_haltonIdx));
-        m_dimension += 2;
-        return res;
-    }
-
-    int64_t m_haltonIdx;
-    int m_dimension;
-};
+#include "FilmAccumulator.h"
+#include "LightSampler.h"
+#include "Sampler.h"
 
 static const float PI = 3.14159265358979323846f;
 
@@ -198,17 +99,19 @@ struct DiffuseSphereLight
         ray.Origin = p;
         ray.Direction = wi;
         ray.TMin = 0.001f;
-        ray.TMax = 10000.f;
-
-        float lightDist = distance(p, lightSamplePos);
+        ray.TMax = distance(p, lightSamplePos);
 
+        // Any hit before the light occludes it, so the search ends at the first one found and only
+        // the miss shader runs.
         VisibilityPayload payload;
-        payload.T = 1000000.f;
+        payload.Visible = false;
 
         // TODO: Consider if we can do an inline ray here.
-        TraceRay(g_scene, RAY_FLAG_NONE, ~0, 4, 1, 1, ray, payload);
+        TraceRay(g_scene,
+                 RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH | RAY_FLAG_SKIP_CLOSEST_HIT_SHADER, ~0, 4,
+                 1, 1, ray, payload);
 
-        visible = (payload.T >= lightDist);
+        visible = payload.Visible;
 
         return m_data.L;
     }
@@ -267,28 +170,47 @@ void Lambertian_Sample_f(float3 wo, float2 u, float3 n, out float3 wi, out float
 [shader("raygeneration")]
 void RayGenShader()
 {
-    float fov = 26.5f / 180.f * 3.142f;
+    float fov = g_camera.Fov / 180.f * 3.142f;
+
+    // The field of view spans the shorter side of the film.
+    float2 dimensions = (float2)DispatchRaysDimensions().xy;
+    float aspect = dimensions.x / dimensions.y;
 
     float maxScreenY = tan(fov / 2.f);
-    float maxScreenX = maxScreenY * (1024.f / 576.f);
+    float maxScreenX = maxScreenY * aspect;
+
+    if (aspect < 1.f)
+    {
+        maxScreenX = maxScreenY;
+        maxScreenY = maxScreenX / aspect;
+    }
 
     uint2 pixel = DispatchRaysIndex().xy;
     uint sampleIdx = g_drawConstants.SampleIndex;
 
-    HaltonSampler haltonSampler;
+    Sampler pixelSampler;
+    pixelSampler.m_type = g_drawConstants.SamplerType;
+    pixelSampler.m_halton.Init(DispatchRaysDimensions().xy);
+    pixelSampler.m_sobol.Init(g_drawConstants.SamplerType, DispatchRaysDimensions().xy,
+                              g_drawConstants.SamplesPerPixel, g_drawConstants.Seed);
+    pixelSampler.StartPixelSample(pixel, sampleIdx);
 
-    float2 filmOffset = haltonSampler.StartPixelSample(pixel, sampleIdx);
+    float2 filmOffset = pixelSampler.GetPixel2D();
 
     float2 filmPos = (float2)pixel + filmOffset;
 
+    // A pixel's footprint widens by about the angle it spans at the center of the film.
+    RayCone cone;
+    cone.Width = 0.f;
+    cone.SpreadAngle = atan(2.f * maxScreenY / dimensions.y);
+
     float3 rayDir =
-        normalize(float3(
-            lerp(-maxScreenX, maxScreenX, filmPos.x / (float)DispatchRaysDimensions().x),
-            lerp(maxScreenY, -maxScreenY, filmPos.y / (float)DispatchRaysDimensions().y),
-            -1.f));
+        normalize(lerp(-maxScreenX, maxScreenX, filmPos.x / dimensions.x) * g_camera.Right +
+                  lerp(maxScreenY, -maxScreenY, filmPos.y / dimensions.y) * g_camera.Up +
+                  g_camera.Forward);
 
     RayDesc ray;
-    ray.Origin = float3(0.f, 2.1088f, 13.574f);
+    ray.Origin = g_camera.Origin;
     ray.Direction = rayDir;
     ray.TMin = 0.1f;
     ray.TMax = 1000.f;
@@ -296,13 +218,22 @@ void RayGenShader()
     float3 L = float3(0.f, 0.f, 0.f);
     float3 throughput = float3(1.f, 1.f, 1.f);
 
-    static const int MAX_DEPTH = 3;
+    uint maxDepth = g_drawConstants.MaxDepth;
+    uint rouletteDepth = g_drawConstants.RouletteDepth;
+
+    LightSampler lightSampler;
+    lightSampler.m_type = g_drawConstants.LightSampler;
+    lightSampler.m_lightCount = g_drawConstants.LightCount;
+
+    uint lightSampleCount = lightSampler.m_type == LIGHT_SAMPLER_ALL ? g_drawConstants.LightCount
+                                                                    : g_drawConstants.LightSamples;
 
-    for (int depth = 1;; ++depth)
+    for (uint depth = 1;; ++depth)
     {
         RayPayload payload;
         payload.Reflectance = float3(0.5f, 0.5f, 0.5f);
         payload.HitT = ray.TMax;
+        payload.Cone = cone;
 
         TraceRay(g_scene, RAY_FLAG_CULL_BACK_FACING_TRIANGLES, ~0, 0, 1, 0, ray, payload);
 
@@ -314,45 +245,73 @@ void RayGenShader()
         // TODO: Use the right brdf.
         float3 f = payload.Reflectance / PI;
 
-        for (int i = 0; i < 2; ++i)
+        for (uint i = 0; i < lightSampleCount; ++i)
         {
+            uint lightIdx = i;
+            float weight = 1.f;
+
+            // Sampled lights are weighted by the inverse of how likely they were to be picked.
+            if (lightSampler.m_type != LIGHT_SAMPLER_ALL)
+            {
+                LightSample lightSample =
+                    lightSampler.Sample(position, payload.Normal, pixelSampler.Get1D());
+
+                if (lightSample.Pmf == 0.f)
+                    continue;
+
+                lightIdx = lightSample.LightIdx;
+                weight = 1.f / (lightSample.Pmf * lightSampleCount);
+            }
+
             DiffuseSphereLight light;
-            light.m_data = g_lights[i];
+            light.m_data = g_lights[lightIdx];
 
             float3 wi = float3(0.f, 0.f, 0.f);
             float pdf = 0.f;
             bool visible = false;
 
-            float3 Li = light.Sample_Li(position, haltonSampler.Get2D(), wi, pdf, visible);
+            float3 Li = light.Sample_Li(position, pixelSampler.Get2D(), wi, pdf, visible);
 
             if (visible)
             {
-                L += throughput * (f * Li * abs(dot(wi, payload.Normal)) / pdf);
+                L += weight * throughput * (f * Li * abs(dot(wi, payload.Normal)) / pdf);
             }
         }
 
-        if (depth == MAX_DEPTH)
+        if (depth == maxDepth)
             break;
 
         float3 wo = -ray.Direction;
 
         float3 wi = float3(0.f, 0.f, 0.f);
         float pdf = 0.f;
-        Lambertian_Sample_f(wo, haltonSampler.Get2D(), payload.Normal, wi, pdf);
+        Lambertian_Sample_f(wo, pixelSampler.Get2D(), payload.Normal, wi, pdf);
 
         if (pdf == 0.f)
             break;
 
+        throughput *= f * abs(dot(wi, payload.Normal)) / pdf;
+
+        // The survivors make up for the paths that end, so the estimate stays unbiased.
+        if (rouletteDepth != 0 && depth >= rouletteDepth)
+        {
+            float q = GetSurvivalProbability(throughput);
+
+            if (q < 1.f)
+            {
+                if (pixelSampler.Get1D() >= q)
+                    break;
+
+                throughput /= q;
+            }
+        }
+
         ray.Origin = position;
         ray.Direction = wi;
 
-        throughput *= f * abs(dot(wi, payload.Normal)) / pdf;
+        cone.Width = GetRayConeWidth(cone, payload.HitT);
     }
 
-    float3 prevFilmVal = g_film[pixel].rgb;
-
-    float N = (float)(sampleIdx + 1);
-
     static const float iso = 150.f;
     static const float exposureTime = 1.f;
 
@@ -360,51 +319,127 @@ void RayGenShader()
 
     float3 filmValue = imagingRatio * L;
 
-    g_film[pixel].rgb = ((N - 1.f) / N) * prevFilmVal + (1.f / N) * filmValue;
-    g_film[pixel].a = 1.f;
+    FilmAccumulator film;
+    film.m_sum = float4(0.f, 0.f, 0.f, 0.f);
+    film.m_compensation = float4(0.f, 0.f, 0.f, 0.f);
+
+    if (sampleIdx != 0)
+    {
+        film.m_sum = g_film[pixel];
+        film.m_compensation = g_filmCompensation[pixel];
+    }
+
+    film.Add(filmValue, 1.f);
+
+    g_film[pixel] = film.m_sum;
+    g_filmCompensation[pixel] = film.m_compensation;
 }
 
 // Hit group descriptors.
 
 ByteAddressBuffer g_indices: register(t0, space1);
 
-StructuredBuffer<float3> g_normals : register(t1, space1);
-StructuredBuffer<float2> g_uvs : register(t2, space1);
+// Laid out according to HitGroupGeometryConstants::VertexLayout. For the interleaved layout both
+// alias the vertex buffer, and for the quantized layout g_uvs aliases g_normals.
+ByteAddressBuffer g_normals : register(t1, space1);
+ByteAddressBuffer g_uvs : register(t2, space1);
 
 StructuredBuffer<HitGroupGeometryConstants> g_hitGroupGeomConstants : register(t3, space1);
 
 Texture2D g_texture : register(t4, space1);
 
+uint3 LoadTriangleIndices(uint primitiveIdx, uint indexSize)
+{
+    uint indexByteOffset = primitiveIdx * 3 * indexSize;
+
+    if (indexSize == 2)
+    {
+        return uint3(g_indices.Load<uint16_t>(indexByteOffset),
+                     g_indices.Load<uint16_t>(indexByteOffset + 2),
+                     g_indices.Load<uint16_t>(indexByteOffset + 4));
+    }
+
+    return g_indices.Load3(indexByteOffset);
+}
+
+float Snorm16ToFloat(uint value)
+{
+    return max(float(int(value << 16) >> 16) / 32767.f, -1.f);
+}
+
+float3 DecodeOctahedralNormal(uint encoded)
+{
+    float2 p = float2(Snorm16ToFloat(encoded & 0xffff), Snorm16ToFloat(encoded >> 16));
+
+    float3 n = float3(p, 1.f - abs(p.x) - abs(p.y));
+
+    if (n.z < 0.f)
+    {
+        float2 signs = float2(p.x >= 0.f ? 1.f : -1.f, p.y >= 0.f ? 1.f : -1.f);
+        n.xy = (1.f - abs(p.yx)) * signs;
+    }
+
+    return normalize(n);
+}
+
+void LoadVertexAttributes(uint vertexIdx, uint layout, out float3 normal, out float2 uv)
+{
+    if (layout == VERTEX_LAYOUT_INTERLEAVED)
+    {
+        uint offset = vertexIdx * 32;
+
+        normal = g_normals.Load<float3>(offset + 12);
+        uv = g_uvs.Load<float2>(offset + 24);
+    }
+    else if (layout == VERTEX_LAYOUT_QUANTIZED)
+    {
+        uint2 attributes = g_normals.Load2(vertexIdx * 8);
+
+        normal = DecodeOctahedralNormal(attributes.x);
+        uv = f16tof32(uint2(attributes.y & 0xffff, attributes.y >> 16));
+    }
+    else
+    {
+        normal = g_normals.Load<float3>(vertexIdx * 12);
+        uv = g_uvs.Load<float2>(vertexIdx * 8);
+    }
+}
+
 [shader("closesthit")]
 void ClosestHitShader(inout RayPayload payload, IntersectAttributes attr)
 {
-    // PrimitiveIndex() gives the index of the triangle in the mesh. Each triangle has 3 indices
-    // and each index takes up 4 bytes, so each triangle takes up 12 bytes.
-    uint indexByteOffset = PrimitiveIndex() * 12;
+    HitGroupGeometryConstants constants = g_hitGroupGeomConstants[GeometryIndex()];
 
-    uint indices[] = {g_indices.Load(indexByteOffset), g_indices.Load(indexByteOffset + 4),
-                      g_indices.Load(indexByteOffset + 8)};
+    // PrimitiveIndex() gives the index of the triangle in the mesh.
+    uint3 indices = LoadTriangleIndices(PrimitiveIndex(), constants.IndexSize);
 
-    float2 uv0 = g_uvs[indices[0]];
-    float2 uv1 = g_uvs[indices[1]];
-    float2 uv2 = g_uvs[indices[2]];
+    float3 n0, n1, n2;
+    float2 uv0, uv1, uv2;
 
-    float2 uv = uv0 + attr.barycentrics.x * (uv1 - uv0) + attr.barycentrics.y * (uv2 - uv0);
+    LoadVertexAttributes(indices[0], constants.VertexLayout, n0, uv0);
+    LoadVertexAttributes(indices[1], constants.VertexLayout, n1, uv1);
+    LoadVertexAttributes(indices[2], constants.VertexLayout, n2, uv2);
 
-    float3 n0 = g_normals[indices[0]];
-    float3 n1 = g_normals[indices[1]];
-    float3 n2 = g_normals[indices[2]];
+    float2 uv = uv0 + attr.barycentrics.x * (uv1 - uv0) + attr.barycentrics.y * (uv2 - uv0);
 
-    float4x4 normalMat = g_hitGroupGeomConstants[GeometryIndex()].NormalMatrix;
+    float4x4 normalMat = constants.NormalMatrix;
 
     payload.Normal = n0 + attr.barycentrics.x * (n1 - n0) + attr.barycentrics.y * (n2 - n0);
     payload.Normal = normalize(mul(normalMat, float4(payload.Normal, 0.f))).xyz;
 
     payload.HitT = RayTCurrent();
 
-    if (g_hitGroupGeomConstants[GeometryIndex()].IsTextured)
+    if (constants.IsTextured)
     {
-        payload.Reflectance = g_texture.SampleLevel(g_sampler, uv, 0).rgb;
+        float2 size;
+        float levelCount;
+        g_texture.GetDimensions(0, size.x, size.y, levelCount);
+
+        float lod = GetRayConeLod(GetRayConeWidth(payload.Cone, payload.HitT),
+                                  dot(WorldRayDirection(), payload.Normal), constants.UVLodOffset,
+                                  size);
+
+        payload.Reflectance = g_texture.SampleLevel(g_sampler, uv, lod).rgb;
     }
 }
 
@@ -413,15 +448,10 @@ void MissShader(inout RayPayload payload)
 {
 }
 
-[shader("closesthit")]
-void VisibilityClosestHitShader(inout VisibilityPayload payload, IntersectAttributes attr)
-{
-    payload.T = RayTCurrent();
-}
-
 [shader("miss")]
 void VisibilityMissShader(inout VisibilityPayload payload)
 {
+    payload.Visible = true;
 }
 
 struct SphereIntersectAttributes {
@@ -0,0 +1,235 @@
+#ifndef SHADERS_SOBOL_SAMPLER_H
+#define SHADERS_SOBOL_SAMPLER_H
+
+// pbrt-v4's PaddedSobolSampler and ZSobolSampler with RandomizeStrategy::FastOwen, shared by
+// Shader.hlsl and the CPU backend. Both pad the first two Sobol dimensions, scrambled differently
+// for every pair of sample dimensions, so they only need two generator matrices. They come from
+// Sobol.h; in HLSL they are bound as g_sobolMatrices, which has to be declared before this is
+// included.
+
+#include "Common.h"
+#include "SamplerCommon.h"
+
+#ifndef HLSL
+#include <cstdint>
+#endif // #ifndef HLSL
+
+// Columns of each generator matrix, one per bit of the sample index. Column i holds the 32 bits
+// of the sample that bit i of the index flips.
+static const uint32_t SOBOL_MATRIX_SIZE = 52;
+static const uint32_t SOBOL_DIMENSION_COUNT = 2;
+
+// The 24 permutations of a base 4 digit, two bits per digit, for shuffling ZSobol's Morton index.
+static const uint32_t ZSOBOL_PERMUTATIONS[24] = {
+    0xe4, 0xb4, 0xd8, 0x78, 0x6c, 0x9c, 0xe1, 0xb1, 0xc9, 0x39, 0x2d, 0x8d,
+    0xc6, 0x36, 0xd2, 0x72, 0x4e, 0x1e, 0x27, 0x87, 0x1b, 0x4b, 0x63, 0x93};
+
+// Laine and Karras's hash based approximation of Owen scrambling, as in pbrt-v4.
+inline uint32_t FastOwenScramble(uint32_t v, uint32_t seed)
+{
+    v = ReverseBits32(v);
+    v ^= v * 0x3d20adea;
+    v += seed;
+    v *= (seed >> 16) | 1;
+    v ^= v * 0x05526c56;
+    v ^= v * 0x53a22864;
+
+    return ReverseBits32(v);
+}
+
+// Spreads the low 32 bits of x out to the even bits.
+inline uint64_t LeftShift2(uint64_t x)
+{
+    x &= 0xffffffff;
+    x = (x ^ (x << 16)) & 0x0000ffff0000ffffull;
+    x = (x ^ (x << 8)) & 0x00ff00ff00ff00ffull;
+    x = (x ^ (x << 4)) & 0x0f0f0f0f0f0f0f0full;
+    x = (x ^ (x << 2)) & 0x3333333333333333ull;
+    x = (x ^ (x << 1)) & 0x5555555555555555ull;
+
+    return x;
+}
+
+inline uint64_t EncodeMorton2(uint32_t x, uint32_t y)
+{
+    return (LeftShift2(y) << 1) | LeftShift2(x);
+}
+
+inline uint32_t CeilLog2(uint32_t v)
+{
+    uint32_t log2 = 0;
+
+    while (log2 < 32 && (1u << log2) < v)
+        ++log2;
+
+    return log2;
+}
+
+struct SobolSampler
+{
+    // SAMPLER_PADDED_SOBOL or SAMPLER_ZSOBOL.
+    uint32_t m_type;
+    uint32_t m_seed;
+
+    uint32_t m_samplesPerPixel;
+
+    // ZSobol rounds the samples per pixel up to a power of two.
+    uint32_t m_log2SamplesPerPixel;
+    uint32_t m_base4DigitCount;
+
+    uint2 m_pixel;
+    uint32_t m_sampleIdx;
+    uint64_t m_mortonIdx;
+    uint32_t m_dimension;
+
+#ifdef HLSL
+    uint32_t LoadMatrixColumn(uint32_t idx)
+    {
+        return g_sobolMatrices[idx];
+    }
+#else
+    const uint32_t* m_matrices;
+
+    SobolSampler(const uint32_t* matrices, uint32_t type, uint2 resolution,
+                 uint32_t samplesPerPixel, uint32_t seed)
+        : m_matrices(matrices)
+    {
+        Init(type, resolution, samplesPerPixel, seed);
+    }
+
+    uint32_t LoadMatrixColumn(uint32_t idx)
+    {
+        return m_matrices[idx];
+    }
+#endif // #ifdef HLSL
+
+    void Init(uint32_t type, uint2 resolution, uint32_t samplesPerPixel, uint32_t seed)
+    {
+        m_type = type;
+        m_seed = seed;
+
+        uint32_t maxResolution = resolution.x > resolution.y ? resolution.x : resolution.y;
+
+        m_samplesPerPixel = samplesPerPixel;
+        m_log2SamplesPerPixel = CeilLog2(samplesPerPixel);
+        m_base4DigitCount = CeilLog2(maxResolution) + (m_log2SamplesPerPixel + 1) / 2;
+
+        m_pixel = uint2(0, 0);
+        m_sampleIdx = 0;
+        m_mortonIdx = 0;
+        m_dimension = 0;
+    }
+
+    void StartPixelSample(uint2 pixel, uint32_t sampleIdx)
+    {
+        m_pixel = pixel;
+        m_sampleIdx = sampleIdx;
+        m_mortonIdx = (EncodeMorton2(pixel.x, pixel.y) << m_log2SamplesPerPixel) | sampleIdx;
+        m_dimension = 0;
+    }
+
+    // The sample's position in the pixel, which is just the first two dimensions.
+    float2 GetPixel2D()
+    {
+        return Get2D();
+    }
+
+    float Get1D()
+    {
+        uint64_t sampleIdx;
+        uint64_t hash;
+
+        if (m_type == SAMPLER_ZSOBOL)
+        {
+            sampleIdx = GetZSobolSampleIndex();
+            ++m_dimension;
+            hash = HashWords(m_dimension | ((uint64_t)m_seed << 32));
+        }
+        else
+        {
+            hash = HashWords(m_pixel.x | ((uint64_t)m_pixel.y << 32),
+                             m_dimension | ((uint64_t)m_seed << 32));
+            sampleIdx = PermutationElement(m_sampleIdx, m_samplesPerPixel, (uint32_t)hash);
+            ++m_dimension;
+        }
+
+        return SobolSample(sampleIdx, 0, (uint32_t)hash);
+    }
+
+    float2 Get2D()
+    {
+        uint64_t sampleIdx;
+        uint64_t hash;
+
+        if (m_type == SAMPLER_ZSOBOL)
+        {
+            sampleIdx = GetZSobolSampleIndex();
+            m_dimension += 2;
+            hash = HashWords(m_dimension | ((uint64_t)m_seed << 32));
+        }
+        else
+        {
+            // Each pair of dimensions visits the pixel's samples in its own order. Otherwise they
+            // would all be scrambles of the same points, and so functions of each other.
+            hash = HashWords(m_pixel.x | ((uint64_t)m_pixel.y << 32),
+                             m_dimension | ((uint64_t)m_seed << 32));
+            sampleIdx = PermutationElement(m_sampleIdx, m_samplesPerPixel, (uint32_t)hash);
+            m_dimension += 2;
+        }
+
+        return float2(SobolSample(sampleIdx, 0, (uint32_t)hash),
+                      SobolSample(sampleIdx, 1, (uint32_t)(hash >> 32)));
+    }
+
+    float SobolSample(uint64_t a, uint32_t dimension, uint32_t seed)
+    {
+        uint32_t v = 0;
+
+        for (uint32_t i = dimension * SOBOL_MATRIX_SIZE; a != 0; a >>= 1, ++i)
+        {
+            if ((a & 1) != 0)
+                v ^= LoadMatrixColumn(i);
+        }
+
+        v = FastOwenScramble(v, seed);
+
+        float sample = (float)v * 0x1p-32f;
+
+        return sample < ONE_MINUS_EPSILON ? sample : ONE_MINUS_EPSILON;
+    }
+
+    // The index of the pixel's sample in a Sobol sequence shared by the whole film, which is laid
+    // out along a Morton curve. Shuffling its base 4 digits, differently for every dimension and
+    // every subtree of the curve, decorrelates neighbouring pixels into blue noise.
+    uint64_t GetZSobolSampleIndex()
+    {
+        uint64_t sampleIdx = 0;
+
+        // With an odd power of two samples per pixel, the lowest digit is base 2.
+        bool pow2Samples = (m_log2SamplesPerPixel & 1) != 0;
+        int lastDigit = pow2Samples ? 1 : 0;
+
+        for (int i = (int)m_base4DigitCount - 1; i >= lastDigit; --i)
+        {
+            int digitShift = 2 * i - (pow2Samples ? 1 : 0);
+            uint32_t digit = (uint32_t)(m_mortonIdx >> digitShift) & 3;
+
+            uint64_t higherDigits = m_mortonIdx >> (digitShift + 2);
+            uint64_t p = (MixBits(higherDigits ^ (0x55555555u * m_dimension)) >> 24) % 24;
+
+            digit = (ZSOBOL_PERMUTATIONS[(uint32_t)p] >> (2 * digit)) & 3;
+            sampleIdx |= (uint64_t)digit << digitShift;
+        }
+
+        if (pow2Samples)
+        {
+            uint64_t digit = m_mortonIdx & 1;
+            uint64_t higherDigits = m_mortonIdx >> 1;
+            sampleIdx |= digit ^ (MixBits(higherDigits ^ (0x55555555u * m_dimension)) & 1);
+        }
+
+        return sampleIdx;
+    }
+};
+
+#endif // SHADERS_SOBOL_SAMPLER_H